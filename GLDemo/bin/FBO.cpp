@@ -1,5 +1,7 @@
 #include <FBO.h>
 #include <glad/glad.h> 
+#include <glstate.h>
+#include <gpumemory.h>
 #include <string>
 #include <iostream>
 #include <vector>
@@ -9,18 +11,23 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 
-FBO::FBO(const GLuint& windowWidth, const GLuint& windowHeight, glm::vec3& lightPos) {
+FBO::FBO(const GLuint& windowWidth, const GLuint& windowHeight, glm::vec3& lightPos, StereoLayout layout)
+	: m_width(windowWidth), m_height(windowHeight), m_layout(layout), m_target(layout == STEREO_LAYERED ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D) {
+	//packed stereo layouts put the eyes next to each other in a single texture
+	GLsizei width = layout == STEREO_SIDE_BY_SIDE ? windowWidth * 2 : windowWidth;
+	GLsizei height = layout == STEREO_TOP_BOTTOM ? windowHeight * 2 : windowHeight;
 
 	//create framebuffer
 	glGenFramebuffers(1, &m_FBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, m_FBO);
 
 	//set up array and buffer objects for the screen quad
 	glGenVertexArrays(1, &m_scrVAO);
 	glGenBuffers(1, &m_scrVBO);
-	glBindVertexArray(m_scrVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_scrVBO);
+	GLState::bindVertexArray(m_scrVAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, m_scrVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+	GPUMemory::buffer(m_scrVBO, GPUMemory::MEMORY_FRAMEBUFFERS, sizeof(quadVertices));
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(1);
@@ -28,46 +35,132 @@ FBO::FBO(const GLuint& windowWidth, const GLuint& windowHeight, glm::vec3& light
 
 	//generate the texture to which the render output will be bound to
 	glGenTextures(1, &m_TCB);
-	glBindTexture(GL_TEXTURE_2D, m_TCB);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, windowWidth, windowHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_TCB, 0);
-
-	//create render-buffer object
-	glGenRenderbuffers(1, &m_RBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, m_RBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, windowWidth, windowHeight);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_RBO);
+	GLState::bindTexture(m_target, m_TCB);
+	if (layout == STEREO_LAYERED)
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, width, height, 2, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	else
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	GPUMemory::texture(m_TCB, m_target, GPUMemory::MEMORY_FRAMEBUFFERS, GL_RGB, width, height, layout == STEREO_LAYERED ? 2 : 1);
+	glTexParameteri(m_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(m_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	if (layout == STEREO_LAYERED) {
+		//renderbuffers can't have layers, so the depth goes into a texture array with a layer for every eye as well
+		glGenTextures(1, &m_depth);
+		GLState::bindTexture(GL_TEXTURE_2D_ARRAY, m_depth);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH24_STENCIL8, width, height, 2, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+		GPUMemory::texture(m_depth, GL_TEXTURE_2D_ARRAY, GPUMemory::MEMORY_FRAMEBUFFERS, GL_DEPTH24_STENCIL8, width, height, 2);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_TCB, 0);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, m_depth, 0);
+
+		//draws that aren't instanced for both eyes, such as the orbits and the HUD, are drawn into every layer through a framebuffer of its own
+		glGenFramebuffers(2, m_eyeFBO);
+		for (int eye = 0; eye < 2; eye++) {
+			GLState::bindFramebuffer(GL_FRAMEBUFFER, m_eyeFBO[eye]);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_TCB, 0, eye);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, m_depth, 0, eye);
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+				std::cout << "Framebuffer of eye " << eye << " is not complete" << std::endl;
+			}
+		}
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+
+		GLboolean stereo = GL_FALSE;
+		glGetBooleanv(GL_STEREO, &stereo);
+		m_quadBuffered = stereo == GL_TRUE;
+	} else {
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_TCB, 0);
+
+		//create render-buffer object
+		glGenRenderbuffers(1, &m_RBO);
+		GLState::bindRenderbuffer(m_RBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		GPUMemory::renderbuffer(m_RBO, GPUMemory::MEMORY_FRAMEBUFFERS, GL_DEPTH24_STENCIL8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_RBO);
+	}
 
 	//check if framebuffer setup was successful
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
 		std::cout << "Primary framebuffer is not complete" << std::endl;
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 //clear the screen and draw the screen texture stored in the framebuffer
-void FBO::drawTextureQuad(Shader& shader) {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glDisable(GL_DEPTH_TEST);
+void FBO::drawTextureQuad(Shader& shader, int screenWidth, int screenHeight) {
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+	//the framebuffer doesn't have to be the size of the window, f.e. while exporting video, the quad is stretched over the window either way
+	glViewport(0, 0, screenWidth, screenHeight);
+	GLState::disable(GL_DEPTH_TEST);
 	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	shader.use();
-	glBindVertexArray(m_scrVAO);
-	glBindTexture(GL_TEXTURE_2D, m_TCB);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+	GLState::bindVertexArray(m_scrVAO);
+	GLState::bindTexture(0, m_target, m_TCB);
+	if (m_layout != STEREO_LAYERED) {
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		return;
+	}
+
+	for (int eye = 0; eye < 2; eye++) {
+		shader.setInt("layer", eye);
+		if (m_quadBuffered) {
+			//GL_BACK is both back buffers of a stereo window, so both were cleared above
+			glDrawBuffer(eye == 0 ? GL_BACK_LEFT : GL_BACK_RIGHT);
+		} else {
+			glViewport(eye * screenWidth / 2, 0, screenWidth / 2, screenHeight);
+		}
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+	if (m_quadBuffered)
+		glDrawBuffer(GL_BACK);
 }
 
 //set the framebuffer to be active and enable depth testing again
 void FBO::enable() {
-	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
-	glEnable(GL_DEPTH_TEST);
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+	glViewport(0, 0, m_layout == STEREO_SIDE_BY_SIDE ? m_width * 2 : m_width, m_layout == STEREO_TOP_BOTTOM ? m_height * 2 : m_height);
+	GLState::enable(GL_DEPTH_TEST);
+}
+
+void FBO::selectEye(int eye) {
+	if (eye == ALL_EYES || m_layout == STEREO_OFF) {
+		enable();
+		return;
+	}
+	int x, y;
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, getEyeFramebuffer(eye, x, y));
+	glViewport(x, y, m_width, m_height);
+}
+
+int FBO::getEyes() const {
+	return m_layout == STEREO_OFF ? 1 : 2;
+}
+
+GLuint FBO::getFramebuffer() const {
+	return m_FBO;
+}
+
+//the left eye is on the left or at the top, like the vertex shaders put it (see stereo.glsl)
+GLuint FBO::getEyeFramebuffer(int eye, int& x, int& y) const {
+	x = m_layout == STEREO_SIDE_BY_SIDE && eye == 1 ? m_width : 0;
+	y = m_layout == STEREO_TOP_BOTTOM && eye == 0 ? m_height : 0;
+	return m_layout == STEREO_LAYERED ? m_eyeFBO[eye] : m_FBO;
 }
 
 FBO::~FBO() {
-	glDeleteVertexArrays(1, &m_scrVAO);
-	glDeleteBuffers(1, &m_scrVBO);
+	GLState::deleteVertexArrays(1, &m_scrVAO);
+	GLState::deleteBuffers(1, &m_scrVBO);
+	GLState::deleteFramebuffers(1, &m_FBO);
+	GLState::deleteTextures(1, &m_TCB);
+	if (m_layout == STEREO_LAYERED) {
+		GLState::deleteFramebuffers(2, m_eyeFBO);
+		GLState::deleteTextures(1, &m_depth);
+	} else {
+		GLState::deleteRenderbuffers(1, &m_RBO);
+	}
 }
\ No newline at end of file
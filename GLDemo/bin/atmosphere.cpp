@@ -0,0 +1,266 @@
+#include <glad/glad.h>
+
+#include <atmosphere.h>
+#include <glstate.h>
+#include <gpumemory.h>
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+const char * ATMOSPHERE_CACHE_PATH = "./bin/cache/atmosphere/";
+//bump this whenever the way the tables are computed changes, so stale cache files are ignored
+const uint32_t ATMOSPHERE_CACHE_VERSION = 1;
+const uint32_t ATMOSPHERE_CACHE_MAGIC = 0x4F4D5441; //"ATMO"
+
+//amount of integration steps along each ray
+const int TRANSMITTANCE_STEPS = 32;
+const int INSCATTER_STEPS = 32;
+
+//returns the distance along a ray starting at radius r with the given zenith cosine to the sphere with the given radius, or -1 if it misses
+static float raySphere(float r, float mu, float sphereRadius) {
+	float discriminant = r * r * (mu * mu - 1.0f) + sphereRadius * sphereRadius;
+	if (discriminant < 0.0f)
+		return -1.0f;
+	float root = std::sqrt(discriminant);
+	float near = -r * mu - root;
+	return near >= 0.0f ? near : -r * mu + root;
+}
+
+//the fraction of light that survives travelling from radius r towards the top of the atmosphere along the zenith cosine mu
+static glm::vec3 transmittance(const AtmosphereProfile& p, float r, float mu) {
+	//light that would have to travel through the planetoid doesn't arrive at all
+	if (mu < 0.0f && r * r * (mu * mu - 1.0f) + 1.0f >= 0.0f)
+		return glm::vec3(0.0f);
+
+	float length = raySphere(r, mu, 1.0f + p.height);
+	float step = length / TRANSMITTANCE_STEPS;
+	float rayleighDepth = 0.0f, mieDepth = 0.0f;
+	for (int i = 0; i < TRANSMITTANCE_STEPS; i++) {
+		//sample in the middle of each step, using the law of cosines to get the radius at that distance along the ray
+		float t = (i + 0.5f) * step;
+		float h = std::sqrt(r * r + t * t + 2.0f * r * t * mu) - 1.0f;
+		rayleighDepth += std::exp(-h / p.rayleighScaleHeight) * step;
+		mieDepth += std::exp(-h / p.mieScaleHeight) * step;
+	}
+	//mie particles also absorb a bit of light, so their extinction is slightly higher than their scattering
+	glm::vec3 depth = p.rayleighScattering * rayleighDepth + glm::vec3(p.mieScattering / 0.9f * mieDepth);
+	return glm::exp(-depth);
+}
+
+/*
+Integrates single scattering along a view ray that enters the atmosphere from above. The ray enters at the top of the atmosphere with zenith cosine
+mu, the Sun is at zenith cosine muS at that point and nu is the cosine of the angle between the view ray and the Sun. The phase functions are
+left out so they can be applied per fragment, which is why the angle between the view ray and the Sun only affects where the Sun is relative to each sample.
+The mie scattering is only stored for the red channel, the shader reconstructs the other channels from the ratio with the rayleigh scattering.
+*/
+static glm::vec4 inscatter(const AtmosphereProfile& p, float mu, float muS, float nu) {
+	float top = 1.0f + p.height;
+
+	//build the view and Sun direction in a frame where the entry point is straight up the Y-axis
+	float sinMu = std::sqrt(glm::max(0.0f, 1.0f - mu * mu));
+	glm::vec3 view(sinMu, mu, 0.0f);
+	float sinMuS = std::sqrt(glm::max(0.0f, 1.0f - muS * muS));
+	float sunX = sinMu > 0.0001f ? glm::clamp((nu - mu * muS) / sinMu, -sinMuS, sinMuS) : 0.0f;
+	glm::vec3 sun(sunX, muS, std::sqrt(glm::max(0.0f, 1.0f - sunX * sunX - muS * muS)));
+
+	//the view ray ends either on the ground or where it leaves the atmosphere again
+	float length = raySphere(top, mu, 1.0f);
+	if (length < 0.0f)
+		length = -2.0f * top * mu; //the far intersection with the sphere the ray starts on
+	if (length <= 0.0f)
+		return glm::vec4(0.0f);
+
+	glm::vec3 origin(0.0f, top, 0.0f);
+	float step = length / INSCATTER_STEPS;
+	glm::vec3 viewDepth(0.0f);
+	glm::vec3 rayleigh(0.0f), mie(0.0f);
+	for (int i = 0; i < INSCATTER_STEPS; i++) {
+		glm::vec3 point = origin + view * ((i + 0.5f) * step);
+		float r = glm::length(point);
+		float h = r - 1.0f;
+		float rayleighDensity = std::exp(-h / p.rayleighScaleHeight) * step;
+		float mieDensity = std::exp(-h / p.mieScaleHeight) * step;
+
+		//light is attenuated on the way from the Sun to the sample, and again on the way from the sample to the viewer
+		viewDepth += p.rayleighScattering * rayleighDensity + glm::vec3(p.mieScattering / 0.9f * mieDensity);
+		glm::vec3 attenuation = glm::exp(-viewDepth) * transmittance(p, r, glm::dot(point / r, sun));
+
+		rayleigh += attenuation * rayleighDensity;
+		mie += attenuation * mieDensity;
+	}
+	rayleigh *= p.rayleighScattering;
+	mie *= p.mieScattering;
+	return glm::vec4(rayleigh, mie.r);
+}
+
+static AtmosphereTables computeTables(const AtmosphereProfile& p) {
+	AtmosphereTables tables;
+
+	//the parameters are sampled at the texel centers so a linear texture lookup returns the exact value there
+	tables.transmittance.reserve(TRANSMITTANCE_WIDTH * TRANSMITTANCE_HEIGHT * 3);
+	for (int y = 0; y < TRANSMITTANCE_HEIGHT; y++) {
+		float r = 1.0f + (y + 0.5f) / TRANSMITTANCE_HEIGHT * p.height;
+		for (int x = 0; x < TRANSMITTANCE_WIDTH; x++) {
+			float mu = (x + 0.5f) / TRANSMITTANCE_WIDTH * 2.0f - 1.0f;
+			glm::vec3 t = transmittance(p, r, mu);
+			tables.transmittance.insert(tables.transmittance.end(), { t.r, t.g, t.b });
+		}
+	}
+
+	tables.inscatter.reserve(INSCATTER_MU * INSCATTER_MU_S * INSCATTER_NU * 4);
+	for (int z = 0; z < INSCATTER_NU; z++) {
+		float nu = (z + 0.5f) / INSCATTER_NU * 2.0f - 1.0f;
+		for (int y = 0; y < INSCATTER_MU_S; y++) {
+			float muS = (y + 0.5f) / INSCATTER_MU_S * 2.0f - 1.0f;
+			for (int x = 0; x < INSCATTER_MU; x++) {
+				//a view ray entering the atmosphere always points downwards, so mu only ranges from -1 to 0
+				float mu = (x + 0.5f) / INSCATTER_MU - 1.0f;
+				glm::vec4 s = inscatter(p, mu, muS, nu);
+				tables.inscatter.insert(tables.inscatter.end(), { s.r, s.g, s.b, s.a });
+			}
+		}
+	}
+	return tables;
+}
+
+//FNV-1a hash over everything that affects the contents of the tables
+static uint64_t hashProfile(const AtmosphereProfile& p) {
+	const float values[] = {
+		p.height, p.rayleighScattering.r, p.rayleighScattering.g, p.rayleighScattering.b, p.rayleighScaleHeight,
+		p.mieScattering, p.mieScaleHeight,
+		(float)TRANSMITTANCE_WIDTH, (float)TRANSMITTANCE_HEIGHT, (float)INSCATTER_MU, (float)INSCATTER_MU_S, (float)INSCATTER_NU,
+		(float)TRANSMITTANCE_STEPS, (float)INSCATTER_STEPS, (float)ATMOSPHERE_CACHE_VERSION
+	};
+	uint64_t hash = 14695981039346656037ull;
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+	for (size_t i = 0; i < sizeof(values); i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static std::string cachePath(const AtmosphereProfile& p) {
+	std::stringstream path;
+	path << ATMOSPHERE_CACHE_PATH << p.name << "_" << std::hex << hashProfile(p) << ".lut";
+	return path.str();
+}
+
+static bool loadCache(const std::string& path, AtmosphereTables& tables) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	uint32_t header[2];
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file || header[0] != ATMOSPHERE_CACHE_MAGIC || header[1] != ATMOSPHERE_CACHE_VERSION)
+		return false;
+
+	tables.transmittance.resize(TRANSMITTANCE_WIDTH * TRANSMITTANCE_HEIGHT * 3);
+	tables.inscatter.resize(INSCATTER_MU * INSCATTER_MU_S * INSCATTER_NU * 4);
+	file.read(reinterpret_cast<char*>(tables.transmittance.data()), tables.transmittance.size() * sizeof(float));
+	file.read(reinterpret_cast<char*>(tables.inscatter.data()), tables.inscatter.size() * sizeof(float));
+	return (bool)file;
+}
+
+static void saveCache(const std::string& path, const AtmosphereTables& tables) {
+	std::error_code error;
+	fs::create_directories(ATMOSPHERE_CACHE_PATH, error);
+
+	//write to a temporary file first so an interrupted write never leaves a corrupt cache file behind
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary);
+		if (!file) {
+			std::cout << "Couldn't write atmosphere cache: " << path << std::endl;
+			return;
+		}
+		const uint32_t header[2] = { ATMOSPHERE_CACHE_MAGIC, ATMOSPHERE_CACHE_VERSION };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(tables.transmittance.data()), tables.transmittance.size() * sizeof(float));
+		file.write(reinterpret_cast<const char*>(tables.inscatter.data()), tables.inscatter.size() * sizeof(float));
+	}
+	fs::rename(tempPath, path, error);
+}
+
+Atmosphere::Atmosphere(const AtmosphereProfile& profile) : profile(profile) {
+	//the profile is copied into the task so the worker thread never touches this object
+	pending = std::async(std::launch::async, [profile]() {
+		AtmosphereTables tables;
+		std::string path = cachePath(profile);
+		if (!loadCache(path, tables)) {
+			tables = computeTables(profile);
+			saveCache(path, tables);
+		}
+		return tables;
+	});
+}
+
+Atmosphere::~Atmosphere() {
+	//the destructor of the future waits for the worker thread to finish
+	GLState::deleteTextures(1, &transmittanceTex);
+	GLState::deleteTextures(1, &inscatterTex);
+}
+
+bool Atmosphere::poll() {
+	if (!ready && pending.valid() && pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		upload(pending.get());
+		ready = true;
+	}
+	return ready;
+}
+
+void Atmosphere::upload(const AtmosphereTables& tables) {
+	glGenTextures(1, &transmittanceTex);
+	GLState::bindTexture(GL_TEXTURE_2D, transmittanceTex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, 0, GL_RGB, GL_FLOAT, tables.transmittance.data());
+	GPUMemory::texture(transmittanceTex, GL_TEXTURE_2D, GPUMemory::MEMORY_ATMOSPHERES, GL_RGB16F, TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glGenTextures(1, &inscatterTex);
+	GLState::bindTexture(GL_TEXTURE_3D, inscatterTex);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, INSCATTER_MU, INSCATTER_MU_S, INSCATTER_NU, 0, GL_RGBA, GL_FLOAT, tables.inscatter.data());
+	GPUMemory::texture(inscatterTex, GL_TEXTURE_3D, GPUMemory::MEMORY_ATMOSPHERES, GL_RGBA16F, INSCATTER_MU, INSCATTER_MU_S, INSCATTER_NU);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void Atmosphere::setSurfaceUniforms(const Shader& shader, GLuint unit, const glm::vec3& center, float planetRadius) const {
+	GLState::bindTexture(unit, GL_TEXTURE_2D, transmittanceTex);
+
+	shader.setBool("atmosphere.enabled", true);
+	shader.setInt("atmosphere.transmittance", unit);
+	shader.setVec3("atmosphere.center", center);
+	shader.setFloat("atmosphere.planetRadius", planetRadius);
+	shader.setFloat("atmosphere.height", profile.height);
+}
+
+void Atmosphere::setShellUniforms(const Shader& shader, GLuint unit, const glm::vec3& center, float planetRadius) const {
+	GLState::bindTexture(unit, GL_TEXTURE_3D, inscatterTex);
+
+	shader.setInt("inscatter", unit);
+	shader.setVec3("center", center);
+	shader.setFloat("planetRadius", planetRadius);
+	shader.setFloat("height", profile.height);
+	shader.setVec3("rayleighScattering", profile.rayleighScattering);
+	shader.setFloat("mieG", profile.mieG);
+	shader.setFloat("sunIntensity", profile.sunIntensity);
+	//the shell is slightly larger than the top of the atmosphere so the outer edge isn't cut off by the tessellation of the sphere
+	shader.setMat4("model", glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(planetRadius * (1.0f + profile.height) * 1.02f)));
+}
+
+const AtmosphereProfile& Atmosphere::getProfile() const {
+	return profile;
+}
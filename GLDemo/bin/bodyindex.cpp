@@ -0,0 +1,89 @@
+#include <bodyindex.h>
+
+#include <algorithm>
+
+BodyIndex::BodyIndex(ThreadPool& pool, const std::vector<Planetoid*>& planetoids, const MinorPlanetCatalog* catalog, const MinorPlanets* minorPlanets)
+	: pool(pool), planetoids(planetoids), catalog(minorPlanets ? catalog : nullptr), minorPlanets(minorPlanets), bvh(pool) {
+	bvh.bodies.resize(planetoids.size() + (this->catalog ? this->catalog->size() : 0));
+}
+
+BodyIndex::~BodyIndex() {
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this] { return !updating; });
+}
+
+bool BodyIndex::ready() const {
+	return !updating.load(std::memory_order_acquire);
+}
+
+void BodyIndex::finishUpdate() {
+	bvh.refit();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		updating.store(false, std::memory_order_release);
+	}
+	condition.notify_all();
+}
+
+void BodyIndex::update(const glm::vec3& sunPos, double days) {
+	//the planetoids are moved by the simulation on the render thread, so they're copied here
+	for (size_t i = 0; i < planetoids.size(); i++) {
+		bvh.bodies[i] = glm::vec4(planetoids[i]->position, planetoids[i]->getRadius());
+	}
+	updating = true;
+	size_t count = catalog ? catalog->size() : 0;
+	if (count == 0) {
+		pool.submit([this]() { finishUpdate(); });
+		return;
+	}
+
+	int chunks = (int)std::max(1u, pool.size());
+	remainingChunks = chunks;
+	size_t first = planetoids.size();
+	for (int chunk = 0; chunk < chunks; chunk++) {
+		size_t begin = count * chunk / chunks;
+		size_t end = count * (chunk + 1) / chunks;
+		pool.submit([this, sunPos, days, first, begin, end]() {
+			//the asteroids have no size, they're found by the spread of a pick instead
+			for (size_t i = begin; i < end; i++) {
+				bvh.bodies[first + i] = glm::vec4(minorPlanets->position(*catalog, i, sunPos, days), 0.0f);
+			}
+			if (--remainingChunks == 0)
+				finishUpdate();
+		});
+	}
+}
+
+BodyHit BodyIndex::toBodyHit(const BVH::Hit& hit) const {
+	BodyHit body;
+	if (hit.body < planetoids.size())
+		body.planetoid = (int)hit.body;
+	else
+		body.asteroid = hit.body - planetoids.size();
+	body.distance = hit.distance;
+	return body;
+}
+
+bool BodyIndex::pick(const glm::vec3& origin, const glm::vec3& direction, float spread, BodyHit& hit) const {
+	BVH::Hit found;
+	if (!bvh.raycast(origin, direction, spread, found))
+		return false;
+	hit = toBodyHit(found);
+	return true;
+}
+
+bool BodyIndex::nearest(const glm::vec3& point, float maxDistance, BodyHit& hit) const {
+	BVH::Hit found;
+	if (!bvh.nearest(point, maxDistance, found))
+		return false;
+	hit = toBodyHit(found);
+	return true;
+}
+
+void BodyIndex::within(const glm::vec3& point, float radius, std::vector<BodyHit>& hits) const {
+	std::vector<BVH::Hit> found;
+	bvh.within(point, radius, found);
+	for (const BVH::Hit& hit : found) {
+		hits.push_back(toBodyHit(hit));
+	}
+}
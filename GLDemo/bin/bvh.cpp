@@ -0,0 +1,380 @@
+#include <bvh.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+//the most bodies in a leaf
+const uint32_t MAX_LEAF_SIZE = 4;
+//subtrees with at least this many bodies are built by a job of their own
+const uint32_t PARALLEL_BUILD_SIZE = 16 * 1024;
+//candidate splits along every axis for the surface area heuristic
+const int BUILD_BINS = 16;
+//nodes this deep are split at the median instead, which keeps the tree shallow enough for the QUERY_STACK_SIZE entries of the queries
+const int MAX_SAH_DEPTH = 48;
+const int QUERY_STACK_SIZE = 128;
+
+struct BVHNode {
+	glm::vec3 min;
+	//the first index of the bodies of a leaf, or the first of the two children of an inner node, which are always next to each other
+	uint32_t first;
+	glm::vec3 max;
+	uint32_t count; //of the bodies in a leaf, 0 for inner nodes
+};
+
+//children are always stored after their parent, so going through the nodes backwards visits every child before its parent
+struct BVHTree {
+	std::vector<BVHNode> nodes;
+	std::vector<uint32_t> indices;
+	float builtCost = 0.0f;
+	float cost = 0.0f;
+};
+
+struct BVHBuild {
+	std::vector<glm::vec4> bodies;
+	BVHTree tree;
+	std::atomic<uint32_t> nodeCount{ 1 };
+	//the job that finishes last completes the tree
+	std::atomic<int> jobs{ 1 };
+	std::atomic<bool> done{ false };
+};
+
+struct Bounds {
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	void grow(const glm::vec3& point) {
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+	void grow(const glm::vec4& body) {
+		min = glm::min(min, glm::vec3(body) - body.w);
+		max = glm::max(max, glm::vec3(body) + body.w);
+	}
+	void grow(const Bounds& bounds) {
+		min = glm::min(min, bounds.min);
+		max = glm::max(max, bounds.max);
+	}
+	//half the surface area, which is all the heuristic needs
+	float area() const {
+		glm::vec3 size = max - min;
+		return size.x < 0.0f ? 0.0f : size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+};
+
+static float nodeArea(const BVHNode& node) {
+	glm::vec3 size = node.max - node.min;
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+//the surface area heuristic: the expected amount of nodes and bodies a ray through the root visits, which is what overlapping boxes make worse
+static float treeCost(const BVHTree& tree) {
+	float rootArea = nodeArea(tree.nodes[0]);
+	if (rootArea <= 0.0f)
+		return 1.0f;
+	double cost = 0.0;
+	for (const BVHNode& node : tree.nodes) {
+		cost += nodeArea(node) * (node.count > 0 ? node.count : 1);
+	}
+	return (float)(cost / rootArea);
+}
+
+static void finishJob(BVHBuild& build) {
+	if (--build.jobs > 0)
+		return;
+	build.tree.nodes.resize(build.nodeCount);
+	build.tree.builtCost = build.tree.cost = treeCost(build.tree);
+	build.done.store(true, std::memory_order_release);
+}
+
+static int binOf(float center, float min, float scale) {
+	return std::min(BUILD_BINS - 1, (int)((center - min) * scale));
+}
+
+/*
+Builds the subtree of the bodies from begin to end into the given node with the binned surface area heuristic: the centers are sorted into
+bins along every axis, and the split between two bins with the lowest cost is taken. The right half of a large subtree is handed to another
+job and the left half is built in place.
+*/
+static void buildNode(const std::shared_ptr<BVHBuild>& build, ThreadPool& pool, uint32_t nodeIndex, uint32_t begin, uint32_t end, int depth) {
+	std::vector<glm::vec4>& bodies = build->bodies;
+	std::vector<uint32_t>& indices = build->tree.indices;
+	for (;; depth++) {
+		Bounds bounds, centers;
+		for (uint32_t i = begin; i < end; i++) {
+			bounds.grow(bodies[indices[i]]);
+			centers.grow(glm::vec3(bodies[indices[i]]));
+		}
+		BVHNode& node = build->tree.nodes[nodeIndex];
+		node.min = bounds.min;
+		node.max = bounds.max;
+		uint32_t count = end - begin;
+		if (count <= MAX_LEAF_SIZE) {
+			node.first = begin;
+			node.count = count;
+			return;
+		}
+
+		int bestAxis = -1, bestBin = 0;
+		float bestCost = FLT_MAX;
+		for (int axis = 0; axis < 3 && depth < MAX_SAH_DEPTH; axis++) {
+			float extent = centers.max[axis] - centers.min[axis];
+			if (extent <= 0.0f)
+				continue;
+			float scale = BUILD_BINS / extent;
+			Bounds bins[BUILD_BINS];
+			uint32_t binCounts[BUILD_BINS] = {};
+			for (uint32_t i = begin; i < end; i++) {
+				const glm::vec4& body = bodies[indices[i]];
+				int bin = binOf(body[axis], centers.min[axis], scale);
+				bins[bin].grow(body);
+				binCounts[bin]++;
+			}
+			//the cost of every split is the area of both sides times the bodies in them
+			float rightAreas[BUILD_BINS];
+			uint32_t rightCounts[BUILD_BINS];
+			Bounds right;
+			uint32_t rightCount = 0;
+			for (int bin = BUILD_BINS - 1; bin > 0; bin--) {
+				right.grow(bins[bin]);
+				rightCount += binCounts[bin];
+				rightAreas[bin] = right.area();
+				rightCounts[bin] = rightCount;
+			}
+			Bounds left;
+			uint32_t leftCount = 0;
+			for (int bin = 0; bin < BUILD_BINS - 1; bin++) {
+				left.grow(bins[bin]);
+				leftCount += binCounts[bin];
+				float cost = left.area() * leftCount + rightAreas[bin + 1] * rightCounts[bin + 1];
+				if (leftCount > 0 && rightCounts[bin + 1] > 0 && cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = bin;
+				}
+			}
+		}
+
+		uint32_t middle = begin + count / 2;
+		if (bestAxis >= 0) {
+			float min = centers.min[bestAxis];
+			float scale = BUILD_BINS / (centers.max[bestAxis] - min);
+			middle = (uint32_t)(std::partition(indices.begin() + begin, indices.begin() + end, [&](uint32_t index) {
+				return binOf(bodies[index][bestAxis], min, scale) <= bestBin;
+			}) - indices.begin());
+		} else if (depth >= MAX_SAH_DEPTH) {
+			int axis = 0;
+			glm::vec3 extent = centers.max - centers.min;
+			if (extent.y > extent[axis])
+				axis = 1;
+			if (extent.z > extent[axis])
+				axis = 2;
+			std::nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end, [&](uint32_t a, uint32_t b) {
+				return bodies[a][axis] < bodies[b][axis];
+			});
+		}
+		//otherwise all centers are in the same place and the bodies are split in half as they are
+
+		uint32_t children = build->nodeCount.fetch_add(2);
+		node.first = children;
+		node.count = 0;
+		if (end - middle >= PARALLEL_BUILD_SIZE) {
+			build->jobs++;
+			pool.submit([build, &pool, children, middle, end, depth]() {
+				buildNode(build, pool, children + 1, middle, end, depth + 1);
+				finishJob(*build);
+			});
+		} else {
+			buildNode(build, pool, children + 1, middle, end, depth + 1);
+		}
+		nodeIndex = children;
+		end = middle;
+	}
+}
+
+BVH::BVH(ThreadPool& pool) : pool(pool) {
+}
+
+//a rebuild that's still running finishes on its own, it only uses its own copy of the bodies
+BVH::~BVH() {
+}
+
+void BVH::startBuild() {
+	build = std::make_shared<BVHBuild>();
+	build->bodies = bodies;
+	uint32_t count = (uint32_t)bodies.size();
+	build->tree.indices.resize(count);
+	std::iota(build->tree.indices.begin(), build->tree.indices.end(), 0);
+	//a binary tree never has more than twice as many nodes as bodies
+	build->tree.nodes.resize(2 * (size_t)count);
+
+	std::shared_ptr<BVHBuild> job = build;
+	ThreadPool& pool = this->pool;
+	pool.submit([job, &pool, count]() {
+		buildNode(job, pool, 0, 0, count, 0);
+		finishJob(*job);
+	});
+}
+
+void BVH::refit() {
+	//a finished rebuild was built from where the bodies were a few frames ago, it's refit to where they are now like the tree it replaces
+	if (build && build->done.load(std::memory_order_acquire)) {
+		if (build->bodies.size() == bodies.size())
+			tree.reset(new BVHTree(std::move(build->tree)));
+		build.reset();
+	}
+	if (tree && tree->indices.size() != bodies.size())
+		tree.reset();
+	if (bodies.empty())
+		return;
+	if (!tree) {
+		if (!build)
+			startBuild();
+		return;
+	}
+
+	//the cost is summed up along the way, the same as treeCost does
+	double cost = 0.0;
+	for (size_t i = tree->nodes.size(); i-- > 0;) {
+		BVHNode& node = tree->nodes[i];
+		Bounds bounds;
+		if (node.count > 0) {
+			for (uint32_t j = node.first; j < node.first + node.count; j++) {
+				bounds.grow(bodies[tree->indices[j]]);
+			}
+		} else {
+			bounds.min = glm::min(tree->nodes[node.first].min, tree->nodes[node.first + 1].min);
+			bounds.max = glm::max(tree->nodes[node.first].max, tree->nodes[node.first + 1].max);
+		}
+		node.min = bounds.min;
+		node.max = bounds.max;
+		cost += nodeArea(node) * (node.count > 0 ? node.count : 1);
+	}
+	float rootArea = nodeArea(tree->nodes[0]);
+	tree->cost = rootArea > 0.0f ? (float)(cost / rootArea) : 1.0f;
+	if (!build && getDegradation() > REBUILD_DEGRADATION)
+		startBuild();
+}
+
+float BVH::getDegradation() const {
+	return tree && tree->builtCost > 0.0f ? tree->cost / tree->builtCost : 1.0f;
+}
+
+//the distance along the ray where it enters the box, or a negative number when it misses it or enters it past maxDistance
+static float enterBox(const BVHNode& node, const glm::vec3& origin, const glm::vec3& inverse, float spread, float maxDistance) {
+	//the box is grown by how far the cone has spread by its farthest corner, so the cone never touches a body the grown box doesn't contain
+	glm::vec3 farthest = glm::max(glm::abs(origin - node.min), glm::abs(origin - node.max));
+	float margin = spread * glm::length(farthest);
+	glm::vec3 nearPlanes = (node.min - margin - origin) * inverse;
+	glm::vec3 farPlanes = (node.max + margin - origin) * inverse;
+	glm::vec3 enter = glm::min(nearPlanes, farPlanes);
+	glm::vec3 exit = glm::max(nearPlanes, farPlanes);
+	float enterDistance = std::max(std::max(enter.x, enter.y), std::max(enter.z, 0.0f));
+	float exitDistance = std::min(std::min(exit.x, exit.y), std::min(exit.z, maxDistance));
+	return enterDistance <= exitDistance ? enterDistance : -1.0f;
+}
+
+bool BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float spread, Hit& hit) const {
+	if (!tree)
+		return false;
+	glm::vec3 inverse = 1.0f / direction;
+	float best = FLT_MAX;
+	bool found = false;
+	uint32_t stack[QUERY_STACK_SIZE];
+	int size = 0;
+	stack[size++] = 0;
+	while (size > 0) {
+		const BVHNode& node = tree->nodes[stack[--size]];
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				uint32_t index = tree->indices[i];
+				glm::vec3 toCenter = glm::vec3(bodies[index]) - origin;
+				float distance = glm::dot(toCenter, direction);
+				if (distance < 0.0f || distance >= best)
+					continue;
+				if (glm::length(toCenter - direction * distance) <= bodies[index].w + spread * distance) {
+					best = distance;
+					hit.body = index;
+					found = true;
+				}
+			}
+			continue;
+		}
+		//the nearer child is visited first, as whatever it hits makes the other one more likely to be skipped
+		float left = enterBox(tree->nodes[node.first], origin, inverse, spread, best);
+		float right = enterBox(tree->nodes[node.first + 1], origin, inverse, spread, best);
+		if (left >= 0.0f && right >= 0.0f) {
+			stack[size++] = left < right ? node.first + 1 : node.first;
+			stack[size++] = left < right ? node.first : node.first + 1;
+		} else if (left >= 0.0f) {
+			stack[size++] = node.first;
+		} else if (right >= 0.0f) {
+			stack[size++] = node.first + 1;
+		}
+	}
+	hit.distance = best;
+	return found;
+}
+
+static float boxDistance(const BVHNode& node, const glm::vec3& point) {
+	return glm::length(glm::max(glm::max(node.min - point, point - node.max), glm::vec3(0.0f)));
+}
+
+bool BVH::nearest(const glm::vec3& point, float maxDistance, Hit& hit) const {
+	if (!tree)
+		return false;
+	float best = maxDistance;
+	bool found = false;
+	uint32_t stack[QUERY_STACK_SIZE];
+	int size = 0;
+	stack[size++] = 0;
+	while (size > 0) {
+		const BVHNode& node = tree->nodes[stack[--size]];
+		if (boxDistance(node, point) > best)
+			continue;
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				uint32_t index = tree->indices[i];
+				float distance = std::max(glm::length(glm::vec3(bodies[index]) - point) - bodies[index].w, 0.0f);
+				if (distance <= best) {
+					best = distance;
+					hit.body = index;
+					found = true;
+				}
+			}
+			continue;
+		}
+		float left = boxDistance(tree->nodes[node.first], point);
+		float right = boxDistance(tree->nodes[node.first + 1], point);
+		stack[size++] = left < right ? node.first + 1 : node.first;
+		stack[size++] = left < right ? node.first : node.first + 1;
+	}
+	hit.distance = best;
+	return found;
+}
+
+void BVH::within(const glm::vec3& point, float radius, std::vector<Hit>& hits) const {
+	if (!tree)
+		return;
+	uint32_t stack[QUERY_STACK_SIZE];
+	int size = 0;
+	stack[size++] = 0;
+	while (size > 0) {
+		const BVHNode& node = tree->nodes[stack[--size]];
+		if (boxDistance(node, point) > radius)
+			continue;
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				uint32_t index = tree->indices[i];
+				float distance = std::max(glm::length(glm::vec3(bodies[index]) - point) - bodies[index].w, 0.0f);
+				if (distance <= radius)
+					hits.push_back({ index, distance });
+			}
+			continue;
+		}
+		stack[size++] = node.first;
+		stack[size++] = node.first + 1;
+	}
+}
@@ -0,0 +1,110 @@
+#include <ctex.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+//the header as it's stored on disk, followed by a CTexFileLevel for every level
+struct CTexHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+struct CTexFileLevel {
+	uint64_t offset; //from the start of the file
+	uint64_t size;
+};
+
+size_t ctexBlockSize(CTexFormat format) {
+	return format == CTEX_BC1 || format == CTEX_BC4 ? 8 : 16;
+}
+
+size_t ctexLevelSize(CTexFormat format, int width, int height) {
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * ctexBlockSize(format);
+}
+
+GLenum ctexGLFormat(CTexFormat format) {
+	switch (format) {
+	case CTEX_BC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case CTEX_BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case CTEX_BC4:
+		return GL_COMPRESSED_RED_RGTC1;
+	case CTEX_BC5:
+		return GL_COMPRESSED_RG_RGTC2;
+	}
+	return 0;
+}
+
+bool readCompressedImage(const std::string& path, CompressedImage& image) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	CTexHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != CTEX_MAGIC || header.version != CTEX_VERSION
+		|| header.format < CTEX_BC1 || header.format > CTEX_BC5 || header.levels == 0 || header.levels > 32) {
+		std::cout << "Compressed texture has an invalid header: " << path << std::endl;
+		return false;
+	}
+	image.format = (CTexFormat)header.format;
+	image.width = (int)header.width;
+	image.height = (int)header.height;
+	image.flags = header.flags;
+
+	std::vector<CTexFileLevel> table(header.levels);
+	file.read(reinterpret_cast<char*>(table.data()), table.size() * sizeof(CTexFileLevel));
+	size_t dataStart = sizeof(CTexHeader) + table.size() * sizeof(CTexFileLevel);
+
+	//the levels follow each other directly, so the block data can be read in one go
+	file.seekg(0, std::ios::end);
+	size_t fileSize = (size_t)file.tellg();
+	if (!file || fileSize < dataStart) {
+		std::cout << "Compressed texture is truncated: " << path << std::endl;
+		return false;
+	}
+	image.data.resize(fileSize - dataStart);
+	file.seekg(dataStart);
+	file.read(reinterpret_cast<char*>(image.data.data()), image.data.size());
+
+	image.levels.clear();
+	int width = image.width, height = image.height;
+	for (const CTexFileLevel& level : table) {
+		size_t offset = (size_t)level.offset - dataStart;
+		if (level.offset < dataStart || offset + level.size > image.data.size() || level.size != ctexLevelSize(image.format, width, height)) {
+			std::cout << "Compressed texture has an invalid level table: " << path << std::endl;
+			return false;
+		}
+		image.levels.push_back({ width, height, offset, (size_t)level.size });
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return true;
+}
+
+bool writeCompressedImage(const std::string& path, const CompressedImage& image) {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		std::cout << "Couldn't write compressed texture: " << path << std::endl;
+		return false;
+	}
+
+	CTexHeader header = { CTEX_MAGIC, CTEX_VERSION, (uint32_t)image.format, (uint32_t)image.width, (uint32_t)image.height,
+		(uint32_t)image.levels.size(), image.flags, 0 };
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	size_t dataStart = sizeof(CTexHeader) + image.levels.size() * sizeof(CTexFileLevel);
+	for (const CTexLevel& level : image.levels) {
+		CTexFileLevel entry = { dataStart + level.offset, level.size };
+		file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+	}
+	file.write(reinterpret_cast<const char*>(image.data.data()), image.data.size());
+	return (bool)file;
+}
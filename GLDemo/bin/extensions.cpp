@@ -0,0 +1,86 @@
+#include <glad/glad.h>
+
+#include <extensions.h>
+
+#include <set>
+
+namespace GLExtensions {
+	static std::set<std::string> extensions;
+	static int glVersion = 33;
+
+	bool programBinary = false;
+	PFNGLGETPROGRAMBINARYPROC GetProgramBinary = nullptr;
+	PFNGLPROGRAMBINARYPROC ProgramBinary = nullptr;
+	PFNGLPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+
+	bool parallelShaderCompile = false;
+	PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreads = nullptr;
+
+	bool textureCompressionS3TC = false;
+
+	bool bufferStorage = false;
+	PFNGLBUFFERSTORAGEPROC BufferStorage = nullptr;
+
+	bool vertexShaderLayer = false;
+
+	bool memoryInfoNVX = false;
+	bool memoryInfoATI = false;
+
+	void load(GLADloadproc loader) {
+		GLint major, minor, count;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		glVersion = major * 10 + minor;
+
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++) {
+			extensions.insert((const char*)glGetStringi(GL_EXTENSIONS, i));
+		}
+
+		//program binaries are only useful when the driver supports at least one binary format
+		if (glVersion >= 41 || has("GL_ARB_get_program_binary")) {
+			GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)loader("glGetProgramBinary");
+			ProgramBinary = (PFNGLPROGRAMBINARYPROC)loader("glProgramBinary");
+			ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)loader("glProgramParameteri");
+			GLint formats = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			programBinary = GetProgramBinary && ProgramBinary && ProgramParameteri && formats > 0;
+		}
+
+		if (has("GL_KHR_parallel_shader_compile")) {
+			MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsKHR");
+		} else if (has("GL_ARB_parallel_shader_compile")) {
+			MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsARB");
+		}
+		parallelShaderCompile = MaxShaderCompilerThreads != nullptr;
+		if (parallelShaderCompile) {
+			//let the driver decide how many threads it uses for compiling
+			MaxShaderCompilerThreads(0xFFFFFFFF);
+		}
+
+		textureCompressionS3TC = has("GL_EXT_texture_compression_s3tc");
+
+		if (glVersion >= 44 || has("GL_ARB_buffer_storage")) {
+			BufferStorage = (PFNGLBUFFERSTORAGEPROC)loader("glBufferStorage");
+			bufferStorage = BufferStorage != nullptr;
+		}
+
+		//shaders enable both extensions, only the one the driver has is actually used (see stereo.glsl)
+		vertexShaderLayer = has("GL_ARB_shader_viewport_layer_array") || has("GL_AMD_vertex_shader_layer");
+
+		memoryInfoNVX = has("GL_NVX_gpu_memory_info");
+		memoryInfoATI = has("GL_ATI_meminfo");
+	}
+
+	bool has(const std::string& name) {
+		return extensions.count(name) > 0;
+	}
+
+	int version() {
+		return glVersion;
+	}
+
+	std::string driverString() {
+		return std::string((const char*)glGetString(GL_VENDOR)) + " | " + (const char*)glGetString(GL_RENDERER) + " | " + (const char*)glGetString(GL_VERSION);
+	}
+}
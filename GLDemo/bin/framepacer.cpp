@@ -0,0 +1,79 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#endif
+
+#include <framepacer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+//time the automatic delay leaves before the refresh, for frames that take a bit longer than the ones before them
+const double AUTO_DELAY_MARGIN = 2.0;
+//the longest recent work time shrinks by this much every frame, so a single slow frame only shortens the delay for a while
+const double WORK_TIME_DECAY = 0.98;
+
+static double now() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LatencySettings::addOptions(Options& options) {
+	options.add("--latency", [this](const std::string& value) {
+		if (value == "low") {
+			lowLatency = true;
+		} else if (value != "normal") {
+			std::cout << "Unknown latency " << value << ", expected normal or low" << std::endl;
+			return false;
+		}
+		return true;
+	});
+	options.add("--frame-delay", [this](const std::string& value) {
+		if (value == "auto")
+			autoDelay = true;
+		else
+			frameDelay = std::max((float)atof(value.c_str()), 0.0f);
+		lowLatency = lowLatency || autoDelay || frameDelay > 0.0f;
+		return true;
+	});
+}
+
+FramePacer::FramePacer(const LatencySettings& settings, int refreshRate) : settings(settings), refreshInterval(1000.0 / (refreshRate > 0 ? refreshRate : 60)) {
+#ifdef _WIN32
+	//sleeps are rounded up to the timer resolution, which is 15.6 ms unless it's asked for a finer one
+	timeBeginPeriod(1);
+#endif
+	frameStart = now();
+}
+
+FramePacer::~FramePacer() {
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::afterSwap() {
+	//a fence after the swap passes once the GPU is done with everything of the frame
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+	glDeleteSync(fence);
+
+	/*
+	The next frame is shown at the refresh after the one this frame is waiting for, which is at least a refresh interval away. The automatic
+	delay leaves the slowest recent frame enough time to make it, the GPU time included.
+	*/
+	workTime = std::max(now() - frameStart, workTime * WORK_TIME_DECAY);
+	delay = settings.autoDelay ? (float)std::max(refreshInterval - workTime - AUTO_DELAY_MARGIN, 0.0) : settings.frameDelay;
+	if (delay > 0.0f)
+		std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(delay));
+	frameStart = now();
+}
+
+float FramePacer::getDelay() const {
+	return delay;
+}
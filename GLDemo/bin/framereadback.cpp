@@ -0,0 +1,77 @@
+#include <framereadback.h>
+#include <glstate.h>
+#include <gpumemory.h>
+
+FrameReadback::FrameReadback(int width, int height, int buffers) : width(width), height(height), slots(buffers) {
+	for (Slot& slot : slots) {
+		glGenBuffers(1, &slot.buffer);
+		GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * 3, NULL, GL_STREAM_READ);
+		GPUMemory::buffer(slot.buffer, GPUMemory::MEMORY_BUFFERS, (size_t)width * height * 3);
+	}
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameReadback::~FrameReadback() {
+	for (Slot& slot : slots) {
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+		GLState::deleteBuffers(1, &slot.buffer);
+	}
+}
+
+bool FrameReadback::read(GLuint framebuffer, uint64_t frame, int x, int y) {
+	if (inFlight == (int)slots.size())
+		return false;
+	Slot& slot = slots[(oldest + inFlight) % slots.size()];
+	slot.frame = frame;
+
+	GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	//rows of RGB pixels aren't a multiple of 4 bytes long for most widths
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	//with a pixel pack buffer bound this only queues the copy, the last argument is an offset into the buffer
+	glReadPixels(x, y, width, height, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	inFlight++;
+	return true;
+}
+
+void FrameReadback::collect(const Handler& handler, bool wait) {
+	while (inFlight > 0) {
+		Slot& slot = slots[oldest];
+		//flushing makes sure the fence is actually sent to the GPU before waiting on it, only the first frame is ever waited for
+		GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		wait = false;
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+
+		GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (size_t)width * height * 3, GL_MAP_READ_BIT);
+		if (pixels) {
+			handler(slot.frame, pixels);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		oldest = (oldest + 1) % slots.size();
+		inFlight--;
+	}
+}
+
+int FrameReadback::pending() const {
+	return inFlight;
+}
+
+int FrameReadback::getWidth() const {
+	return width;
+}
+
+int FrameReadback::getHeight() const {
+	return height;
+}
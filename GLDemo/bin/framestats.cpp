@@ -0,0 +1,285 @@
+#include <framestats.h>
+#include <glstate.h>
+#include <gpumemory.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+//frames between updates of the percentiles
+const int PERCENTILE_INTERVAL = 15;
+//stutters that are kept for the report
+const size_t MAX_STUTTERS = 32;
+//frames that fit into the queue to the log, about a minute at 60 frames per second
+const size_t LOG_QUEUE_SIZE = 4096;
+
+static const char* SECTION_NAMES[SECTION_COUNT] = { "input", "update", "upload", "draw", "output", "present" };
+
+FrameStats::FrameStats(const std::string& logPath) : logQueue(LOG_QUEUE_SIZE) {
+	origin = frameStart = sectionStart = std::chrono::steady_clock::now();
+	glGenQueries(QUERY_FRAMES, queries);
+	glGenVertexArrays(1, &graphVAO);
+	glGenBuffers(1, &graphVBO);
+	GLState::bindVertexArray(graphVAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, graphVBO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+
+	if (logPath.empty())
+		return;
+	log.open(logPath);
+	if (!log) {
+		std::cout << "Couldn't write the frame log " << logPath << std::endl;
+		return;
+	}
+	log << "frame,start_ms,frame_ms,cpu_ms,gpu_ms";
+	for (const char* name : SECTION_NAMES) {
+		log << "," << name << "_ms";
+	}
+	log << ",stutter\n";
+	writer = std::thread(&FrameStats::writeLog, this);
+}
+
+FrameStats::~FrameStats() {
+	//the frames whose GPU time hasn't come back yet are logged without it
+	for (uint64_t f = frame >= QUERY_FRAMES ? frame - QUERY_FRAMES : 0; f < frame; f++) {
+		int slot = f % QUERY_FRAMES;
+		if (pending[slot] && queryFrames[slot] == f)
+			publish(history[f % HISTORY_FRAMES]);
+	}
+	stopping = true;
+	if (writer.joinable())
+		writer.join();
+	if (dropped > 0)
+		std::cout << dropped << " frames were left out of the frame log, it couldn't be written fast enough" << std::endl;
+	glDeleteQueries(QUERY_FRAMES, queries);
+	GLState::deleteVertexArrays(1, &graphVAO);
+	GLState::deleteBuffers(1, &graphVBO);
+}
+
+bool FrameStats::isLogging() const {
+	return writer.joinable();
+}
+
+static double milliseconds(std::chrono::steady_clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void FrameStats::section(FrameSection section) {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	history[frame % HISTORY_FRAMES].sections[current] += (float)milliseconds(now - sectionStart);
+	current = section;
+	sectionStart = now;
+}
+
+void FrameStats::endFrame() {
+	glEndQuery(GL_TIME_ELAPSED);
+	section(SECTION_PRESENT);
+	history[frame % HISTORY_FRAMES].cpuTime = (float)milliseconds(sectionStart - frameStart);
+}
+
+void FrameStats::beginFrame() {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (frame > 0) {
+		FrameRecord& last = history[frame % HISTORY_FRAMES];
+		last.sections[current] += (float)milliseconds(now - sectionStart);
+		last.frameTime = (float)milliseconds(now - frameStart);
+		finishFrame(last);
+	}
+	frame++;
+	frameStart = sectionStart = now;
+	current = SECTION_INPUT;
+
+	//hand the frames whose GPU time has come back to the log, oldest first. The query of the oldest frame is given up on when its slot is needed again
+	for (uint64_t f = frame >= QUERY_FRAMES ? frame - QUERY_FRAMES : 0; f < frame; f++) {
+		int slot = f % QUERY_FRAMES;
+		if (!pending[slot] || queryFrames[slot] != f)
+			continue;
+		if (!readQuery(slot) && f + QUERY_FRAMES > frame)
+			break;
+		publish(history[f % HISTORY_FRAMES]);
+		pending[slot] = false;
+	}
+
+	FrameRecord& record = history[frame % HISTORY_FRAMES];
+	record = FrameRecord();
+	record.frame = frame;
+	record.start = milliseconds(now - origin);
+	int slot = frame % QUERY_FRAMES;
+	glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+	pending[slot] = true;
+	queryFrames[slot] = frame;
+}
+
+void FrameStats::finishFrame(FrameRecord& record) {
+	histogram[std::min((int)(record.frameTime / HISTOGRAM_BIN), HISTOGRAM_BINS - 1)]++;
+
+	//the section to blame is the one that took the most longer than it usually does, not the one that's always the longest
+	if (percentiles.p50 > 0.0f && record.frameTime > STUTTER_FACTOR * percentiles.p50) {
+		record.stutter = true;
+		Stutter stutter = { record.frame, record.start, record.frameTime, percentiles.p50, SECTION_INPUT };
+		for (int section = 1; section < SECTION_COUNT; section++) {
+			if (record.sections[section] - sectionMedians[section] > record.sections[stutter.section] - sectionMedians[stutter.section])
+				stutter.section = (FrameSection)section;
+		}
+		stutters.push_back(stutter);
+		if (stutters.size() > MAX_STUTTERS)
+			stutters.pop_front();
+		stutterCount++;
+	}
+	if (record.frame % PERCENTILE_INTERVAL == 0)
+		updatePercentiles();
+}
+
+void FrameStats::updatePercentiles() {
+	//every finished frame that's still in the history, the current one isn't done yet
+	size_t count = (size_t)std::min<uint64_t>(frame, HISTORY_FRAMES - 1);
+	std::vector<float> times(count);
+	auto percentile = [&times](float fraction) {
+		auto nth = times.begin() + std::min((size_t)(fraction * times.size()), times.size() - 1);
+		std::nth_element(times.begin(), nth, times.end());
+		return *nth;
+	};
+	for (int section = 0; section < SECTION_COUNT; section++) {
+		for (size_t i = 0; i < count; i++) {
+			times[i] = history[(frame - i) % HISTORY_FRAMES].sections[section];
+		}
+		sectionMedians[section] = percentile(0.5f);
+	}
+	for (size_t i = 0; i < count; i++) {
+		times[i] = history[(frame - i) % HISTORY_FRAMES].frameTime;
+	}
+	percentiles.max = *std::max_element(times.begin(), times.end());
+	percentiles.p99 = percentile(0.99f);
+	percentiles.p95 = percentile(0.95f);
+	percentiles.p50 = percentile(0.5f);
+}
+
+bool FrameStats::readQuery(int slot) {
+	GLuint available = 0;
+	glGetQueryObjectuiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return false;
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+	history[queryFrames[slot] % HISTORY_FRAMES].gpuTime = (float)(elapsed / 1.0e6);
+	return true;
+}
+
+void FrameStats::publish(const FrameRecord& record) {
+	if (isLogging() && !logQueue.push(record))
+		dropped++;
+}
+
+void FrameStats::writeLog() {
+	FrameRecord record;
+	for (;;) {
+		bool stop = stopping;
+		while (logQueue.pop(record)) {
+			log << record.frame << "," << record.start << "," << record.frameTime << "," << record.cpuTime << ",";
+			if (record.gpuTime >= 0.0f)
+				log << record.gpuTime;
+			for (float time : record.sections) {
+				log << "," << time;
+			}
+			log << "," << (record.stutter ? 1 : 0) << "\n";
+		}
+		if (stop)
+			break;
+		log.flush();
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+	log.flush();
+}
+
+FrameTimePercentiles FrameStats::getPercentiles() const {
+	return percentiles;
+}
+
+size_t FrameStats::getStutterCount() const {
+	return stutterCount;
+}
+
+void FrameStats::drawGraph(Shader& shader, const glm::mat4& projection, float x, float y, float width, float height, float refreshInterval) {
+	//the graph goes up to three refresh intervals, longer frames are cut off at the top
+	float scale = height / (3.0f * refreshInterval);
+	auto point = [&](int column, float time) {
+		return glm::vec2(x + width * column / (GRAPH_FRAMES - 1), y + std::min(time * scale, height));
+	};
+	int columns = (int)std::min<uint64_t>(frame > 0 ? frame - 1 : 0, GRAPH_FRAMES);
+	std::vector<glm::vec2> vertices = {
+		{ x, y }, { x + width, y }, { x + width, y + height }, { x, y }, { x + width, y + height }, { x, y + height },
+		point(0, refreshInterval), point(GRAPH_FRAMES - 1, refreshInterval),
+		point(0, 2.0f * refreshInterval), point(GRAPH_FRAMES - 1, 2.0f * refreshInterval)
+	};
+	//the newest frame is on the right, missing GPU times keep the last one that came back
+	size_t frameLine = vertices.size();
+	for (int column = 0; column < columns; column++) {
+		vertices.push_back(point(GRAPH_FRAMES - columns + column, history[(frame - columns + column) % HISTORY_FRAMES].frameTime));
+	}
+	size_t gpuLine = vertices.size();
+	float gpuTime = 0.0f;
+	for (int column = 0; column < columns; column++) {
+		const FrameRecord& record = history[(frame - columns + column) % HISTORY_FRAMES];
+		gpuTime = record.gpuTime >= 0.0f ? record.gpuTime : gpuTime;
+		vertices.push_back(point(GRAPH_FRAMES - columns + column, gpuTime));
+	}
+	size_t stutterLines = vertices.size();
+	for (int column = 0; column < columns; column++) {
+		if (history[(frame - columns + column) % HISTORY_FRAMES].stutter) {
+			vertices.push_back(point(GRAPH_FRAMES - columns + column, 0.0f));
+			vertices.push_back(point(GRAPH_FRAMES - columns + column, 3.0f * refreshInterval));
+		}
+	}
+
+	shader.use();
+	shader.setMat4("projection", projection);
+	GLState::bindVertexArray(graphVAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, graphVBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), vertices.data(), GL_STREAM_DRAW);
+	GPUMemory::buffer(graphVBO, GPUMemory::MEMORY_HUD, vertices.size() * sizeof(glm::vec2));
+	GLState::disable(GL_DEPTH_TEST);
+	shader.setVec4("color", glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	shader.setVec4("color", glm::vec4(0.5f, 0.8f, 0.2f, 0.6f));
+	glDrawArrays(GL_LINES, 6, 4);
+	shader.setVec4("color", glm::vec4(1.0f, 0.2f, 0.2f, 0.8f));
+	glDrawArrays(GL_LINES, (GLint)stutterLines, (GLsizei)(vertices.size() - stutterLines));
+	shader.setVec4("color", glm::vec4(1.0f, 0.6f, 0.1f, 1.0f));
+	glDrawArrays(GL_LINE_STRIP, (GLint)gpuLine, (GLsizei)(stutterLines - gpuLine));
+	shader.setVec4("color", glm::vec4(1.0f));
+	glDrawArrays(GL_LINE_STRIP, (GLint)frameLine, (GLsizei)(gpuLine - frameLine));
+	GLState::enable(GL_DEPTH_TEST);
+}
+
+void FrameStats::report() const {
+	uint64_t finished = frame > 0 ? frame - 1 : 0;
+	std::cout << "Frame times of the last " << std::min<uint64_t>(finished, HISTORY_FRAMES - 1) << " frames: " << percentiles.p50 << " ms median, "
+		<< percentiles.p95 << " ms p95, " << percentiles.p99 << " ms p99, " << percentiles.max << " ms max" << std::endl;
+
+	std::cout << "Frame times of all " << finished << " frames:" << std::endl;
+	uint64_t most = *std::max_element(histogram, histogram + HISTOGRAM_BINS);
+	int first = 0, last = HISTOGRAM_BINS - 1;
+	while (first < last && histogram[first] == 0)
+		first++;
+	while (last > first && histogram[last] == 0)
+		last--;
+	for (int bin = first; bin <= last; bin++) {
+		char line[64];
+		if (bin < HISTOGRAM_BINS - 1)
+			snprintf(line, sizeof(line), "  %3d - %3d ms %10llu ", (int)(bin * HISTOGRAM_BIN), (int)((bin + 1) * HISTOGRAM_BIN), (unsigned long long)histogram[bin]);
+		else
+			snprintf(line, sizeof(line), "  %3d+     ms %10llu ", (int)(bin * HISTOGRAM_BIN), (unsigned long long)histogram[bin]);
+		std::cout << line << std::string(most > 0 ? (size_t)(histogram[bin] * 40 / most) : 0, '#') << std::endl;
+	}
+
+	std::cout << stutterCount << " stutters";
+	if (!stutters.empty())
+		std::cout << ", the last " << stutters.size() << " of them:";
+	std::cout << std::endl;
+	for (const Stutter& stutter : stutters) {
+		std::cout << "  frame " << stutter.frame << " at " << stutter.start / 1000.0 << " s took " << stutter.frameTime << " ms (median "
+			<< stutter.median << " ms), mostly in " << SECTION_NAMES[stutter.section] << std::endl;
+	}
+}
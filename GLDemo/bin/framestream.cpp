@@ -0,0 +1,357 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET Socket;
+static const Socket NO_SOCKET = INVALID_SOCKET;
+static const int SHUTDOWN_BOTH = SD_BOTH;
+static void closeSocket(Socket socket) { closesocket(socket); }
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int Socket;
+static const Socket NO_SOCKET = -1;
+static const int SHUTDOWN_BOTH = SHUT_RDWR;
+static void closeSocket(Socket socket) { close(socket); }
+#endif
+
+#include <framestream.h>
+#include <imagewriter.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <string>
+#include <thread>
+
+//a viewer that went away must not end the application with SIGPIPE
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+//every connection is served by a thread of its own, further connections are turned away
+static const int MAX_CONNECTIONS = 16;
+//a small send buffer makes a slow viewer run out of room sooner, so it skips frames instead of the network stack queueing them up
+static const int SEND_BUFFER_SIZE = 128 * 1024;
+static const size_t MAX_REQUEST_SIZE = 8192;
+
+static const char* PAGE =
+	"<!DOCTYPE html><html><head><title>Solar System</title><style>html, body { margin: 0; height: 100%; background: #000; }"
+	" img { width: 100%; height: 100%; object-fit: contain; }</style></head><body><img src=\"/stream\"></body></html>";
+
+void StreamSettings::addOptions(Options& options) {
+	options.add("--stream", [this](const std::string& value) {
+		size_t colon = value.rfind(':');
+		if (colon != std::string::npos)
+			address = value.substr(0, colon);
+		port = atoi(value.c_str() + (colon == std::string::npos ? 0 : colon + 1));
+		if (port <= 0 || port > 65535) {
+			std::cout << "Invalid stream port " << value << ", expected [<address>:]<port>" << std::endl;
+			port = 0;
+			return false;
+		}
+		return true;
+	});
+	options.add("--stream-quality", [this](const std::string& value) {
+		quality = std::min(std::max(atoi(value.c_str()), 1), 100);
+		return true;
+	});
+}
+
+/*
+A minimal HTTP server for the stream. A thread accepts the connections and every connection gets a thread of its own, which blocks
+while its viewer takes its time to receive a frame. Only the newest compressed frame is kept, so whichever frames were published in the
+meantime are skipped.
+*/
+class StreamServer {
+public:
+	StreamServer(const std::string& address, int port);
+	~StreamServer();
+	StreamServer(const StreamServer&) = delete;
+	StreamServer& operator=(const StreamServer&) = delete;
+
+	bool isOpen() const;
+	//connections that are waiting for frames
+	int getViewers() const;
+	//makes the frame the one every viewer gets next, unless a newer one was published already
+	void publish(uint64_t frame, std::shared_ptr<const std::vector<uint8_t>> jpeg);
+
+private:
+	struct Connection {
+		Socket socket;
+		std::thread thread;
+		std::atomic<bool> done{ false };
+	};
+
+	Socket listener = NO_SOCKET;
+	bool started = false;
+	std::thread acceptor;
+	//only touched by the accepting thread, and by the destructor once it's stopped
+	std::list<std::unique_ptr<Connection>> connections;
+	std::atomic<int> viewers{ 0 };
+	std::atomic<bool> stopping{ false };
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::shared_ptr<const std::vector<uint8_t>> latest;
+	uint64_t latestFrame = 0;
+
+	void run();
+	void serve(Connection& connection);
+	void stream(Socket socket, bool once);
+	//waits for a frame newer than the one that was sent last, returns false when the server is stopping
+	bool waitForFrame(uint64_t& sent, std::shared_ptr<const std::vector<uint8_t>>& jpeg);
+};
+
+static bool sendAll(Socket socket, const char* data, size_t size) {
+	while (size > 0) {
+		int sent = send(socket, data, (int)std::min<size_t>(size, 1 << 30), SEND_FLAGS);
+		if (sent <= 0)
+			return false;
+		data += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+static bool sendAll(Socket socket, const std::string& text) {
+	return sendAll(socket, text.data(), text.size());
+}
+
+StreamServer::StreamServer(const std::string& address, int port) {
+#ifdef _WIN32
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+		std::cout << "Couldn't start Winsock" << std::endl;
+		return;
+	}
+#endif
+	started = true;
+	sockaddr_in local = {};
+	local.sin_family = AF_INET;
+	local.sin_port = htons((unsigned short)port);
+	if (inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1) {
+		std::cout << "Invalid stream address " << address << std::endl;
+		return;
+	}
+	listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (listener == NO_SOCKET)
+		return;
+	//the port can be taken again right after a restart, while the connections of the last run are still closing
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+	if (bind(listener, (const sockaddr*)&local, sizeof(local)) != 0 || listen(listener, MAX_CONNECTIONS) != 0) {
+		std::cout << "Couldn't listen on " << address << ":" << port << std::endl;
+		closeSocket(listener);
+		listener = NO_SOCKET;
+		return;
+	}
+	acceptor = std::thread(&StreamServer::run, this);
+}
+
+StreamServer::~StreamServer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		condition.notify_all();
+	}
+	if (acceptor.joinable())
+		acceptor.join();
+	//shutting a socket down wakes up its thread when it's blocked sending or receiving
+	for (std::unique_ptr<Connection>& connection : connections) {
+		shutdown(connection->socket, SHUTDOWN_BOTH);
+	}
+	for (std::unique_ptr<Connection>& connection : connections) {
+		connection->thread.join();
+		closeSocket(connection->socket);
+	}
+	if (listener != NO_SOCKET)
+		closeSocket(listener);
+#ifdef _WIN32
+	if (started)
+		WSACleanup();
+#endif
+}
+
+bool StreamServer::isOpen() const {
+	return listener != NO_SOCKET;
+}
+
+int StreamServer::getViewers() const {
+	return viewers.load(std::memory_order_relaxed);
+}
+
+void StreamServer::publish(uint64_t frame, std::shared_ptr<const std::vector<uint8_t>> jpeg) {
+	std::lock_guard<std::mutex> lock(mutex);
+	//frames are compressed in parallel, so they can be done out of order
+	if (frame <= latestFrame)
+		return;
+	latest = std::move(jpeg);
+	latestFrame = frame;
+	condition.notify_all();
+}
+
+bool StreamServer::waitForFrame(uint64_t& sent, std::shared_ptr<const std::vector<uint8_t>>& jpeg) {
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this, &sent]() { return stopping || latestFrame > sent; });
+	if (stopping)
+		return false;
+	jpeg = latest;
+	sent = latestFrame;
+	return true;
+}
+
+void StreamServer::run() {
+	while (!stopping) {
+		//finished connections are cleaned up here, so only this thread ever changes the list
+		for (auto it = connections.begin(); it != connections.end();) {
+			if ((*it)->done) {
+				(*it)->thread.join();
+				closeSocket((*it)->socket);
+				it = connections.erase(it);
+			} else {
+				++it;
+			}
+		}
+
+		//waits with a timeout rather than blocking in accept, so the thread notices when it's stopped
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(listener, &readable);
+		timeval timeout = { 0, 200000 };
+		int ready = select((int)listener + 1, &readable, NULL, NULL, &timeout);
+		if (ready < 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		if (ready <= 0)
+			continue;
+		Socket client = accept(listener, NULL, NULL);
+		if (client == NO_SOCKET)
+			continue;
+		if (connections.size() >= (size_t)MAX_CONNECTIONS) {
+			sendAll(client, "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+			closeSocket(client);
+			continue;
+		}
+		//frames go out as soon as they're handed over instead of waiting to be combined with whatever comes next
+		int noDelay = 1, sendBuffer = SEND_BUFFER_SIZE;
+		setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+		setsockopt(client, SOL_SOCKET, SO_SNDBUF, (const char*)&sendBuffer, sizeof(sendBuffer));
+		connections.emplace_back(new Connection());
+		Connection& connection = *connections.back();
+		connection.socket = client;
+		connection.thread = std::thread(&StreamServer::serve, this, std::ref(connection));
+	}
+}
+
+void StreamServer::serve(Connection& connection) {
+	std::string request;
+	char buffer[1024];
+	while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE) {
+		int received = recv(connection.socket, buffer, sizeof(buffer), 0);
+		if (received <= 0)
+			break;
+		request.append(buffer, received);
+	}
+
+	//only the path of a GET request matters, anything after it is ignored
+	std::string path;
+	if (request.compare(0, 4, "GET ") == 0)
+		path = request.substr(4, request.find_first_of(" ?\r\n", 4) - 4);
+	if (path == "/") {
+		sendAll(connection.socket, "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: " + std::to_string(strlen(PAGE)) +
+			"\r\nConnection: close\r\n\r\n" + PAGE);
+	} else if (path == "/stream" || path == "/frame.jpg") {
+		stream(connection.socket, path == "/frame.jpg");
+	} else {
+		sendAll(connection.socket, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+	}
+	shutdown(connection.socket, SHUTDOWN_BOTH);
+	connection.done = true;
+}
+
+//sends the frames that are published from now on, or only the next one
+void StreamServer::stream(Socket socket, bool once) {
+	if (!once && !sendAll(socket, "HTTP/1.1 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+		"Cache-Control: no-cache, no-store\r\nConnection: close\r\n\r\n"))
+		return;
+	uint64_t sent;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		sent = latestFrame;
+	}
+	//nothing is read back while no one is watching, so the frame from before that is too old to send
+	viewers++;
+	std::shared_ptr<const std::vector<uint8_t>> jpeg;
+	while (waitForFrame(sent, jpeg)) {
+		std::string header = once
+			? "HTTP/1.1 200 OK\r\nContent-Type: image/jpeg\r\nCache-Control: no-cache, no-store\r\nConnection: close\r\n"
+			: "--frame\r\nContent-Type: image/jpeg\r\n";
+		header += "Content-Length: " + std::to_string(jpeg->size()) + "\r\n\r\n";
+		if (!sendAll(socket, header) || !sendAll(socket, (const char*)jpeg->data(), jpeg->size()) || once || !sendAll(socket, "\r\n"))
+			break;
+	}
+	viewers--;
+}
+
+FrameStream::FrameStream(const StreamSettings& settings, int width, int height, ThreadPool& pool)
+	: settings(settings), pool(pool), readback(width, height) {
+	//the rest of the thread pool is left for streaming in textures
+	maxEncoding = std::max(1, (int)pool.size() / 2);
+	server.reset(new StreamServer(settings.address, settings.port));
+	if (server->isOpen())
+		std::cout << "Streaming " << width << "x" << height << " at http://" << settings.address << ":" << settings.port << "/" << std::endl;
+}
+
+FrameStream::~FrameStream() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return encoding == 0; });
+	}
+	server.reset();
+}
+
+bool FrameStream::isOpen() const {
+	return server->isOpen();
+}
+
+void FrameStream::capture(GLuint framebuffer, int x, int y) {
+	if (!isOpen())
+		return;
+	readback.collect([this](uint64_t frame, const unsigned char* pixels) { encode(frame, pixels); });
+	if (server->getViewers() == 0)
+		return;
+	//when every buffer is still waiting for the GPU the frame is dropped, the next one has a better chance
+	readback.read(framebuffer, ++frame, x, y);
+}
+
+void FrameStream::encode(uint64_t frame, const unsigned char* pixels) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (encoding >= maxEncoding)
+			return;
+		encoding++;
+	}
+
+	int width = readback.getWidth(), height = readback.getHeight();
+	size_t rowSize = (size_t)width * 3;
+	std::shared_ptr<std::vector<unsigned char>> copy = std::make_shared<std::vector<unsigned char>>(pixels, pixels + rowSize * height);
+	pool.submit([this, copy, frame, width, height, rowSize]() {
+		//the rows are read back from the bottom up, while JPEG files start at the top
+		std::vector<uint8_t> jpeg = encodeJpeg(width, height, copy->data() + rowSize * (height - 1), -(ptrdiff_t)rowSize, settings.quality);
+		server->publish(frame, std::make_shared<const std::vector<uint8_t>>(std::move(jpeg)));
+		std::lock_guard<std::mutex> lock(mutex);
+		encoding--;
+		condition.notify_all();
+	});
+}
@@ -0,0 +1,294 @@
+#include <glad/glad.h>
+
+#include <glstate.h>
+#include <gpumemory.h>
+
+namespace GLState {
+	//marks a binding whose value isn't known, so the next call to change it always reaches the driver
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	//the texture and buffer targets that are tracked, any other target is passed on to the driver without caching
+	static const GLenum TEXTURE_TARGETS[] = { GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BUFFER, GL_TEXTURE_2D_ARRAY };
+	static const int NUM_TEXTURE_TARGETS = sizeof(TEXTURE_TARGETS) / sizeof(GLenum);
+	static const GLenum BUFFER_TARGETS[] = { GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_TEXTURE_BUFFER,
+		GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER };
+	static const int NUM_BUFFER_TARGETS = sizeof(BUFFER_TARGETS) / sizeof(GLenum);
+
+	static GLuint program;
+	static GLuint vertexArray;
+	static GLuint drawFramebuffer;
+	static GLuint readFramebuffer;
+	static GLuint renderbuffer;
+	static GLuint buffers[NUM_BUFFER_TARGETS];
+	static GLuint activeUnit;
+	static GLuint textures[MAX_TEXTURE_UNITS][NUM_TEXTURE_TARGETS];
+
+	//GL_TRUE/GL_FALSE for known state, UNKNOWN otherwise
+	static GLuint depthTest, blend, cullFace;
+	static GLenum depthFunction;
+	static GLuint depthWrite;
+	static GLenum blendSrc, blendDst;
+
+	static Stats stats;
+
+	static int textureIndex(GLenum target) {
+		for (int i = 0; i < NUM_TEXTURE_TARGETS; i++) {
+			if (TEXTURE_TARGETS[i] == target)
+				return i;
+		}
+		return -1;
+	}
+
+	static int bufferIndex(GLenum target) {
+		for (int i = 0; i < NUM_BUFFER_TARGETS; i++) {
+			if (BUFFER_TARGETS[i] == target)
+				return i;
+		}
+		return -1;
+	}
+
+	//counts a requested state change, returns true when it's redundant and can be skipped
+	static bool elide(GLuint& cached, GLuint value) {
+		stats.calls++;
+		if (cached == value) {
+			stats.elided++;
+			return true;
+		}
+		cached = value;
+		return false;
+	}
+
+	static GLuint* capability(GLenum cap) {
+		switch (cap) {
+		case GL_DEPTH_TEST:
+			return &depthTest;
+		case GL_BLEND:
+			return &blend;
+		case GL_CULL_FACE:
+			return &cullFace;
+		}
+		return nullptr;
+	}
+
+	void reset() {
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		drawFramebuffer = UNKNOWN;
+		readFramebuffer = UNKNOWN;
+		renderbuffer = UNKNOWN;
+		for (int i = 0; i < NUM_BUFFER_TARGETS; i++)
+			buffers[i] = UNKNOWN;
+		activeUnit = UNKNOWN;
+		for (GLuint unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+			for (int i = 0; i < NUM_TEXTURE_TARGETS; i++)
+				textures[unit][i] = UNKNOWN;
+		}
+		depthTest = blend = cullFace = UNKNOWN;
+		depthFunction = UNKNOWN;
+		depthWrite = UNKNOWN;
+		blendSrc = blendDst = UNKNOWN;
+	}
+
+	void useProgram(GLuint id) {
+		if (!elide(program, id))
+			glUseProgram(id);
+	}
+
+	void bindVertexArray(GLuint vao) {
+		if (elide(vertexArray, vao))
+			return;
+		glBindVertexArray(vao);
+		//the element buffer belongs to the VAO that was just bound, which is unknown here
+		buffers[bufferIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+	}
+
+	void bindBuffer(GLenum target, GLuint buffer) {
+		int index = bufferIndex(target);
+		if (index < 0) {
+			stats.calls++;
+			glBindBuffer(target, buffer);
+		} else if (!elide(buffers[index], buffer)) {
+			glBindBuffer(target, buffer);
+		}
+	}
+
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+		stats.calls++;
+		glBindBufferBase(target, index, buffer);
+		int i = bufferIndex(target);
+		if (i >= 0)
+			buffers[i] = buffer;
+	}
+
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+		stats.calls++;
+		glBindBufferRange(target, index, buffer, offset, size);
+		int i = bufferIndex(target);
+		if (i >= 0)
+			buffers[i] = buffer;
+	}
+
+	void bindFramebuffer(GLenum target, GLuint framebuffer) {
+		switch (target) {
+		case GL_FRAMEBUFFER:
+			stats.calls++;
+			if (drawFramebuffer == framebuffer && readFramebuffer == framebuffer) {
+				stats.elided++;
+				return;
+			}
+			drawFramebuffer = readFramebuffer = framebuffer;
+			break;
+		case GL_DRAW_FRAMEBUFFER:
+			if (elide(drawFramebuffer, framebuffer))
+				return;
+			break;
+		case GL_READ_FRAMEBUFFER:
+			if (elide(readFramebuffer, framebuffer))
+				return;
+			break;
+		}
+		glBindFramebuffer(target, framebuffer);
+	}
+
+	void bindRenderbuffer(GLuint id) {
+		if (!elide(renderbuffer, id))
+			glBindRenderbuffer(GL_RENDERBUFFER, id);
+	}
+
+	void activeTexture(GLuint unit) {
+		if (!elide(activeUnit, unit))
+			glActiveTexture(GL_TEXTURE0 + unit);
+	}
+
+	void bindTexture(GLenum target, GLuint texture) {
+		int index = textureIndex(target);
+		if (index < 0 || activeUnit >= MAX_TEXTURE_UNITS) {
+			stats.calls++;
+			glBindTexture(target, texture);
+		} else if (!elide(textures[activeUnit][index], texture)) {
+			glBindTexture(target, texture);
+		}
+	}
+
+	void bindTexture(GLuint unit, GLenum target, GLuint texture) {
+		int index = textureIndex(target);
+		//skip switching the active unit as well when the texture is already bound to it
+		if (index >= 0 && unit < MAX_TEXTURE_UNITS && textures[unit][index] == texture) {
+			stats.calls++;
+			stats.elided++;
+			return;
+		}
+		activeTexture(unit);
+		bindTexture(target, texture);
+	}
+
+	void enable(GLenum cap) {
+		GLuint* cached = capability(cap);
+		if (!cached) {
+			stats.calls++;
+			glEnable(cap);
+		} else if (!elide(*cached, GL_TRUE)) {
+			glEnable(cap);
+		}
+	}
+
+	void disable(GLenum cap) {
+		GLuint* cached = capability(cap);
+		if (!cached) {
+			stats.calls++;
+			glDisable(cap);
+		} else if (!elide(*cached, GL_FALSE)) {
+			glDisable(cap);
+		}
+	}
+
+	void depthFunc(GLenum func) {
+		if (!elide(depthFunction, func))
+			glDepthFunc(func);
+	}
+
+	void depthMask(GLboolean flag) {
+		if (!elide(depthWrite, flag))
+			glDepthMask(flag);
+	}
+
+	void blendFunc(GLenum sfactor, GLenum dfactor) {
+		stats.calls++;
+		if (blendSrc == sfactor && blendDst == dfactor) {
+			stats.elided++;
+			return;
+		}
+		blendSrc = sfactor;
+		blendDst = dfactor;
+		glBlendFunc(sfactor, dfactor);
+	}
+
+	void deleteTextures(GLsizei n, const GLuint* ids) {
+		for (GLsizei i = 0; i < n; i++) {
+			for (GLuint unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+				for (int j = 0; j < NUM_TEXTURE_TARGETS; j++) {
+					if (textures[unit][j] == ids[i])
+						textures[unit][j] = 0;
+				}
+			}
+		}
+		GPUMemory::releaseTextures(n, ids);
+		glDeleteTextures(n, ids);
+	}
+
+	void deleteBuffers(GLsizei n, const GLuint* ids) {
+		for (GLsizei i = 0; i < n; i++) {
+			for (int j = 0; j < NUM_BUFFER_TARGETS; j++) {
+				if (buffers[j] == ids[i])
+					buffers[j] = 0;
+			}
+		}
+		GPUMemory::releaseBuffers(n, ids);
+		glDeleteBuffers(n, ids);
+	}
+
+	void deleteVertexArrays(GLsizei n, const GLuint* ids) {
+		for (GLsizei i = 0; i < n; i++) {
+			if (vertexArray == ids[i]) {
+				vertexArray = 0;
+				buffers[bufferIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+			}
+		}
+		glDeleteVertexArrays(n, ids);
+	}
+
+	void deleteFramebuffers(GLsizei n, const GLuint* ids) {
+		for (GLsizei i = 0; i < n; i++) {
+			if (drawFramebuffer == ids[i])
+				drawFramebuffer = 0;
+			if (readFramebuffer == ids[i])
+				readFramebuffer = 0;
+		}
+		glDeleteFramebuffers(n, ids);
+	}
+
+	void deleteRenderbuffers(GLsizei n, const GLuint* ids) {
+		for (GLsizei i = 0; i < n; i++) {
+			if (renderbuffer == ids[i])
+				renderbuffer = 0;
+		}
+		GPUMemory::releaseRenderbuffers(n, ids);
+		glDeleteRenderbuffers(n, ids);
+	}
+
+	void deleteProgram(GLuint id) {
+		if (program == id)
+			program = 0;
+		glDeleteProgram(id);
+	}
+
+	const Stats& frameStats() {
+		return stats;
+	}
+
+	Stats endFrame() {
+		Stats frame = stats;
+		stats = Stats();
+		return frame;
+	}
+}
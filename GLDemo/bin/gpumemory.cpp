@@ -0,0 +1,298 @@
+#include <glad/glad.h>
+
+#include <gpumemory.h>
+#include <extensions.h>
+#include <ctex.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <utility>
+
+namespace GPUMemory {
+	static const char* CATEGORY_NAMES[MEMORY_CATEGORY_COUNT] = {
+		"textures", "skybox", "virtual textures", "atmospheres", "models", "framebuffers", "HUD", "buffers"
+	};
+	//the default budget, the smallest GPUs the app has to run on have 2 GB
+	static const size_t DEFAULT_BUDGET = (size_t)2048 * 1024 * 1024;
+
+	struct Image {
+		GLenum internalFormat;
+		int width, height, depth;
+		size_t bytes;
+	};
+
+	struct Allocation {
+		Category category = MEMORY_TEXTURES;
+		size_t bytes = 0;
+		//the images of a texture by face and level, see imageKey
+		std::map<int, Image> images;
+	};
+
+	//every object by its kind and name, as textures, buffers and renderbuffers have separate names
+	enum Kind { KIND_TEXTURE, KIND_BUFFER, KIND_RENDERBUFFER };
+	static std::map<std::pair<Kind, GLuint>, Allocation> allocations;
+	static size_t totals[MEMORY_CATEGORY_COUNT] = {};
+	static size_t budget = DEFAULT_BUDGET;
+	static bool warned = false;
+
+	//rounded up, so anything over the budget shows as such
+	static size_t megabytes(size_t bytes) {
+		return (bytes + 1024 * 1024 - 1) / (1024 * 1024);
+	}
+
+	static int imageKey(int face, int level) {
+		return face * 32 + level;
+	}
+
+	static void checkBudget() {
+		size_t used = total();
+		if (budget == 0 || used <= budget) {
+			warned = false;
+			return;
+		}
+		if (warned)
+			return;
+		warned = true;
+		std::cout << "Warning: " << megabytes(used) << " MB of video memory is in use, which is over the budget of " << megabytes(budget) << " MB:";
+		for (int category = 0; category < MEMORY_CATEGORY_COUNT; category++) {
+			if (totals[category] > 0)
+				std::cout << " " << CATEGORY_NAMES[category] << " " << megabytes(totals[category]) << " MB";
+		}
+		std::cout << std::endl;
+	}
+
+	//moves an allocation into another category along with the bytes it takes, f.e. when a buffer name is reused for something else
+	static void recategorize(Allocation& allocation, Category category) {
+		totals[allocation.category] -= allocation.bytes;
+		allocation.category = category;
+		totals[allocation.category] += allocation.bytes;
+	}
+
+	//changes the size of an allocation and the total of its category, the allocation is dropped when it doesn't take any memory anymore
+	static void resize(std::pair<Kind, GLuint> key, Allocation& allocation, size_t bytes) {
+		totals[allocation.category] += bytes;
+		totals[allocation.category] -= allocation.bytes;
+		allocation.bytes = bytes;
+		if (bytes == 0)
+			allocations.erase(key);
+		checkBudget();
+	}
+
+	static void release(Kind kind, GLsizei n, const GLuint* names) {
+		for (GLsizei i = 0; i < n; i++) {
+			auto allocation = allocations.find({ kind, names[i] });
+			if (allocation == allocations.end())
+				continue;
+			totals[allocation->second.category] -= allocation->second.bytes;
+			allocations.erase(allocation);
+		}
+		checkBudget();
+	}
+
+	const char* categoryName(Category category) {
+		return CATEGORY_NAMES[category];
+	}
+
+	size_t imageSize(GLenum internalFormat, int width, int height, int depth) {
+		size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4) * depth;
+		size_t pixels = (size_t)width * height * depth;
+		switch (internalFormat) {
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RED_RGTC1:
+			return blocks * 8;
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_RG_RGTC2:
+			return blocks * 16;
+		case GL_RED:
+		case GL_R8:
+			return pixels;
+		case GL_RG:
+		case GL_RG8:
+			return pixels * 2;
+		//three channels are padded to four
+		case GL_RGB16F:
+		case GL_RGBA16F:
+		case GL_RGBA16UI:
+			return pixels * 8;
+		case GL_RGB32F:
+		case GL_RGBA32F:
+			return pixels * 16;
+		default: //RGB, RGBA and the depth formats
+			return pixels * 4;
+		}
+	}
+
+	void texture(GLuint texture, GLenum target, Category category, GLenum internalFormat, int width, int height, int depth, int level) {
+		std::pair<Kind, GLuint> key(KIND_TEXTURE, texture);
+		Allocation& allocation = allocations[key];
+		if (allocation.images.empty())
+			allocation.category = category;
+
+		bool cubeFace = target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+		int face = cubeFace ? (int)(target - GL_TEXTURE_CUBE_MAP_POSITIVE_X) : 0;
+		Image image{ internalFormat, width, height, depth, imageSize(internalFormat, width, height, depth) };
+		size_t bytes = allocation.bytes + image.bytes;
+		auto previous = allocation.images.find(imageKey(face, level));
+		if (previous != allocation.images.end())
+			bytes -= previous->second.bytes;
+		allocation.images[imageKey(face, level)] = image;
+		resize(key, allocation, bytes);
+	}
+
+	void mipmaps(GLuint texture) {
+		std::pair<Kind, GLuint> key(KIND_TEXTURE, texture);
+		auto found = allocations.find(key);
+		if (found == allocations.end())
+			return;
+		Allocation& allocation = found->second;
+
+		std::map<int, Image> images;
+		size_t bytes = 0;
+		for (int face = 0; face < 6; face++) {
+			auto base = allocation.images.find(imageKey(face, 0));
+			if (base == allocation.images.end())
+				continue;
+			//every level halves the size down to 1x1, the layers of arrays stay
+			Image image = base->second;
+			for (int level = 0; ; level++) {
+				image.bytes = imageSize(image.internalFormat, image.width, image.height, image.depth);
+				images[imageKey(face, level)] = image;
+				bytes += image.bytes;
+				if (image.width == 1 && image.height == 1)
+					break;
+				image.width = std::max(1, image.width / 2);
+				image.height = std::max(1, image.height / 2);
+			}
+		}
+		allocation.images = std::move(images);
+		resize(key, allocation, bytes);
+	}
+
+	void buffer(GLuint buffer, Category category, size_t bytes) {
+		std::pair<Kind, GLuint> key(KIND_BUFFER, buffer);
+		Allocation& allocation = allocations[key];
+		recategorize(allocation, category);
+		resize(key, allocation, bytes);
+	}
+
+	void renderbuffer(GLuint renderbuffer, Category category, GLenum internalFormat, int width, int height) {
+		std::pair<Kind, GLuint> key(KIND_RENDERBUFFER, renderbuffer);
+		Allocation& allocation = allocations[key];
+		recategorize(allocation, category);
+		resize(key, allocation, imageSize(internalFormat, width, height));
+	}
+
+	void releaseTextures(GLsizei n, const GLuint* textures) {
+		release(KIND_TEXTURE, n, textures);
+	}
+
+	void releaseBuffers(GLsizei n, const GLuint* buffers) {
+		release(KIND_BUFFER, n, buffers);
+	}
+
+	void releaseRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+		release(KIND_RENDERBUFFER, n, renderbuffers);
+	}
+
+	size_t total() {
+		size_t sum = 0;
+		for (size_t bytes : totals) {
+			sum += bytes;
+		}
+		return sum;
+	}
+
+	size_t total(Category category) {
+		return totals[category];
+	}
+
+	void setBudget(size_t bytes) {
+		budget = bytes;
+		warned = false;
+		checkBudget();
+	}
+
+	size_t getBudget() {
+		return budget;
+	}
+
+	bool overBudget() {
+		return budget > 0 && total() > budget;
+	}
+
+	bool queryDriver(size_t& available, size_t& dedicated) {
+		if (GLExtensions::memoryInfoNVX) {
+			GLint freeKB = 0, dedicatedKB = 0;
+			glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &freeKB);
+			glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &dedicatedKB);
+			available = (size_t)freeKB * 1024;
+			dedicated = (size_t)dedicatedKB * 1024;
+			return true;
+		}
+		if (GLExtensions::memoryInfoATI) {
+			//the free memory of the pool, the largest free block and the same two for memory shared with the CPU
+			GLint freeKB[4] = {};
+			glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, freeKB);
+			available = (size_t)freeKB[0] * 1024;
+			dedicated = 0;
+			return true;
+		}
+		return false;
+	}
+
+	std::string summary() {
+		char line[256];
+		int length = snprintf(line, sizeof(line), "%zu MB of video memory", megabytes(total()));
+		if (budget > 0)
+			length += snprintf(line + length, sizeof(line) - length, " of a %zu MB budget", megabytes(budget));
+
+		//the three largest categories
+		Category order[MEMORY_CATEGORY_COUNT];
+		for (int category = 0; category < MEMORY_CATEGORY_COUNT; category++) {
+			order[category] = (Category)category;
+		}
+		std::sort(order, order + MEMORY_CATEGORY_COUNT, [](Category a, Category b) { return totals[a] > totals[b]; });
+		for (int i = 0; i < 3 && totals[order[i]] > 0; i++) {
+			length += snprintf(line + length, sizeof(line) - length, "%s%s %zu MB", i == 0 ? " (" : ", ", CATEGORY_NAMES[order[i]], megabytes(totals[order[i]]));
+		}
+		if (totals[order[0]] > 0)
+			length += snprintf(line + length, sizeof(line) - length, ")");
+
+		size_t available, dedicated;
+		if (queryDriver(available, dedicated)) {
+			if (dedicated > 0)
+				snprintf(line + length, sizeof(line) - length, ", %zu of %zu MB free on the GPU", megabytes(available), megabytes(dedicated));
+			else
+				snprintf(line + length, sizeof(line) - length, ", %zu MB free on the GPU", megabytes(available));
+		}
+		return line;
+	}
+
+	void report() {
+		size_t counts[MEMORY_CATEGORY_COUNT] = {};
+		for (auto& allocation : allocations) {
+			counts[allocation.second.category]++;
+		}
+
+		std::cout << "Video memory in use:" << std::endl;
+		for (int category = 0; category < MEMORY_CATEGORY_COUNT; category++) {
+			std::cout << "  " << CATEGORY_NAMES[category] << ": " << (totals[category] + 1023) / 1024 << " KB in " << counts[category] << " objects" << std::endl;
+		}
+		std::cout << megabytes(total()) << " MB in total";
+		if (budget > 0)
+			std::cout << ", the budget is " << megabytes(budget) << " MB" << (overBudget() ? " and it's exceeded" : "");
+		std::cout << std::endl;
+
+		size_t available, dedicated;
+		if (!queryDriver(available, dedicated)) {
+			std::cout << "The driver doesn't report how much video memory is free" << std::endl;
+		} else {
+			std::cout << "The driver reports " << megabytes(available) << " MB free";
+			if (dedicated > 0)
+				std::cout << " of " << megabytes(dedicated) << " MB, so " << megabytes(dedicated - std::min(available, dedicated)) << " MB is used by every program together";
+			std::cout << std::endl;
+		}
+	}
+}
@@ -0,0 +1,713 @@
+#include <imagewriter.h>
+
+#include <algorithm>
+#include <cstring>
+
+//rows are compressed in blocks of about this many bytes, matches are only searched within a block
+static const size_t BLOCK_SIZE = 256 * 1024;
+static const int HASH_BITS = 15;
+//how many earlier positions with the same hash are tried for a match, more compresses slightly better but slower
+static const int MAX_CHAIN = 16;
+static const int MIN_MATCH = 3;
+static const int MAX_MATCH = 258;
+static const int WINDOW_SIZE = 32768;
+
+//the lengths and distances of matches are stored as a symbol with a base value and extra bits, see RFC 1951
+static const int LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const int DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+	4097, 6145, 8193, 12289, 16385, 24577 };
+static const int DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+//Huffman codes are stored starting with their most significant bit, while everything else in the stream starts with the least significant one
+static uint32_t reverseBits(uint32_t bits, int count) {
+	uint32_t reversed = 0;
+	for (int i = 0; i < count; i++) {
+		reversed = (reversed << 1) | ((bits >> i) & 1);
+	}
+	return reversed;
+}
+
+//the fixed Huffman codes of every literal and length symbol, already reversed
+struct FixedCodes {
+	uint32_t codes[288];
+	int lengths[288];
+	uint32_t distances[30];
+
+	FixedCodes() {
+		for (int symbol = 0; symbol < 288; symbol++) {
+			uint32_t code;
+			if (symbol < 144) {
+				code = 0x30 + symbol;
+				lengths[symbol] = 8;
+			} else if (symbol < 256) {
+				code = 0x190 + symbol - 144;
+				lengths[symbol] = 9;
+			} else if (symbol < 280) {
+				code = symbol - 256;
+				lengths[symbol] = 7;
+			} else {
+				code = 0xC0 + symbol - 280;
+				lengths[symbol] = 8;
+			}
+			codes[symbol] = reverseBits(code, lengths[symbol]);
+		}
+		for (int symbol = 0; symbol < 30; symbol++) {
+			distances[symbol] = reverseBits(symbol, 5);
+		}
+	}
+};
+static const FixedCodes FIXED_CODES;
+
+//built once before main(), so writers on different threads never race to fill it in
+struct CrcTable {
+	uint32_t values[256];
+
+	CrcTable() {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; bit++) {
+				value = value & 1 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+			}
+			values[i] = value;
+		}
+	}
+};
+static const CrcTable CRC_TABLE;
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++) {
+		crc = CRC_TABLE.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size) {
+	uint32_t a = adler & 0xFFFF, b = adler >> 16;
+	while (size > 0) {
+		//the sums can't overflow within 5552 bytes, so the modulo is only taken once per run
+		size_t run = std::min<size_t>(size, 5552);
+		for (size_t i = 0; i < run; i++) {
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += run;
+		size -= run;
+	}
+	return (b << 16) | a;
+}
+
+static void putBigEndian(uint8_t* destination, uint32_t value) {
+	destination[0] = (uint8_t)(value >> 24);
+	destination[1] = (uint8_t)(value >> 16);
+	destination[2] = (uint8_t)(value >> 8);
+	destination[3] = (uint8_t)value;
+}
+
+Deflater::Deflater() {
+	//zlib header for a 32 KB window and the fastest compression level
+	compressed = { 0x78, 0x01 };
+	head.assign(1 << HASH_BITS, -1);
+	pending.reserve(BLOCK_SIZE);
+}
+
+void Deflater::write(const uint8_t* data, size_t size) {
+	while (size > 0) {
+		size_t run = std::min(size, BLOCK_SIZE - pending.size());
+		pending.insert(pending.end(), data, data + run);
+		data += run;
+		size -= run;
+		if (pending.size() >= BLOCK_SIZE)
+			compressBlock(false);
+	}
+}
+
+void Deflater::finish() {
+	compressBlock(true);
+	//pad the last byte and end the stream with the checksum of the uncompressed data
+	if (bitCount > 0)
+		writeBits(0, 8 - bitCount);
+	uint8_t checksum[4];
+	putBigEndian(checksum, adler);
+	compressed.insert(compressed.end(), checksum, checksum + 4);
+}
+
+std::vector<uint8_t>& Deflater::output() {
+	return compressed;
+}
+
+void Deflater::writeBits(uint32_t bits, int count) {
+	bitBuffer |= (uint64_t)bits << bitCount;
+	bitCount += count;
+	while (bitCount >= 8) {
+		compressed.push_back((uint8_t)bitBuffer);
+		bitBuffer >>= 8;
+		bitCount -= 8;
+	}
+}
+
+//compresses the pending data into a block with the fixed Huffman codes, matching repeated runs within the block
+void Deflater::compressBlock(bool final) {
+	const uint8_t* data = pending.data();
+	int size = (int)pending.size();
+	adler = adler32(adler, data, size);
+	previous.resize(size);
+	std::fill(head.begin(), head.end(), -1);
+	auto hash = [data](int position) {
+		uint32_t value = data[position] | (data[position + 1] << 8) | (data[position + 2] << 16);
+		return (value * 2654435761u) >> (32 - HASH_BITS);
+	};
+
+	writeBits(final ? 1 : 0, 1);
+	writeBits(1, 2);
+	int position = 0;
+	while (position < size) {
+		int bestLength = 0, bestDistance = 0;
+		if (position + MIN_MATCH <= size) {
+			uint32_t key = hash(position);
+			int limit = std::min(MAX_MATCH, size - position);
+			int candidate = head[key];
+			for (int chain = 0; candidate >= 0 && position - candidate <= WINDOW_SIZE && chain < MAX_CHAIN; chain++) {
+				int length = 0;
+				while (length < limit && data[candidate + length] == data[position + length])
+					length++;
+				if (length > bestLength) {
+					bestLength = length;
+					bestDistance = position - candidate;
+					if (length == limit)
+						break;
+				}
+				candidate = previous[candidate];
+			}
+			previous[position] = head[key];
+			head[key] = position;
+		}
+
+		if (bestLength >= MIN_MATCH) {
+			int lengthSymbol = (int)(std::upper_bound(LENGTH_BASE, LENGTH_BASE + 29, bestLength) - LENGTH_BASE) - 1;
+			writeBits(FIXED_CODES.codes[257 + lengthSymbol], FIXED_CODES.lengths[257 + lengthSymbol]);
+			writeBits(bestLength - LENGTH_BASE[lengthSymbol], LENGTH_EXTRA[lengthSymbol]);
+			int distanceSymbol = (int)(std::upper_bound(DISTANCE_BASE, DISTANCE_BASE + 30, bestDistance) - DISTANCE_BASE) - 1;
+			writeBits(FIXED_CODES.distances[distanceSymbol], 5);
+			writeBits(bestDistance - DISTANCE_BASE[distanceSymbol], DISTANCE_EXTRA[distanceSymbol]);
+
+			//the positions inside the match are hashed as well, so later runs can match against them
+			int end = position + bestLength;
+			for (position++; position < end; position++) {
+				if (position + MIN_MATCH <= size) {
+					uint32_t key = hash(position);
+					previous[position] = head[key];
+					head[key] = position;
+				}
+			}
+		} else {
+			writeBits(FIXED_CODES.codes[data[position]], FIXED_CODES.lengths[data[position]]);
+			position++;
+		}
+	}
+	writeBits(FIXED_CODES.codes[256], FIXED_CODES.lengths[256]);
+	pending.clear();
+}
+
+PngWriter::PngWriter(const std::string& path, int width, int height, int channels) : width(width), height(height), channels(channels) {
+	file = fopen(path.c_str(), "wb");
+	if (!file)
+		return;
+
+	static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	failed = fwrite(SIGNATURE, 1, 8, file) != 8;
+	uint8_t header[13];
+	putBigEndian(header, width);
+	putBigEndian(header + 4, height);
+	header[8] = 8; //bits per channel
+	header[9] = channels == 4 ? 6 : 2; //RGBA or RGB
+	header[10] = 0; //deflate
+	header[11] = 0; //adaptive filtering
+	header[12] = 0; //not interlaced
+	writeChunk("IHDR", header, sizeof(header));
+	row.resize((size_t)width * channels + 1);
+}
+
+PngWriter::~PngWriter() {
+	close();
+}
+
+bool PngWriter::isOpen() const {
+	return file != nullptr;
+}
+
+void PngWriter::writeChunk(const char* type, const uint8_t* data, size_t size) {
+	uint8_t header[8];
+	putBigEndian(header, (uint32_t)size);
+	memcpy(header + 4, type, 4);
+	uint8_t crc[4];
+	putBigEndian(crc, crc32(crc32(0, header + 4, 4), data, size));
+	failed = failed || fwrite(header, 1, 8, file) != 8 || (size > 0 && fwrite(data, 1, size, file) != size) || fwrite(crc, 1, 4, file) != 4;
+}
+
+void PngWriter::writeRows(const unsigned char* first, int rows, ptrdiff_t stride) {
+	if (!file)
+		return;
+	size_t rowSize = (size_t)width * channels;
+	for (int i = 0; i < rows && rowsWritten < height; i++, rowsWritten++) {
+		//the Sub filter stores every byte as the difference with the same channel of the pixel to its left
+		const unsigned char* source = first + i * stride;
+		row[0] = 1;
+		memcpy(&row[1], source, std::min(rowSize, (size_t)channels));
+		for (size_t j = channels; j < rowSize; j++) {
+			row[j + 1] = (uint8_t)(source[j] - source[j - channels]);
+		}
+		deflater.write(row.data(), row.size());
+		//the deflater only has output once it has compressed a block
+		flushChunks();
+	}
+}
+
+void PngWriter::flushChunks() {
+	std::vector<uint8_t>& compressed = deflater.output();
+	if (!compressed.empty()) {
+		writeChunk("IDAT", compressed.data(), compressed.size());
+		compressed.clear();
+	}
+}
+
+bool PngWriter::close() {
+	if (!file)
+		return false;
+	if (rowsWritten < height) {
+		//the image is cut short, the rest is left black
+		std::vector<unsigned char> black((size_t)width * channels, 0);
+		while (rowsWritten < height)
+			writeRows(black.data(), 1, 0);
+	}
+
+	deflater.finish();
+	flushChunks();
+	writeChunk("IEND", nullptr, 0);
+
+	bool written = !failed && fclose(file) == 0;
+	file = nullptr;
+	return written;
+}
+
+bool writePng(const std::string& path, int width, int height, int channels, const unsigned char* pixels, bool bottomUp) {
+	PngWriter writer(path, width, height, channels);
+	if (!writer.isOpen())
+		return false;
+	ptrdiff_t stride = (ptrdiff_t)width * channels;
+	writer.writeRows(bottomUp ? pixels + (height - 1) * stride : pixels, height, bottomUp ? -stride : stride);
+	return writer.close();
+}
+
+static void putLittleEndian(std::vector<uint8_t>& destination, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++) {
+		destination.push_back((uint8_t)(value >> (i * 8)));
+	}
+}
+
+TiffWriter::TiffWriter(const std::string& path, int width, int height, int tileSize, int channels)
+	: width(width), height(height), tileSize(tileSize), channels(channels) {
+	//the largest the file can get: every tile is padded to its full size, and deflate with fixed codes stores a byte in up to 9 bits. Every
+	//tile adds its zlib header, checksum and the ends of its blocks, and the directory is followed by the offsets and sizes of all tiles.
+	//When that could reach past 4 GB, the offsets might not fit in 32 bits
+	uint64_t tiles = (uint64_t)getColumns() * getRows();
+	uint64_t tileBytes = (uint64_t)tileSize * tileSize * channels;
+	uint64_t largestTile = tileBytes + (tileBytes + 7) / 8 + 16 + 2 * (tileBytes / BLOCK_SIZE + 1);
+	uint64_t largestFile = 16 + tiles * largestTile + 1 + 512 + tiles * 2 * 4;
+	big = largestFile > 0xFFFFFFFFull;
+	offsets.assign((size_t)tiles, 0);
+	sizes.assign(offsets.size(), 0);
+	file = fopen(path.c_str(), "wb");
+	if (!file)
+		return;
+
+	//little endian, the offset of the directory is filled in once it's written after the last tile
+	std::vector<uint8_t> header = { 'I', 'I' };
+	if (big) {
+		putLittleEndian(header, 43, 2);
+		putLittleEndian(header, 8, 2); //size of an offset
+		putLittleEndian(header, 0, 2);
+		putLittleEndian(header, 0, 8);
+	} else {
+		putLittleEndian(header, 42, 2);
+		putLittleEndian(header, 0, 4);
+	}
+	failed = fwrite(header.data(), 1, header.size(), file) != header.size();
+	offset = header.size();
+}
+
+TiffWriter::~TiffWriter() {
+	close();
+}
+
+bool TiffWriter::isOpen() const {
+	return file != nullptr;
+}
+
+int TiffWriter::getColumns() const {
+	return (width + tileSize - 1) / tileSize;
+}
+
+int TiffWriter::getRows() const {
+	return (height + tileSize - 1) / tileSize;
+}
+
+std::vector<uint8_t> TiffWriter::compressTile(const unsigned char* first, ptrdiff_t stride) const {
+	Deflater deflater;
+	size_t rowSize = (size_t)tileSize * channels;
+	std::vector<uint8_t> row(rowSize);
+	for (int i = 0; i < tileSize; i++) {
+		//the horizontal predictor is the same as the Sub filter of PNG files
+		const unsigned char* source = first + i * stride;
+		memcpy(row.data(), source, channels);
+		for (size_t j = channels; j < rowSize; j++) {
+			row[j] = (uint8_t)(source[j] - source[j - channels]);
+		}
+		deflater.write(row.data(), rowSize);
+	}
+	deflater.finish();
+	return std::move(deflater.output());
+}
+
+void TiffWriter::writeTile(int index, const std::vector<uint8_t>& compressed) {
+	if (!file || index < 0 || index >= (int)offsets.size())
+		return;
+	failed = failed || fwrite(compressed.data(), 1, compressed.size(), file) != compressed.size();
+	offsets[index] = offset;
+	sizes[index] = compressed.size();
+	offset += compressed.size();
+}
+
+bool TiffWriter::close() {
+	if (!file)
+		return false;
+	//tiles that were never written are left black, readers don't accept tiles without any data
+	std::vector<uint8_t> black;
+	for (size_t i = 0; i < offsets.size(); i++) {
+		if (sizes[i] == 0) {
+			if (black.empty()) {
+				std::vector<unsigned char> pixels((size_t)tileSize * tileSize * channels, 0);
+				black = compressTile(pixels.data(), (ptrdiff_t)tileSize * channels);
+			}
+			writeTile((int)i, black);
+		}
+	}
+
+	//the directory has to start on a word boundary
+	if (offset % 2 != 0) {
+		uint8_t padding = 0;
+		failed = failed || fwrite(&padding, 1, 1, file) != 1;
+		offset++;
+	}
+
+	enum Type { SHORT = 3, LONG = 4, LONG8 = 16 };
+	struct Entry {
+		uint16_t tag;
+		Type type;
+		std::vector<uint64_t> values;
+	};
+	Type offsetType = big ? LONG8 : LONG;
+	std::vector<Entry> entries = {
+		{ 256, LONG, { (uint64_t)width } },
+		{ 257, LONG, { (uint64_t)height } },
+		{ 258, SHORT, std::vector<uint64_t>(channels, 8) }, //bits per sample
+		{ 259, SHORT, { 8 } }, //deflate
+		{ 262, SHORT, { 2 } }, //RGB
+		{ 277, SHORT, { (uint64_t)channels } },
+		{ 284, SHORT, { 1 } }, //the channels of a pixel are stored together
+		{ 317, SHORT, { 2 } }, //horizontal predictor
+		{ 322, LONG, { (uint64_t)tileSize } },
+		{ 323, LONG, { (uint64_t)tileSize } },
+		{ 324, offsetType, offsets },
+		{ 325, offsetType, sizes }
+	};
+	if (channels == 4)
+		entries.push_back({ 338, SHORT, { 2 } }); //unassociated alpha
+
+	//values that don't fit in an entry are stored after the directory
+	int countSize = big ? 8 : 2, fieldSize = big ? 8 : 4, entrySize = big ? 20 : 12;
+	uint64_t directory = offset;
+	uint64_t extra = directory + countSize + entries.size() * entrySize + fieldSize;
+	std::vector<uint8_t> table, values;
+	putLittleEndian(table, entries.size(), countSize);
+	for (const Entry& entry : entries) {
+		int size = entry.type == SHORT ? 2 : entry.type == LONG ? 4 : 8;
+		putLittleEndian(table, entry.tag, 2);
+		putLittleEndian(table, entry.type, 2);
+		putLittleEndian(table, entry.values.size(), big ? 8 : 4);
+		std::vector<uint8_t>& destination = entry.values.size() * size <= (size_t)fieldSize ? table : values;
+		if (&destination == &values) {
+			putLittleEndian(table, extra + values.size(), fieldSize);
+		}
+		size_t start = destination.size();
+		for (uint64_t value : entry.values) {
+			putLittleEndian(destination, value, size);
+		}
+		//values inside the entry are padded to the size of the field
+		if (&destination == &table)
+			putLittleEndian(table, 0, fieldSize - (int)(table.size() - start));
+		else if (values.size() % 2 != 0)
+			values.push_back(0);
+	}
+	putLittleEndian(table, 0, fieldSize); //no further directories
+	failed = failed || fwrite(table.data(), 1, table.size(), file) != table.size() || fwrite(values.data(), 1, values.size(), file) != values.size();
+
+	//point the header to the directory
+	std::vector<uint8_t> pointer;
+	putLittleEndian(pointer, directory, fieldSize);
+	failed = failed || fseek(file, big ? 8 : 4, SEEK_SET) != 0 || fwrite(pointer.data(), 1, pointer.size(), file) != pointer.size();
+
+	bool written = !failed && fclose(file) == 0;
+	file = nullptr;
+	return written;
+}
+
+//the order in which the coefficients of a block are stored, from the lowest frequencies to the highest
+static const int ZIGZAG[64] = { 0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21,
+	28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+
+//the example quantization tables of the JPEG standard for quality 50, in the order of the pixels
+static const uint8_t LUMA_QUANTIZATION[64] = { 16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55, 14, 13, 16, 24, 40, 57, 69, 56,
+	14, 17, 22, 29, 51, 87, 80, 62, 18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92, 49, 64, 78, 87, 103, 121, 120, 101,
+	72, 92, 95, 98, 112, 100, 103, 99 };
+static const uint8_t CHROMA_QUANTIZATION[64] = { 17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99, 99, 99,
+	47, 66, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99 };
+
+//the standard Huffman tables as they're stored in the file: the amount of codes of every length from 1 to 16 bits, followed by the symbols
+static const uint8_t DC_LUMA_TABLE[28] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+static const uint8_t DC_CHROMA_TABLE[28] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+static const uint8_t AC_LUMA_TABLE[178] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D,
+	0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08,
+	0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+	0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+	0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6,
+	0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+	0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA };
+static const uint8_t AC_CHROMA_TABLE[178] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77,
+	0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91,
+	0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+	0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+	0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+	0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4,
+	0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+	0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA };
+
+//the code and length of every symbol of a Huffman table, codes are handed out in the order of the symbols from the shortest to the longest
+struct JpegCodes {
+	uint16_t codes[256] = {};
+	uint8_t lengths[256] = {};
+
+	JpegCodes(const uint8_t* table) {
+		const uint8_t* symbols = table + 16;
+		uint16_t code = 0;
+		for (int length = 1; length <= 16; length++) {
+			for (int i = 0; i < table[length - 1]; i++) {
+				codes[*symbols] = code++;
+				lengths[*symbols++] = (uint8_t)length;
+			}
+			code <<= 1;
+		}
+	}
+};
+static const JpegCodes DC_LUMA_CODES(DC_LUMA_TABLE), DC_CHROMA_CODES(DC_CHROMA_TABLE), AC_LUMA_CODES(AC_LUMA_TABLE), AC_CHROMA_CODES(AC_CHROMA_TABLE);
+
+//the entropy coded data of a JPEG file, which starts with the most significant bit and escapes every 0xFF byte with a 0x00
+struct JpegBits {
+	std::vector<uint8_t>& output;
+	uint32_t buffer = 0;
+	int count = 0;
+
+	JpegBits(std::vector<uint8_t>& output) : output(output) {}
+
+	void write(uint32_t bits, int length) {
+		buffer = (buffer << length) | (bits & ((1u << length) - 1));
+		count += length;
+		while (count >= 8) {
+			uint8_t byte = (uint8_t)(buffer >> (count - 8));
+			output.push_back(byte);
+			if (byte == 0xFF)
+				output.push_back(0);
+			count -= 8;
+		}
+	}
+
+	//the last byte is padded with ones
+	void flush() {
+		if (count > 0)
+			write(0x7F, 8 - count);
+	}
+};
+
+//a one dimensional DCT of 8 values that are step floats apart, with the factorization of Arai, Agui and Nakajima (AAN). Its outputs are
+//scaled by a factor per frequency, which is taken out together with the quantization
+static void forwardDct(float* d, int step) {
+	float tmp0 = d[0] + d[7 * step], tmp7 = d[0] - d[7 * step];
+	float tmp1 = d[step] + d[6 * step], tmp6 = d[step] - d[6 * step];
+	float tmp2 = d[2 * step] + d[5 * step], tmp5 = d[2 * step] - d[5 * step];
+	float tmp3 = d[3 * step] + d[4 * step], tmp4 = d[3 * step] - d[4 * step];
+
+	float tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+	float tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+	d[0] = tmp10 + tmp11;
+	d[4 * step] = tmp10 - tmp11;
+	float z1 = (tmp12 + tmp13) * 0.707106781f;
+	d[2 * step] = tmp13 + z1;
+	d[6 * step] = tmp13 - z1;
+
+	tmp10 = tmp4 + tmp5;
+	tmp11 = tmp5 + tmp6;
+	tmp12 = tmp6 + tmp7;
+	float z5 = (tmp10 - tmp12) * 0.382683433f;
+	float z2 = tmp10 * 0.541196100f + z5;
+	float z4 = tmp12 * 1.306562965f + z5;
+	float z3 = tmp11 * 0.707106781f;
+	float z11 = tmp7 + z3, z13 = tmp7 - z3;
+	d[5 * step] = z13 + z2;
+	d[3 * step] = z13 - z2;
+	d[step] = z11 + z4;
+	d[7 * step] = z11 - z4;
+}
+
+//transforms, quantizes and writes a block of 8x8 values, returns its DC coefficient, which is stored as the difference to the previous one
+static int encodeBlock(JpegBits& bits, float* block, const float* scales, int previousDc, const JpegCodes& dcCodes, const JpegCodes& acCodes) {
+	for (int row = 0; row < 8; row++) {
+		forwardDct(block + row * 8, 1);
+	}
+	for (int column = 0; column < 8; column++) {
+		forwardDct(block + column, 8);
+	}
+	int coefficients[64];
+	for (int i = 0; i < 64; i++) {
+		float value = block[ZIGZAG[i]] * scales[ZIGZAG[i]];
+		coefficients[i] = (int)(value < 0.0f ? value - 0.5f : value + 0.5f);
+	}
+
+	//values are written as the amount of bits they need, followed by the bits themselves, negative values are stored minus one
+	auto writeValue = [&bits](const JpegCodes& codes, int symbol, int value) {
+		int magnitude = value < 0 ? -value : value;
+		int length = 0;
+		while (magnitude >> length)
+			length++;
+		bits.write(codes.codes[symbol | length], codes.lengths[symbol | length]);
+		if (length > 0)
+			bits.write(value < 0 ? value - 1 : value, length);
+	};
+	writeValue(dcCodes, 0, coefficients[0] - previousDc);
+	int last = 63;
+	while (last > 0 && coefficients[last] == 0)
+		last--;
+	int zeros = 0;
+	for (int i = 1; i <= last; i++) {
+		if (coefficients[i] == 0) {
+			zeros++;
+			continue;
+		}
+		//runs of more than 15 zeros are split up
+		for (; zeros >= 16; zeros -= 16) {
+			bits.write(acCodes.codes[0xF0], acCodes.lengths[0xF0]);
+		}
+		writeValue(acCodes, zeros << 4, coefficients[i]);
+		zeros = 0;
+	}
+	//the rest of the block is zero
+	if (last < 63)
+		bits.write(acCodes.codes[0], acCodes.lengths[0]);
+	return coefficients[0];
+}
+
+static void putMarker(std::vector<uint8_t>& output, uint8_t marker, size_t length) {
+	output.push_back(0xFF);
+	output.push_back(marker);
+	output.push_back((uint8_t)((length + 2) >> 8));
+	output.push_back((uint8_t)(length + 2));
+}
+
+std::vector<uint8_t> encodeJpeg(int width, int height, const unsigned char* first, ptrdiff_t stride, int quality) {
+	quality = std::min(std::max(quality, 1), 100);
+	int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+	uint8_t quantization[2][64];
+	//the quantization is combined with the scale factors of the DCT, and 8 for the scale of the two dimensional DCT
+	static const float DCT_FACTORS[8] = { 1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f };
+	float scales[2][64];
+	for (int i = 0; i < 64; i++) {
+		quantization[0][i] = (uint8_t)std::min(std::max((LUMA_QUANTIZATION[i] * scale + 50) / 100, 1), 255);
+		quantization[1][i] = (uint8_t)std::min(std::max((CHROMA_QUANTIZATION[i] * scale + 50) / 100, 1), 255);
+		for (int table = 0; table < 2; table++) {
+			scales[table][i] = 1.0f / (quantization[table][i] * DCT_FACTORS[i / 8] * DCT_FACTORS[i % 8] * 8.0f);
+		}
+	}
+
+	std::vector<uint8_t> output = { 0xFF, 0xD8 };
+	static const uint8_t JFIF[14] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+	putMarker(output, 0xE0, sizeof(JFIF));
+	output.insert(output.end(), JFIF, JFIF + sizeof(JFIF));
+	//the quantization tables are stored in zigzag order
+	putMarker(output, 0xDB, 2 * 65);
+	for (int table = 0; table < 2; table++) {
+		output.push_back((uint8_t)table);
+		for (int i = 0; i < 64; i++) {
+			output.push_back(quantization[table][ZIGZAG[i]]);
+		}
+	}
+	//the luma is stored at full resolution, both chroma channels at half the resolution in both directions
+	static const uint8_t COMPONENTS[9] = { 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1 };
+	putMarker(output, 0xC0, 6 + sizeof(COMPONENTS));
+	output.insert(output.end(), { 8, (uint8_t)(height >> 8), (uint8_t)height, (uint8_t)(width >> 8), (uint8_t)width, 3 });
+	output.insert(output.end(), COMPONENTS, COMPONENTS + sizeof(COMPONENTS));
+	putMarker(output, 0xC4, 4 + sizeof(DC_LUMA_TABLE) + sizeof(AC_LUMA_TABLE) + sizeof(DC_CHROMA_TABLE) + sizeof(AC_CHROMA_TABLE));
+	const std::pair<uint8_t, const uint8_t*> tables[4] = { { 0x00, DC_LUMA_TABLE }, { 0x10, AC_LUMA_TABLE }, { 0x01, DC_CHROMA_TABLE }, { 0x11, AC_CHROMA_TABLE } };
+	for (const auto& table : tables) {
+		output.push_back(table.first);
+		size_t symbols = 0;
+		for (int length = 0; length < 16; length++) {
+			symbols += table.second[length];
+		}
+		output.insert(output.end(), table.second, table.second + 16 + symbols);
+	}
+	static const uint8_t SCAN[10] = { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+	putMarker(output, 0xDA, sizeof(SCAN));
+	output.insert(output.end(), SCAN, SCAN + sizeof(SCAN));
+
+	//the image is encoded in blocks of 16x16 pixels, pixels past the right and bottom edge repeat the last column and row
+	JpegBits bits(output);
+	int dc[3] = { 0, 0, 0 };
+	float y[256], cb[256], cr[256], block[64];
+	for (int top = 0; top < height; top += 16) {
+		for (int left = 0; left < width; left += 16) {
+			for (int row = 0; row < 16; row++) {
+				const unsigned char* line = first + std::min(top + row, height - 1) * stride;
+				for (int column = 0; column < 16; column++) {
+					const unsigned char* pixel = line + std::min(left + column, width - 1) * 3;
+					float r = pixel[0], g = pixel[1], b = pixel[2];
+					int i = row * 16 + column;
+					y[i] = 0.299f * r + 0.587f * g + 0.114f * b - 128.0f;
+					cb[i] = -0.168736f * r - 0.331264f * g + 0.5f * b;
+					cr[i] = 0.5f * r - 0.418688f * g - 0.081312f * b;
+				}
+			}
+			for (int i = 0; i < 4; i++) {
+				for (int j = 0; j < 64; j++) {
+					block[j] = y[((i / 2) * 8 + j / 8) * 16 + (i % 2) * 8 + j % 8];
+				}
+				dc[0] = encodeBlock(bits, block, scales[0], dc[0], DC_LUMA_CODES, AC_LUMA_CODES);
+			}
+			float* chroma[2] = { cb, cr };
+			for (int channel = 0; channel < 2; channel++) {
+				//every chroma value is the average of 2x2 pixels
+				for (int j = 0; j < 64; j++) {
+					const float* values = chroma[channel] + (j / 8) * 32 + (j % 8) * 2;
+					block[j] = (values[0] + values[1] + values[16] + values[17]) * 0.25f;
+				}
+				dc[channel + 1] = encodeBlock(bits, block, scales[1], dc[channel + 1], DC_CHROMA_CODES, AC_CHROMA_CODES);
+			}
+		}
+	}
+	bits.flush();
+	output.insert(output.end(), { 0xFF, 0xD9 });
+	return output;
+}
@@ -0,0 +1,151 @@
+#include <glad/glad.h>
+
+#include <lensflare.h>
+#include <glstate.h>
+#include <gpumemory.h>
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+//quad that's used both for the occlusion disc and for every sprite of the flare
+static const float QUAD_VERTICES[8] = {
+	-1.0f, -1.0f,
+	 1.0f, -1.0f,
+	-1.0f,  1.0f,
+	 1.0f,  1.0f
+};
+
+LensFlare::LensFlare() {
+	glGenQueries(QUERY_FRAMES, visibleQueries);
+	glGenQueries(QUERY_FRAMES, totalQueries);
+
+	glGenVertexArrays(1, &quadVAO);
+	glGenBuffers(1, &quadVBO);
+	GLState::bindVertexArray(quadVAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD_VERTICES), QUAD_VERTICES, GL_STATIC_DRAW);
+	GPUMemory::buffer(quadVBO, GPUMemory::MEMORY_MODELS, sizeof(QUAD_VERTICES));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+}
+
+LensFlare::~LensFlare() {
+	glDeleteQueries(QUERY_FRAMES, visibleQueries);
+	glDeleteQueries(QUERY_FRAMES, totalQueries);
+	GLState::deleteVertexArrays(1, &quadVAO);
+	GLState::deleteBuffers(1, &quadVBO);
+}
+
+//reads the results of the queries in the given slot if the GPU is done with them, otherwise the previous visibility is kept
+void LensFlare::readResults(int slot) {
+	if (!pending[slot])
+		return;
+
+	//the total query is issued last, so when its result is available the result of the visible query is as well
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(totalQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	GLuint visibleSamples, totalSamples;
+	glGetQueryObjectuiv(visibleQueries[slot], GL_QUERY_RESULT, &visibleSamples);
+	glGetQueryObjectuiv(totalQueries[slot], GL_QUERY_RESULT, &totalSamples);
+	if (discSamples[slot] > 0.0f)
+		visibility = std::min((float)visibleSamples / discSamples[slot], 1.0f);
+	else
+		visibility = totalSamples > 0 ? (float)visibleSamples / totalSamples : 0.0f;
+	pending[slot] = false;
+}
+
+void LensFlare::testVisibility(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const glm::vec2& viewportSize, const glm::vec3& sunPos,
+	float sunRadius, const glm::vec3& viewPos) {
+	//the slot of this frame holds the queries of QUERY_FRAMES frames ago, read them before they're overwritten
+	int slot = frame % QUERY_FRAMES;
+	readResults(slot);
+	frame++;
+
+	//place a disc facing the camera just in front of the surface of the Sun, so the Sun itself doesn't hide it
+	glm::vec3 toCamera = glm::normalize(viewPos - sunPos);
+	glm::vec3 right = glm::normalize(glm::cross(glm::abs(toCamera.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f), toCamera));
+	glm::vec3 up = glm::cross(toCamera, right);
+	glm::vec3 center = sunPos + toCamera * sunRadius * 1.01f;
+
+	//the area of the whole disc on screen in pixels, including the parts outside of the view, from the outline projected onto the screen.
+	//Only when the disc reaches behind the camera it can't be projected, the total query then counts the part in view instead
+	discSamples[slot] = 0.0f;
+	glm::mat4 viewProjection = projection * view;
+	glm::vec2 outline[OUTLINE_POINTS];
+	bool inFront = true;
+	for (int i = 0; i < OUTLINE_POINTS && inFront; i++) {
+		float angle = glm::two_pi<float>() * i / OUTLINE_POINTS;
+		glm::vec4 clipPos = viewProjection * glm::vec4(center + (right * std::cos(angle) + up * std::sin(angle)) * sunRadius, 1.0f);
+		inFront = clipPos.w > 0.0f;
+		outline[i] = glm::vec2(clipPos) / clipPos.w * 0.5f * viewportSize;
+	}
+	if (inFront) {
+		float area = 0.0f;
+		for (int i = 0; i < OUTLINE_POINTS; i++) {
+			const glm::vec2& a = outline[i];
+			const glm::vec2& b = outline[(i + 1) % OUTLINE_POINTS];
+			area += a.x * b.y - b.x * a.y;
+		}
+		discSamples[slot] = std::abs(area) * 0.5f;
+	}
+
+	shader.use();
+	shader.setMat4("view", view);
+	shader.setMat4("projection", projection);
+	shader.setVec3("center", center);
+	shader.setVec3("right", right * sunRadius);
+	shader.setVec3("up", up * sunRadius);
+
+	//the disc only has to be counted, not drawn
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	GLState::depthMask(GL_FALSE);
+	GLState::bindVertexArray(quadVAO);
+
+	glBeginQuery(GL_SAMPLES_PASSED, visibleQueries[slot]);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glEndQuery(GL_SAMPLES_PASSED);
+
+	GLState::depthFunc(GL_ALWAYS);
+	glBeginQuery(GL_SAMPLES_PASSED, totalQueries[slot]);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glEndQuery(GL_SAMPLES_PASSED);
+	GLState::depthFunc(GL_LEQUAL);
+
+	pending[slot] = true;
+	GLState::depthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+/*
+The flare is a set of sprites along the line from the Sun through the center of the screen, the way reflections between the lenses
+of a camera line up. Each sprite is an instance of the same quad, its position along the line, size and color are looked up in
+the flare shader by gl_InstanceID.
+*/
+void LensFlare::draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& sunPos, float aspect, const glm::vec4& tile) {
+	glm::vec4 clipPos = projection * view * glm::vec4(sunPos, 1.0f);
+	//no flare when the Sun is behind the camera or fully hidden
+	if (clipPos.w <= 0.0f || visibility <= 0.0f)
+		return;
+
+	shader.use();
+	shader.setVec2("sunPos", glm::vec2(clipPos) / clipPos.w);
+	shader.setFloat("aspect", aspect);
+	shader.setVec4("tile", tile);
+	shader.setFloat("intensity", visibility);
+
+	GLState::disable(GL_DEPTH_TEST);
+	GLState::blendFunc(GL_SRC_ALPHA, GL_ONE);
+	GLState::bindVertexArray(quadVAO);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, FLARE_SPRITES);
+	GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLState::enable(GL_DEPTH_TEST);
+}
+
+float LensFlare::getVisibility() const {
+	return visibility;
+}
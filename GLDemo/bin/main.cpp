@@ -10,6 +10,10 @@
 
 #include <IK/irrKlang.h>
 
+#include <extensions.h>
+#include <glstate.h>
+#include <gpumemory.h>
+#include <options.h>
 #include <shader_m.h>
 #include <camera.h>
 #include <model.h>
@@ -17,7 +21,31 @@
 #include <FBO.h>
 #include <HUD.h>
 #include <skybox.h>
+#include <atmosphere.h>
+#include <orbits.h>
+#include <uniforms.h>
+#include <lensflare.h>
+#include <threadpool.h>
+#include <texturestreamer.h>
+#include <virtualtexture.h>
+#include <resources.h>
+#include <startup.h>
+#include <simulation.h>
+#include <videoexport.h>
+#include <posterexport.h>
+#include <framestream.h>
+#include <framepacer.h>
+#include <framestats.h>
+#include <minorplanets.h>
+#include <bodyindex.h>
+#include <scene.h>
+#include <stereo.h>
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <filesystem>
@@ -30,7 +58,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
-vector<vector<Texture>> loadTextureAtlas(string path);
+void loadTextureAtlas(string path, Resources& resources, VirtualTextures& virtualTextures, vector<vector<Texture>>& textureAtlas);
 
 //gets called when setting up the window goes wrong
 static void glfwError(int id, const char* description)
@@ -48,6 +76,35 @@ const char * MUSIC_PATH = "./bin/audio/foregonedestruction.mp3";
 const char * FONT_PATH = "./bin/fonts/arial.ttf";
 const char * PLANET_TEXTURES_PATH = "./bin/textures/planets/";
 
+//textures are streamed to the GPU through a ring of this size, with at most TEXTURE_UPLOAD_BUDGET bytes per frame so loading never causes a hitch
+const size_t TEXTURE_RING_SIZE = 16 * 1024 * 1024;
+const size_t TEXTURE_UPLOAD_BUDGET = 4 * 1024 * 1024;
+//steps per second of the simulation thread
+const double SIMULATION_RATE = 240.0;
+//the main view, a close-up of two planetoids and the orbit map
+const int MAX_VIEWS = 4;
+//distance from the Sun to the edge of the orbit map, a little past the orbit of Neptune
+const float ORBIT_MAP_EXTENT = 80.0f;
+//frames drawn before an export starts recording, on top of waiting for the textures and atmospheres, so the virtual textures can load the pages in view
+const int EXPORT_WARMUP_FRAMES = 30;
+//frames drawn before each tile of a poster, for the pages of the virtual textures it needs at its resolution to be loaded
+const int POSTER_TILE_FRAMES = 12;
+//bodies are picked when the ray through the crosshair comes within this many pixels of them, and counted as nearby within NEARBY_DISTANCE of the camera
+const float PICK_RADIUS = 4.0f;
+const float NEARBY_DISTANCE = 5.0f;
+//pages along a side of the page cache of each format used by virtual textures, 32 pages of 128x128 pixels take 8 MB for BC1 and BC4 and 16 MB for BC5
+const int VIRTUAL_CACHE_PAGES = 32;
+
+//the models used by the planetoids, they're imported on worker threads during startup
+enum ModelIndex { MODEL_SPHERE, MODEL_RING, MODEL_PHOBOS, MODEL_DEIMOS };
+const std::vector<std::string> MODEL_PATHS
+{
+	"./bin/models/newsphere.obj",
+	"./bin/models/ring.obj",
+	"./bin/models/phobos.3DS",
+	"./bin/models/deimos.3ds"
+};
+
 const std::vector<std::string> SKYBOX_FACES
 {
 	"./bin/textures/skybox/bkg1_right.png",
@@ -58,77 +115,311 @@ const std::vector<std::string> SKYBOX_FACES
 	"./bin/textures/skybox/bkg1_back.png"
 };
 
+//atmosphere profiles, all distances are relative to the radius of the planetoid (see atmosphere.h)
+const AtmosphereProfile EARTH_ATMOSPHERE{ "earth", 0.06f, glm::vec3(3.9f, 9.0f, 22.0f), 0.012f, 8.4f, 0.003f, 0.76f, 20.0f };
+const AtmosphereProfile VENUS_ATMOSPHERE{ "venus", 0.08f, glm::vec3(6.0f, 7.5f, 9.0f), 0.02f, 30.0f, 0.015f, 0.7f, 12.0f };
+const AtmosphereProfile MARS_ATMOSPHERE{ "mars", 0.04f, glm::vec3(1.2f, 0.9f, 0.5f), 0.012f, 6.0f, 0.008f, 0.65f, 20.0f };
+const AtmosphereProfile JUPITER_ATMOSPHERE{ "jupiter", 0.03f, glm::vec3(4.0f, 5.0f, 7.0f), 0.008f, 4.0f, 0.004f, 0.7f, 12.0f };
+const AtmosphereProfile SATURN_ATMOSPHERE{ "saturn", 0.03f, glm::vec3(4.5f, 5.0f, 5.5f), 0.008f, 4.0f, 0.004f, 0.7f, 12.0f };
+const AtmosphereProfile URANUS_ATMOSPHERE{ "uranus", 0.04f, glm::vec3(2.0f, 8.0f, 12.0f), 0.01f, 1.0f, 0.004f, 0.7f, 16.0f };
+const AtmosphereProfile NEPTUNE_ATMOSPHERE{ "neptune", 0.04f, glm::vec3(1.5f, 6.0f, 16.0f), 0.01f, 1.0f, 0.004f, 0.7f, 16.0f };
+
 //set up camera to be above the Sun
 Camera camera(0.0f, 61.0f, 0.0f, 0, 1, 0, -88.9f, 180.6);
+//size of the window in pixels, which is what the framebuffer is drawn to at the end of every frame
+int screenWidth = WINDOW_WIDTH;
+int screenHeight = WINDOW_HEIGHT;
 float lastX = (float)WINDOW_WIDTH / 2.0;
 float lastY = (float)WINDOW_HEIGHT / 2.0;
 bool firstMouse = true;
 
 bool turning = true;
 bool turnPressed = false;
+//the resources and the video memory in use are printed once when M is pressed
+bool reportResources = false;
+bool reportPressed = false;
+//the graph of the frame times is shown with G, and the statistics of the frame times are printed with T
+bool showFrameGraph = false;
+bool frameGraphPressed = false;
+//the statistics are printed on exit as well, but only when they were asked for with --frame-log or by showing the graph
+bool frameGraphShown = false;
+bool reportFrameTimes = false;
+bool frameTimesPressed = false;
+//insets with close-ups of a few planetoids and a map of all orbits
+bool showCloseUps = false;
+bool closeUpsPressed = false;
+bool showOrbitMap = false;
+bool orbitMapPressed = false;
 
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main() {
+int main(int argc, char** argv) {
+	/*
+	Every module adds the options it reads to a single table, which reads the command line once and refuses to start with an option that's
+	unknown or invalid.
+	With --export or --pipe on the command line the scene is recorded to video instead of being shown interactively (see videoexport.h).
+	It's rendered at the size of the export rather than the window, and the simulation is advanced by exactly one frame of the video each frame.
+	With --poster a single still of any size is rendered in tiles instead, while the simulation stands still.
+	With --stereo the main view is drawn for both eyes, at the render size per eye (see stereo.h). An export writes an image for every eye.
+	With --stream every frame is also served to other displays over HTTP, the left eye in stereo (see framestream.h).
+	With --latency low or --frame-delay the driver can't queue up frames, so the camera follows the mouse sooner (see framepacer.h).
+	With --catalog the asteroids of a catalog like MPCORB.DAT are drawn along with the planets (see minorplanets.h).
+	With --frame-log the times of every frame are written to a CSV file (see framestats.h).
+	With --gpu-budget a warning is printed when the app takes more than this many MB of video memory, 0 turns it off (see gpumemory.h).
+	*/
+	Options options;
+	ExportSettings exportSettings;
+	exportSettings.addOptions(options);
+	StereoSettings stereoSettings;
+	stereoSettings.addOptions(options);
+	StreamSettings streamSettings;
+	streamSettings.addOptions(options);
+	LatencySettings latencySettings;
+	latencySettings.addOptions(options);
+	std::string catalogPath, frameLogPath;
+	options.add("--catalog", [&catalogPath](const std::string& value) {
+		catalogPath = value;
+		return true;
+	});
+	options.add("--frame-log", [&frameLogPath](const std::string& value) {
+		frameLogPath = value;
+		return true;
+	});
+	options.add("--gpu-budget", [](const std::string& value) {
+		GPUMemory::setBudget((size_t)std::max(0, std::atoi(value.c_str())) * 1024 * 1024);
+		return true;
+	});
+	if (!options.parse(argc, argv))
+		return -1;
+
+	bool exporting = exportSettings.isExporting();
+	int renderWidth = exporting ? exportSettings.width : WINDOW_WIDTH;
+	int renderHeight = exporting ? exportSettings.height : WINDOW_HEIGHT;
+	bool stereo = stereoSettings.layout != STEREO_OFF;
+	if (stereo && exportSettings.poster) {
+		std::cout << "Posters can't be rendered in stereo, rendering a single eye" << std::endl;
+		stereoSettings.layout = STEREO_OFF;
+		stereo = false;
+	}
+	exportSettings.eyes = stereo ? 2 : 1;
+	bool streaming = streamSettings.port > 0;
+	bool lowLatency = latencySettings.lowLatency && !exporting;
+
+	/*
+	The CPU heavy parts of loading (importing the models, rasterizing the font and starting the sound engine) are started on worker threads
+	first, while the render thread creates the window and everything else that needs OpenGL. Their results are uploaded at the end of startup,
+	and the timeline of all stages is printed once the first frame is on screen (see startup.h).
+	*/
+	ThreadPool threadPool;
+	vector<ModelData> importedModels(MODEL_PATHS.size());
+	FontData font;
+	irrklang::ISoundEngine *SoundEngine = nullptr;
+	Startup startup(threadPool);
+
+	vector<Startup::Stage> modelImports;
+	for (size_t i = 0; i < MODEL_PATHS.size(); i++) {
+		modelImports.push_back(startup.addTask("import " + fs::path(MODEL_PATHS[i]).filename().string(), [&importedModels, i]() {
+			importedModels[i] = Model::import(MODEL_PATHS[i]);
+			return !importedModels[i].meshes.empty();
+		}));
+	}
+	Startup::Stage fontRaster = startup.addTask("rasterize font", [&font]() {
+		font = HUD::rasterize(FONT_PATH);
+		return true;
+	});
+	//load sound engine, the application runs without music when there's no audio device
+	startup.addTask("start audio", [&SoundEngine]() {
+		SoundEngine = irrklang::createIrrKlangDevice();
+		if (SoundEngine)
+			SoundEngine->play2D(MUSIC_PATH, GL_TRUE);
+		else
+			std::cout << "Couldn't start the sound engine" << std::endl;
+		return true;
+	});
+	//the application runs without the asteroids when the catalog can't be read
+	MinorPlanetCatalog catalog;
+	Startup::Stage catalogLoad = -1;
+	if (!catalogPath.empty()) {
+		catalogLoad = startup.addTask("load " + fs::path(catalogPath).filename().string(), [&catalog, &catalogPath]() {
+			MinorPlanetCatalog::load(catalogPath, catalog);
+			return true;
+		});
+	}
+	startup.start();
+
 	//The GPU must support OpenGL 3.3+ to be able to run this application, else the program will automatically exit
+	startup.step("create window");
 	glfwSetErrorCallback(&glfwError);
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+	//layered stereo is shown with quad buffered stereo when the driver has it, and next to each other in a regular window when it doesn't
+	if (stereoSettings.layout == STEREO_LAYERED)
+		glfwWindowHint(GLFW_STEREO, GLFW_TRUE);
 	GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
+	if (window == NULL && stereoSettings.layout == STEREO_LAYERED) {
+		glfwWindowHint(GLFW_STEREO, GLFW_FALSE);
+		window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
+	}
 	if (window == NULL) {
 		std::cout << "Couldn't create window" << std::endl;
 		glfwTerminate();
 		return -1;
 	}
 	glfwMakeContextCurrent(window);
+	//everything that owns GL objects is declared after this, so it's all destroyed while the context is still around, on every return
+	//from here on. The window goes last, when this goes out of scope
+	struct WindowGuard {
+		GLFWwindow* window;
+		~WindowGuard() {
+			glfwDestroyWindow(window);
+			glfwTerminate();
+		}
+	} windowGuard{ window };
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetScrollCallback(window, scroll_callback);
-	glfwSwapInterval(1); //enable vsync
+	glfwGetFramebufferSize(window, &screenWidth, &screenHeight);
+	if (exporting) {
+		//the camera isn't controlled during an export so it's the same every time, and frames are rendered as fast as they can be written
+		glfwSwapInterval(0);
+	} else {
+		glfwSetCursorPosCallback(window, mouse_callback);
+		glfwSetScrollCallback(window, scroll_callback);
+		glfwSwapInterval(1); //enable vsync
 
-	//capture mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		//capture mouse, and read its movement before the OS applies pointer acceleration to it when it can
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		if (glfwRawMouseMotionSupported())
+			glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+	}
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+	//load the optional functionality of newer OpenGL versions that the driver supports
+	GLExtensions::load((GLADloadproc)glfwGetProcAddress);
+	//the eye of an instance can only be sent to its layer when vertex shaders can write gl_Layer
+	if (stereoSettings.layout == STEREO_LAYERED && !GLExtensions::vertexShaderLayer) {
+		std::cout << "Layered stereo isn't supported by the driver, drawing the eyes side by side instead" << std::endl;
+		stereoSettings.layout = STEREO_SIDE_BY_SIDE;
+	}
+	//a poster (--poster) is drawn one tile at a time, so the framebuffer only has to be as large as a tile (see posterexport.h)
+	//the tiles have to fit into a texture, smaller tiles only mean more of them
+	if (exportSettings.poster) {
+		GLint maxSize;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+		if (exportSettings.tileSize > maxSize) {
+			exportSettings.tileSize = maxSize / 16 * 16;
+			std::cout << "Tiles are limited to " << exportSettings.tileSize << " pixels by the driver" << std::endl;
+		}
+		renderWidth = renderHeight = exportSettings.tileSize;
+	}
+
+	const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+	int refreshRate = videoMode ? videoMode->refreshRate : 60;
+	std::unique_ptr<FramePacer> framePacer;
+	if (lowLatency)
+		framePacer.reset(new FramePacer(latencySettings, refreshRate));
+
+	//all state changes go through GLState so redundant ones never reach the driver (see glstate.h)
+	GLState::reset();
 
 	//Enable depth testing for skybox support and transparency blending for text rendering
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	//load and compile shaders
-	Shader sphereShader("./bin/shaders/sphere_vs.glsl", "./bin/shaders/sphere_fs.glsl");
-	Shader skyboxShader("./bin/shaders/skybox_vs.glsl", "./bin/shaders/skybox_fs.glsl");
-	Shader screenShader("./bin/shaders/screen_vs.glsl", "./bin/shaders/screen_fs.glsl");
-	Shader hudShader("./bin/shaders/hud_vs.glsl", "./bin/shaders/hud_fs.glsl");
-
-	//load all necessary textures and models
-	Model base("./bin/models/newsphere.obj");
-	Model saturn_ring("./bin/models/ring.obj");
-	Model phobos_base("./bin/models/phobos.3DS");
-	Model deimos_base("./bin/models/deimos.3ds");
-	vector<vector<Texture>> textureAtlas = loadTextureAtlas(PLANET_TEXTURES_PATH);
+	//depth values equal to the depth buffer pass as well, so the skybox can be drawn at the far plane without changing the depth function every frame
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::depthFunc(GL_LEQUAL);
+	GLState::enable(GL_BLEND);
+	GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	//models, textures and shaders are loaded through the resources, which load every file once and release it when it's no longer used
+	TextureStreamer textureStreamer(threadPool, TEXTURE_RING_SIZE, TEXTURE_UPLOAD_BUDGET);
+	Resources resources(textureStreamer);
+
+	//load and compile shaders, programs that aren't cached yet are compiled in the background and finished the first time they're used
+	//the sphere shader is compiled into a variant for every combination of textures the planetoids use (see Planetoid::getVariant)
+	startup.step("shaders");
+	//in stereo the shaders of everything that's drawn for both eyes at once are compiled for the layout of the eyes (see stereo.glsl)
+	vector<string> stereoLayout = stereo ? vector<string>{ stereoSettings.getDefine() } : vector<string>{};
+	vector<string> stereoDefines = stereo ? vector<string>{ "STEREO", stereoSettings.getDefine() } : vector<string>{};
+	ShaderVariants sphereShaders("./bin/shaders/sphere_vs.glsl", "./bin/shaders/sphere_fs.glsl", { "NORMAL_MAP", "SPECULAR_MAP", "EMISSIVE", "VIRTUAL_DIFFUSE", "VIRTUAL_NORMAL", "VIRTUAL_SPECULAR", "STEREO" }, stereoLayout);
+	ShaderHandle skyboxShader = resources.shader("./bin/shaders/skybox_vs.glsl", "./bin/shaders/skybox_fs.glsl", nullptr, stereoDefines);
+	ShaderHandle screenShader = resources.shader("./bin/shaders/screen_vs.glsl", "./bin/shaders/screen_fs.glsl", nullptr,
+		stereoSettings.layout == STEREO_LAYERED ? vector<string>{ "LAYERED" } : vector<string>{});
+	ShaderHandle hudShader = resources.shader("./bin/shaders/hud_vs.glsl", "./bin/shaders/hud_fs.glsl");
+	ShaderHandle atmosphereShader = resources.shader("./bin/shaders/atmosphere_vs.glsl", "./bin/shaders/atmosphere_fs.glsl", nullptr, stereoDefines);
+	ShaderHandle orbitShader = resources.shader("./bin/shaders/orbit_vs.glsl", "./bin/shaders/orbit_fs.glsl", "./bin/shaders/orbit_gs.glsl");
+	ShaderHandle sunQueryShader = resources.shader("./bin/shaders/sunquery_vs.glsl", "./bin/shaders/sunquery_fs.glsl");
+	ShaderHandle flareShader = resources.shader("./bin/shaders/flare_vs.glsl", "./bin/shaders/flare_fs.glsl");
+	ShaderHandle graphShader = resources.shader("./bin/shaders/graph_vs.glsl", "./bin/shaders/graph_fs.glsl");
+	ShaderHandle minorPlanetShader = resources.shader("./bin/shaders/minorplanet_vs.glsl", "./bin/shaders/minorplanet_fs.glsl");
+	ShaderHandle feedbackShader = resources.shader("./bin/shaders/sphere_vs.glsl", "./bin/shaders/vtfeedback_fs.glsl", nullptr, { "EMISSIVE" });
+
+	//start building the atmosphere lookup tables on worker threads while the rest of the scene is loading
+	startup.step("atmospheres");
+	Atmosphere earthAtmosphere(EARTH_ATMOSPHERE);
+	Atmosphere venusAtmosphere(VENUS_ATMOSPHERE);
+	Atmosphere marsAtmosphere(MARS_ATMOSPHERE);
+	Atmosphere jupiterAtmosphere(JUPITER_ATMOSPHERE);
+	Atmosphere saturnAtmosphere(SATURN_ATMOSPHERE);
+	Atmosphere uranusAtmosphere(URANUS_ATMOSPHERE);
+	Atmosphere neptuneAtmosphere(NEPTUNE_ATMOSPHERE);
+
+	//start decoding all textures on worker threads first, they're uploaded a bit every frame once the render loop runs
+	startup.step("textures");
+	vector<vector<Texture>> textureAtlas;
+	VirtualTextures virtualTextures(threadPool, textureStreamer, VIRTUAL_CACHE_PAGES, VIRTUAL_CACHE_TEXTURE_UNIT, renderWidth, renderHeight);
+	loadTextureAtlas(PLANET_TEXTURES_PATH, resources, virtualTextures, textureAtlas);
+	Skybox skybox(SKYBOX_FACES, resources);
+
+	//upload the models and the font once the workers are done with them, planetoids that use the same model share it
+	vector<ModelHandle> models(MODEL_PATHS.size());
+	for (size_t i = 0; i < MODEL_PATHS.size(); i++) {
+		startup.addGLTask("upload " + fs::path(MODEL_PATHS[i]).filename().string(), [&, i]() {
+			models[i] = resources.model(MODEL_PATHS[i], &importedModels[i]);
+			return true;
+		}, { modelImports[i] });
+	}
+	std::unique_ptr<HUD> hud;
+	startup.addGLTask("upload font", [&]() {
+		hud.reset(new HUD(font));
+		return true;
+	}, { fontRaster });
+	std::unique_ptr<MinorPlanets> minorPlanets;
+	if (!catalogPath.empty()) {
+		startup.addGLTask("upload catalog", [&]() {
+			if (catalog.size() > 0)
+				minorPlanets.reset(new MinorPlanets(catalog));
+			//the elements live on the GPU from now on, picking the asteroids needs them as well (see BodyIndex)
+			if (exporting)
+				catalog = MinorPlanetCatalog();
+			return true;
+		}, { catalogLoad });
+	}
+	if (!startup.finish()) {
+		std::cout << "Couldn't load the scene" << std::endl;
+		return -1;
+	}
+	ModelHandle base = models[MODEL_SPHERE];
+	ModelHandle saturn_ring = models[MODEL_RING];
+	ModelHandle phobos_base = models[MODEL_PHOBOS];
+	ModelHandle deimos_base = models[MODEL_DEIMOS];
 
 	//initialize all planets in the solar system, assign the proper models, textures, and properties
-	Planetoid sun = Planetoid(&base, glm::vec3(0), &textureAtlas[0], 0, 6.0f, 0.0f, 5.0f, false);
-	Planetoid mercury = Planetoid(&base, sun.position, &textureAtlas[1], 10.0f, 0.3f, 10.0f, 30.0f, true);
-	Planetoid venus = Planetoid(&base, sun.position, &textureAtlas[2], 16.0f, 0.7f, 13.0f, 40.0f, true);
-	Planetoid earth = Planetoid(&base, sun.position, &textureAtlas[3], 25.0f, 0.8f, 10.0f, 40.0f, true);
-	Planetoid moon = Planetoid(&base, earth.position, &textureAtlas[4], 1.3f, 0.05f, 20.0f, 50.0f, true);
-	Planetoid mars = Planetoid(&base, sun.position, &textureAtlas[5], 35.0f, 0.7f, 15.0f, 30.0f, true);
-	Planetoid deimos = Planetoid(&deimos_base, mars.position, &textureAtlas[6], 1.5f, 0.01f, 40.0f, 30.0f, true);
-	Planetoid phobos = Planetoid(&phobos_base, mars.position, &textureAtlas[7], 2.0f, 0.01f, 50.0f, 35.0f, true);
-	Planetoid jupiter = Planetoid(&base, sun.position, &textureAtlas[8], 50.0f, 2.0f, 8.0f, 25.0f, true);
-	Planetoid saturn = Planetoid(&base, sun.position, &textureAtlas[9], 60.0f, 1.8f, 6.0f, 20.0f, true);
-	Planetoid saturnRing = Planetoid(&saturn_ring, saturn.position, &textureAtlas[10], 0.0f, 4, 0.0f, 0.0f, true);
-	Planetoid uranus = Planetoid(&base, sun.position, &textureAtlas[11], 68.0f, 1.9f, 5.0f, 20.0f, true);
-	Planetoid neptune = Planetoid(&base, sun.position, &textureAtlas[12], 76.0f, 1.8f, 4.0f, 25.0f, true);
+	Planetoid sun = Planetoid(base, glm::vec3(0), textureAtlas[0], 0, 6.0f, 0.0f, 5.0f, false);
+	Planetoid mercury = Planetoid(base, sun.position, textureAtlas[1], 10.0f, 0.3f, 10.0f, 30.0f, true);
+	Planetoid venus = Planetoid(base, sun.position, textureAtlas[2], 16.0f, 0.7f, 13.0f, 40.0f, true);
+	Planetoid earth = Planetoid(base, sun.position, textureAtlas[3], 25.0f, 0.8f, 10.0f, 40.0f, true);
+	Planetoid moon = Planetoid(base, earth.position, textureAtlas[4], 1.3f, 0.05f, 20.0f, 50.0f, true);
+	Planetoid mars = Planetoid(base, sun.position, textureAtlas[5], 35.0f, 0.7f, 15.0f, 30.0f, true);
+	Planetoid deimos = Planetoid(deimos_base, mars.position, textureAtlas[6], 1.5f, 0.01f, 40.0f, 30.0f, true);
+	Planetoid phobos = Planetoid(phobos_base, mars.position, textureAtlas[7], 2.0f, 0.01f, 50.0f, 35.0f, true);
+	Planetoid jupiter = Planetoid(base, sun.position, textureAtlas[8], 50.0f, 2.0f, 8.0f, 25.0f, true);
+	Planetoid saturn = Planetoid(base, sun.position, textureAtlas[9], 60.0f, 1.8f, 6.0f, 20.0f, true);
+	Planetoid saturnRing = Planetoid(saturn_ring, saturn.position, textureAtlas[10], 0.0f, 4, 0.0f, 0.0f, true);
+	Planetoid uranus = Planetoid(base, sun.position, textureAtlas[11], 68.0f, 1.9f, 5.0f, 20.0f, true);
+	Planetoid neptune = Planetoid(base, sun.position, textureAtlas[12], 76.0f, 1.8f, 4.0f, 25.0f, true);
 
 	//establish parent-child relationships between planetoids
 	sun.addPlanetoid(&mercury);
@@ -144,95 +435,427 @@ int main() {
 	sun.addPlanetoid(&uranus);
 	sun.addPlanetoid(&neptune);
 
-	//load skybox
-	Skybox skybox(SKYBOX_FACES);
+	//set up which planetoids can eclipse each other. Jupiter has no moons in this scene yet, once the Galilean moons are added they should be registered here as well
+	earth.addOccluder(&moon);
+	moon.addOccluder(&earth);
+	mars.addOccluder(&phobos);
+	mars.addOccluder(&deimos);
+	saturnRing.addOccluder(&saturn);
+	saturn.setRingShadow(&saturnRing, 0.66f, 0.7f);
+
+	earth.setAtmosphere(&earthAtmosphere);
+	venus.setAtmosphere(&venusAtmosphere);
+	mars.setAtmosphere(&marsAtmosphere);
+	jupiter.setAtmosphere(&jupiterAtmosphere);
+	saturn.setAtmosphere(&saturnAtmosphere);
+	uranus.setAtmosphere(&uranusAtmosphere);
+	neptune.setAtmosphere(&neptuneAtmosphere);
+
+	//the distances of the planets aren't to scale, so the asteroids are placed between the planets whose real orbits they're between
+	if (minorPlanets) {
+		minorPlanets->setScale({ { 0.387f, mercury.getOrbitRadius() }, { 0.723f, venus.getOrbitRadius() }, { 1.0f, earth.getOrbitRadius() },
+			{ 1.524f, mars.getOrbitRadius() }, { 5.203f, jupiter.getOrbitRadius() }, { 9.537f, saturn.getOrbitRadius() },
+			{ 19.19f, uranus.getOrbitRadius() }, { 30.07f, neptune.getOrbitRadius() } });
+	}
+
+	//the bodies that can be picked with the crosshair in the middle of the window, the ring is part of Saturn. Nothing is picked during an export
+	vector<Planetoid*> pickable = { &sun, &mercury, &venus, &earth, &moon, &mars, &deimos, &phobos, &jupiter, &saturn, &uranus, &neptune };
+	vector<string> pickableNames = { "the Sun", "Mercury", "Venus", "Earth", "the Moon", "Mars", "Deimos", "Phobos", "Jupiter", "Saturn", "Uranus", "Neptune" };
+	std::unique_ptr<BodyIndex> bodyIndex;
+	if (!exporting)
+		bodyIndex.reset(new BodyIndex(threadPool, pickable, &catalog, minorPlanets.get()));
+	auto bodyName = [&](const BodyHit& hit) {
+		return hit.planetoid >= 0 ? pickableNames[hit.planetoid] : "asteroid " + catalog.name(hit.asteroid);
+	};
+	std::string pickedText, nearbyText;
+	//the video memory in use, which is updated along with the FPS as asking the driver isn't free
+	std::string memoryText;
+	vector<BodyHit> nearby;
+
+	//the planetoids are moved along their orbits on the simulation thread from here on, the render loop only draws its snapshots
+	//an export steps the simulation itself, by one frame of the video every frame
+	Simulation simulation(&sun, exporting ? 0.0 : SIMULATION_RATE);
+	vector<Atmosphere*> atmospheres = { &earthAtmosphere, &venusAtmosphere, &marsAtmosphere, &jupiterAtmosphere, &saturnAtmosphere, &uranusAtmosphere, &neptuneAtmosphere };
+	//generate the orbit paths of all planetoids once
+	Orbits orbits(&sun);
+	//start compiling the sphere shader variants that are needed for the planetoids
+	sun.prepareShaders(sphereShaders, stereo ? 2 : 1);
+	FrameUniforms frameUniforms(MAX_VIEWS);
+	StereoUniforms stereoUniforms;
+	//the planetoids to draw this frame, shared by all views (see scene.h)
+	DrawList drawList;
+	//the planetoids that get a close-up when they're turned on
+	vector<Planetoid*> closeUps = { &earth, &saturn };
+	//set up the occlusion queries for the lens flare
+	LensFlare lensFlare;
+	//the time every frame takes, on the CPU and on the GPU
+	std::unique_ptr<FrameStats> frameStats(new FrameStats(frameLogPath));
+
 	//load framebuffer
-	FBO frameBuffer(WINDOW_WIDTH, WINDOW_HEIGHT, sun.position);
-	//load sound engine
-	irrklang::ISoundEngine *SoundEngine = irrklang::createIrrKlangDevice();
-	SoundEngine->play2D(MUSIC_PATH, GL_TRUE);
-	//load HUD
+	FBO frameBuffer(renderWidth, renderHeight, sun.position, stereoSettings.layout);
+	std::unique_ptr<VideoExport> videoExport;
+	std::unique_ptr<PosterExport> poster;
+	//recording only starts once everything that's streamed in has arrived, so the first frame of the video looks like all the others
+	bool recording = false;
+	int warmupFrames = 0;
+	if (exportSettings.poster) {
+		poster.reset(new PosterExport(exportSettings, threadPool));
+		if (!poster->isOpen())
+			return -1;
+	} else if (exporting) {
+		videoExport.reset(new VideoExport(exportSettings, threadPool));
+		if (!videoExport->isOpen())
+			return -1;
+	}
+	//the application keeps running without the stream when its port can't be opened
+	std::unique_ptr<FrameStream> frameStream;
+	if (streaming) {
+		frameStream.reset(new FrameStream(streamSettings, renderWidth, renderHeight, threadPool));
+		if (!frameStream->isOpen())
+			frameStream.reset();
+	}
+	//set up the HUD
 	glm::mat4 hud_projection = glm::ortho(0.0f, static_cast<GLfloat>(WINDOW_WIDTH), 0.0f, static_cast<GLfloat>(WINDOW_HEIGHT)); //perspective usually doesn't matter for HUD rendering so we just keep it orthographic
-	hudShader.use();
-	glUniformMatrix4fv(glGetUniformLocation(hudShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(hud_projection));
-	HUD hud(FONT_PATH);
+	hudShader->use();
+	glUniformMatrix4fv(glGetUniformLocation(hudShader->ID, "projection"), 1, GL_FALSE, glm::value_ptr(hud_projection));
+	bool firstFrame = true;
 
 	//set variables for calculating frames per second
 	float lastTime = glfwGetTime();
 	int frameCount = 0;
 	int oldFrameCount = 1;
+	//number of GL state changes in the last frame and how many of them were redundant
+	GLState::Stats stateStats;
 
 	//main render loop
 	while (!glfwWindowShouldClose(window)) {
 
 		/**deltaTime is the time interval between the current and the last frame. 
 		Each calculation which is executed each frame is multiplied by deltaTime in order to prevent inconsistencies from happening
-		when the frames per second dip in numbers (f.e. planets moving slower at a lower FPS)**/
+		when the frames per second dip in numbers (f.e. the camera moving slower at a lower FPS)**/
+		frameStats->beginFrame();
 		float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
+		deltaTime = videoExport ? videoExport->getDeltaTime() : currentFrame - lastFrame;
 		lastFrame = currentFrame;
 		frameCount++;
 
-		//Check if any inputs are given
-		processInput(window);
+		//Check if any inputs are given, an export can only be cancelled
+		if (!exporting)
+			processInput(window);
+		else if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+			glfwSetWindowShouldClose(window, true);
+		frameStats->section(SECTION_UPDATE);
+		//move every planetoid to the newest state of the simulation, which keeps running on its own thread while this frame is drawn
+		simulation.setTurning(turning);
+		if (recording && videoExport)
+			simulation.step(deltaTime);
+		const SceneSnapshot& snapshot = simulation.apply();
+		//the asteroids orbit at the speed of the Earth, a year of the scene takes as long as a turn of the Earth around the Sun
+		double catalogDays = snapshot.orbitTime * earth.getMotion().orbitSpeed / 360.0 * 365.25;
+		//find what's under the crosshair and near the camera among the bodies of the last frame, and start moving them to this one
+		if (bodyIndex && bodyIndex->ready()) {
+			char line[128];
+			BodyHit hit;
+			float spread = std::tan(glm::radians(camera.Zoom) * 0.5f) * 2.0f * PICK_RADIUS / renderHeight;
+			pickedText.clear();
+			if (bodyIndex->pick(camera.Position, camera.Front, spread, hit)) {
+				snprintf(line, sizeof(line), "Looking at %s, %.1f away", bodyName(hit).c_str(), hit.distance);
+				pickedText = line;
+			}
+			nearbyText.clear();
+			if (bodyIndex->nearest(camera.Position, FLT_MAX, hit)) {
+				nearby.clear();
+				bodyIndex->within(camera.Position, NEARBY_DISTANCE, nearby);
+				snprintf(line, sizeof(line), "Nearest is %s, %.1f away, %zu bodies within %.0f", bodyName(hit).c_str(), hit.distance, nearby.size(), NEARBY_DISTANCE);
+				nearbyText = line;
+			}
+			bodyIndex->update(sun.position, catalogDays);
+		}
+		if (reportResources) {
+			resources.report();
+			GPUMemory::report();
+			reportResources = false;
+		}
+		if (reportFrameTimes) {
+			frameStats->report();
+			reportFrameTimes = false;
+		}
+		//upload the pages of the virtual textures that came into view and the next part of the textures that are still loading
+		frameStats->section(SECTION_UPLOAD);
+		virtualTextures.update();
+		textureStreamer.update();
+		frameStats->section(SECTION_DRAW);
 
 		//Set the framebuffer to read input
 		frameBuffer.enable();
 		//refresh the GPU color and depth buffers so they can be rewritten
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		//Get the view and projection matrix from the camera
-		glm::mat4 view = camera.GetViewMatrix();
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 100.0f);
-		
-		//set lighting properties
-		sphereShader.use();
-		sphereShader.setVec3("light.position", sun.position);
-		sphereShader.setVec3("viewPos", camera.Position);
-
-		sphereShader.setVec3("light.ambient", 0.03f, 0.03f, 0.03f);
-		sphereShader.setVec3("light.diffuse", 1.0f, 1.0f, 1.0f);
-		sphereShader.setFloat("light.constant", 1.0f);
-		sphereShader.setFloat("light.linear", 0.0056f);
-		sphereShader.setFloat("light.quadratic", 0.000014f);
-		sphereShader.setFloat("material.shininess", 100.0f);
-
-		sphereShader.setMat4("projection", projection);
-		sphereShader.setMat4("view", view);
-
-		//draw the Sun and all its children
-		sun.Draw(sphereShader, deltaTime, sun.position, turning);
-		//draw skybox
-		skybox.draw(skyboxShader, view, projection);
+		//the planetoids and the orbits are placed once per frame, and then drawn from every view
+		drawList.build(&sun);
+		//move the orbits of moons along with their parents
+		orbits.update();
+
+		//the main camera fills the framebuffer, the close-ups and the orbit map are drawn on top of it when they're turned on (C and O) and not in stereo
+		vector<View> views(1);
+		views[0].view = camera.GetViewMatrix();
+		//a tile of a poster sees its own part of the projection of the whole poster
+		glm::mat4 fullProjection = glm::perspective(glm::radians(camera.Zoom), poster ? poster->getAspect() : (float)renderWidth / renderHeight, 0.1f, 100.0f);
+		views[0].projection = poster ? poster->getTileProjection(fullProjection) : fullProjection;
+		views[0].position = camera.Position;
+		views[0].x = views[0].y = 0;
+		views[0].width = renderWidth;
+		views[0].height = renderHeight;
+		views[0].main = true;
+		int margin = renderHeight / 64;
+		if (showCloseUps && !stereo) {
+			int width = renderWidth / 4, height = renderHeight / 4;
+			for (size_t i = 0; i < closeUps.size(); i++) {
+				//seen from the side of the Sun and a bit off to the side, so the terminator is in view
+				glm::vec3 outward = closeUps[i]->position - sun.position;
+				outward = glm::length(outward) > 0.0f ? glm::normalize(outward) : glm::vec3(0.0f, 0.0f, -1.0f);
+				glm::vec3 direction = outward + glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), outward) * 0.7f - glm::vec3(0.0f, 0.3f, 0.0f);
+				views.push_back(followView(*closeUps[i], direction, renderWidth - width - margin, renderHeight - (int)(i + 1) * (height + margin), width, height));
+			}
+		}
+		if (showOrbitMap && !stereo) {
+			int size = renderHeight / 3;
+			views.push_back(mapView(sun.position, ORBIT_MAP_EXTENT, margin, renderHeight - size - margin, size, size));
+		}
+
+		//set the lighting properties shared by all variants of the sphere shader, the camera is set for every view
+		FrameData frame;
+		frame.shininess = 100.0f;
+		frame.light.position = sun.position;
+		frame.light.radius = sun.getRadius();
+		frame.light.ambient = glm::vec3(0.03f);
+		frame.light.diffuse = glm::vec3(1.0f);
+		frame.light.specular = glm::vec3(0.6f);
+		frame.light.constant = 1.0f;
+		frame.light.linear = 0.0056f;
+		frame.light.quadratic = 0.000014f;
+
+		for (size_t i = 0; i < views.size() && i < (size_t)MAX_VIEWS; i++) {
+			View& view = views[i];
+			//the camera is latched as late as it can be: the mouse is read again right before the main view is culled and its uniforms are uploaded,
+			//so the movement that came in while the frame was being prepared is in it as well
+			if (view.main && !exporting) {
+				glfwPollEvents();
+				view.view = camera.GetViewMatrix();
+				view.position = camera.Position;
+			}
+			/*
+			In stereo both eyes of the main view are drawn in a single pass: the planetoids, the skybox and the atmospheres are drawn with an
+			instance for every eye, and only the orbits are drawn for one eye at a time. Everything either eye can see is drawn.
+			*/
+			int eyes = view.main ? frameBuffer.getEyes() : 1;
+			View eyeViews[2];
+			bool clipEyes = eyes > 1 && stereoSettings.layout != STEREO_LAYERED;
+			if (eyes > 1) {
+				stereoEyes(view, stereoSettings, eyeViews);
+				stereoCull(drawList, view, eyeViews);
+				stereoUniforms.update(stereoData(eyeViews));
+			} else {
+				drawList.cull(view);
+			}
+			if (view.main) {
+				frameBuffer.selectEye(FBO::ALL_EYES);
+			} else {
+				glViewport(view.x, view.y, view.width, view.height);
+				//insets cover whatever was drawn underneath them
+				GLState::enable(GL_SCISSOR_TEST);
+				glScissor(view.x, view.y, view.width, view.height);
+				glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			}
+			frame.view = view.view;
+			frame.projection = view.projection;
+			frame.viewPos = view.position;
+			frameUniforms.update(frame, (int)i);
+
+			//the eyes that are packed into a single texture are kept apart by a clip distance
+			if (clipEyes)
+				GLState::enable(GL_CLIP_DISTANCE0);
+			//draw the Sun and all its children that are in view
+			for (const DrawItem* item : view.visible) {
+				item->planetoid->Draw(sphereShaders, eyes);
+			}
+			//draw skybox
+			if (view.perspective)
+				skybox.draw(*skyboxShader, view.view, view.projection, eyes);
+			if (clipEyes)
+				GLState::disable(GL_CLIP_DISTANCE0);
+
+			//record which pages of the virtual textures are visible, they're read back and loaded over the next few frames
+			//in stereo the pages are picked from between the eyes, which is close enough for the eyes as well
+			if (view.main && virtualTextures.beginFeedback(*feedbackShader)) {
+				for (const DrawItem* item : view.visible) {
+					item->planetoid->DrawFeedback(*feedbackShader);
+				}
+				virtualTextures.endFeedback();
+				frameBuffer.enable();
+			}
+			//draw the orbits over the skybox, the lines of a poster are as wide on the poster as they are in the window
+			glm::vec2 orbitViewport = poster ? glm::vec2(view.width, view.height) / poster->getPixelScale(WINDOW_HEIGHT) : glm::vec2(view.width, view.height);
+			for (int eye = 0; eye < eyes; eye++) {
+				View& eyeView = eyes > 1 ? eyeViews[eye] : view;
+				if (eyes > 1)
+					frameBuffer.selectEye(eye);
+				orbits.draw(*orbitShader, eyeView.view, eyeView.projection, eyeView.position, orbitViewport);
+				if (minorPlanets)
+					minorPlanets->draw(*minorPlanetShader, eyeView.view, eyeView.projection, sun.position, catalogDays, poster ? poster->getPixelScale(WINDOW_HEIGHT) : 1.0f);
+			}
+			if (eyes > 1)
+				frameBuffer.selectEye(FBO::ALL_EYES);
+
+			/*
+			Draw the atmospheres last and add their scattered light on top of the planetoids and the skybox. The shells don't write any depth so they
+			never hide what's behind them, and only their front faces are drawn so the scattered light isn't added twice.
+			*/
+			if (view.perspective) {
+				atmosphereShader->use();
+				atmosphereShader->setMat4("projection", view.projection);
+				atmosphereShader->setMat4("view", view.view);
+				atmosphereShader->setVec3("viewPos", view.position);
+				atmosphereShader->setVec3("lightPos", sun.position);
+				GLState::depthMask(GL_FALSE);
+				GLState::enable(GL_CULL_FACE);
+				GLState::blendFunc(GL_ONE, GL_ONE);
+				if (clipEyes)
+					GLState::enable(GL_CLIP_DISTANCE0);
+				for (const DrawItem* item : view.visible) {
+					item->planetoid->DrawAtmosphere(*atmosphereShader, eyes);
+				}
+				if (clipEyes)
+					GLState::disable(GL_CLIP_DISTANCE0);
+				GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				GLState::disable(GL_CULL_FACE);
+				GLState::depthMask(GL_TRUE);
+			}
+
+			//measure how much of the Sun is visible and draw the lens flare with the result of a few frames ago
+			//the flare is a screen space effect that has no depth of its own, so it's left out in stereo
+			//the tiles of a poster keep the visibility that was measured over the whole poster before the first tile, as most of them can't see the Sun
+			if (view.main && eyes == 1) {
+				if (!poster || !poster->isTiling())
+					lensFlare.testVisibility(*sunQueryShader, view.view, view.projection, glm::vec2(view.width, view.height), sun.position, sun.getRadius(),
+						view.position);
+				if (poster)
+					lensFlare.draw(*flareShader, view.view, fullProjection, sun.position, poster->getAspect(), poster->getTileTransform());
+				else
+					lensFlare.draw(*flareShader, view.view, view.projection, sun.position, (float)view.width / view.height);
+			}
+		}
+		GLState::disable(GL_SCISSOR_TEST);
+		frameBuffer.enable();
+		frameStats->section(SECTION_OUTPUT);
 
 		//Draw the FPS on the HUD every second
 		if (currentFrame - lastTime >= 1.0) {
 			oldFrameCount = frameCount;
 			frameCount = 0;
 			lastTime += 1.0;
+			memoryText = GPUMemory::summary();
+		}
+		//the statistics aren't part of an export, in stereo they're drawn for both eyes
+		//the percentiles show hitches that an average over a second hides
+		if (!exporting) {
+			FrameTimePercentiles percentiles = frameStats->getPercentiles();
+			char frameTimes[160];
+			snprintf(frameTimes, sizeof(frameTimes), "%d FPS, %.1f ms median, %.1f ms p95, %.1f ms p99, %.1f ms max, %zu stutters", oldFrameCount,
+				percentiles.p50, percentiles.p95, percentiles.p99, percentiles.max, frameStats->getStutterCount());
+			for (int eye = 0; eye < frameBuffer.getEyes(); eye++) {
+				frameBuffer.selectEye(eye);
+				hud->RenderText(*hudShader,
+					frameTimes + (framePacer ? ", waiting " + std::to_string((int)framePacer->getDelay()) + " ms before every frame" : std::string()),
+					5.0f, 5.0f, 0.25f, glm::vec3(0.5, 0.8, 0.2f)
+				);
+				hud->RenderText(*hudShader,
+					std::to_string(stateStats.calls) + " GL state changes, " + std::to_string(stateStats.elided) + " elided",
+					5.0f, 20.0f, 0.25f, glm::vec3(0.5, 0.8, 0.2f)
+				);
+				if (bodyIndex) {
+					hud->RenderText(*hudShader, "+", WINDOW_WIDTH / 2.0f - 4.0f, WINDOW_HEIGHT / 2.0f - 4.0f, 0.3f, glm::vec3(0.8f));
+					hud->RenderText(*hudShader, pickedText, 5.0f, 35.0f, 0.25f, glm::vec3(0.5, 0.8, 0.2f));
+					hud->RenderText(*hudShader, nearbyText, 5.0f, 50.0f, 0.25f, glm::vec3(0.5, 0.8, 0.2f));
+				}
+				hud->RenderText(*hudShader, memoryText, 5.0f, bodyIndex ? 65.0f : 35.0f, 0.25f,
+					GPUMemory::overBudget() ? glm::vec3(0.9f, 0.3f, 0.2f) : glm::vec3(0.5, 0.8, 0.2f));
+				if (showFrameGraph)
+					frameStats->drawGraph(*graphShader, hud_projection, WINDOW_WIDTH - 305.0f, 5.0f, 300.0f, 100.0f, 1000.0f / refreshRate);
+			}
+		} else if (recording && poster) {
+			//every tile is drawn once everything it shows has been loaded, the first capture only ends the preview of the whole poster
+			poster->capture(frameBuffer.getFramebuffer());
+			if (poster->isDone())
+				glfwSetWindowShouldClose(window, true);
+			recording = false;
+			warmupFrames = 0;
+		} else if (recording) {
+			for (int eye = 0; eye < frameBuffer.getEyes(); eye++) {
+				int x, y;
+				GLuint framebuffer = frameBuffer.getEyeFramebuffer(eye, x, y);
+				videoExport->capture(framebuffer, eye, x, y);
+			}
+			//a frame that couldn't be written ends the export early, finish() then reports it and the app exits with an error
+			if (videoExport->isDone() || videoExport->hasFailed())
+				glfwSetWindowShouldClose(window, true);
+		} else {
+			int frames = poster && poster->isTiling() ? POSTER_TILE_FRAMES : EXPORT_WARMUP_FRAMES;
+			bool ready = textureStreamer.idle() && ++warmupFrames >= frames;
+			for (Atmosphere* atmosphere : atmospheres) {
+				ready = ready && atmosphere->poll();
+			}
+			recording = ready;
+		}
+
+		//hand the finished frame to the stream, which never waits for its readback or for the viewers
+		if (frameStream) {
+			int x, y;
+			GLuint framebuffer = frameBuffer.getEyeFramebuffer(0, x, y);
+			frameStream->capture(framebuffer, x, y);
 		}
-		hud.RenderText(hudShader,
-			std::to_string(oldFrameCount) + " FPS, " + std::to_string(1000.0 / double(oldFrameCount)) + " ms/frame",
-			5.0f, 5.0f, 0.25f, glm::vec3(0.5, 0.8, 0.2f)
-		);
 
 		//Have the framebuffer convert everything on screen into a texture that's drawn on a quad the size of the window
-		frameBuffer.drawTextureQuad(screenShader);
+		frameBuffer.drawTextureQuad(*screenShader, screenWidth, screenHeight);
+		stateStats = GLState::endFrame();
+		frameStats->endFrame();
 
 		glfwSwapBuffers(window);
+		if (framePacer)
+			framePacer->afterSwap();
 		glfwPollEvents();
+		if (firstFrame) {
+			startup.firstFrame();
+			firstFrame = false;
+		}
 	}
 
-	//destroy the window when a closing request is sent
-	glfwDestroyWindow(window);
-	glfwTerminate();
-	return 0;
+	//the frames of an export that are still being read back or written are finished before anything else is destroyed
+	int result = 0;
+	if (videoExport && !videoExport->finish())
+		result = -1;
+	videoExport.reset();
+	if (poster && !poster->finish())
+		result = -1;
+	poster.reset();
+	frameStream.reset();
+	bodyIndex.reset();
+	if (!frameLogPath.empty() || frameGraphShown)
+		frameStats->report();
+	frameStats.reset();
+
+	//the rest of the scene is destroyed on the way out, and the window after it (see WindowGuard)
+	if (SoundEngine)
+		SoundEngine->drop();
+	return result;
 }
 
-//if window gets resized, resize OpenGL viewport as well with new dimensions
+//if window gets resized, the framebuffer is drawn across the new dimensions (see FBO::drawTextureQuad)
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	screenWidth = width;
+	screenHeight = height;
 }
 
 //calculate the change in mouse position per frame and pass it to the camera
@@ -283,6 +906,52 @@ void processInput(GLFWwindow *window)
 	} 
 	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_RELEASE)
 		turnPressed = false;
+
+	//print the models, textures and shaders in use along with the memory they take
+	if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && !reportPressed) {
+		reportResources = true;
+		reportPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE)
+		reportPressed = false;
+
+	//show/hide the graph of the frame times, and print their statistics
+	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !frameGraphPressed) {
+		showFrameGraph = !showFrameGraph;
+		frameGraphShown = frameGraphShown || showFrameGraph;
+		frameGraphPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE)
+		frameGraphPressed = false;
+	if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS && !frameTimesPressed) {
+		reportFrameTimes = true;
+		frameTimesPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_T) == GLFW_RELEASE)
+		frameTimesPressed = false;
+
+	//show/hide the close-ups and the orbit map
+	if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && !closeUpsPressed) {
+		showCloseUps = !showCloseUps;
+		closeUpsPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE)
+		closeUpsPressed = false;
+	if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS && !orbitMapPressed) {
+		showOrbitMap = !showOrbitMap;
+		orbitMapPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_O) == GLFW_RELEASE)
+		orbitMapPressed = false;
+}
+
+//whether there's an image next to a page file that it could have been made from
+static bool hasSourceImage(const fs::path& pageFile) {
+	for (const char* extension : { ".jpg", ".jpeg", ".png" }) {
+		if (fs::exists(fs::path(pageFile).replace_extension(extension)))
+			return true;
+	}
+	return false;
 }
 
 /*
@@ -291,75 +960,97 @@ Loads all the planet textures into a vector of vectors containing planet texture
 Every planetoid has a vector of textures for diffuse, normal and specular maps, which are saved in their own folders.
 The folder names all begin with a number representing the rank of each planetoid for how close it is to the sun (the Sun itself is 0, Mercury is 1, Earth is 3, the Moon is 4, etc.)
 The vectors for each planetoid are also sorted by these ranks, so the textures for the Sun will be in textureAtlas[0], the Moons' textures in textureAtlas[4], etc.
-*/
-vector<vector<Texture>> loadTextureAtlas(std::string path) {
-	vector<vector<Texture>> textureAtlas;
 
+The images themselves are decoded and uploaded in the background by the texture streamer, until then every texture shows a placeholder color
+that matches its type. Textures are shared through the resources, so planetoids that use the same image share a single texture.
+Maps that have been cut into a page file by "texconvert --virtual" are loaded as virtual textures instead, which is the only way to use maps
+that are larger than the GPU can hold as a single texture.
+*/
+void loadTextureAtlas(std::string path, Resources& resources, VirtualTextures& virtualTextures, vector<vector<Texture>>& textureAtlas) {
 	for (const auto & dir : fs::directory_iterator(path)) {
 		if (dir.is_directory()) {
 			//for every subdirectory in path, create a new vector for textures
 			vector<Texture> textures;
+			bool hasDiffuse = false;
+			std::string normalMap;
 
 			//for every item in the subdirectory, generate a new texture
 			for (const auto & item : fs::directory_iterator(dir.path())) {
 				std::string path = item.path().string();
+				std::string filename = item.path().filename().string();
+				//precompressed versions of the images are picked up by the texture streamer itself
+				if (item.path().extension() == ".ctex")
+					continue;
+				//page files are loaded along with the image they were made from, they're only used on their own when there's no image
+				fs::path pageFile = fs::path(item.path()).replace_extension(".vtex");
+				if (item.path().extension() == ".vtex" && hasSourceImage(item.path()))
+					continue;
 
+				//every texture image filename ends in _d, _n or _s to signify it represents a diffuse, normal or specular map respectively
+				//the correct enum representing the texture type is then set for each texture, along with the color shown while it's loading
 				Texture texture;
-				GLuint textureID;
-				glGenTextures(1, &textureID);
-
-				//Images are loaded with the STB library and automatically have their attributes ascertained
-				int width, height, nrComponents;
-				unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-				if (data)
-				{
-					//check whether we're dealing with monochrome images, JPEGs, or PNGs
-					GLenum format;
-					if (nrComponents == 1)
-						format = GL_RED;
-					else if (nrComponents == 3)
-						format = GL_RGB;
-					else if (nrComponents == 4)
-						format = GL_RGBA;
-
-					//set texture properties, wrapping, and mipmapping
-					glBindTexture(GL_TEXTURE_2D, textureID);
-					glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-					glGenerateMipmap(GL_TEXTURE_2D);
-
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-					stbi_image_free(data);
-
-					texture.id = textureID;
-
-					//every texture image filename ends in _d, _n or _s to signify it represents a diffuse, normal or specular map respectively
-					//the correct enum representing the texture type is then set for each texture
-					int n = path.find("_") + 1;
-					string type = path.substr(n, 1);
-
-					if (type == "d") {
-						texture.type = TEX_DIFFUSE;
-					} else if (type == "n") {
-						texture.type = TEX_NORMAL;
-					} else if (type == "s") {
-						texture.type = TEX_SPECULAR;
-					} else {
-						cout << "Failed to assign type to texture (" << path << ") of type: " << type << endl;
-					}
+				TextureParams params;
+				int n = filename.find("_") + 1;
+				string type = filename.substr(n, 1);
+
+				if (type == "d") {
+					texture.type = TEX_DIFFUSE;
+					params.placeholder = glm::vec3(0.5f);
+				} else if (type == "n") {
+					texture.type = TEX_NORMAL;
+					params.placeholder = glm::vec3(0.5f, 0.5f, 1.0f); //a normal pointing straight out of the surface
+					//flat normal maps are dropped once they've been decoded, so the planetoid switches to a variant without normal mapping
+					params.discardFlat = true;
+				} else if (type == "s") {
+					texture.type = TEX_SPECULAR;
+					params.placeholder = glm::vec3(0.0f);
+				} else {
+					cout << "Failed to assign type to texture (" << path << ") of type: " << type << endl;
+					continue;
+				}
 
+				//fall back to streaming the image itself when the page file can't be used
+				if (fs::exists(pageFile))
+					texture.virtualTexture = virtualTextures.load(pageFile.string());
+				if (texture.virtualTexture) {
+					texture.id = texture.virtualTexture->getPageTable();
+					hasDiffuse = hasDiffuse || texture.type == TEX_DIFFUSE;
 					textures.push_back(texture);
+					continue;
+				} else if (item.path().extension() == ".vtex") {
+					continue;
+				}
+
+				//repeating and mipmapped, which are the defaults of the texture parameters
+				texture.resource = resources.texture(path, params);
+				texture.id = texture.resource->id;
+				hasDiffuse = hasDiffuse || texture.type == TEX_DIFFUSE;
+				if (texture.type == TEX_NORMAL)
+					normalMap = path;
+				textures.push_back(texture);
+			}
+
+			/*
+			Every variant of the sphere shader samples a diffuse map. The Moon, Mars and Uranus only ship a map named as a normal map, which
+			the shader has always sampled as their color as well, so it's loaded a second time as their diffuse map to keep them looking the
+			same (the normal map itself may be dropped when it's flat, the diffuse map never is). Planetoids without either get a plain texture
+			*/
+			if (!hasDiffuse) {
+				Texture texture;
+				texture.type = TEX_DIFFUSE;
+				if (!normalMap.empty()) {
+					TextureParams params;
+					params.placeholder = glm::vec3(0.5f);
+					texture.resource = resources.texture(normalMap, params);
 				} else {
-					std::cout << "Texture failed to load at path: " << path << std::endl;
-					stbi_image_free(data);
+					texture.resource = resources.solidTexture(glm::vec3(0.8f));
 				}
+				texture.id = texture.resource->id;
+				textures.push_back(texture);
 			}
+
 			//add the new vector into the main texture atlas
 			textureAtlas.push_back(textures);
 		}
 	}
-	return textureAtlas;
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include <glad/glad.h>
+
+#include <meshbuffer.h>
+#include <glstate.h>
+#include <gpumemory.h>
+
+#include <algorithm>
+
+//starting sizes of the shared buffers, 64k vertices take 3.5 MB and 256k indices 1 MB
+const size_t INITIAL_VERTEX_CAPACITY = 64 * 1024;
+const size_t INITIAL_INDEX_CAPACITY = 256 * 1024;
+
+bool MeshBuffer::Ranges::allocate(size_t count, size_t& first) {
+	for (auto it = free.begin(); it != free.end(); it++) {
+		if (it->second < count)
+			continue;
+		first = it->first;
+		size_t left = it->second - count;
+		free.erase(it);
+		if (left > 0)
+			free[first + count] = left;
+		return true;
+	}
+	return false;
+}
+
+void MeshBuffer::Ranges::release(size_t first, size_t count) {
+	if (count == 0)
+		return;
+	auto next = free.lower_bound(first);
+	//merge with the free range directly after it
+	if (next != free.end() && next->first == first + count) {
+		count += next->second;
+		next = free.erase(next);
+	}
+	//and with the one directly before it
+	if (next != free.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == first) {
+			previous->second += count;
+			return;
+		}
+	}
+	free[first] = count;
+}
+
+void MeshBuffer::Ranges::grow(size_t newCapacity) {
+	release(capacity, newCapacity - capacity);
+	capacity = newCapacity;
+}
+
+MeshBuffer::MeshBuffer() {
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, INITIAL_VERTEX_CAPACITY * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+	GPUMemory::buffer(VBO, GPUMemory::MEMORY_MODELS, INITIAL_VERTEX_CAPACITY * sizeof(Vertex));
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, INITIAL_INDEX_CAPACITY * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+	GPUMemory::buffer(EBO, GPUMemory::MEMORY_MODELS, INITIAL_INDEX_CAPACITY * sizeof(GLuint));
+	vertexRanges.grow(INITIAL_VERTEX_CAPACITY);
+	indexRanges.grow(INITIAL_INDEX_CAPACITY);
+
+	setupVertexArray();
+}
+
+MeshBuffer::~MeshBuffer() {
+	GLState::deleteVertexArrays(1, &VAO);
+	GLState::deleteBuffers(1, &VBO);
+	GLState::deleteBuffers(1, &EBO);
+}
+
+GLuint MeshBuffer::getVAO() const {
+	return VAO;
+}
+
+MeshAllocation MeshBuffer::allocate(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) {
+	MeshAllocation mesh;
+	if (vertices.empty() || indices.empty())
+		return mesh;
+
+	size_t firstVertex, firstIndex;
+	if (!vertexRanges.allocate(vertices.size(), firstVertex)) {
+		growBuffer(VBO, vertexRanges, sizeof(Vertex), vertices.size());
+		vertexRanges.allocate(vertices.size(), firstVertex);
+	}
+	if (!indexRanges.allocate(indices.size(), firstIndex)) {
+		growBuffer(EBO, indexRanges, sizeof(GLuint), indices.size());
+		indexRanges.allocate(indices.size(), firstIndex);
+	}
+
+	//uploads go through the copy target, so the bindings of the VAO are left alone
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, firstVertex * sizeof(Vertex), vertices.size() * sizeof(Vertex), vertices.data());
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, firstIndex * sizeof(GLuint), indices.size() * sizeof(GLuint), indices.data());
+
+	mesh.baseVertex = (GLint)firstVertex;
+	mesh.firstIndex = (GLuint)firstIndex;
+	mesh.vertexCount = (GLsizei)vertices.size();
+	mesh.indexCount = (GLsizei)indices.size();
+	return mesh;
+}
+
+void MeshBuffer::free(const MeshAllocation& mesh) {
+	vertexRanges.release(mesh.baseVertex, mesh.vertexCount);
+	indexRanges.release(mesh.firstIndex, mesh.indexCount);
+}
+
+/*
+The buffer is doubled until there's a free range at its end that fits the mesh, the free range at the old end (if any) is merged into the new space.
+Growing happens while loading, so the copy isn't worth spreading over several frames.
+*/
+void MeshBuffer::growBuffer(GLuint& buffer, Ranges& ranges, size_t elementSize, size_t needed) {
+	size_t tail = 0;
+	if (!ranges.free.empty()) {
+		auto last = std::prev(ranges.free.end());
+		if (last->first + last->second == ranges.capacity)
+			tail = last->second;
+	}
+	size_t capacity = ranges.capacity;
+	while (capacity - ranges.capacity + tail < needed) {
+		capacity *= 2;
+	}
+
+	GLuint grown;
+	glGenBuffers(1, &grown);
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, grown);
+	glBufferData(GL_COPY_WRITE_BUFFER, capacity * elementSize, NULL, GL_STATIC_DRAW);
+	GPUMemory::buffer(grown, GPUMemory::MEMORY_MODELS, capacity * elementSize);
+	GLState::bindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, ranges.capacity * elementSize);
+	GLState::deleteBuffers(1, &buffer);
+	buffer = grown;
+	ranges.grow(capacity);
+
+	//the VAO still points at the old buffer
+	setupVertexArray();
+}
+
+//sets up the vertex attribute pointers for the Vertex format and the index buffer of the VAO
+void MeshBuffer::setupVertexArray() {
+	GLState::bindVertexArray(VAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+	//The byte offset for each property in the vertex is calculated with the offsetof() macro which automatically determines the amount of bytes after which
+	//a given member begins in the given struct, allowing us to easily pass the offset for each vertex member per vertex attribute pointer.
+
+	// vertex Positions
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+	// vertex normals
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+	// vertex texture coords
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+	// vertex tangent
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+	// vertex bitangent
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+}
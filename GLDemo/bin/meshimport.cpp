@@ -0,0 +1,517 @@
+#include <meshimport.h>
+#include <textfile.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+//the rest of the line without the whitespace around it
+static std::string parseName(const char* p, const char* end) {
+	skipSpaces(p, end);
+	while (end > p && isSpace(end[-1]))
+		end--;
+	return std::string(p, end);
+}
+
+//whether the line starts with the keyword followed by whitespace, p is moved past the keyword
+static inline bool isKeyword(const char*& p, const char* end, const char* keyword, size_t length) {
+	if ((size_t)(end - p) <= length || memcmp(p, keyword, length) != 0 || !isSpace(p[length]))
+		return false;
+	p += length;
+	return true;
+}
+
+/*
+Maps a key of three integers to the index of a vertex with open addressing, which is used to share vertices between the faces that use
+the same corner. It's a lot faster than std::unordered_map for the millions of corners of a large scan, as the slots are a single array.
+*/
+class VertexMap {
+public:
+	static constexpr GLuint EMPTY = ~0u;
+
+	//returns the vertex stored for the key, or stores vertex for it when there's none yet
+	GLuint insert(int a, int b, int c, GLuint vertex) {
+		if ((count + 1) * 2 > slots.size())
+			grow();
+		size_t mask = slots.size() - 1;
+		size_t i = hash(a, b, c) & mask;
+		while (slots[i].vertex != EMPTY) {
+			const Slot& slot = slots[i];
+			if (slot.a == a && slot.b == b && slot.c == c)
+				return slot.vertex;
+			i = (i + 1) & mask;
+		}
+		slots[i] = { a, b, c, vertex };
+		count++;
+		return vertex;
+	}
+
+private:
+	struct Slot {
+		int a, b, c;
+		GLuint vertex = EMPTY;
+	};
+	std::vector<Slot> slots;
+	size_t count = 0;
+
+	static size_t hash(int a, int b, int c) {
+		uint64_t h = (uint32_t)a * 0x9E3779B97F4A7C15ULL ^ (uint32_t)b * 0xC2B2AE3D27D4EB4FULL ^ (uint32_t)c * 0x165667B19E3779F9ULL;
+		return (size_t)(h ^ (h >> 29));
+	}
+
+	void grow() {
+		std::vector<Slot> old = std::move(slots);
+		slots.assign(std::max<size_t>(1024, old.size() * 2), Slot());
+		size_t mask = slots.size() - 1;
+		for (const Slot& slot : old) {
+			if (slot.vertex == EMPTY)
+				continue;
+			size_t i = hash(slot.a, slot.b, slot.c) & mask;
+			while (slots[i].vertex != EMPTY)
+				i = (i + 1) & mask;
+			slots[i] = slot;
+		}
+	}
+};
+
+static glm::vec3 safeNormalize(const glm::vec3& vector) {
+	float length = glm::length(vector);
+	return length > 0.0f ? vector / length : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+static void updateBoundingRadius(ModelData& data) {
+	for (const ModelData::Mesh& mesh : data.meshes) {
+		for (const Vertex& vertex : mesh.vertices) {
+			data.boundingRadius = glm::max(data.boundingRadius, glm::length(vertex.Position));
+		}
+	}
+}
+
+void calculateTangents(ModelData::Mesh& mesh) {
+	std::vector<Vertex>& vertices = mesh.vertices;
+	for (Vertex& vertex : vertices) {
+		vertex.Tangent = glm::vec3(0.0f);
+		vertex.Bitangent = glm::vec3(0.0f);
+	}
+
+	//every triangle adds its tangent space to its corners, so vertices shared between triangles get their average
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		Vertex& v0 = vertices[mesh.indices[i]];
+		Vertex& v1 = vertices[mesh.indices[i + 1]];
+		Vertex& v2 = vertices[mesh.indices[i + 2]];
+		glm::vec3 edge1 = v1.Position - v0.Position, edge2 = v2.Position - v0.Position;
+		glm::vec2 delta1 = v1.TexCoords - v0.TexCoords, delta2 = v2.TexCoords - v0.TexCoords;
+		float determinant = delta1.x * delta2.y - delta2.x * delta1.y;
+		if (std::abs(determinant) < 1e-12f)
+			continue;
+		float r = 1.0f / determinant;
+		glm::vec3 tangent = (edge1 * delta2.y - edge2 * delta1.y) * r;
+		glm::vec3 bitangent = (edge2 * delta1.x - edge1 * delta2.x) * r;
+		v0.Tangent += tangent; v1.Tangent += tangent; v2.Tangent += tangent;
+		v0.Bitangent += bitangent; v1.Bitangent += bitangent; v2.Bitangent += bitangent;
+	}
+
+	//make them perpendicular to the normal, vertices without usable texture coordinates get any tangent space around their normal
+	for (Vertex& vertex : vertices) {
+		const glm::vec3& normal = vertex.Normal;
+		glm::vec3 tangent = vertex.Tangent - normal * glm::dot(normal, vertex.Tangent);
+		glm::vec3 bitangent = vertex.Bitangent - normal * glm::dot(normal, vertex.Bitangent);
+		if (glm::dot(tangent, tangent) < 1e-20f) {
+			tangent = glm::cross(normal, std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+			bitangent = glm::cross(normal, tangent);
+		} else if (glm::dot(bitangent, bitangent) < 1e-20f) {
+			bitangent = glm::cross(normal, tangent);
+		}
+		vertex.Tangent = safeNormalize(tangent);
+		vertex.Bitangent = safeNormalize(bitangent);
+	}
+}
+
+static bool parseObj(const std::string& path, ModelData& data) {
+	MappedFile file(path);
+	if (!file.isOpen())
+		return false;
+
+	struct Corner {
+		int position, texCoord, normal;
+	};
+	//a mesh for every material, the position of every vertex is kept to smooth the normals of faces that don't have any
+	struct ObjMesh {
+		VertexMap corners;
+		std::vector<int> positions;
+	};
+
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> texCoords;
+	std::vector<ObjMesh> meshes;
+	std::unordered_map<std::string, int> meshOfMaterial;
+	std::vector<glm::vec3> smoothNormals;
+	std::vector<Corner> corners;
+	std::vector<GLuint> faceVertices;
+	int currentMesh = -1;
+	bool missingNormals = false;
+
+	auto useMaterial = [&](const std::string& name) {
+		auto found = meshOfMaterial.find(name);
+		if (found == meshOfMaterial.end()) {
+			found = meshOfMaterial.insert({ name, (int)meshes.size() }).first;
+			meshes.emplace_back();
+			data.meshes.emplace_back();
+		}
+		currentMesh = found->second;
+	};
+
+	//OBJ indices start at 1, and negative ones count back from the last element read so far
+	auto parseIndex = [](const char*& p, const char* end, size_t count, int& index) {
+		long long value;
+		if (!parseInt(p, end, value) || value == 0)
+			return false;
+		value = value > 0 ? value - 1 : (long long)count + value;
+		if (value < 0 || value >= (long long)count)
+			return false;
+		index = (int)value;
+		return true;
+	};
+
+	size_t line = 1;
+	for (const char* p = file.begin(); p < file.end(); p++, line++) {
+		const char* lineEnd = (const char*)memchr(p, '\n', file.end() - p);
+		if (!lineEnd)
+			lineEnd = file.end();
+		skipSpaces(p, lineEnd);
+
+		bool parsed = true;
+		if (isKeyword(p, lineEnd, "v", 1)) {
+			glm::vec3 position;
+			parsed = parseFloat(p, lineEnd, position.x) && parseFloat(p, lineEnd, position.y) && parseFloat(p, lineEnd, position.z);
+			positions.push_back(position);
+		} else if (isKeyword(p, lineEnd, "vt", 2)) {
+			//the second coordinate is optional, and they're flipped like with aiProcess_FlipUVs
+			glm::vec2 texCoord(0.0f);
+			parsed = parseFloat(p, lineEnd, texCoord.x);
+			const char* next = p;
+			if (parsed && parseFloat(next, lineEnd, texCoord.y))
+				p = next;
+			texCoords.push_back(glm::vec2(texCoord.x, 1.0f - texCoord.y));
+		} else if (isKeyword(p, lineEnd, "vn", 2)) {
+			glm::vec3 normal;
+			parsed = parseFloat(p, lineEnd, normal.x) && parseFloat(p, lineEnd, normal.y) && parseFloat(p, lineEnd, normal.z);
+			normals.push_back(safeNormalize(normal));
+		} else if (isKeyword(p, lineEnd, "f", 1)) {
+			corners.clear();
+			while (parsed) {
+				skipSpaces(p, lineEnd);
+				if (p == lineEnd)
+					break;
+				Corner corner = { -1, -1, -1 };
+				parsed = parseIndex(p, lineEnd, positions.size(), corner.position);
+				if (parsed && p < lineEnd && *p == '/') {
+					p++;
+					if (p < lineEnd && *p != '/')
+						parsed = parseIndex(p, lineEnd, texCoords.size(), corner.texCoord);
+					if (parsed && p < lineEnd && *p == '/') {
+						p++;
+						parsed = parseIndex(p, lineEnd, normals.size(), corner.normal);
+					}
+				}
+				parsed = parsed && (p == lineEnd || isSpace(*p));
+				corners.push_back(corner);
+			}
+
+			//points and lines are skipped like with the assimp import
+			if (parsed && corners.size() >= 3) {
+				if (currentMesh < 0)
+					useMaterial("DefaultMaterial");
+				ObjMesh& mesh = meshes[currentMesh];
+				ModelData::Mesh& result = data.meshes[currentMesh];
+
+				faceVertices.clear();
+				for (const Corner& corner : corners) {
+					GLuint vertex = mesh.corners.insert(corner.position, corner.texCoord, corner.normal, (GLuint)result.vertices.size());
+					if (vertex == result.vertices.size()) {
+						Vertex created = {};
+						created.Position = positions[corner.position];
+						created.TexCoords = corner.texCoord >= 0 ? texCoords[corner.texCoord] : glm::vec2(0.0f);
+						created.Normal = corner.normal >= 0 ? normals[corner.normal] : glm::vec3(0.0f);
+						result.vertices.push_back(created);
+						mesh.positions.push_back(corner.normal >= 0 ? -1 : corner.position);
+					}
+					faceVertices.push_back(vertex);
+				}
+
+				//polygons are split into a fan of triangles, faces without normals add their area weighted normal to their positions
+				for (size_t i = 1; i + 1 < corners.size(); i++) {
+					result.indices.insert(result.indices.end(), { faceVertices[0], faceVertices[i], faceVertices[i + 1] });
+					if (corners[0].normal < 0 || corners[i].normal < 0 || corners[i + 1].normal < 0) {
+						missingNormals = true;
+						if (smoothNormals.size() < positions.size())
+							smoothNormals.resize(positions.size(), glm::vec3(0.0f));
+						const glm::vec3& a = positions[corners[0].position];
+						glm::vec3 normal = glm::cross(positions[corners[i].position] - a, positions[corners[i + 1].position] - a);
+						for (size_t corner : { (size_t)0, i, i + 1 }) {
+							smoothNormals[corners[corner].position] += normal;
+						}
+					}
+				}
+			}
+		} else if (isKeyword(p, lineEnd, "usemtl", 6)) {
+			useMaterial(parseName(p, lineEnd));
+		}
+
+		if (!parsed) {
+			std::cout << "ERROR::MESHIMPORT:: Couldn't parse line " << line << " of " << path << ", using assimp instead" << std::endl;
+			return false;
+		}
+		p = lineEnd;
+	}
+
+	if (missingNormals) {
+		for (size_t i = 0; i < meshes.size(); i++) {
+			std::vector<Vertex>& vertices = data.meshes[i].vertices;
+			for (size_t j = 0; j < vertices.size(); j++) {
+				int position = meshes[i].positions[j];
+				if (position >= 0)
+					vertices[j].Normal = safeNormalize(smoothNormals[position]);
+			}
+		}
+	}
+	//meshes of materials that were only used by points or lines
+	data.meshes.erase(std::remove_if(data.meshes.begin(), data.meshes.end(), [](const ModelData::Mesh& mesh) { return mesh.indices.empty(); }),
+		data.meshes.end());
+	return true;
+}
+
+//3DS files are a tree of chunks, each of which starts with its id and its length including the 6 byte header
+template<typename Visitor>
+static bool forEachChunk(const char* p, const char* end, Visitor visit) {
+	while (end - p >= 6) {
+		uint16_t id;
+		uint32_t length;
+		memcpy(&id, p, 2);
+		memcpy(&length, p + 2, 4);
+		if (length < 6 || length > (size_t)(end - p))
+			return false;
+		if (!visit(id, p + 6, p + length))
+			return false;
+		p += length;
+	}
+	return true;
+}
+
+static bool readString(const char*& p, const char* end, std::string& result) {
+	const char* terminator = (const char*)memchr(p, '\0', end - p);
+	if (!terminator)
+		return false;
+	result.assign(p, terminator);
+	p = terminator + 1;
+	return true;
+}
+
+static bool readUint16(const char*& p, const char* end, uint16_t& result) {
+	if (end - p < 2)
+		return false;
+	memcpy(&result, p, 2);
+	p += 2;
+	return true;
+}
+
+static bool parse3ds(const std::string& path, ModelData& data) {
+	MappedFile file(path);
+	if (!file.isOpen())
+		return false;
+
+	struct Object {
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> texCoords;
+		std::vector<uint16_t> faces;
+		std::vector<std::pair<std::string, std::vector<uint16_t>>> faceMaterials;
+		//where the object was placed when the file was saved, its vertices are stored with this applied already
+		glm::mat4 matrix = glm::mat4(1.0f);
+	};
+	std::vector<Object> objects;
+
+	auto parseTrimesh = [&](const char* begin, const char* end) {
+		Object& object = objects.back();
+		return forEachChunk(begin, end, [&](uint16_t id, const char* p, const char* end) {
+			uint16_t count;
+			if (id == 0x4110) {
+				if (!readUint16(p, end, count) || (size_t)(end - p) < count * 12u)
+					return false;
+				object.positions.resize(count);
+				memcpy(object.positions.data(), p, count * 12u);
+			} else if (id == 0x4140) {
+				if (!readUint16(p, end, count) || (size_t)(end - p) < count * 8u)
+					return false;
+				object.texCoords.resize(count);
+				for (uint16_t i = 0; i < count; i++, p += 8) {
+					float texCoord[2];
+					memcpy(texCoord, p, 8);
+					object.texCoords[i] = glm::vec2(texCoord[0], 1.0f - texCoord[1]);
+				}
+			} else if (id == 0x4160) {
+				//the X, Y and Z axes of the object followed by its position
+				if (end - p < 48)
+					return false;
+				float matrix[12];
+				memcpy(matrix, p, 48);
+				for (int column = 0; column < 4; column++) {
+					object.matrix[column] = glm::vec4(matrix[column * 3], matrix[column * 3 + 1], matrix[column * 3 + 2], column == 3 ? 1.0f : 0.0f);
+				}
+			} else if (id == 0x4120) {
+				//every face is 3 indices and a flags word, followed by the chunks that assign materials to the faces
+				if (!readUint16(p, end, count) || (size_t)(end - p) < count * 8u)
+					return false;
+				object.faces.resize(count * 3);
+				for (uint16_t i = 0; i < count; i++, p += 8) {
+					memcpy(&object.faces[i * 3], p, 6);
+				}
+				return forEachChunk(p, end, [&](uint16_t id, const char* p, const char* end) {
+					if (id != 0x4130)
+						return true;
+					std::string name;
+					uint16_t faceCount;
+					if (!readString(p, end, name) || !readUint16(p, end, faceCount) || (size_t)(end - p) < faceCount * 2u)
+						return false;
+					std::vector<uint16_t> faces(faceCount);
+					memcpy(faces.data(), p, faceCount * 2u);
+					object.faceMaterials.push_back({ name, std::move(faces) });
+					return true;
+				});
+			}
+			return true;
+		});
+	};
+
+	bool parsed = forEachChunk(file.begin(), file.end(), [&](uint16_t id, const char* p, const char* end) {
+		if (id != 0x4D4D)
+			return true;
+		return forEachChunk(p, end, [&](uint16_t id, const char* p, const char* end) {
+			if (id != 0x3D3D)
+				return true;
+			return forEachChunk(p, end, [&](uint16_t id, const char* p, const char* end) {
+				if (id != 0x4000)
+					return true;
+				std::string name;
+				if (!readString(p, end, name))
+					return false;
+				//objects can also be lights and cameras
+				return forEachChunk(p, end, [&](uint16_t id, const char* p, const char* end) {
+					if (id != 0x4100)
+						return true;
+					objects.emplace_back();
+					return parseTrimesh(p, end);
+				});
+			});
+		});
+	});
+	if (!parsed || objects.empty()) {
+		std::cout << "ERROR::MESHIMPORT:: Couldn't parse " << path << ", using assimp instead" << std::endl;
+		return false;
+	}
+
+	for (const Object& object : objects) {
+		size_t faceCount = object.faces.size() / 3;
+		for (uint16_t index : object.faces) {
+			if (index >= object.positions.size())
+				return false;
+		}
+
+		//faces that aren't assigned a material share a mesh of their own
+		std::vector<unsigned int> faceMaterials(faceCount, (unsigned int)object.faceMaterials.size());
+		for (size_t material = 0; material < object.faceMaterials.size(); material++) {
+			for (uint16_t face : object.faceMaterials[material].second) {
+				if (face < faceCount)
+					faceMaterials[face] = (unsigned int)material;
+			}
+		}
+
+		//the vertices are stored where the objects were placed, they're moved into the space of the first object like with the assimp import
+		glm::mat4 toObject = glm::inverse(objects.front().matrix);
+		std::vector<glm::vec3> positions(object.positions.size());
+		for (size_t i = 0; i < positions.size(); i++) {
+			positions[i] = glm::vec3(toObject * glm::vec4(object.positions[i], 1.0f));
+		}
+
+		//the normals are smoothed over all faces sharing a position, smoothing groups are ignored
+		VertexMap welded;
+		std::vector<GLuint> weldedPositions(positions.size());
+		GLuint weldedCount = 0;
+		for (size_t i = 0; i < positions.size(); i++) {
+			int bits[3];
+			memcpy(bits, &positions[i], 12);
+			weldedPositions[i] = welded.insert(bits[0], bits[1], bits[2], weldedCount);
+			if (weldedPositions[i] == weldedCount)
+				weldedCount++;
+		}
+		std::vector<glm::vec3> weldedNormals(weldedCount, glm::vec3(0.0f));
+		for (size_t face = 0; face < faceCount; face++) {
+			const uint16_t* corners = &object.faces[face * 3];
+			const glm::vec3& a = positions[corners[0]];
+			glm::vec3 normal = glm::cross(positions[corners[1]] - a, positions[corners[2]] - a);
+			for (int i = 0; i < 3; i++) {
+				weldedNormals[weldedPositions[corners[i]]] += normal;
+			}
+		}
+
+		//the meshes of this object start at firstMesh, each with the index of its vertices by the position they came from
+		size_t firstMesh = data.meshes.size();
+		std::map<unsigned int, size_t> meshOfMaterial;
+		std::vector<std::vector<GLuint>> remaps;
+		for (size_t face = 0; face < faceCount; face++) {
+			unsigned int material = faceMaterials[face];
+			auto mesh = meshOfMaterial.find(material);
+			if (mesh == meshOfMaterial.end()) {
+				mesh = meshOfMaterial.insert({ material, remaps.size() }).first;
+				data.meshes.emplace_back();
+				remaps.emplace_back(positions.size(), VertexMap::EMPTY);
+			}
+			ModelData::Mesh& result = data.meshes[firstMesh + mesh->second];
+			std::vector<GLuint>& remap = remaps[mesh->second];
+
+			for (int i = 0; i < 3; i++) {
+				uint16_t index = object.faces[face * 3 + i];
+				if (remap[index] == VertexMap::EMPTY) {
+					remap[index] = (GLuint)result.vertices.size();
+					Vertex vertex = {};
+					vertex.Position = positions[index];
+					vertex.Normal = safeNormalize(weldedNormals[weldedPositions[index]]);
+					vertex.TexCoords = index < object.texCoords.size() ? object.texCoords[index] : glm::vec2(0.0f);
+					result.vertices.push_back(vertex);
+				}
+				result.indices.push_back(remap[index]);
+			}
+		}
+	}
+	return true;
+}
+
+bool importNative(const std::string& path, ModelData& data) {
+	std::string extension = fs::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+
+	ModelData result;
+	bool parsed;
+	if (extension == ".obj")
+		parsed = parseObj(path, result);
+	else if (extension == ".3ds")
+		parsed = parse3ds(path, result);
+	else
+		return false;
+	if (!parsed)
+		return false;
+
+	for (ModelData::Mesh& mesh : result.meshes) {
+		calculateTangents(mesh);
+	}
+	updateBoundingRadius(result);
+	data = std::move(result);
+	return true;
+}
@@ -0,0 +1,423 @@
+#include <glad/glad.h>
+#include <glm/gtc/constants.hpp>
+
+#include <minorplanets.h>
+#include <glstate.h>
+#include <gpumemory.h>
+#include <textfile.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+const char * CATALOG_CACHE_PATH = "./bin/cache/catalogs/";
+//bump this whenever the way the catalog is parsed changes, so stale cache files are ignored
+const uint32_t CATALOG_CACHE_VERSION = 2;
+const uint32_t CATALOG_CACHE_MAGIC = 0x4243504D; //"MPCB"
+
+const double J2000 = 2451545.0; //as a Julian day
+//used for the few bodies without an absolute magnitude
+const float DEFAULT_MAGNITUDE = 18.0f;
+//records run up to the semimajor axis at least, everything after it isn't used
+const int MIN_RECORD_LENGTH = 103;
+//the header of MPCORB.DAT ends with a line of dashes, which is looked for at the start of the file
+const size_t MAX_HEADER_SIZE = 64 * 1024;
+
+//every element array of a catalog, in the order they're cached and uploaded in
+template<typename Catalog>
+static auto elementsOf(Catalog& catalog) {
+	return std::array<decltype(&catalog.semiMajorAxis), 8>{ &catalog.semiMajorAxis, &catalog.eccentricity, &catalog.inclination,
+		&catalog.ascendingNode, &catalog.perihelion, &catalog.meanAnomaly, &catalog.meanMotion, &catalog.magnitude };
+}
+
+size_t MinorPlanetCatalog::size() const {
+	return semiMajorAxis.size();
+}
+
+void MinorPlanetCatalog::resize(size_t count) {
+	for (std::vector<float>* elements : elementsOf(*this)) {
+		elements->resize(count);
+	}
+	designation.resize(count);
+}
+
+std::string MinorPlanetCatalog::name(size_t index) const {
+	char packed[8] = {};
+	memcpy(packed, &designation[index], 7);
+	//numbered bodies are packed into 5 characters, the first of which counts the ten thousands (A is 10 up to z for 61)
+	int tenThousands = -1;
+	if (isDigit(packed[0]))
+		tenThousands = packed[0] - '0';
+	else if (packed[0] >= 'A' && packed[0] <= 'Z')
+		tenThousands = packed[0] - 'A' + 10;
+	else if (packed[0] >= 'a' && packed[0] <= 'z')
+		tenThousands = packed[0] - 'a' + 36;
+	bool numbered = tenThousands >= 0 && packed[5] == ' ';
+	for (int i = 1; i < 5; i++) {
+		numbered = numbered && isDigit(packed[i]);
+	}
+	if (numbered)
+		return "(" + std::to_string(tenThousands * 10000 + atoi(packed + 1)) + ")";
+	std::string name(packed);
+	name.erase(name.find_last_not_of(' ') + 1);
+	return name;
+}
+
+//digits and letters in the packed epochs of the Minor Planet Center, A stands for 10 up to V for 31
+static int unpackDigit(char c) {
+	if (isDigit(c))
+		return c - '0';
+	if (c >= 'A' && c <= 'V')
+		return c - 'A' + 10;
+	return -1;
+}
+
+//the Julian day at the start of a packed date, f.e. K2555 is 2025-05-05 (see Fliegel and Van Flandern)
+static bool parseEpoch(const char* packed, double& julianDay) {
+	int century = unpackDigit(packed[0]);
+	int year = isDigit(packed[1]) && isDigit(packed[2]) ? (packed[1] - '0') * 10 + packed[2] - '0' : -1;
+	int month = unpackDigit(packed[3]);
+	int day = unpackDigit(packed[4]);
+	if (century < 18 || century > 21 || year < 0 || month < 1 || month > 12 || day < 1 || day > 31)
+		return false;
+	year += century * 100;
+	int a = (14 - month) / 12;
+	int y = year + 4800 - a;
+	int m = month + 12 * a - 3;
+	long dayNumber = day + (153 * m + 2) / 5 + 365L * y + y / 4 - y / 100 + y / 400 - 32045;
+	//the day number starts at noon
+	julianDay = dayNumber - 0.5;
+	return true;
+}
+
+//reads the number in the columns from first to last, counted from 1 like in the description of the format
+static bool parseColumns(const char* line, int first, int last, double& value) {
+	const char* p = line + first - 1;
+	const char* end = line + last;
+	if (!parseDouble(p, end, value))
+		return false;
+	skipSpaces(p, end);
+	return p == end;
+}
+
+//header lines and the blank lines between the groups of the catalog are skipped by where records have the decimal points of their
+//mean anomaly and semimajor axis, which are at the same columns in every record
+static inline bool isRecord(const char* line, const char* lineEnd) {
+	return lineEnd - line >= MIN_RECORD_LENGTH && line[29] == '.' && line[95] == '.';
+}
+
+//the end of the line without its line break, and the start of the next one
+static inline const char* findLineEnd(const char* line, const char* end, const char*& next) {
+	const char* newline = (const char*)memchr(line, '\n', end - line);
+	next = newline ? newline + 1 : end;
+	const char* lineEnd = newline ? newline : end;
+	if (lineEnd > line && lineEnd[-1] == '\r')
+		lineEnd--;
+	return lineEnd;
+}
+
+//parses a record into the given index of the catalog, records with an orbit that isn't closed are left out
+static bool parseRecord(const char* line, MinorPlanetCatalog& catalog, size_t index) {
+	double magnitude, epoch, anomaly, perihelion, node, inclination, eccentricity, motion, axis;
+	if (!parseEpoch(line + 20, epoch) || !parseColumns(line, 27, 35, anomaly) || !parseColumns(line, 38, 46, perihelion) ||
+		!parseColumns(line, 49, 57, node) || !parseColumns(line, 60, 68, inclination) || !parseColumns(line, 71, 79, eccentricity) ||
+		!parseColumns(line, 81, 91, motion) || !parseColumns(line, 93, 103, axis))
+		return false;
+	if (eccentricity < 0.0 || eccentricity >= 1.0 || axis <= 0.0)
+		return false;
+	if (!parseColumns(line, 9, 13, magnitude))
+		magnitude = DEFAULT_MAGNITUDE;
+
+	//the elements of different bodies are given at different epochs, so all of them are moved to the same one
+	anomaly = std::fmod(anomaly + motion * (J2000 - epoch), 360.0);
+	if (anomaly < 0.0)
+		anomaly += 360.0;
+	catalog.semiMajorAxis[index] = (float)axis;
+	catalog.eccentricity[index] = (float)eccentricity;
+	catalog.inclination[index] = (float)glm::radians(inclination);
+	catalog.ascendingNode[index] = (float)glm::radians(node);
+	catalog.perihelion[index] = (float)glm::radians(perihelion);
+	catalog.meanAnomaly[index] = (float)glm::radians(anomaly);
+	catalog.meanMotion[index] = (float)glm::radians(motion);
+	catalog.magnitude[index] = (float)magnitude;
+	uint64_t designation = 0;
+	memcpy(&designation, line, 7);
+	catalog.designation[index] = designation;
+	return true;
+}
+
+//runs the work for every chunk on a thread of its own and waits for all of them
+static void forEachChunk(int chunks, const std::function<void(int)>& work) {
+	std::vector<std::thread> workers;
+	for (int chunk = 1; chunk < chunks; chunk++) {
+		workers.emplace_back(work, chunk);
+	}
+	work(0);
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+static bool parseCatalog(const std::string& path, MinorPlanetCatalog& catalog) {
+	MappedFile file(path);
+	if (!file.isOpen())
+		return false;
+	const char* begin = file.begin();
+	const char* end = file.end();
+	for (const char* line = begin, *next; line < end && line < file.begin() + MAX_HEADER_SIZE; line = next) {
+		const char* lineEnd = findLineEnd(line, end, next);
+		if (lineEnd - line >= 10 && std::all_of(line, lineEnd, [](char c) { return c == '-'; })) {
+			begin = next;
+			break;
+		}
+	}
+
+	//every chunk starts at the beginning of a line
+	int chunks = (int)std::max(1u, std::thread::hardware_concurrency());
+	std::vector<const char*> bounds(chunks + 1, end);
+	bounds[0] = begin;
+	for (int chunk = 1; chunk < chunks; chunk++) {
+		const char* bound = std::max(begin + (end - begin) * chunk / chunks, bounds[chunk - 1]);
+		const char* newline = (const char*)memchr(bound, '\n', end - bound);
+		bounds[chunk] = newline ? newline + 1 : end;
+	}
+
+	//count the records of every chunk first, so every chunk knows where in the arrays its records start
+	std::vector<size_t> firsts(chunks + 1, 0);
+	forEachChunk(chunks, [&](int chunk) {
+		size_t records = 0;
+		for (const char* line = bounds[chunk], *next; line < bounds[chunk + 1]; line = next) {
+			records += isRecord(line, findLineEnd(line, bounds[chunk + 1], next));
+		}
+		firsts[chunk + 1] = records;
+	});
+	for (int chunk = 0; chunk < chunks; chunk++) {
+		firsts[chunk + 1] += firsts[chunk];
+	}
+	catalog.resize(firsts[chunks]);
+
+	//records that can't be parsed get a semimajor axis of 0 and are removed afterwards
+	std::vector<size_t> failed(chunks, 0);
+	forEachChunk(chunks, [&](int chunk) {
+		size_t index = firsts[chunk];
+		for (const char* line = bounds[chunk], *next; line < bounds[chunk + 1]; line = next) {
+			if (!isRecord(line, findLineEnd(line, bounds[chunk + 1], next)))
+				continue;
+			if (!parseRecord(line, catalog, index)) {
+				catalog.semiMajorAxis[index] = 0.0f;
+				failed[chunk]++;
+			}
+			index++;
+		}
+	});
+
+	size_t skipped = 0;
+	for (size_t count : failed) {
+		skipped += count;
+	}
+	if (skipped > 0) {
+		size_t kept = 0;
+		for (size_t i = 0; i < catalog.size(); i++) {
+			if (catalog.semiMajorAxis[i] <= 0.0f)
+				continue;
+			for (std::vector<float>* elements : elementsOf(catalog)) {
+				(*elements)[kept] = (*elements)[i];
+			}
+			catalog.designation[kept] = catalog.designation[i];
+			kept++;
+		}
+		catalog.resize(kept);
+		std::cout << "Skipped " << skipped << " records of " << path << " that couldn't be read or aren't on a closed orbit" << std::endl;
+	}
+	return true;
+}
+
+struct CatalogCacheHeader {
+	uint32_t magic, version;
+	uint64_t count;
+	//the catalog the cache was made from, which has changed when either of these has
+	uint64_t sourceSize;
+	int64_t sourceTime;
+};
+
+static std::string cachePath(const std::string& path) {
+	//FNV-1a of the full path, so catalogs with the same name in different places don't share a cache file
+	uint64_t hash = 14695981039346656037ull;
+	std::error_code error;
+	for (char c : fs::absolute(path, error).string()) {
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ull;
+	}
+	std::stringstream cache;
+	cache << CATALOG_CACHE_PATH << fs::path(path).filename().string() << "_" << std::hex << hash << ".bin";
+	return cache.str();
+}
+
+static bool sourceHeader(const std::string& path, CatalogCacheHeader& header) {
+	std::error_code error;
+	header.magic = CATALOG_CACHE_MAGIC;
+	header.version = CATALOG_CACHE_VERSION;
+	header.sourceSize = fs::file_size(path, error);
+	if (error)
+		return false;
+	header.sourceTime = (int64_t)fs::last_write_time(path, error).time_since_epoch().count();
+	return !error;
+}
+
+static bool loadCache(const std::string& path, const CatalogCacheHeader& source, MinorPlanetCatalog& catalog) {
+	std::ifstream file(cachePath(path), std::ios::binary);
+	if (!file)
+		return false;
+
+	CatalogCacheHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.magic != source.magic || header.version != source.version || header.sourceSize != source.sourceSize ||
+		header.sourceTime != source.sourceTime)
+		return false;
+	catalog.resize(header.count);
+	for (std::vector<float>* elements : elementsOf(catalog)) {
+		file.read(reinterpret_cast<char*>(elements->data()), elements->size() * sizeof(float));
+	}
+	file.read(reinterpret_cast<char*>(catalog.designation.data()), catalog.designation.size() * sizeof(uint64_t));
+	return (bool)file;
+}
+
+static void saveCache(const std::string& path, CatalogCacheHeader header, const MinorPlanetCatalog& catalog) {
+	std::error_code error;
+	fs::create_directories(CATALOG_CACHE_PATH, error);
+
+	//write to a temporary file first so an interrupted write never leaves a corrupt cache file behind
+	std::string cache = cachePath(path);
+	std::string tempPath = cache + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary);
+		if (!file) {
+			std::cout << "Couldn't write catalog cache: " << cache << std::endl;
+			return;
+		}
+		header.count = catalog.size();
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const std::vector<float>* elements : elementsOf(catalog)) {
+			file.write(reinterpret_cast<const char*>(elements->data()), elements->size() * sizeof(float));
+		}
+		file.write(reinterpret_cast<const char*>(catalog.designation.data()), catalog.designation.size() * sizeof(uint64_t));
+	}
+	fs::rename(tempPath, cache, error);
+}
+
+bool MinorPlanetCatalog::load(const std::string& path, MinorPlanetCatalog& catalog) {
+	CatalogCacheHeader source = {};
+	if (!sourceHeader(path, source)) {
+		std::cout << "Couldn't find the catalog " << path << std::endl;
+		return false;
+	}
+	if (loadCache(path, source, catalog))
+		return true;
+	if (!parseCatalog(path, catalog)) {
+		std::cout << "Couldn't read the catalog " << path << std::endl;
+		catalog.resize(0);
+		return false;
+	}
+	saveCache(path, source, catalog);
+	return true;
+}
+
+MinorPlanets::MinorPlanets(const MinorPlanetCatalog& catalog) : count((GLsizei)catalog.size()) {
+	//the arrays are uploaded one after another into a single buffer, every element is an attribute of its own
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	GLState::bindVertexArray(VAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+	size_t arraySize = catalog.size() * sizeof(float);
+	glBufferData(GL_ARRAY_BUFFER, arraySize * 8, NULL, GL_STATIC_DRAW);
+	GPUMemory::buffer(VBO, GPUMemory::MEMORY_MODELS, arraySize * 8);
+	GLuint attribute = 0;
+	for (const std::vector<float>* elements : elementsOf(catalog)) {
+		glBufferSubData(GL_ARRAY_BUFFER, arraySize * attribute, arraySize, elements->data());
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribPointer(attribute, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(arraySize * attribute));
+		attribute++;
+	}
+}
+
+MinorPlanets::~MinorPlanets() {
+	GLState::deleteVertexArrays(1, &VAO);
+	GLState::deleteBuffers(1, &VBO);
+}
+
+void MinorPlanets::setScale(const std::vector<glm::vec2>& orbits) {
+	scale.assign(orbits.begin(), orbits.begin() + std::min<size_t>(orbits.size(), MAX_SCALE_POINTS));
+}
+
+/*
+The points are added on top of whatever is behind them and don't write any depth, like the orbits, and are drawn after the skybox so
+it doesn't draw over them.
+*/
+void MinorPlanets::draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& sunPos, double days, float pointScale) {
+	shader.use();
+	shader.setMat4("view", view);
+	shader.setMat4("projection", projection);
+	shader.setVec3("sunPos", sunPos);
+	shader.setFloat("days", (float)days);
+	shader.setFloat("pointScale", pointScale);
+	shader.setInt("scalePointCount", (int)scale.size());
+	for (size_t i = 0; i < scale.size(); i++) {
+		shader.setVec2("scalePoints[" + std::to_string(i) + "]", scale[i]);
+	}
+
+	GLState::bindVertexArray(VAO);
+	GLState::enable(GL_PROGRAM_POINT_SIZE);
+	GLState::blendFunc(GL_SRC_ALPHA, GL_ONE);
+	GLState::depthMask(GL_FALSE);
+	glDrawArrays(GL_POINTS, 0, count);
+	GLState::depthMask(GL_TRUE);
+	GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLState::disable(GL_PROGRAM_POINT_SIZE);
+}
+
+float MinorPlanets::sceneDistance(float distance) const {
+	glm::vec2 previous(0.0f);
+	glm::vec2 next(1.0f);
+	for (size_t i = 0; i < scale.size(); i++) {
+		next = scale[i];
+		if (distance <= next.x)
+			break;
+		if (i + 1 < scale.size())
+			previous = next;
+	}
+	return glm::mix(previous.y, next.y, (distance - previous.x) / (next.x - previous.x));
+}
+
+glm::vec3 MinorPlanets::position(const MinorPlanetCatalog& catalog, size_t index, const glm::vec3& sunPos, double days) const {
+	//in single precision like the vertex shader, so the bodies are found where they're drawn
+	float e = catalog.eccentricity[index];
+	float M = std::fmod(catalog.meanAnomaly[index] + catalog.meanMotion[index] * (float)days, glm::two_pi<float>());
+	if (M < 0.0f)
+		M += glm::two_pi<float>();
+	float E = e < 0.8f ? M : glm::pi<float>();
+	for (int i = 0; i < 6; i++) {
+		E -= (E - e * std::sin(E) - M) / (1.0f - e * std::cos(E));
+	}
+	glm::vec2 orbital = catalog.semiMajorAxis[index] * glm::vec2(std::cos(E) - e, std::sqrt(1.0f - e * e) * std::sin(E));
+	float cw = std::cos(catalog.perihelion[index]), sw = std::sin(catalog.perihelion[index]);
+	float cn = std::cos(catalog.ascendingNode[index]), sn = std::sin(catalog.ascendingNode[index]);
+	float ci = std::cos(catalog.inclination[index]), si = std::sin(catalog.inclination[index]);
+	glm::vec3 ecliptic(
+		(cn * cw - sn * sw * ci) * orbital.x - (cn * sw + sn * cw * ci) * orbital.y,
+		(sn * cw + cn * sw * ci) * orbital.x - (sn * sw - cn * cw * ci) * orbital.y,
+		sw * si * orbital.x + cw * si * orbital.y);
+
+	float distance = glm::length(ecliptic);
+	glm::vec3 direction = glm::vec3(ecliptic.x, ecliptic.z, -ecliptic.y) / std::max(distance, 1e-6f);
+	return sunPos + direction * sceneDistance(distance);
+}
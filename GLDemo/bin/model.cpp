@@ -1,23 +1,36 @@
 #include <glad/glad.h>
 
 #include <model.h>
+#include <glstate.h>
+#include <meshimport.h>
+#include <resources.h>
+#include <virtualtexture.h>
 
-Model::Model(std::string const &path) {
-	loadModel(path);
+#include <glm/gtc/type_ptr.hpp>
+
+Model::Model(std::string const &path, MeshBuffer& meshes) : Model(import(path), meshes) {
+}
+
+Model::Model(ModelData data, MeshBuffer& meshes) : meshes(meshes) {
+	for (const ModelData::Mesh& mesh : data.meshes) {
+		submeshes.push_back(meshes.allocate(mesh.vertices, mesh.indices));
+	}
+	boundingRadius = data.boundingRadius;
 }
 
 Model::~Model() {
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	for (const MeshAllocation& mesh : submeshes) {
+		meshes.free(mesh);
+	}
 }
 
-void Model::Draw(const Shader& shader, const std::vector<Texture>* textures) {
-	// bind appropriate textures
+void Model::Draw(const Shader& shader, const std::vector<Texture>* textures, GLsizei instances) {
+	// bind appropriate textures, models drawn without any textures (such as atmosphere shells) can pass nullptr
 	GLuint i = 0;
-	for (i; i < textures->size(); i++)
+	for (i; textures && i < textures->size(); i++)
 	{
-		glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
+		if (textures->at(i).isDiscarded())
+			continue;
 		std::string name;
 
 		//get the shader uniform variable to set depending on the type of the current texture
@@ -33,127 +46,148 @@ void Model::Draw(const Shader& shader, const std::vector<Texture>* textures) {
 			break;
 		}
 
+		// virtual textures are a struct of the page table, the page cache and their shape, of which the page table takes the place of the texture
+		const VirtualTexture* virtualTexture = textures->at(i).virtualTexture;
+		if (virtualTexture) {
+			virtualTexture->setUniforms(shader, name);
+			name += ".pages";
+		}
+
 		// now set the sampler to the correct texture unit
 		glUniform1i(glGetUniformLocation(shader.ID, name.c_str()), i);
-		// and finally bind the texture
-		glBindTexture(GL_TEXTURE_2D, textures->at(i).id);
+		// and finally bind the texture to it, planetoids that share textures (f.e. the default diffuse map) don't rebind them
+		GLState::bindTexture(i, GL_TEXTURE_2D, textures->at(i).id);
 	}
 
-	// draw mesh
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+	// draw the meshes, which all share the VAO of the mesh buffer
+	GLState::bindVertexArray(meshes.getVAO());
+	for (const MeshAllocation& mesh : submeshes) {
+		if (instances > 1)
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, (void*)(mesh.firstIndex * sizeof(GLuint)), instances, mesh.baseVertex);
+		else
+			glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, (void*)(mesh.firstIndex * sizeof(GLuint)), mesh.baseVertex);
+	}
+}
 
-	//set current active texture back to default
-	glActiveTexture(GL_TEXTURE0);
+float Model::getBoundingRadius() const {
+	return boundingRadius;
 }
 
-//imports a model file into an aiMesh object
-void Model::loadModel(std::string const &path) {
-	// read file via ASSIMP
-	Assimp::Importer importer;
-	const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace); //get the tangents of the model for normal mapping
-	// check for errors
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-	{
-		std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-		return;
+size_t Model::getMemoryUsage() const {
+	size_t size = 0;
+	for (const MeshAllocation& mesh : submeshes) {
+		size += mesh.vertexCount * sizeof(Vertex) + mesh.indexCount * sizeof(GLuint);
 	}
+	return size;
+}
 
-	aiMesh* mesh = scene->mMeshes[scene->mRootNode->mChildren[0]->mMeshes[0]];
-	processMesh(mesh, scene);
+bool Texture::isDiscarded() const {
+	return resource && resource->discarded;
 }
 
-//read all the data from the aiMesh object and write it to vectors where it can be later used to set up the vertex array objects and buffers
-void Model::processMesh(aiMesh *mesh, const aiScene *scene) {
+//read all the data from the aiMesh object and transform it into the space of the model
+static void processMesh(const aiMesh *mesh, const glm::mat4 &transform, ModelData &data) {
+	//directions are transformed without the translation, and normals with the inverse transpose so non-uniform scales don't skew them
+	glm::mat3 directionTransform = glm::mat3(transform);
+	glm::mat3 normalTransform = glm::transpose(glm::inverse(directionTransform));
+	auto toVec3 = [](const aiVector3D& vector) { return glm::vec3(vector.x, vector.y, vector.z); };
+
+	ModelData::Mesh result;
+	std::vector<Vertex>& vertices = result.vertices;
+	std::vector<GLuint>& indices = result.indices;
+	vertices.reserve(mesh->mNumVertices);
+
 	// Walk through each of the mesh's vertices
 	for (GLuint i = 0; i < mesh->mNumVertices; i++)
 	{
+		//assimp uses its own vector class which doesn't automatically translate to glm's vec3, so the data has to be transferred manually
 		Vertex vertex;
-		glm::vec3 vector; //assimp uses its own vector class which doesn't automatically translate to glm's vec3, so the data has to be transferred manually
 		// positions
-		vector.x = mesh->mVertices[i].x;
-		vector.y = mesh->mVertices[i].y;
-		vector.z = mesh->mVertices[i].z;
-		vertex.Position = vector;
+		vertex.Position = glm::vec3(transform * glm::vec4(toVec3(mesh->mVertices[i]), 1.0f));
+		data.boundingRadius = glm::max(data.boundingRadius, glm::length(vertex.Position));
 		// normals
-		vector.x = mesh->mNormals[i].x;
-		vector.y = mesh->mNormals[i].y;
-		vector.z = mesh->mNormals[i].z;
-		vertex.Normal = vector;
+		vertex.Normal = mesh->mNormals ? glm::normalize(normalTransform * toVec3(mesh->mNormals[i])) : glm::vec3(0.0f);
 		// texture coordinates
 		if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
 		{
-			glm::vec2 vec;
 			// a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
 			// use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-			vec.x = mesh->mTextureCoords[0][i].x;
-			vec.y = mesh->mTextureCoords[0][i].y;
-			vertex.TexCoords = vec;
+			vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
 		}
 		else
 			vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-		// tangent
-		vector.x = mesh->mTangents[i].x;
-		vector.y = mesh->mTangents[i].y;
-		vector.z = mesh->mTangents[i].z;
-		vertex.Tangent = vector;
-		// bitangent
-		vector.x = mesh->mBitangents[i].x;
-		vector.y = mesh->mBitangents[i].y;
-		vector.z = mesh->mBitangents[i].z;
-		vertex.Bitangent = vector;
+		// tangent and bitangent, which can only be calculated for meshes with texture coordinates
+		vertex.Tangent = mesh->mTangents ? directionTransform * toVec3(mesh->mTangents[i]) : glm::vec3(0.0f);
+		vertex.Bitangent = mesh->mBitangents ? directionTransform * toVec3(mesh->mBitangents[i]) : glm::vec3(0.0f);
 		vertices.push_back(vertex);
 	}
 
 	for (GLuint i = 0; i < mesh->mNumFaces; i++)
 	{
-		aiFace face = mesh->mFaces[i];
-		// retrieve all indices of the face and store them in the indices vector
+		const aiFace& face = mesh->mFaces[i];
+		// retrieve all indices of the face and store them in the indices vector, points and lines left over by the triangulation are skipped
+		if (face.mNumIndices != 3)
+			continue;
 		for (GLuint j = 0; j < face.mNumIndices; j++)
 			indices.push_back(face.mIndices[j]);
 	}
 
-	setupMesh();
+	if (indices.empty())
+		return;
+	data.meshes.push_back(std::move(result));
 }
 
-//set up the vertex array objects and buffers for the model
-void Model::setupMesh() {
-
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-	//The size in bytes for each vertex in the buffer is defined by the size of each member in the Vertex struct.
-	//Each Vertex member is a matrix of floats, and each float is read as a fixed bytesize.
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-	//the indices vector consists of only GLuints, so only the size of a GLuint needs to be passed to determine the stride
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
-
-	// set the vertex attribute pointers
-	//The byte offset for each property in the vertex is calculated with the offsetof() macro which automatically determines the amount of bytes after which
-	//a given member begins in the given struct, allowing us to easily pass the offset for each vertex member per vertex attribute pointer.
-
-	// vertex Positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-	// vertex normals
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-	// vertex texture coords
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-	// vertex tangent
-	glEnableVertexAttribArray(3);
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-	// vertex bitangent
-	glEnableVertexAttribArray(4);
-	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-	glBindVertexArray(0);
-}
\ No newline at end of file
+//assimp matrices are row major, glm matrices are column major
+static glm::mat4 nodeTransform(const aiNode *node) {
+	return glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+}
+
+//finds the transform of the first node with meshes in the order processNode imports them, returns false when there are no meshes at all
+static bool firstMeshTransform(const aiNode *node, const glm::mat4 &parentTransform, glm::mat4 &result) {
+	glm::mat4 transform = parentTransform * nodeTransform(node);
+	if (node->mNumMeshes > 0) {
+		result = transform;
+		return true;
+	}
+	for (unsigned int i = 0; i < node->mNumChildren; i++) {
+		if (firstMeshTransform(node->mChildren[i], transform, result))
+			return true;
+	}
+	return false;
+}
+
+//walks the node hierarchy and imports the meshes of every node with the transforms of all nodes above it
+static void processNode(const aiNode *node, const glm::mat4 &parentTransform, const aiScene *scene, ModelData &data) {
+	glm::mat4 transform = parentTransform * nodeTransform(node);
+	for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+		processMesh(scene->mMeshes[node->mMeshes[i]], transform, data);
+	}
+	for (unsigned int i = 0; i < node->mNumChildren; i++) {
+		processNode(node->mChildren[i], transform, scene, data);
+	}
+}
+
+//imports every mesh of a model file
+ModelData Model::import(std::string const &path) {
+	ModelData data;
+	//the formats we ship are read by our own importer, which is a lot faster, anything else goes through assimp
+	if (importNative(path, data))
+		return data;
+
+	// read file via ASSIMP
+	Assimp::Importer importer;
+	//get the tangents of the model for normal mapping, and normals for meshes that don't come with any
+	const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals);
+	// check for errors
+	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+	{
+		std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+		return data;
+	}
+
+	//everything is moved into the space of the first mesh, see model.h
+	glm::mat4 firstMesh(1.0f);
+	firstMeshTransform(scene->mRootNode, glm::mat4(1.0f), firstMesh);
+	processNode(scene->mRootNode, glm::inverse(firstMesh), scene, data);
+	return data;
+}
@@ -0,0 +1,26 @@
+#include <options.h>
+
+#include <iostream>
+
+void Options::add(const std::string& name, Handler handler) {
+	handlers[name] = handler;
+}
+
+bool Options::parse(int argc, char** argv) {
+	//every problem is reported before giving up, so they can all be fixed at once
+	bool valid = true;
+	for (int i = 1; i < argc; i += 2) {
+		std::string option = argv[i];
+		auto handler = handlers.find(option);
+		if (handler == handlers.end()) {
+			std::cout << "Unknown option " << option << std::endl;
+			valid = false;
+		} else if (i + 1 >= argc) {
+			std::cout << "Option " << option << " needs a value" << std::endl;
+			valid = false;
+		} else if (!handler->second(argv[i + 1])) {
+			valid = false;
+		}
+	}
+	return valid;
+}
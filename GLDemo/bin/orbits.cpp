@@ -0,0 +1,87 @@
+#include <glad/glad.h>
+#include <glm/gtc/constants.hpp>
+
+#include <orbits.h>
+#include <glstate.h>
+#include <gpumemory.h>
+
+Orbits::Orbits(Planetoid* root, int segments) {
+	std::vector<glm::vec4> vertices;
+	addOrbits(root, segments, vertices);
+	centers.resize(parents.size());
+
+	//the vertices never change, so they're uploaded once as static data
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	GLState::bindVertexArray(VAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec4), vertices.data(), GL_STATIC_DRAW);
+	GPUMemory::buffer(VBO, GPUMemory::MEMORY_MODELS, vertices.size() * sizeof(glm::vec4));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+
+	//the centers are read in the vertex shader through a buffer texture, which unlike a uniform array has no practical size limit
+	glGenBuffers(1, &centerBuffer);
+	GLState::bindBuffer(GL_TEXTURE_BUFFER, centerBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, centers.size() * sizeof(glm::vec4), NULL, GL_DYNAMIC_DRAW);
+	//the buffer texture has no storage of its own
+	GPUMemory::buffer(centerBuffer, GPUMemory::MEMORY_MODELS, centers.size() * sizeof(glm::vec4));
+	glGenTextures(1, &centerTex);
+	GLState::bindTexture(GL_TEXTURE_BUFFER, centerTex);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, centerBuffer);
+}
+
+Orbits::~Orbits() {
+	GLState::deleteVertexArrays(1, &VAO);
+	GLState::deleteBuffers(1, &VBO);
+	GLState::deleteBuffers(1, &centerBuffer);
+	GLState::deleteTextures(1, &centerTex);
+}
+
+//generate a circle for every child of the given planetoid that orbits around it, and then do the same for the children of those children
+void Orbits::addOrbits(Planetoid* parent, int segments, std::vector<glm::vec4>& vertices) {
+	for (Planetoid* child : parent->getChildren()) {
+		float radius = child->getOrbitRadius();
+		//planetoids that don't orbit (such as Saturn's ring) don't need to have an orbit drawn
+		if (radius > 0.0f) {
+			//the orbit index is stored in the w-component so the vertex shader knows which center to add
+			float index = (float)parents.size();
+			firsts.push_back((GLint)vertices.size());
+			counts.push_back(segments);
+			for (int i = 0; i < segments; i++) {
+				//planetoids orbit around the Y-axis of their parent (see Simulation::advance)
+				float angle = glm::two_pi<float>() * i / segments;
+				vertices.push_back(glm::vec4(radius * cos(angle), 0.0f, -radius * sin(angle), index));
+			}
+			parents.push_back(parent);
+		}
+		addOrbits(child, segments, vertices);
+	}
+}
+
+void Orbits::update() {
+	for (size_t i = 0; i < parents.size(); i++) {
+		centers[i] = glm::vec4(parents[i]->position, 1.0f);
+	}
+	GLState::bindBuffer(GL_TEXTURE_BUFFER, centerBuffer);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, centers.size() * sizeof(glm::vec4), centers.data());
+}
+
+/*
+The orbits are transparent and drawn without writing depth, after the skybox so it doesn't draw over them.
+They're still depth tested so planetoids in front of an orbit hide it.
+*/
+void Orbits::draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos, const glm::vec2& viewportSize) {
+	shader.use();
+	shader.setMat4("view", view);
+	shader.setMat4("projection", projection);
+	shader.setVec3("viewPos", viewPos);
+	shader.setVec2("viewportSize", viewportSize);
+	shader.setInt("centers", 0);
+
+	GLState::bindTexture(0, GL_TEXTURE_BUFFER, centerTex);
+	GLState::bindVertexArray(VAO);
+	GLState::depthMask(GL_FALSE);
+	glMultiDrawArrays(GL_LINE_LOOP, firsts.data(), counts.data(), (GLsizei)firsts.size());
+	GLState::depthMask(GL_TRUE);
+}
@@ -1,8 +1,9 @@
 #include <glad/glad.h>
 
 #include <planetoid.h>
+#include <virtualtexture.h>
 
-Planetoid::Planetoid(Model* model, const glm::vec3& startingPos, const vector<Texture>* textures, float radius, float size, float orbitSpeed, float rotationSpeed, bool light) {
+Planetoid::Planetoid(ModelHandle model, const glm::vec3& startingPos, const vector<Texture>& textures, float radius, float size, float orbitSpeed, float rotationSpeed, bool light) {
 	//set up all properties of the planetoid
 	this->base = model;
 	this->textures = textures;
@@ -12,51 +13,150 @@ Planetoid::Planetoid(Model* model, const glm::vec3& startingPos, const vector<Te
 	this->light = light;
 	this->size = size;
 
-	//set up transformation matrices
-	planetRot = glm::mat4(1.0f);
-	planetTrans = glm::mat4(1.0f);
-	planetScale = glm::mat4(1.0f);
-	planetScale = glm::scale(planetScale, glm::vec3(size));
-}
-
-//Draws the planetoid into space using the given shader and the point of origin it needs to orbit around
-void Planetoid::Draw(const Shader& shader, float& deltaTime, glm::vec3& origin, bool turning) {
-
-	if (!light) { //planetoid is not affected by any lighting (used exclusively for the sun)
-		planetRot = glm::rotate(planetRot, glm::radians(rotationSpeed * deltaTime), glm::vec3(0.0f, 1.0f, 0.0f));
-		shader.setBool("isSun", true);
-	} else {
-		if (turning) { //Should the planetoid orbit around its parent?
-			/**
-			To orbit the planetoid around its origin, the planetoid is first moved toward the origin,
-			is rotated around the Y-axis with the orbitSpeed property, and then moved back by the distance of the
-			given radius, so the distance between the planetoid center and the origin is always equal to the radius.
-			**/
-			planetTrans[3] = glm::vec4(origin, 1.0f);
-			planetTrans = glm::rotate(planetTrans, glm::radians(orbitSpeed * deltaTime), glm::vec3(0.0f, 1.0f, 0.0f));
-			planetTrans = glm::translate(planetTrans, glm::vec3(radius, 0, 0));
-			//Rotate the planetoid around its own center
-			planetRot = glm::rotate(planetRot, glm::radians(rotationSpeed * deltaTime), glm::vec3(0.0f, 1.0f, 0.0f));
+	//the simulation moves the planetoid into place before it's drawn for the first time
+	position = startingPos;
+	this->model = glm::scale(glm::translate(glm::mat4(1.0f), startingPos), glm::vec3(size));
+}
+
+//Draws the planetoid into space using the given shader, at the position of the current snapshot of the simulation
+void Planetoid::Draw(ShaderVariants& shaders, int eyes) {
+	Shader& shader = shaders.get(getVariant() | (eyes > 1 ? SPHERE_STEREO : 0));
+	shader.use();
+
+	if (light) { //the sun is not affected by any lighting
+		setShadowUniforms(shader);
+
+		//the lookup tables are built on a worker thread, until they're uploaded the planetoid is drawn without an atmosphere
+		if (atmosphere && atmosphere->poll()) {
+			atmosphere->setSurfaceUniforms(shader, ATMOSPHERE_TEXTURE_UNIT, position, getRadius());
 		} else {
-			planetRot = glm::rotate(planetRot, glm::radians(rotationSpeed * deltaTime), glm::vec3(0.0f, 1.0f, 0.0f));
+			shader.setBool("atmosphere.enabled", false);
 		}
-		//set the position to the third vec4 in the planetTrans mat4 where the XYZ position is located (and the fourth variable is always 1.0)
-		position = glm::vec3(planetTrans[3]);
-
-		shader.setBool("isSun", false);
 	}
 
 	//pass the model matrix to the shader
-	shader.setMat4("model", (planetTrans * planetRot * planetScale));
+	shader.setMat4("model", model);
 	//call the draw command of the model with the textures of this Planetoid
-	base->Draw(shader, textures);
+	base->Draw(shader, &textures, eyes);
+}
 
-	//draw all of the children Planetoids with the origin position of this Planetoid
+void Planetoid::prepareShaders(ShaderVariants& shaders, int eyes) {
+	shaders.get(getVariant() | (eyes > 1 ? SPHERE_STEREO : 0));
 	for (Planetoid* planet : children) {
-		planet->Draw(shader, deltaTime, position, turning);
+		planet->prepareShaders(shaders, eyes);
 	}
 }
 
+/*
+Planetoids without a normal map or specular map use a variant that doesn't sample them at all, instead of sampling a texture
+that doesn't change the result. Flat placeholder normal maps are dropped once they've been decoded (see TextureResource::discarded).
+Maps that are virtual textures are read through their page table instead.
+*/
+unsigned int Planetoid::getVariant() const {
+	unsigned int variant = light ? 0 : SPHERE_EMISSIVE;
+	for (const Texture& texture : textures) {
+		if (texture.isDiscarded())
+			continue;
+		bool isVirtual = texture.virtualTexture != nullptr;
+		if (texture.type == TEX_DIFFUSE && isVirtual)
+			variant |= SPHERE_VIRTUAL_DIFFUSE;
+		//the Sun is only drawn with its diffuse map
+		if (!light)
+			continue;
+		if (texture.type == TEX_NORMAL)
+			variant |= SPHERE_NORMAL_MAP | (isVirtual ? SPHERE_VIRTUAL_NORMAL : 0);
+		else if (texture.type == TEX_SPECULAR)
+			variant |= SPHERE_SPECULAR_MAP | (isVirtual ? SPHERE_VIRTUAL_SPECULAR : 0);
+	}
+	return variant;
+}
+
 void Planetoid::addPlanetoid(Planetoid* planet) {
 	children.push_back(planet);
-}
\ No newline at end of file
+}
+
+void Planetoid::addOccluder(Planetoid* occluder) {
+	occluders.push_back(occluder);
+}
+
+void Planetoid::setRingShadow(Planetoid* ring, float innerRatio, float opacity) {
+	this->ring = ring;
+	ringInnerRatio = innerRatio;
+	ringOpacity = opacity;
+}
+
+void Planetoid::setAtmosphere(Atmosphere* atmosphere) {
+	this->atmosphere = atmosphere;
+}
+
+void Planetoid::DrawAtmosphere(const Shader& shader, int eyes) {
+	if (atmosphere && atmosphere->poll()) {
+		atmosphere->setShellUniforms(shader, 0, position, getRadius());
+		base->Draw(shader, nullptr, eyes);
+	}
+}
+
+void Planetoid::DrawFeedback(const Shader& shader) {
+	//planetoids without virtual textures are still drawn, as they can hide the pages of the ones behind them
+	int count = 0;
+	for (const Texture& texture : textures) {
+		if (texture.virtualTexture && count < MAX_VIRTUAL_MAPS) {
+			shader.setVec4("shapes[" + std::to_string(count) + "]", texture.virtualTexture->getShape());
+			shader.setInt("indices[" + std::to_string(count) + "]", texture.virtualTexture->getIndex());
+			count++;
+		}
+	}
+	shader.setInt("count", count);
+	shader.setMat4("model", getModelMatrix());
+	base->Draw(shader, nullptr);
+}
+
+float Planetoid::getRadius() const {
+	return size * base->getBoundingRadius();
+}
+
+float Planetoid::getOrbitRadius() const {
+	return radius;
+}
+
+const vector<Planetoid*>& Planetoid::getChildren() const {
+	return children;
+}
+
+glm::mat4 Planetoid::getModelMatrix() const {
+	return model;
+}
+
+void Planetoid::setModelMatrix(const glm::mat4& model) {
+	this->model = model;
+	//the translation of the model matrix is the center of the planetoid
+	position = glm::vec3(model[3]);
+}
+
+PlanetoidMotion Planetoid::getMotion() const {
+	return { radius, orbitSpeed, rotationSpeed, size, light };
+}
+
+/*
+Passes the spheres that can block sunlight from reaching this planetoid to the shader, which computes the umbra and penumbra analytically
+(see sphere_fs.glsl). All planetoids are moved to the same snapshot of the simulation before anything is drawn, so occluders are always
+exactly where they're drawn.
+*/
+void Planetoid::setShadowUniforms(const Shader& shader) {
+	int count = glm::min((int)occluders.size(), MAX_OCCLUDERS);
+	for (int i = 0; i < count; i++) {
+		shader.setVec4("occluders[" + std::to_string(i) + "]", glm::vec4(occluders[i]->position, occluders[i]->getRadius()));
+	}
+	shader.setInt("numOccluders", count);
+
+	shader.setBool("ring.enabled", ring != nullptr);
+	if (ring) {
+		//the ring model lies flat in its local XZ-plane, so its normal is the local Y-axis
+		glm::mat4 ringModel = ring->getModelMatrix();
+		shader.setVec3("ring.center", glm::vec3(ringModel[3]));
+		shader.setVec3("ring.normal", glm::normalize(glm::vec3(ringModel * glm::vec4(0.0f, 1.0f, 0.0f, 0.0f))));
+		shader.setFloat("ring.innerRadius", ring->getRadius() * ringInnerRatio);
+		shader.setFloat("ring.outerRadius", ring->getRadius());
+		shader.setFloat("ring.opacity", ringOpacity);
+	}
+}
@@ -0,0 +1,129 @@
+#include <posterexport.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+PosterExport::PosterExport(const ExportSettings& settings, ThreadPool& pool)
+	: settings(settings), pool(pool), readback(settings.tileSize, settings.tileSize) {
+	writer.reset(new TiffWriter(settings.output, settings.width, settings.height, settings.tileSize));
+	tiles = writer->getColumns() * writer->getRows();
+	//every tile is compressed on a worker thread from a copy of its pixels
+	maxWriting = std::max(2, (int)pool.size());
+	if (!writer->isOpen()) {
+		std::cout << "Couldn't create the poster " << settings.output << std::endl;
+		return;
+	}
+	std::cout << "Rendering a poster of " << settings.width << "x" << settings.height << " in " << tiles << " tiles of " << settings.tileSize
+		<< "x" << settings.tileSize << " to " << settings.output << std::endl;
+}
+
+PosterExport::~PosterExport() {
+	finish();
+}
+
+bool PosterExport::isOpen() const {
+	return writer->isOpen();
+}
+
+bool PosterExport::isDone() const {
+	return tile >= tiles;
+}
+
+bool PosterExport::isTiling() const {
+	return tile >= 0 && tile < tiles;
+}
+
+int PosterExport::getTileSize() const {
+	return settings.tileSize;
+}
+
+float PosterExport::getAspect() const {
+	return (float)settings.width / settings.height;
+}
+
+float PosterExport::getPixelScale(int windowHeight) const {
+	return (float)settings.height / windowHeight;
+}
+
+/*
+Tiles are numbered from the top left like they're stored in the file, while OpenGL counts from the bottom left. Tiles along the right and
+bottom edge reach past the poster, the part that's outside of it is drawn as well and then cut off by the readers of the file.
+*/
+glm::vec4 PosterExport::getTileTransform() const {
+	if (!isTiling())
+		return glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+	int columns = writer->getColumns();
+	float size = (float)settings.tileSize;
+	float left = (tile % columns) * size;
+	float bottom = settings.height - (tile / columns + 1) * size;
+	glm::vec2 scale(settings.width / size, settings.height / size);
+	//the center of the tile ends up in the center of the framebuffer
+	glm::vec2 center((left + size * 0.5f) / settings.width * 2.0f - 1.0f, (bottom + size * 0.5f) / settings.height * 2.0f - 1.0f);
+	return glm::vec4(scale, -center * scale);
+}
+
+//the scale and offset are applied to clip space, where they're multiplied with W so they still hold after the perspective division
+glm::mat4 PosterExport::getTileProjection(const glm::mat4& projection) const {
+	glm::vec4 transform = getTileTransform();
+	glm::mat4 tileMatrix(1.0f);
+	tileMatrix[0][0] = transform.x;
+	tileMatrix[1][1] = transform.y;
+	tileMatrix[3][0] = transform.z;
+	tileMatrix[3][1] = transform.w;
+	return tileMatrix * projection;
+}
+
+void PosterExport::capture(GLuint framebuffer) {
+	if (isDone() || !isOpen())
+		return;
+	if (isTiling()) {
+		FrameReadback::Handler handler = [this](uint64_t index, const unsigned char* pixels) { write(index, pixels); };
+		readback.collect(handler);
+		while (!readback.read(framebuffer, tile)) {
+			readback.collect(handler, true);
+		}
+		if ((tile + 1) % 8 == 0 || tile + 1 == tiles)
+			std::cout << "Rendered " << tile + 1 << " of " << tiles << " tiles" << std::endl;
+	}
+	tile++;
+}
+
+void PosterExport::write(uint64_t index, const unsigned char* pixels) {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return writing < maxWriting; });
+		writing++;
+	}
+
+	size_t rowSize = (size_t)settings.tileSize * 3;
+	std::shared_ptr<std::vector<unsigned char>> copy = std::make_shared<std::vector<unsigned char>>(pixels, pixels + rowSize * settings.tileSize);
+	pool.submit([this, copy, rowSize, index]() {
+		//the rows are read back from the bottom up, while the tiles in the file start at the top
+		std::vector<uint8_t> compressed = writer->compressTile(copy->data() + rowSize * (settings.tileSize - 1), -(ptrdiff_t)rowSize);
+		std::lock_guard<std::mutex> lock(mutex);
+		writer->writeTile((int)index, compressed);
+		writing--;
+		condition.notify_all();
+	});
+}
+
+bool PosterExport::finish() {
+	if (finished)
+		return !failed;
+	finished = true;
+	while (readback.pending() > 0) {
+		readback.collect([this](uint64_t index, const unsigned char* pixels) { write(index, pixels); }, true);
+	}
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return writing == 0; });
+	}
+	failed = !isOpen() || !writer->close();
+	if (failed)
+		std::cout << "Couldn't write the poster " << settings.output << std::endl;
+	else if (!isDone())
+		std::cout << "The poster was cancelled, the tiles that weren't rendered are left black" << std::endl;
+	failed = failed || !isDone();
+	return !failed;
+}
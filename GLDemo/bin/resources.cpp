@@ -0,0 +1,201 @@
+#include <glad/glad.h>
+
+#include <resources.h>
+#include <glstate.h>
+#include <gpumemory.h>
+
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+//the same file reached through different relative paths gets the same key, paths that can't be resolved are used as they are
+static std::string canonicalPath(const std::string& path) {
+	std::error_code error;
+	fs::path canonical = fs::weakly_canonical(path, error);
+	return error ? path : canonical.generic_string();
+}
+
+static std::string textureKey(const std::string& paths, const TextureParams& params) {
+	std::stringstream key;
+	key << paths << " (placeholder " << params.placeholder.r << " " << params.placeholder.g << " " << params.placeholder.b
+		<< ", wrap 0x" << std::hex << params.wrap << std::dec << (params.mipmaps ? ", mipmaps" : "") << (params.discardFlat ? ", discard flat" : "") << ")";
+	return key.str();
+}
+
+//forgets the resources whose last handle is gone
+template<typename T>
+static void prune(std::map<std::string, std::weak_ptr<T>>& resources) {
+	for (auto it = resources.begin(); it != resources.end();) {
+		if (it->second.expired())
+			it = resources.erase(it);
+		else
+			it++;
+	}
+}
+
+static std::string kilobytes(size_t bytes) {
+	return std::to_string((bytes + 1023) / 1024) + " KB";
+}
+
+TextureResource::TextureResource(GLuint id, GLenum target, TextureStreamer* streamer) : id(id), target(target), streamer(streamer) {
+}
+
+TextureResource::~TextureResource() {
+	if (streamer)
+		streamer->release(id);
+	else
+		GLState::deleteTextures(1, &id);
+}
+
+size_t TextureResource::getMemoryUsage() const {
+	GLState::bindTexture(target, id);
+	size_t size = 0;
+	int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+	for (int face = 0; face < faces; face++) {
+		GLenum faceTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+		//levels aren't always allocated from 0 up, f.e. while the streamer keeps the placeholder at the smallest level, so every level is checked
+		for (GLint level = 0; level < 16; level++) {
+			GLint width = 0, height = 0, compressed = GL_FALSE;
+			glGetTexLevelParameteriv(faceTarget, level, GL_TEXTURE_WIDTH, &width);
+			if (width == 0)
+				continue;
+			glGetTexLevelParameteriv(faceTarget, level, GL_TEXTURE_HEIGHT, &height);
+			glGetTexLevelParameteriv(faceTarget, level, GL_TEXTURE_COMPRESSED, &compressed);
+			if (compressed) {
+				GLint bytes = 0;
+				glGetTexLevelParameteriv(faceTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &bytes);
+				size += bytes;
+			} else {
+				GLint bits = 0;
+				for (GLenum component : { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE }) {
+					GLint componentBits = 0;
+					glGetTexLevelParameteriv(faceTarget, level, component, &componentBits);
+					bits += componentBits;
+				}
+				size += (size_t)width * height * bits / 8;
+			}
+		}
+	}
+	return size;
+}
+
+Resources::Resources(TextureStreamer& streamer) : streamer(streamer) {
+}
+
+ModelHandle Resources::model(const std::string& path, ModelData* imported) {
+	std::string key = canonicalPath(path);
+	ModelHandle model = models[key].lock();
+	if (!model) {
+		model = std::make_shared<Model>(imported ? std::move(*imported) : Model::import(path), meshes);
+		models[key] = model;
+	}
+	return model;
+}
+
+TextureHandle Resources::texture(const std::string& path, const TextureParams& params) {
+	return createTexture(textureKey(canonicalPath(path), params), GL_TEXTURE_2D, { path }, params);
+}
+
+TextureHandle Resources::cubemap(const std::vector<std::string>& faces, const TextureParams& params) {
+	std::string paths;
+	for (const std::string& face : faces) {
+		paths += (paths.empty() ? "" : ", ") + canonicalPath(face);
+	}
+	return createTexture(textureKey(paths, params), GL_TEXTURE_CUBE_MAP, faces, params);
+}
+
+TextureHandle Resources::solidTexture(const glm::vec3& color) {
+	const unsigned char pixel[3] = { (unsigned char)(color.r * 255), (unsigned char)(color.g * 255), (unsigned char)(color.b * 255) };
+	std::string key = "solid " + std::to_string(pixel[0]) + " " + std::to_string(pixel[1]) + " " + std::to_string(pixel[2]);
+	TextureHandle texture = textures[key].lock();
+	if (texture)
+		return texture;
+
+	GLuint id;
+	glGenTextures(1, &id);
+	GLState::bindTexture(GL_TEXTURE_2D, id);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, pixel);
+	GPUMemory::texture(id, GL_TEXTURE_2D, GPUMemory::MEMORY_TEXTURES, GL_RGB, 1, 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	texture = std::make_shared<TextureResource>(id, GL_TEXTURE_2D, nullptr);
+	textures[key] = texture;
+	return texture;
+}
+
+TextureHandle Resources::createTexture(const std::string& key, GLenum target, const std::vector<std::string>& paths, const TextureParams& params) {
+	TextureHandle texture = textures[key].lock();
+	if (texture)
+		return texture;
+
+	GLuint id = streamer.create(target, params.placeholder, params.mipmaps);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, params.wrap);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, params.wrap);
+	if (target == GL_TEXTURE_CUBE_MAP)
+		glTexParameteri(target, GL_TEXTURE_WRAP_R, params.wrap);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, params.mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	texture = std::make_shared<TextureResource>(id, target, &streamer);
+	textures[key] = texture;
+
+	//the streamer doesn't call onDiscard anymore once the texture has been released, so the resource is still alive whenever it's called
+	std::function<void(GLuint)> onDiscard;
+	if (params.discardFlat) {
+		TextureResource* resource = texture.get();
+		onDiscard = [resource](GLuint) { resource->discarded = true; };
+	}
+	//flat faces are never dropped, a cubemap can't leave out a face
+	if (target == GL_TEXTURE_CUBE_MAP)
+		streamer.loadCubemap(id, paths);
+	else
+		streamer.load(id, target, paths[0], params.discardFlat, onDiscard);
+	return texture;
+}
+
+ShaderHandle Resources::shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const std::vector<std::string>& defines) {
+	std::string key = canonicalPath(vertexPath) + ", " + canonicalPath(fragmentPath);
+	if (geometryPath)
+		key += ", " + canonicalPath(geometryPath);
+	for (const std::string& define : defines) {
+		key += " -D" + define;
+	}
+
+	ShaderHandle shader = shaders[key].lock();
+	if (!shader) {
+		shader = std::make_shared<Shader>(vertexPath, fragmentPath, geometryPath, defines);
+		shaders[key] = shader;
+	}
+	return shader;
+}
+
+void Resources::report() {
+	prune(models);
+	prune(textures);
+	prune(shaders);
+
+	size_t total = 0;
+	std::cout << "Resources in use:" << std::endl;
+	for (auto& model : models) {
+		size_t size = model.second.lock()->getMemoryUsage();
+		total += size;
+		std::cout << "  model    " << kilobytes(size) << ", " << model.second.use_count() << " handles: " << model.first << std::endl;
+	}
+	for (auto& texture : textures) {
+		TextureHandle resource = texture.second.lock();
+		size_t size = resource->getMemoryUsage();
+		total += size;
+		//the handle that was just locked isn't counted
+		std::cout << "  texture  " << kilobytes(size) << ", " << resource.use_count() - 1 << " handles: " << texture.first
+			<< (resource->discarded ? " (discarded)" : "") << std::endl;
+	}
+	for (auto& shader : shaders) {
+		size_t size = shader.second.lock()->getBinarySize();
+		total += size;
+		std::cout << "  shader   " << kilobytes(size) << ", " << shader.second.use_count() << " handles: " << shader.first << std::endl;
+	}
+	std::cout << models.size() << " models, " << textures.size() << " textures, " << shaders.size() << " shaders, " << kilobytes(total) << " in total" << std::endl;
+}
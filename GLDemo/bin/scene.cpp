@@ -0,0 +1,79 @@
+#include <scene.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+//the atmosphere shells are at most 8% larger than their planetoid (see the profiles in main.cpp)
+static const float ATMOSPHERE_MARGIN = 1.1f;
+
+void DrawList::build(Planetoid* root) {
+	items.clear();
+	add(root);
+}
+
+//parents are drawn before their children, like the planetoid tree was drawn before
+void DrawList::add(Planetoid* planet) {
+	items.push_back({ planet, planet->position, planet->getRadius() * ATMOSPHERE_MARGIN });
+	for (Planetoid* child : planet->getChildren()) {
+		add(child);
+	}
+}
+
+/*
+The planes of the frustum are taken straight from the rows of the view projection matrix (see "Fast Extraction of Viewing Frustum Planes
+from the World-View-Projection Matrix" by Gribb and Hartmann), a sphere is outside when it's entirely behind any one of them.
+*/
+void DrawList::cull(View& view) const {
+	glm::mat4 viewProjection = view.projection * view.view;
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) {
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+	glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+
+	view.visible.clear();
+	for (const DrawItem& item : items) {
+		bool inside = true;
+		for (const glm::vec4& plane : planes) {
+			glm::vec3 normal(plane);
+			if (glm::dot(normal, item.center) + plane.w < -item.radius * glm::length(normal)) {
+				inside = false;
+				break;
+			}
+		}
+		if (inside)
+			view.visible.push_back(&item);
+	}
+}
+
+const std::vector<DrawItem>& DrawList::getItems() const {
+	return items;
+}
+
+View followView(const Planetoid& target, const glm::vec3& direction, int x, int y, int width, int height) {
+	View view;
+	float radius = target.getRadius();
+	view.position = target.position - glm::normalize(direction) * radius * 4.0f;
+	view.view = glm::lookAt(view.position, target.position, glm::vec3(0.0f, 1.0f, 0.0f));
+	view.projection = glm::perspective(glm::radians(35.0f), (float)width / height, radius * 0.1f, 200.0f);
+	view.x = x;
+	view.y = y;
+	view.width = width;
+	view.height = height;
+	return view;
+}
+
+View mapView(const glm::vec3& center, float extent, int x, int y, int width, int height) {
+	View view;
+	float aspect = (float)width / height;
+	view.position = center + glm::vec3(0.0f, extent * 2.0f, 0.0f);
+	//looking straight down, with -Z at the top of the map
+	view.view = glm::lookAt(view.position, center, glm::vec3(0.0f, 0.0f, -1.0f));
+	view.projection = glm::ortho(-extent * glm::max(aspect, 1.0f), extent * glm::max(aspect, 1.0f), -extent / glm::min(aspect, 1.0f),
+		extent / glm::min(aspect, 1.0f), 0.0f, extent * 4.0f);
+	view.x = x;
+	view.y = y;
+	view.width = width;
+	view.height = height;
+	view.perspective = false;
+	return view;
+}
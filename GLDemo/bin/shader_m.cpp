@@ -1,64 +1,282 @@
 #include <glad/glad.h>
 
 #include <shader_m.h>
+#include <extensions.h>
+#include <uniforms.h>
+#include <glstate.h>
 
-Shader::Shader(const char * vertexPath, const char * fragmentPath) {
-	// 1. retrieve the vertex/fragment source code from filePath
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-	// ensure ifstream objects can throw exceptions:
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	try
-	{
-		// open files
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, fShaderStream;
-		// read file's buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-		// close file handlers
-		vShaderFile.close();
-		fShaderFile.close();
-		// convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+const char * SHADER_CACHE_PATH = "./bin/cache/shaders/";
+const uint32_t SHADER_CACHE_MAGIC = 0x4E494250; //"PBIN"
+const uint32_t SHADER_CACHE_VERSION = 1;
+
+//FNV-1a hash, used to name the cache file of a program after its sources and the driver
+static uint64_t hashString(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+	for (unsigned char c : text) {
+		hash ^= c;
+		hash *= 1099511628211ull;
 	}
-	catch (std::ifstream::failure e)
-	{
-		std::cout << "Couldn't read shader file" << std::endl;
+	return hash;
+}
+
+/*
+Reads a shader source file and resolves its #include "file" directives, with paths relative to the file that includes them.
+#line directives are inserted around every included file so the line numbers in compile errors still point at the right line. Every file
+is given the next index of files as its source string number, which the compiler puts in front of the line numbers of its errors.
+*/
+static std::string loadSource(const fs::path& path, std::vector<std::string>& files, int depth = 0) {
+	int index = (int)files.size();
+	files.push_back(path.string());
+	std::ifstream file(path);
+	if (!file || depth > 16) {
+		std::cout << "Couldn't read shader file: " << path.string() << std::endl;
+		return "";
+	}
+
+	std::stringstream source;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		size_t directive = line.find("#include");
+		size_t open = line.find('"');
+		size_t close = line.rfind('"');
+		if (directive != std::string::npos && line.find_first_not_of(" \t") == directive && open != close) {
+			fs::path includePath = path.parent_path() / line.substr(open + 1, close - open - 1);
+			int includeIndex = (int)files.size();
+			std::string included = loadSource(includePath, files, depth + 1);
+			source << "#line 1 " << includeIndex << "\n" << included << "#line " << lineNumber + 1 << " " << index << "\n";
+		} else {
+			source << line << "\n";
+		}
+	}
+	return source.str();
+}
+
+//adds a #define for every feature of the variant directly after the #version directive, which has to stay the first line
+static std::string addDefines(const std::string& source, const std::vector<std::string>& defines) {
+	if (defines.empty())
+		return source;
+
+	std::string defineLines;
+	for (const std::string& define : defines) {
+		defineLines += "#define " + define + "\n";
 	}
+
+	size_t version = source.find("#version");
+	size_t insertAt = version == std::string::npos ? 0 : source.find('\n', version) + 1;
+	//the #line directive makes sure the line numbers in compile errors aren't shifted by the added lines
+	return source.substr(0, insertAt) + defineLines + "#line 2 0\n" + source.substr(insertAt);
+}
+
+Shader::Shader(const char * vertexPath, const char * fragmentPath, const char * geometryPath, const std::vector<std::string>& defines) {
+	// 1. retrieve the source code, resolving includes and adding the defines of this variant
+	std::string vertexCode = addDefines(loadSource(vertexPath, vertexFiles), defines);
+	std::string fragmentCode = addDefines(loadSource(fragmentPath, fragmentFiles), defines);
+	std::string geometryCode = geometryPath ? addDefines(loadSource(geometryPath, geometryFiles), defines) : "";
+
+	// 2. try to load the linked program from the cache, the key contains the sources and the driver so any change to either is a cache miss
+	cacheKey = GLExtensions::driverString() + "\n" + vertexCode + "\n" + fragmentCode + "\n" + geometryCode;
+	std::stringstream path;
+	path << SHADER_CACHE_PATH << std::hex << hashString(cacheKey) << ".bin";
+	cachePath = path.str();
+
+	ID = glCreateProgram();
+	if (loadBinary()) {
+		bindUniformBlocks();
+		return;
+	}
+
+	// 3. compile shaders, without checking the results yet so the driver can compile them in the background
 	const char * vShaderCode = vertexCode.c_str();
 	const char * fShaderCode = fragmentCode.c_str();
-	// 2. compile shaders
-	unsigned int vertex, fragment;
 	// vertex shader
 	vertex = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vertex, 1, &vShaderCode, NULL);
 	glCompileShader(vertex);
-	checkCompileErrors(vertex, "VERTEX");
 	// fragment Shader
 	fragment = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(fragment, 1, &fShaderCode, NULL);
 	glCompileShader(fragment);
-	checkCompileErrors(fragment, "FRAGMENT");
+	// geometry shader
+	if (geometryPath) {
+		const char * gShaderCode = geometryCode.c_str();
+		geometry = glCreateShader(GL_GEOMETRY_SHADER);
+		glShaderSource(geometry, 1, &gShaderCode, NULL);
+		glCompileShader(geometry);
+	}
 	// shader Program
-	ID = glCreateProgram();
 	glAttachShader(ID, vertex);
 	glAttachShader(ID, fragment);
+	if (geometry)
+		glAttachShader(ID, geometry);
+	if (GLExtensions::programBinary)
+		GLExtensions::ProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(ID);
-	checkCompileErrors(ID, "PROGRAM");
+	pending = true;
+}
+
+Shader::~Shader() {
+	// shaders that are still attached are deleted along with the program
+	if (pending) {
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
+		if (geometry)
+			glDeleteShader(geometry);
+	}
+	GLState::deleteProgram(ID);
+}
+
+bool Shader::isReady() const {
+	if (!pending)
+		return true;
+	//without parallel compilation support any status query blocks until the driver is done, so there's no point in polling
+	if (!GLExtensions::parallelShaderCompile)
+		return false;
+	GLint done = GL_FALSE;
+	glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+}
+
+void Shader::finish() {
+	if (!pending)
+		return;
+	pending = false;
+
+	bool success = checkCompileErrors(vertex, "VERTEX", &vertexFiles);
+	success = checkCompileErrors(fragment, "FRAGMENT", &fragmentFiles) && success;
+	if (geometry)
+		success = checkCompileErrors(geometry, "GEOMETRY", &geometryFiles) && success;
+	success = checkCompileErrors(ID, "PROGRAM") && success;
+
 	// delete the shaders as they're linked into our program now and no longer necessery
+	glDetachShader(ID, vertex);
+	glDetachShader(ID, fragment);
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
+	if (geometry) {
+		glDetachShader(ID, geometry);
+		glDeleteShader(geometry);
+	}
+
+	if (success) {
+		bindUniformBlocks();
+		saveBinary();
+	}
+}
+
+size_t Shader::getBinarySize() const {
+	if (pending || !GLExtensions::programBinary)
+		return 0;
+	GLint length = 0;
+	glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+	return (size_t)length;
+}
+
+//bind the uniform blocks shared by all shaders to their fixed binding points
+void Shader::bindUniformBlocks() {
+	GLuint frameBlock = glGetUniformBlockIndex(ID, "Frame");
+	if (frameBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, frameBlock, FRAME_BLOCK_BINDING);
+	GLuint stereoBlock = glGetUniformBlockIndex(ID, "Stereo");
+	if (stereoBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, stereoBlock, STEREO_BLOCK_BINDING);
+}
+
+ShaderVariants::ShaderVariants(const char * vertexPath, const char * fragmentPath, const std::vector<std::string>& features, const std::vector<std::string>& defines)
+	: vertexPath(vertexPath), fragmentPath(fragmentPath), features(features), defines(defines) {
+}
+
+Shader& ShaderVariants::get(unsigned int mask) {
+	std::unique_ptr<Shader>& variant = variants[mask];
+	if (!variant) {
+		std::vector<std::string> defines = this->defines;
+		for (size_t i = 0; i < features.size(); i++) {
+			if (mask & (1u << i))
+				defines.push_back(features[i]);
+		}
+		variant.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), nullptr, defines));
+	}
+	return *variant;
+}
+
+/*
+The cache file starts with a small header, followed by the key the program was stored with and the binary itself.
+The full key is compared as well so a hash collision can't load the wrong program.
+The driver is free to reject a binary (f.e. after a driver update), in which case the program is compiled from source again.
+*/
+bool Shader::loadBinary() {
+	if (!GLExtensions::programBinary)
+		return false;
+
+	std::ifstream file(cachePath, std::ios::binary);
+	if (!file)
+		return false;
+
+	uint32_t header[5]; //magic, version, binary format, key length, binary length
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file || header[0] != SHADER_CACHE_MAGIC || header[1] != SHADER_CACHE_VERSION || header[3] != cacheKey.size())
+		return false;
+
+	std::string key(header[3], '\0');
+	std::vector<char> binary(header[4]);
+	file.read(&key[0], key.size());
+	file.read(binary.data(), binary.size());
+	if (!file || key != cacheKey)
+		return false;
+
+	GLExtensions::ProgramBinary(ID, header[2], binary.data(), (GLsizei)binary.size());
+	GLint success = GL_FALSE;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	return success == GL_TRUE;
+}
+
+void Shader::saveBinary() {
+	if (!GLExtensions::programBinary)
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::vector<char> binary(length);
+	GLenum format;
+	GLExtensions::GetProgramBinary(ID, length, NULL, &format, binary.data());
+
+	std::error_code error;
+	fs::create_directories(SHADER_CACHE_PATH, error);
+
+	//write to a temporary file first, so a crash or a second instance of the app never leaves a half written binary behind
+	std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary);
+		if (!file) {
+			std::cout << "Couldn't write shader cache: " << cachePath << std::endl;
+			return;
+		}
+		const uint32_t header[5] = { SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, format, (uint32_t)cacheKey.size(), (uint32_t)length };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(cacheKey.data(), cacheKey.size());
+		file.write(binary.data(), binary.size());
+		if (!file) {
+			std::cout << "Couldn't write shader cache: " << cachePath << std::endl;
+			file.close();
+			fs::remove(tempPath, error);
+			return;
+		}
+	}
+	fs::rename(tempPath, cachePath, error);
 }
 
 //activate the shader
 void Shader::use() {
-	glUseProgram(ID);
+	finish();
+	GLState::useProgram(ID);
 }
 
 //utility functions for setting uniform variables in the shaders
@@ -120,7 +338,7 @@ void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
 }
 
 //utility function for checking shader compilation/linking errors
-void Shader::checkCompileErrors(GLuint shader, std::string type) {
+bool Shader::checkCompileErrors(GLuint shader, std::string type, const std::vector<std::string>* files) {
 	GLint success;
 	GLchar infoLog[1024];
 	if (type != "PROGRAM")
@@ -130,7 +348,12 @@ void Shader::checkCompileErrors(GLuint shader, std::string type) {
 		{
 			glGetShaderInfoLog(shader, 1024, NULL, infoLog);
 			OutputDebugString(infoLog);
-			std::cout << "Couldn't compile shader of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+			std::cout << "Couldn't compile shader of type: " << type << "\n" << infoLog;
+			//the errors start with the source string number of the file they're in, f.e. 0(12) or 0:12
+			for (size_t i = 0; files && i < files->size(); i++) {
+				std::cout << "source " << i << ": " << files->at(i) << "\n";
+			}
+			std::cout << "\n -- --------------------------------------------------- -- " << std::endl;
 		}
 	}
 	else
@@ -143,4 +366,5 @@ void Shader::checkCompileErrors(GLuint shader, std::string type) {
 			std::cout << "Couldn't link program of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
 		}
 	}
+	return success == GL_TRUE;
 }
\ No newline at end of file
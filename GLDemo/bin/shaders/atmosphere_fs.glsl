@@ -0,0 +1,60 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+
+//precomputed single scattering, indexed by the view zenith, Sun zenith and view-Sun angle where the view ray enters the atmosphere (see atmosphere.cpp)
+uniform sampler3D inscatter;
+
+uniform vec3 center;
+uniform float planetRadius;
+uniform float height;
+uniform vec3 rayleighScattering;
+uniform float mieG;
+uniform float sunIntensity;
+
+#ifdef STEREO
+//the eye this fragment is drawn for
+flat in vec3 EyePos;
+#define viewPos EyePos
+#else
+uniform vec3 viewPos;
+#endif
+uniform vec3 lightPos;
+
+const float PI = 3.14159265;
+
+void main() {
+	//work in units of the planetoid radius with the planetoid at the origin, just like the lookup tables
+	vec3 camera = (viewPos - center) / planetRadius;
+	vec3 dir = normalize(FragPos - viewPos);
+
+	//find the point where the view ray enters the atmosphere, rays that pass the atmosphere entirely don't scatter any light
+	float top = 1.0 + height;
+	float b = dot(camera, dir);
+	float discriminant = b * b - dot(camera, camera) + top * top;
+	if (discriminant < 0.0)
+		discard;
+	vec3 entry = camera + dir * max(-b - sqrt(discriminant), 0.0);
+
+	vec3 up = normalize(entry);
+	vec3 sunDir = normalize(lightPos - (center + entry * planetRadius));
+	float mu = dot(up, dir);
+	float muS = dot(up, sunDir);
+	float nu = dot(dir, sunDir);
+
+	vec4 scattered = texture(inscatter, vec3(mu + 1.0, (muS + 1.0) * 0.5, (nu + 1.0) * 0.5));
+
+	//only the red channel of the mie scattering is stored, the other channels follow from the ratio to the rayleigh scattering
+	vec3 rayleigh = scattered.rgb;
+	vec3 mie = scattered.rgb * (scattered.a / max(scattered.r, 0.00001)) * (rayleighScattering.r / rayleighScattering);
+
+	//the phase functions determine how much light is scattered towards the viewer depending on the angle with the Sun
+	float rayleighPhase = 3.0 / (16.0 * PI) * (1.0 + nu * nu);
+	float g2 = mieG * mieG;
+	float miePhase = 3.0 / (8.0 * PI) * ((1.0 - g2) * (1.0 + nu * nu)) / ((2.0 + g2) * pow(1.0 + g2 - 2.0 * mieG * nu, 1.5));
+
+	//the scattered light is added on top of the planetoid and the skybox, so it's tone mapped to prevent it from clipping
+	vec3 color = sunIntensity * (rayleigh * rayleighPhase + mie * miePhase);
+	FragColor = vec4(1.0 - exp(-color), 1.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+#include "stereo.glsl"
+layout (location = 0) in vec3 aPos;
+
+out vec3 FragPos;
+#ifdef STEREO
+flat out vec3 EyePos;
+#endif
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat4 model;
+
+//the atmosphere shell is a sphere slightly larger than the atmosphere itself, the fragment shader finds the actual edge
+void main() {
+	FragPos = vec3(model * vec4(aPos, 1.0));
+#ifdef STEREO
+	int eye = stereoEye();
+	EyePos = eyePosition[eye].xyz;
+	gl_Position = stereoPack(eyeProjection[eye] * eyeView[eye] * vec4(FragPos, 1.0));
+#else
+	gl_Position = projection * view * vec4(FragPos, 1.0);
+#endif
+}
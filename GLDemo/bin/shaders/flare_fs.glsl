@@ -0,0 +1,28 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 SpritePos;
+flat in int Shape;
+in vec4 Color;
+
+//the visible fraction of the Sun
+uniform float intensity;
+
+//every sprite is generated procedurally, so the flare doesn't need any textures
+void main() {
+	float r = length(SpritePos);
+	float brightness;
+	if (Shape == 0) {
+		//glare: a bright core that falls off quickly, with faint rays around it
+		float angle = atan(SpritePos.y, SpritePos.x);
+		float rays = pow(abs(cos(angle * 6.0)), 30.0) * 0.4 * (1.0 - r);
+		brightness = exp(-r * r * 12.0) + max(rays, 0.0);
+	} else if (Shape == 1) {
+		//halo: a thin ring
+		brightness = 1.0 - smoothstep(0.0, 0.12, abs(r - 0.85));
+	} else {
+		//disc: a soft-edged circle
+		brightness = 1.0 - smoothstep(0.7, 1.0, r);
+	}
+	FragColor = vec4(Color.rgb, Color.a * brightness * intensity);
+}
@@ -0,0 +1,44 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;
+
+out vec2 SpritePos;
+flat out int Shape;
+out vec4 Color;
+
+uniform vec2 sunPos; //position of the Sun in normalized device coordinates
+uniform float aspect;
+uniform vec4 tile = vec4(1.0, 1.0, 0.0, 0.0); //scale and offset from the whole image to the tile that's drawn
+
+#define FLARE_SPRITES 8
+//x: position along the line from the Sun (0.0) through the center of the screen (1.0), y: size, z: shape (0 glare, 1 halo, 2 disc)
+const vec3 sprites[FLARE_SPRITES] = vec3[](
+	vec3(0.0, 0.9, 0.0),
+	vec3(0.4, 0.08, 2.0),
+	vec3(0.7, 0.15, 1.0),
+	vec3(1.15, 0.05, 2.0),
+	vec3(1.35, 0.22, 1.0),
+	vec3(1.6, 0.1, 2.0),
+	vec3(1.9, 0.35, 1.0),
+	vec3(2.2, 0.06, 2.0)
+);
+const vec4 colors[FLARE_SPRITES] = vec4[](
+	vec4(1.0, 0.95, 0.8, 0.8),
+	vec4(1.0, 0.6, 0.3, 0.25),
+	vec4(0.4, 0.8, 1.0, 0.15),
+	vec4(0.7, 1.0, 0.5, 0.3),
+	vec4(1.0, 0.4, 0.6, 0.12),
+	vec4(0.5, 0.6, 1.0, 0.2),
+	vec4(0.9, 0.9, 1.0, 0.08),
+	vec4(1.0, 0.8, 0.4, 0.25)
+);
+
+void main() {
+	vec3 sprite = sprites[gl_InstanceID];
+	SpritePos = aPos;
+	Shape = int(sprite.z);
+	Color = colors[gl_InstanceID];
+
+	vec2 center = sunPos * (1.0 - sprite.x);
+	vec2 pos = center + aPos * vec2(sprite.y / aspect, sprite.y);
+	gl_Position = vec4(pos * tile.xy + tile.zw, 0.0, 1.0);
+}
@@ -0,0 +1,21 @@
+//data that stays the same for every draw in a frame, must match FrameData in uniforms.h
+
+//holds the properties for the lighting
+struct Light {
+	vec3 position;
+	float radius; //radius of the Sun, needed to calculate the size of the penumbra
+	vec3 ambient;
+	float constant;
+	vec3 diffuse;
+	float linear;
+	vec3 specular;
+	float quadratic;
+};
+
+layout (std140) uniform Frame {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	float shininess; //specular exponent of all planetoids
+	Light light;
+};
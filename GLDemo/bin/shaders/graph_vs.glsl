@@ -0,0 +1,8 @@
+#version 330 core
+layout (location = 0) in vec2 aPos; //in pixels of the HUD
+
+uniform mat4 projection;
+
+void main() {
+	gl_Position = projection * vec4(aPos, 0.0, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+out vec4 FragColor;
+
+in float Brightness;
+
+uniform vec3 color = vec3(0.85, 0.8, 0.7);
+
+void main() {
+	FragColor = vec4(color, Brightness);
+}
@@ -0,0 +1,66 @@
+#version 330 core
+//the orbital elements of a body, see MinorPlanetCatalog
+layout (location = 0) in float aSemiMajorAxis;
+layout (location = 1) in float aEccentricity;
+layout (location = 2) in float aInclination;
+layout (location = 3) in float aAscendingNode;
+layout (location = 4) in float aPerihelion;
+layout (location = 5) in float aMeanAnomaly;
+layout (location = 6) in float aMeanMotion;
+layout (location = 7) in float aMagnitude;
+
+out float Brightness;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 sunPos;
+uniform float days; //since J2000
+uniform float pointScale = 1.0;
+
+//distances in AU (x) and in the scene (y) of the orbits of the planets, the scene isn't to scale so distances are interpolated between them
+#define MAX_SCALE_POINTS 8
+uniform vec2 scalePoints[MAX_SCALE_POINTS];
+uniform int scalePointCount;
+
+float sceneDistance(float distance) {
+	vec2 previous = vec2(0.0);
+	vec2 next = vec2(1.0);
+	for (int i = 0; i < scalePointCount; i++) {
+		next = scalePoints[i];
+		if (distance <= next.x)
+			break;
+		//past the last orbit the slope of the last interval is kept
+		if (i < scalePointCount - 1)
+			previous = next;
+	}
+	return mix(previous.y, next.y, (distance - previous.x) / (next.x - previous.x));
+}
+
+void main() {
+	//Kepler's equation M = E - e sin(E), solved for the eccentric anomaly with a few Newton iterations
+	float e = aEccentricity;
+	float M = mod(aMeanAnomaly + aMeanMotion * days, 6.28318531);
+	float E = e < 0.8 ? M : 3.14159265;
+	for (int i = 0; i < 6; i++) {
+		E -= (E - e * sin(E) - M) / (1.0 - e * cos(E));
+	}
+	//the position in the plane of the orbit with the perihelion along the X-axis, turned into the ecliptic
+	vec2 orbital = aSemiMajorAxis * vec2(cos(E) - e, sqrt(1.0 - e * e) * sin(E));
+	float cw = cos(aPerihelion), sw = sin(aPerihelion);
+	float cn = cos(aAscendingNode), sn = sin(aAscendingNode);
+	float ci = cos(aInclination), si = sin(aInclination);
+	vec3 ecliptic = vec3(
+		(cn * cw - sn * sw * ci) * orbital.x - (cn * sw + sn * cw * ci) * orbital.y,
+		(sn * cw + cn * sw * ci) * orbital.x - (sn * sw - cn * cw * ci) * orbital.y,
+		sw * si * orbital.x + cw * si * orbital.y);
+
+	//the ecliptic is the XZ-plane of the scene, where the planets orbit counterclockwise seen from above (see Simulation::advance)
+	float distance = length(ecliptic);
+	vec3 direction = vec3(ecliptic.x, ecliptic.z, -ecliptic.y) / max(distance, 1e-6);
+	vec3 worldPos = sunPos + direction * sceneDistance(distance);
+
+	//absolute magnitudes of the catalog run from about 3 (Ceres) to over 20 for the smallest bodies
+	Brightness = clamp((21.0 - aMagnitude) / 12.0, 0.1, 1.0);
+	gl_PointSize = aMagnitude < 10.0 ? 2.0 * pointScale : pointScale;
+	gl_Position = projection * view * vec4(worldPos, 1.0);
+}
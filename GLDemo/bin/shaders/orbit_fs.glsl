@@ -0,0 +1,10 @@
+#version 330 core
+out vec4 FragColor;
+
+in float fade;
+
+uniform vec4 orbitColor = vec4(0.4, 0.6, 1.0, 0.35);
+
+void main() {
+	FragColor = vec4(orbitColor.rgb, orbitColor.a * fade);
+}
@@ -0,0 +1,54 @@
+#version 330 core
+layout (lines) in;
+layout (triangle_strip, max_vertices = 4) out;
+
+in float Fade[];
+out float fade;
+
+uniform vec2 viewportSize;
+uniform float lineWidth = 1.5; //in pixels
+
+/*
+Expands every line segment into a quad that's always lineWidth pixels wide, since wide lines aren't supported in the core profile.
+Segments are clipped against the near plane first, otherwise the perspective division of points behind the camera flips them across the screen.
+*/
+void main() {
+	vec4 p0 = gl_in[0].gl_Position;
+	vec4 p1 = gl_in[1].gl_Position;
+	float fade0 = Fade[0];
+	float fade1 = Fade[1];
+
+	//in clip space a point lies in front of the near plane when z > -w
+	float d0 = p0.z + p0.w;
+	float d1 = p1.z + p1.w;
+	if (d0 < 0.0 && d1 < 0.0)
+		return;
+	if (d0 < 0.0) {
+		float t = d0 / (d0 - d1);
+		p0 = mix(p0, p1, t);
+		fade0 = mix(fade0, fade1, t);
+	} else if (d1 < 0.0) {
+		float t = d1 / (d1 - d0);
+		p1 = mix(p1, p0, t);
+		fade1 = mix(fade1, fade0, t);
+	}
+
+	//find the direction of the segment in pixels and offset both points perpendicular to it
+	vec2 screen0 = p0.xy / p0.w * viewportSize * 0.5;
+	vec2 screen1 = p1.xy / p1.w * viewportSize * 0.5;
+	vec2 dir = screen1 - screen0;
+	dir = length(dir) > 0.0001 ? normalize(dir) : vec2(1.0, 0.0);
+	vec2 offset = vec2(-dir.y, dir.x) * lineWidth * 0.5 / (viewportSize * 0.5);
+
+	fade = fade0;
+	gl_Position = vec4(p0.xy + offset * p0.w, p0.zw);
+	EmitVertex();
+	gl_Position = vec4(p0.xy - offset * p0.w, p0.zw);
+	EmitVertex();
+	fade = fade1;
+	gl_Position = vec4(p1.xy + offset * p1.w, p1.zw);
+	EmitVertex();
+	gl_Position = vec4(p1.xy - offset * p1.w, p1.zw);
+	EmitVertex();
+	EndPrimitive();
+}
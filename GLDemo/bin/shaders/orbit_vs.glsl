@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec4 aPos; //xyz is the position relative to the center of the orbit, w is the index of the orbit
+
+out float Fade;
+
+//the current world position of the center of every orbit, updated every frame
+uniform samplerBuffer centers;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPos;
+
+//orbits fade out between these distances from the camera, so orbits far away don't clutter the screen
+uniform float fadeStart = 60.0;
+uniform float fadeEnd = 160.0;
+
+void main() {
+	vec3 worldPos = texelFetch(centers, int(aPos.w)).xyz + aPos.xyz;
+	Fade = 1.0 - smoothstep(fadeStart, fadeEnd, distance(worldPos, viewPos));
+	gl_Position = projection * view * vec4(worldPos, 1.0);
+}
@@ -3,11 +3,21 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
+#ifdef LAYERED
+//a layered stereo framebuffer, with an eye in every layer (see FBO::drawTextureQuad)
+uniform sampler2DArray screenTexture;
+uniform int layer;
+#else
 uniform sampler2D screenTexture;
+#endif
 
 //draws the texture of the view space to the screen
 void main() {
+#ifdef LAYERED
+	vec3 col = texture(screenTexture, vec3(TexCoords, layer)).rgb;
+#else
 	vec3 col = texture(screenTexture, TexCoords).rgb;
+#endif
 	FragColor = vec4(col, 1.0);
 
 	//potential post-processing effects can be implemented here
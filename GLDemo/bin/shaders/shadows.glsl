@@ -0,0 +1,87 @@
+//shadowing of sunlight by eclipsing bodies, rings and atmospheres, requires frame.glsl to be included first
+
+//spheres that can block the light of the Sun for this planetoid, xyz holds the world position and w the radius
+#define MAX_OCCLUDERS 4
+uniform vec4 occluders[MAX_OCCLUDERS];
+uniform int numOccluders;
+
+//a flat ring around the planetoid that can cast its shadow onto it (Saturn's rings)
+struct Ring {
+	bool enabled;
+	vec3 center;
+	vec3 normal;
+	float innerRadius;
+	float outerRadius;
+	float opacity;
+};
+uniform Ring ring;
+
+//sunlight reaching the surface of a planetoid with an atmosphere is dimmed and reddened by the transmittance table (see atmosphere.cpp)
+struct Atmosphere {
+	bool enabled;
+	sampler2D transmittance;
+	vec3 center;
+	float planetRadius;
+	float height;
+};
+uniform Atmosphere atmosphere;
+
+//returns the color of the sunlight after it passed through the atmosphere to the surface at the given world position
+vec3 atmosphereTransmittance(vec3 fragPos) {
+	if (!atmosphere.enabled)
+		return vec3(1.0);
+
+	vec3 up = normalize(fragPos - atmosphere.center);
+	float muS = dot(up, normalize(light.position - fragPos));
+	return texture(atmosphere.transmittance, vec2((muS + 1.0) * 0.5, 0.0)).rgb;
+}
+
+/*
+Returns the fraction of the Sun's disc that is hidden by an occluder, given the angular radius of the Sun, the angular radius of the occluder
+and the angle between both of their centers as seen from the fragment. When the discs don't touch the fragment is fully lit, when the occluder
+lies fully inside the Sun's disc (or the other way around) the hidden fraction is the ratio of their areas, which is 1.0 inside the umbra.
+Between those two cases the fragment is inside the penumbra, where the exact circle-circle intersection is approximated with a smoothstep.
+*/
+float discOcclusion(float sunRadius, float occluderRadius, float separation) {
+	float maxOcclusion = min(1.0, (occluderRadius * occluderRadius) / (sunRadius * sunRadius));
+	return maxOcclusion * (1.0 - smoothstep(abs(sunRadius - occluderRadius), sunRadius + occluderRadius, separation));
+}
+
+//returns how much of the Sun's light reaches the given world position, from 0.0 (umbra) to 1.0 (fully lit)
+float sunVisibility(vec3 fragPos) {
+	vec3 toSun = light.position - fragPos;
+	float sunDistance = length(toSun);
+	toSun /= sunDistance;
+	float sunAngle = asin(clamp(light.radius / sunDistance, 0.0, 1.0));
+
+	float visibility = 1.0;
+	for (int i = 0; i < numOccluders; i++) {
+		vec3 toOccluder = occluders[i].xyz - fragPos;
+		float occluderDistance = length(toOccluder);
+		//occluders behind the fragment or behind the Sun can't cast a shadow onto it
+		if (occluderDistance <= occluders[i].w || occluderDistance >= sunDistance)
+			continue;
+
+		float occluderAngle = asin(occluders[i].w / occluderDistance);
+		float separation = acos(clamp(dot(toSun, toOccluder / occluderDistance), -1.0, 1.0));
+		visibility *= 1.0 - discOcclusion(sunAngle, occluderAngle, separation);
+	}
+
+	//trace a ray towards the Sun and check if it passes through the ring plane between the inner and outer edge of the ring
+	if (ring.enabled) {
+		float facing = dot(toSun, ring.normal);
+		if (abs(facing) > 0.0001) {
+			float t = dot(ring.center - fragPos, ring.normal) / facing;
+			if (t > 0.0) {
+				float r = length(fragPos + toSun * t - ring.center);
+				//soften the edges of the ring shadow by the width of the penumbra at that distance
+				float softness = max(t * tan(sunAngle), 0.001);
+				float coverage = smoothstep(ring.innerRadius - softness, ring.innerRadius + softness, r)
+					* (1.0 - smoothstep(ring.outerRadius - softness, ring.outerRadius + softness, r));
+				visibility *= 1.0 - coverage * ring.opacity;
+			}
+		}
+	}
+
+	return visibility;
+}
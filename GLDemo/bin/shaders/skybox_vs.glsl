@@ -1,4 +1,5 @@
 #version 330 core
+#include "stereo.glsl"
 layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
@@ -9,12 +10,22 @@ uniform mat4 view;
 void main()
 {
     TexCoords = aPos;
+#ifdef STEREO
+    //the eyes only differ in their translation and their projection, so the rotation of either view is the same
+    int eye = stereoEye();
+    vec4 pos = eyeProjection[eye] * mat4(mat3(eyeView[eye])) * vec4(aPos, 1.0);
+#else
     vec4 pos = projection * view * vec4(aPos, 1.0); //perspective division
+#endif
 	
 	/*
 	Because we want the skybox to pass the depth test where possible even though it's drawn later than the planetoids, we want to keep the z-value
 	(whose value is the resulting depth value after perspective division has been performed and then divided by w) to always be 1.0, so it's set to have the same
 	value as w, whose value is always 1.0, so by assigning the value of w to z we end up with w / w = 1.0.
 	*/
+#ifdef STEREO
+    gl_Position = stereoPack(pos.xyww);
+#else
     gl_Position = pos.xyww;
+#endif
 }  
\ No newline at end of file
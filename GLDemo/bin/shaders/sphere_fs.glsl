@@ -1,76 +1,131 @@
 #version 330 core
+#include "frame.glsl"
+#include "shadows.glsl"
+#include "virtualtexture.glsl"
+
 out vec4 FragColor;
 
-//holds the textures
+//holds the textures, only the ones used by this variant (see sphere_vs.glsl) are declared
 struct Material {
+#ifdef VIRTUAL_DIFFUSE
+	VirtualMap diffuse;
+#else
 	sampler2D diffuse;
+#endif
+#ifdef NORMAL_MAP
+#ifdef VIRTUAL_NORMAL
+	VirtualMap normal;
+#else
 	sampler2D normal;
+#endif
+#endif
+#ifdef SPECULAR_MAP
+#ifdef VIRTUAL_SPECULAR
+	VirtualMap specular;
+#else
 	sampler2D specular;
-	float shininess;
-};
-
-//holds the properties for the lighting
-struct Light {
-	vec3 position;
-
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-
-	float constant;
-	float linear;
-	float quadratic;
+#endif
+#endif
 };
 
 //data received from the vertex shader
 in VS_OUT {
 	vec3 FragPos;
 	vec2 TexCoords;
-	vec3 TangentLightPos;
-	vec3 TangentViewPos;
-	vec3 TangentFragPos;
+#ifndef EMISSIVE
+	vec3 Normal;
+#ifdef NORMAL_MAP
+	mat3 TBN;
+#endif
+#ifdef STEREO
+	flat vec3 EyePos; //the eye this fragment is drawn for, instead of viewPos which is between the eyes
+#endif
+#endif
 } fs_in;
 
-uniform vec3 viewPos;
 uniform Material material;
-uniform Light light;
 
-uniform bool isSun;
+//every map can be a regular texture or a virtual texture
+vec4 sampleDiffuse(vec2 uv) {
+#ifdef VIRTUAL_DIFFUSE
+	return sampleVirtual(material.diffuse.pages, material.diffuse.cache, material.diffuse.shape, uv);
+#else
+	return texture(material.diffuse, uv);
+#endif
+}
+
+#ifdef NORMAL_MAP
+vec4 sampleNormal(vec2 uv) {
+#ifdef VIRTUAL_NORMAL
+	return sampleVirtual(material.normal.pages, material.normal.cache, material.normal.shape, uv);
+#else
+	return texture(material.normal, uv);
+#endif
+}
+#endif
+
+#ifdef SPECULAR_MAP
+vec4 sampleSpecular(vec2 uv) {
+#ifdef VIRTUAL_SPECULAR
+	return sampleVirtual(material.specular.pages, material.specular.cache, material.specular.shape, uv);
+#else
+	return texture(material.specular, uv);
+#endif
+}
+#endif
 
 void main() {
-	if (!isSun) { //if this planetoid isn't the sun, skip the lighting calculations and just apply the diffuse texture
-		vec3 color = texture(material.diffuse, fs_in.TexCoords).rgb;
-		vec3 normal = texture(material.normal, fs_in.TexCoords).rgb;
-		normal = normalize(normal * 2.0 - 1.0);
-
-		//apply ambient lighting
-		vec3 ambient = light.ambient * color;
-
-		//apply diffuse lighting
-		vec3 lightDir = normalize(fs_in.TangentLightPos - fs_in.TangentFragPos);
-		float diff = max(dot(lightDir, normal), 0.0);
-		vec3 diffuse = light.diffuse * diff * color;
-
-		//apply specular lighting
-		vec3 viewDir = normalize(fs_in.TangentViewPos - fs_in.TangentFragPos);
-		vec3 reflectDir = reflect(-lightDir, normal);
-		float spec = 0.0;
-		vec3 halfwayDir = normalize(lightDir + viewDir);
-		spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-		vec3 specular = light.specular * spec * texture(material.specular, fs_in.TexCoords).rgb;
-
-		//apply lighting attenuation 
-		float distance = length(light.position - fs_in.FragPos);
-		float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-
-		ambient *= attenuation;
-		diffuse *= attenuation;
-		specular *= attenuation;
-
-		//calculate sum of all lights and output the resulting fragment color
-		vec3 lighting = ambient + diffuse + specular;
-		FragColor = vec4(lighting, 1.0);
-	} else {
-		FragColor = texture(material.diffuse, fs_in.TexCoords);
-	}
-}
\ No newline at end of file
+#ifdef EMISSIVE
+	//the Sun isn't affected by any lighting, so just apply the diffuse texture
+	FragColor = sampleDiffuse(fs_in.TexCoords);
+#else
+	vec3 color = sampleDiffuse(fs_in.TexCoords).rgb;
+
+#ifdef NORMAL_MAP
+	//only X and Y are read so two-channel (BC5) normal maps work as well, Z follows from the normal being a unit vector
+	vec2 xy = sampleNormal(fs_in.TexCoords).rg * 2.0 - 1.0;
+	vec3 normal = vec3(xy, sqrt(clamp(1.0 - dot(xy, xy), 0.0, 1.0)));
+	normal = normalize(fs_in.TBN * normal);
+#else
+	vec3 normal = normalize(fs_in.Normal);
+#endif
+
+	//apply ambient lighting
+	vec3 ambient = light.ambient * color;
+
+	//apply diffuse lighting
+	vec3 lightDir = normalize(light.position - fs_in.FragPos);
+	float diff = max(dot(lightDir, normal), 0.0);
+	vec3 diffuse = light.diffuse * diff * color;
+
+	//apply specular lighting
+#ifdef SPECULAR_MAP
+#ifdef STEREO
+	vec3 viewDir = normalize(fs_in.EyePos - fs_in.FragPos);
+#else
+	vec3 viewDir = normalize(viewPos - fs_in.FragPos);
+#endif
+	vec3 halfwayDir = normalize(lightDir + viewDir);
+	float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
+	//BC4 and gray specular maps have their red channel repeated into green and blue, so .rgb works for every format
+	vec3 specular = light.specular * spec * sampleSpecular(fs_in.TexCoords).rgb;
+#else
+	vec3 specular = vec3(0.0);
+#endif
+
+	//apply lighting attenuation 
+	float distance = length(light.position - fs_in.FragPos);
+	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+	//direct light is blocked by eclipsing bodies and rings, ambient light is not
+	vec3 shadow = sunVisibility(fs_in.FragPos) * atmosphereTransmittance(fs_in.FragPos);
+
+	ambient *= attenuation;
+	diffuse *= attenuation * shadow;
+	specular *= attenuation * shadow;
+
+	//calculate sum of all lights and output the resulting fragment color
+	vec3 lighting = ambient + diffuse + specular;
+	FragColor = vec4(lighting, 1.0);
+#endif
+}
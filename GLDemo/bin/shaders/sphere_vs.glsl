@@ -1,54 +1,70 @@
 #version 330 core
+#include "stereo.glsl"
+#include "frame.glsl"
+
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
 
+/*
+This shader is compiled into several variants depending on which textures a planetoid has (see Planetoid::getVariant):
+EMISSIVE     the planetoid isn't lit at all (used exclusively for the Sun)
+NORMAL_MAP   the normals are read from a normal map
+SPECULAR_MAP specular highlights are read from a specular map
+STEREO       both eyes are drawn at once, see stereo.glsl
+*/
 out VS_OUT {
 	vec3 FragPos;
 	vec2 TexCoords;
-	vec3 TangentLightPos;
-	vec3 TangentViewPos;
-	vec3 TangentFragPos;
+#ifndef EMISSIVE
+	vec3 Normal;
+#ifdef NORMAL_MAP
+	mat3 TBN;
+#endif
+#ifdef STEREO
+	flat vec3 EyePos;
+#endif
+#endif
 } vs_out;
 
-uniform mat4 view;
-uniform mat4 projection;
 uniform mat4 model;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-
-uniform bool isSun;
-
 void main() {
 	vs_out.TexCoords = aTexCoords;
-	if (!isSun) { //if this planetoid isn't the sun, skip the tangent matrix calculations for normal mapping
-		vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
-
-		/*
-		Calculates the TBN (Tangent, Bitangent, Normal) matrix so the normals of the normal maps are 
-		aimed in the proper direction relative to the triangles they are mapped to.
-		*/
-
-		//convert the normals and tangents from local space to world space
-		mat3 normalMatrix = transpose(inverse(mat3(model)));
-		vec3 T = normalize(normalMatrix * aTangent);
-		vec3 N = normalize(normalMatrix * aNormal);
-
-		//Perform the Gram-Schmidt process to re-orthogonalize the vectors to avoid the vectors being
-		//non-perpendicular and looking slightly off in some edge cases
-		T = normalize(T - dot(T, N) * N);
-		vec3 B = cross(N, T);
-
-		//create the TBN matrix for the tangent space
-		mat3 TBN = transpose(mat3(T, B, N));
-		//output variables for the light/view/fragment positions in tangent space
-		vs_out.TangentLightPos = TBN * lightPos;
-		vs_out.TangentViewPos = TBN * viewPos;
-		vs_out.TangentFragPos = TBN * vs_out.FragPos;
-	}
-
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
+
+#ifndef EMISSIVE
+	//convert the normals from local space to world space
+	mat3 normalMatrix = transpose(inverse(mat3(model)));
+	vec3 N = normalize(normalMatrix * aNormal);
+	vs_out.Normal = N;
+
+#ifdef NORMAL_MAP
+	/*
+	Calculates the TBN (Tangent, Bitangent, Normal) matrix so the normals of the normal maps are 
+	aimed in the proper direction relative to the triangles they are mapped to.
+	*/
+	vec3 T = normalize(normalMatrix * aTangent);
+
+	//Perform the Gram-Schmidt process to re-orthogonalize the vectors to avoid the vectors being
+	//non-perpendicular and looking slightly off in some edge cases
+	T = normalize(T - dot(T, N) * N);
+	vec3 B = cross(N, T);
+
+	//the TBN matrix converts the normals of the normal map from tangent space to world space
+	vs_out.TBN = mat3(T, B, N);
+#endif
+#endif
+
+#ifdef STEREO
+	int eye = stereoEye();
+#ifndef EMISSIVE
+	vs_out.EyePos = eyePosition[eye].xyz;
+#endif
+	gl_Position = stereoPack(eyeProjection[eye] * eyeView[eye] * vec4(vs_out.FragPos, 1.0));
+#else
+	gl_Position = projection * view * vec4(vs_out.FragPos, 1.0);
+#endif
 }
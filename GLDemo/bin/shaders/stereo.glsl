@@ -0,0 +1,41 @@
+/*
+Shaders compiled with STEREO draw both eyes at once, every draw has two instances of which the first is the left eye and the second the
+right eye. The layout of the eyes in the framebuffer is selected by STEREO_SIDE_BY_SIDE, STEREO_TOP_BOTTOM or STEREO_LAYERED (see stereo.h).
+Must be included before anything else, as the extensions have to be enabled before the first declaration.
+*/
+#ifdef STEREO
+#ifdef STEREO_LAYERED
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+#endif
+
+//the views of both eyes, must match StereoData in uniforms.h
+layout (std140) uniform Stereo {
+	mat4 eyeView[2];
+	mat4 eyeProjection[2];
+	vec4 eyePosition[2];
+};
+
+int stereoEye() {
+	return gl_InstanceID;
+}
+
+/*
+Moves a clip space position of the current eye into its part of the framebuffer. For the packed layouts the position is squeezed into its
+half of clip space, and a clip distance cuts off what would spill over into the half of the other eye (GL_CLIP_DISTANCE0 must be enabled).
+*/
+vec4 stereoPack(vec4 pos) {
+#if defined(STEREO_LAYERED)
+	gl_Layer = stereoEye();
+#elif defined(STEREO_TOP_BOTTOM)
+	float side = stereoEye() == 0 ? 1.0 : -1.0;
+	pos.y = pos.y * 0.5 + side * 0.5 * pos.w;
+	gl_ClipDistance[0] = side * pos.y;
+#else
+	float side = stereoEye() == 0 ? -1.0 : 1.0;
+	pos.x = pos.x * 0.5 + side * 0.5 * pos.w;
+	gl_ClipDistance[0] = side * pos.x;
+#endif
+	return pos;
+}
+#endif
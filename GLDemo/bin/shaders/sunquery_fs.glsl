@@ -0,0 +1,11 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 DiscPos;
+
+//only used to count the visible samples of the Sun's disc, nothing is written to the color buffer
+void main() {
+	if (dot(DiscPos, DiscPos) > 1.0)
+		discard;
+	FragColor = vec4(1.0);
+}
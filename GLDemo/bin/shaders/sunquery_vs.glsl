@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;
+
+out vec2 DiscPos;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+//the disc is spanned in world space by these vectors, whose length is the radius of the Sun
+uniform vec3 center;
+uniform vec3 right;
+uniform vec3 up;
+
+void main() {
+	DiscPos = aPos;
+	gl_Position = projection * view * vec4(center + right * aPos.x + up * aPos.y, 1.0);
+}
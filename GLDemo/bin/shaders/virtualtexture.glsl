@@ -0,0 +1,39 @@
+//sampling of virtual textures (see virtualtexture.h)
+
+//pixels along a side of a page including the border, must match VTEX_PAGE_SIZE and VTEX_PAGE_BORDER in vtex.h
+const float VT_PAGE_SIZE = 128.0;
+const float VT_PAGE_BORDER = 4.0;
+const float VT_PAGE_CONTENT = VT_PAGE_SIZE - 2.0 * VT_PAGE_BORDER;
+
+struct VirtualMap {
+	usampler2D pages; //page table, every entry holds the position of a page in the cache and the level of that page
+	sampler2D cache;
+	vec4 shape; //width and height of the virtual texture, its coarsest level, and the number of pages along a side of the cache
+};
+
+/*
+The level to sample at, from the derivatives of the texture coordinates. The derivatives are passed in so they can be taken while every pixel
+of a quad is still on the same path through the shader. lodBias is used by the feedback pass, which is drawn at a lower resolution.
+*/
+int virtualLevel(vec4 shape, vec2 dx, vec2 dy, float lodBias) {
+	dx *= shape.xy;
+	dy *= shape.xy;
+	float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lodBias;
+	return int(clamp(floor(lod), 0.0, shape.z));
+}
+
+//the page of the given level that holds the texture coordinates
+ivec2 virtualPage(vec4 shape, vec2 uv, int level) {
+	return ivec2(clamp(uv, 0.0, 0.99999) * shape.xy / (VT_PAGE_CONTENT * exp2(float(level))));
+}
+
+vec4 sampleVirtual(usampler2D pages, sampler2D cache, vec4 shape, vec2 uv) {
+	int level = virtualLevel(shape, dFdx(uv), dFdy(uv), 0.0);
+	uvec4 entry = texelFetch(pages, virtualPage(shape, uv, level), level);
+
+	//the entry points to the page that's in the cache, which is of a coarser level when the page of this level hasn't been loaded yet
+	vec2 texel = clamp(uv, 0.0, 0.99999) * shape.xy / exp2(float(entry.b));
+	vec2 inPage = fract(texel / VT_PAGE_CONTENT);
+	vec2 cacheTexel = vec2(entry.rg) * VT_PAGE_SIZE + VT_PAGE_BORDER + inPage * VT_PAGE_CONTENT;
+	return textureLod(cache, cacheTexel / (VT_PAGE_SIZE * shape.w), 0.0);
+}
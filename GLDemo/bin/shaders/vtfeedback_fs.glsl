@@ -0,0 +1,35 @@
+#version 330 core
+#include "virtualtexture.glsl"
+
+/*
+Writes which page of which virtual texture every pixel would sample, drawn with the EMISSIVE variant of sphere_vs.glsl into a small buffer
+that's read back by VirtualTextures. Pixels without a virtual texture write 0.
+*/
+out uvec4 FragColor;
+
+in VS_OUT {
+	vec3 FragPos;
+	vec2 TexCoords;
+} fs_in;
+
+//the virtual textures of the planetoid that's being drawn, one for every map at most
+#define MAX_VIRTUAL_MAPS 3
+uniform int count;
+uniform vec4 shapes[MAX_VIRTUAL_MAPS];
+uniform int indices[MAX_VIRTUAL_MAPS];
+uniform float lodBias;
+uniform int frame;
+
+void main() {
+	vec2 dx = dFdx(fs_in.TexCoords);
+	vec2 dy = dFdy(fs_in.TexCoords);
+	if (count == 0) {
+		FragColor = uvec4(0);
+		return;
+	}
+
+	//only one page can be written per pixel, so the maps of a planetoid take turns between neighbouring pixels and frames
+	int map = (int(gl_FragCoord.x) + int(gl_FragCoord.y) + frame) % count;
+	int level = virtualLevel(shapes[map], dx, dy, lodBias);
+	FragColor = uvec4(virtualPage(shapes[map], fs_in.TexCoords, level), level, indices[map] + 1);
+}
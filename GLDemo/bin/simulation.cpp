@@ -0,0 +1,144 @@
+#include <simulation.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+//seconds of the steady clock, which the times of the steps and the frames are compared in
+static double now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Simulation::Simulation(Planetoid* root, double stepRate) : stepRate(stepRate) {
+	addBodies(root, -1);
+	//the initial state is published before the thread starts, so the first frame already has something to draw
+	advance(0.0f);
+	publish();
+	if (stepRate > 0.0)
+		thread = std::thread(&Simulation::run, this);
+}
+
+Simulation::~Simulation() {
+	stopping = true;
+	if (thread.joinable())
+		thread.join();
+}
+
+//parents are added before their children, so a step can move the bodies in order and every child sees where its parent went
+void Simulation::addBodies(Planetoid* planet, int parent) {
+	int index = (int)bodies.size();
+	Body body;
+	body.motion = planet->getMotion();
+	body.parent = parent;
+	bodies.push_back(body);
+	planetoids.push_back(planet);
+	for (Planetoid* child : planet->getChildren()) {
+		addBodies(child, index);
+	}
+}
+
+void Simulation::setTurning(bool turning) {
+	this->turning.store(turning, std::memory_order_relaxed);
+}
+
+void Simulation::advance(float deltaTime) {
+	bool turning = this->turning.load(std::memory_order_relaxed);
+	for (Body& body : bodies) {
+		const PlanetoidMotion& motion = body.motion;
+		if (motion.orbiting && turning && body.parent >= 0) {
+			/**
+			To orbit the planetoid around its origin, the planetoid is first moved toward the origin,
+			is rotated around the Y-axis with the orbitSpeed property, and then moved back by the distance of the
+			given radius, so the distance between the planetoid center and the origin is always equal to the radius.
+			**/
+			body.translation[3] = bodies[body.parent].translation[3];
+			body.translation = glm::rotate(body.translation, glm::radians(motion.orbitSpeed * deltaTime), glm::vec3(0.0f, 1.0f, 0.0f));
+			body.translation = glm::translate(body.translation, glm::vec3(motion.orbitRadius, 0, 0));
+		}
+		//Rotate the planetoid around its own center
+		body.rotation = glm::rotate(body.rotation, glm::radians(motion.rotationSpeed * deltaTime), glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+	time += deltaTime;
+	if (turning)
+		orbitTime += deltaTime;
+}
+
+void Simulation::publish() {
+	//the vectors of the back copy keep their size after the first few steps, so publishing doesn't allocate
+	SceneSnapshot& snapshot = snapshots.back();
+	snapshot.bodies.resize(bodies.size());
+	for (size_t i = 0; i < bodies.size(); i++) {
+		//the translation holds the rotation of the orbit as well, both are pure rotations
+		const Body& body = bodies[i];
+		snapshot.bodies[i].position = glm::vec3(body.translation[3]);
+		snapshot.bodies[i].orientation = glm::quat_cast(glm::mat3(body.translation) * glm::mat3(body.rotation));
+		snapshot.bodies[i].scale = body.motion.size;
+	}
+	//the first snapshot has no step before it
+	double published = now();
+	if (lastBodies.empty()) {
+		lastBodies = snapshot.bodies;
+		lastPublished = published;
+	}
+	snapshot.previousBodies = lastBodies;
+	snapshot.previousPublished = lastPublished;
+	snapshot.published = published;
+	lastBodies = snapshot.bodies;
+	lastPublished = published;
+
+	snapshot.time = time;
+	snapshot.orbitTime = orbitTime;
+	snapshot.steps = ++steps;
+	snapshots.publish();
+}
+
+void Simulation::step(float deltaTime) {
+	if (thread.joinable())
+		return;
+	advance(deltaTime);
+	publish();
+}
+
+void Simulation::run() {
+	using clock = std::chrono::steady_clock;
+	const clock::duration interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / stepRate));
+	clock::time_point previous = clock::now();
+	clock::time_point next = previous;
+
+	while (!stopping.load(std::memory_order_relaxed)) {
+		next += interval;
+		std::this_thread::sleep_until(next);
+		clock::time_point now = clock::now();
+		//steps are as long as the time that actually passed, and steps that were missed altogether (f.e. at a breakpoint) aren't caught up on
+		float deltaTime = std::min(std::chrono::duration<float>(now - previous).count(), 0.1f);
+		previous = now;
+		if (now - next > std::chrono::milliseconds(100))
+			next = now;
+
+		advance(deltaTime);
+		publish();
+	}
+}
+
+const SceneSnapshot& Simulation::apply() {
+	const SceneSnapshot& snapshot = snapshots.acquire();
+
+	//the time that's shown lies between the two steps unless the simulation thread fell behind, in which case the newest step is shown
+	float blend = 1.0f;
+	double length = snapshot.published - snapshot.previousPublished;
+	if (thread.joinable() && length > 0.0) {
+		double shown = now() - 1.0 / stepRate;
+		blend = (float)std::min(std::max((shown - snapshot.previousPublished) / length, 0.0), 1.0);
+	}
+
+	for (size_t i = 0; i < planetoids.size(); i++) {
+		const BodyState& from = snapshot.previousBodies[i];
+		const BodyState& to = snapshot.bodies[i];
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::mix(from.position, to.position, blend));
+		model *= glm::mat4_cast(glm::slerp(from.orientation, to.orientation, blend));
+		model = glm::scale(model, glm::vec3(to.scale));
+		planetoids[i]->setModelMatrix(model);
+	}
+	return snapshot;
+}
@@ -1,53 +1,39 @@
 #include <glad/glad.h>
-#include <stb_image.h>
 
 #include <skybox.h>
+#include <glstate.h>
+#include <gpumemory.h>
 #include <shader_m.h>
 
 /*
 The skybox is a cubemap texture which is wrapped along the insides of the world space to give the world a starry background.
 A cubemap itself consists of six individual textures which are passed to Skybox as a vector of string filepaths. 
+The faces are decoded and uploaded in the background by the texture streamer, the skybox stays black until all of them are in.
+The cubemap is shared through the resources, so it's released along with the last skybox that uses it.
 Then a VAO and VBO are created using hard-coded vertex positions in skybox.h 
 */
-Skybox::Skybox(const std::vector<std::string>& faces) {
-	glGenTextures(1, &cubemapTex);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTex);
-
-	int width, height, nrChannels;
-	for (unsigned int i = 0; i < faces.size(); i++)
-	{
-		unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		if (data)
-		{
-			//There are six possible cubemap orientations, which we can just loop through by incrementing the cubemap orientation enum for every loaded face
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
-		}
-		else
-		{
-			std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-			stbi_image_free(data);
-		}
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+Skybox::Skybox(const std::vector<std::string>& faces, Resources& resources) {
+	//There are six possible cubemap orientations, the faces are loaded into them in the order of the cubemap orientation enum
+	TextureParams params;
+	params.placeholder = glm::vec3(0.0f);
+	params.mipmaps = false;
+	params.wrap = GL_CLAMP_TO_EDGE;
+	cubemap = resources.cubemap(faces, params);
 
 	//Set up a VAO and VBO using skyboxVertices in skybox.h
 	glGenVertexArrays(1, &skyboxVAO);
 	glGenBuffers(1, &skyboxVBO);
-	glBindVertexArray(skyboxVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+	GLState::bindVertexArray(skyboxVAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+	GPUMemory::buffer(skyboxVBO, GPUMemory::MEMORY_SKYBOX, sizeof(skyboxVertices));
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 }
 
 Skybox::~Skybox() {
-	glDeleteVertexArrays(1, &skyboxVAO);
-	glDeleteBuffers(1, &skyboxVBO);
+	GLState::deleteVertexArrays(1, &skyboxVAO);
+	GLState::deleteBuffers(1, &skyboxVBO);
 }
 
 /*
@@ -55,11 +41,12 @@ Since drawing the skybox as the background first and then drawing all other plan
 which aren't visible because they're behind the planetoids, it would instead be more efficient if the planetoids were drawn first and
 the skybox last so the skybox fragments are only drawn where there isn't a planetoid in front of it.
 As the depth value of a cubemapped skybox will always be 1.0, the depth test function needs to be set to pass values that are less than or equal
-to the current value in the depth buffer (see skybox_vs.glsl for more details)
+to the current value in the depth buffer (see skybox_vs.glsl for more details). GL_LEQUAL is the depth function of the whole scene, so this is
+normally a no-op.
 */
-void Skybox::draw(Shader& skyboxShader, glm::mat4& view, glm::mat4& projection) {
+void Skybox::draw(Shader& skyboxShader, glm::mat4& view, glm::mat4& projection, int eyes) {
 
-	glDepthFunc(GL_LEQUAL);
+	GLState::depthFunc(GL_LEQUAL);
 	skyboxShader.use();
 
 	/*
@@ -70,10 +57,10 @@ void Skybox::draw(Shader& skyboxShader, glm::mat4& view, glm::mat4& projection)
 	skyboxShader.setMat4("projection", projection);
 
 	//draw the cubemap texture
-	glBindVertexArray(skyboxVAO);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTex);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
-	glDepthFunc(GL_LESS);
+	GLState::bindVertexArray(skyboxVAO);
+	GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, cubemap->id);
+	if (eyes > 1)
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, eyes);
+	else
+		glDrawArrays(GL_TRIANGLES, 0, 36);
 }
\ No newline at end of file
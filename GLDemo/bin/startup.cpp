@@ -0,0 +1,209 @@
+#include <startup.h>
+
+#include <cstdio>
+#include <iostream>
+
+Startup::Startup(ThreadPool& pool) : pool(pool), origin(std::chrono::steady_clock::now()), renderThread(std::this_thread::get_id()) {
+}
+
+Startup::~Startup() {
+	std::unique_lock<std::mutex> lock(mutex);
+	stopping = true;
+	condition.wait(lock, [this]() { return running == 0; });
+}
+
+Startup::Stage Startup::addTask(const std::string& name, std::function<bool()> work, const std::vector<Stage>& dependencies) {
+	return add(name, work, dependencies, false);
+}
+
+Startup::Stage Startup::addGLTask(const std::string& name, std::function<bool()> work, const std::vector<Stage>& dependencies) {
+	return add(name, work, dependencies, true);
+}
+
+Startup::Stage Startup::add(const std::string& name, std::function<bool()> work, const std::vector<Stage>& dependencies, bool gl) {
+	Stage stage;
+	bool ready = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stage = (Stage)stages.size();
+		stages.emplace_back();
+		Node& node = stages.back();
+		node.name = name;
+		node.work = work;
+		node.gl = gl;
+		remaining++;
+		for (Stage dependency : dependencies) {
+			Node& other = stages[dependency];
+			if (other.done) {
+				node.skipped = node.skipped || !other.succeeded;
+			} else {
+				other.dependents.push_back(stage);
+				node.waiting++;
+			}
+		}
+
+		if (!started || node.waiting > 0) {
+			return stage;
+		} else if (node.skipped) {
+			node.done = true;
+			failed = true;
+			remaining--;
+		} else if (gl) {
+			readyGL.push_back(stage);
+		} else {
+			running++;
+			ready = true;
+		}
+	}
+	if (ready)
+		submit(stage);
+	return stage;
+}
+
+double Startup::now() const {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void Startup::start() {
+	std::vector<Stage> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		started = true;
+		for (Stage stage = 0; stage < (Stage)stages.size(); stage++) {
+			Node& node = stages[stage];
+			if (node.done || node.waiting > 0)
+				continue;
+			if (node.gl) {
+				readyGL.push_back(stage);
+			} else {
+				running++;
+				ready.push_back(stage);
+			}
+		}
+	}
+	for (Stage stage : ready) {
+		submit(stage);
+	}
+}
+
+void Startup::step(const std::string& name) {
+	endStep();
+	std::lock_guard<std::mutex> lock(mutex);
+	currentStep = (Stage)stages.size();
+	stages.emplace_back();
+	Node& node = stages.back();
+	node.name = name;
+	node.gl = true;
+	node.onRenderThread = true;
+	node.begin = now();
+	remaining++;
+}
+
+void Startup::endStep() {
+	if (currentStep < 0)
+		return;
+	Stage stage = currentStep;
+	currentStep = -1;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stages[stage].end = now();
+	}
+	complete(stage, true, false);
+}
+
+bool Startup::finish() {
+	endStep();
+	if (!started)
+		start();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (remaining > 0) {
+		if (readyGL.empty()) {
+			condition.wait(lock);
+			continue;
+		}
+		Stage stage = readyGL.front();
+		readyGL.pop_front();
+		Node* node = &stages[stage];
+		lock.unlock();
+		execute(stage, node, false);
+		lock.lock();
+	}
+	return !failed;
+}
+
+void Startup::submit(Stage stage) {
+	Node* node;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		node = &stages[stage];
+	}
+	pool.submit([this, stage, node]() {
+		execute(stage, node, true);
+	});
+}
+
+void Startup::execute(Stage stage, Node* node, bool task) {
+	node->onRenderThread = std::this_thread::get_id() == renderThread;
+	node->begin = now();
+	bool success = node->work();
+	node->end = now();
+	complete(stage, success, task);
+}
+
+//marks a stage as done and starts the stages that were only waiting for it, or skips them when it failed
+void Startup::complete(Stage stage, bool success, bool task) {
+	std::vector<Stage> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::vector<std::pair<Stage, bool>> finished = { { stage, success } };
+		while (!finished.empty()) {
+			Stage current = finished.back().first;
+			bool succeeded = finished.back().second;
+			finished.pop_back();
+			stages[current].done = true;
+			stages[current].succeeded = succeeded;
+			failed = failed || !succeeded;
+			remaining--;
+
+			for (Stage dependent : stages[current].dependents) {
+				Node& node = stages[dependent];
+				node.skipped = node.skipped || !succeeded || (stopping && !node.gl);
+				if (--node.waiting > 0)
+					continue;
+				if (node.skipped) {
+					finished.push_back({ dependent, false });
+				} else if (node.gl) {
+					readyGL.push_back(dependent);
+				} else {
+					running++;
+					ready.push_back(dependent);
+				}
+			}
+		}
+		if (task)
+			running--;
+	}
+	condition.notify_all();
+
+	for (Stage dependent : ready) {
+		submit(dependent);
+	}
+}
+
+void Startup::firstFrame() {
+	double firstFrame = now();
+	std::lock_guard<std::mutex> lock(mutex);
+	std::cout << "Startup timeline:" << std::endl;
+	for (const Node& node : stages) {
+		char line[160];
+		if (node.skipped) {
+			snprintf(line, sizeof(line), "  %-24s skipped", node.name.c_str());
+		} else {
+			snprintf(line, sizeof(line), "  %-24s %8.1f ms - %8.1f ms  %8.1f ms on %s%s", node.name.c_str(), node.begin, node.end,
+				node.end - node.begin, node.onRenderThread ? "the render thread" : "a worker", node.succeeded ? "" : ", failed");
+		}
+		std::cout << line << std::endl;
+	}
+	std::cout << "First frame after " << (int)firstFrame << " ms" << std::endl;
+}
@@ -0,0 +1,81 @@
+#include <stereo.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+void StereoSettings::addOptions(Options& options) {
+	options.add("--stereo", [this](const std::string& value) {
+		if (value == "side-by-side")
+			layout = STEREO_SIDE_BY_SIDE;
+		else if (value == "top-bottom")
+			layout = STEREO_TOP_BOTTOM;
+		else if (value == "layered")
+			layout = STEREO_LAYERED;
+		else {
+			std::cout << "Unknown stereo layout " << value << ", expected side-by-side, top-bottom or layered" << std::endl;
+			return false;
+		}
+		return true;
+	});
+	options.add("--separation", [this](const std::string& value) {
+		separation = (float)atof(value.c_str());
+		return true;
+	});
+	options.add("--convergence", [this](const std::string& value) {
+		convergence = (float)atof(value.c_str());
+		if (convergence <= 0.0f) {
+			std::cout << "Invalid convergence distance " << value << std::endl;
+			return false;
+		}
+		return true;
+	});
+}
+
+const char* StereoSettings::getDefine() const {
+	switch (layout) {
+	case STEREO_TOP_BOTTOM:
+		return "STEREO_TOP_BOTTOM";
+	case STEREO_LAYERED:
+		return "STEREO_LAYERED";
+	default:
+		return "STEREO_SIDE_BY_SIDE";
+	}
+}
+
+/*
+Both eyes look in the same direction as the camera, rather than being turned toward each other, so there's no vertical parallax. Instead
+their frustums are shifted toward each other until they line up at the convergence distance, which is where the screen appears to be.
+*/
+void stereoEyes(const View& center, const StereoSettings& settings, View eyes[2]) {
+	glm::vec3 right(center.view[0][0], center.view[1][0], center.view[2][0]);
+	for (int eye = 0; eye < 2; eye++) {
+		float offset = settings.separation * (eye == 0 ? -0.5f : 0.5f);
+		eyes[eye] = center;
+		eyes[eye].position = center.position + right * offset;
+		eyes[eye].view = glm::translate(glm::mat4(1.0f), glm::vec3(-offset, 0.0f, 0.0f)) * center.view;
+		eyes[eye].projection[2][0] -= center.projection[0][0] * offset / settings.convergence;
+	}
+}
+
+StereoData stereoData(const View eyes[2]) {
+	StereoData data;
+	for (int eye = 0; eye < 2; eye++) {
+		data.view[eye] = eyes[eye].view;
+		data.projection[eye] = eyes[eye].projection;
+		data.position[eye] = glm::vec4(eyes[eye].position, 1.0f);
+	}
+	return data;
+}
+
+//the visible items of both eyes point into the same draw list in the same order, so they're merged by their address
+void stereoCull(const DrawList& drawList, View& center, View eyes[2]) {
+	drawList.cull(eyes[0]);
+	drawList.cull(eyes[1]);
+	center.visible.clear();
+	std::set_union(eyes[0].visible.begin(), eyes[0].visible.end(), eyes[1].visible.begin(), eyes[1].visible.end(), std::back_inserter(center.visible));
+}
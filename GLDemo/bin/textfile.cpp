@@ -0,0 +1,138 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <textfile.h>
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) {
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+		return;
+	file = handle;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		return;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+		return;
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	size = data ? (size_t)fileSize.QuadPart : 0;
+}
+
+MappedFile::~MappedFile() {
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const std::string& path) {
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size > 0) {
+		void* view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED) {
+			madvise(view, (size_t)status.st_size, MADV_SEQUENTIAL);
+			data = (const char*)view;
+			size = (size_t)status.st_size;
+		}
+	}
+	//the mapping stays valid after the file is closed
+	close(file);
+}
+
+MappedFile::~MappedFile() {
+	if (data)
+		munmap((void*)data, size);
+}
+#endif
+
+bool parseDouble(const char*& p, const char* end, double& result) {
+	//powers of ten up to 22 are exact in a double, so scaling by them only rounds once
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	skipSpaces(p, end);
+	bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+'))
+		p++;
+
+	uint64_t mantissa = 0;
+	int exponent = 0, dropped = 0;
+	const char* start = p;
+	p = parseDigits(p, end, mantissa, dropped);
+	size_t digits = p - start;
+	exponent += dropped;
+	if (p < end && *p == '.') {
+		p++;
+		const char* fraction = p;
+		dropped = 0;
+		p = parseDigits(p, end, mantissa, dropped);
+		digits += p - fraction;
+		exponent -= (int)(p - fraction) - dropped;
+	}
+	if (digits == 0)
+		return false;
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool negativeExponent = p < end && *p == '-';
+		if (p < end && (*p == '-' || *p == '+'))
+			p++;
+		uint64_t value = 0;
+		dropped = 0;
+		const char* exponentStart = p;
+		p = parseDigits(p, end, value, dropped);
+		if (p == exponentStart)
+			return false;
+		value = std::min<uint64_t>(value, 1000);
+		exponent += negativeExponent ? -(int)value : (int)value;
+	}
+
+	double value = (double)mantissa;
+	if (exponent >= 0 && exponent <= 22)
+		value *= powers[exponent];
+	else if (exponent < 0 && exponent >= -22)
+		value /= powers[-exponent];
+	else if (mantissa != 0)
+		value *= std::pow(10.0, exponent);
+	result = negative ? -value : value;
+	return true;
+}
+
+bool parseFloat(const char*& p, const char* end, float& result) {
+	double value;
+	if (!parseDouble(p, end, value))
+		return false;
+	result = (float)value;
+	return true;
+}
+
+bool parseInt(const char*& p, const char* end, long long& result) {
+	bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+'))
+		p++;
+	uint64_t value = 0;
+	int dropped = 0;
+	const char* start = p;
+	p = parseDigits(p, end, value, dropped);
+	if (p == start || dropped > 0 || value > (uint64_t)INT32_MAX)
+		return false;
+	result = negative ? -(long long)value : (long long)value;
+	return true;
+}
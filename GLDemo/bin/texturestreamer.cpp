@@ -0,0 +1,509 @@
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <texturestreamer.h>
+#include <extensions.h>
+#include <glstate.h>
+#include <gpumemory.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+//decoded images that haven't been picked up by the render thread yet, workers wait for room when it's full
+const size_t DECODED_QUEUE_SIZE = 64;
+
+/*
+Checks whether every pixel of an image has (nearly) the same color. Some planetoids ship a tiny flat normal map as a placeholder,
+which doesn't change the lighting at all, so those are left out and the planetoid is drawn with a variant that skips normal mapping.
+*/
+static bool isFlatImage(const unsigned char* data, int width, int height, int nrComponents) {
+	const int tolerance = 3; //leave some room for compression artifacts
+	size_t size = (size_t)width * height * nrComponents;
+	for (size_t i = nrComponents; i < size; i++) {
+		if (abs((int)data[i] - (int)data[i % nrComponents]) > tolerance)
+			return false;
+	}
+	return true;
+}
+
+static GLenum formatOf(int components) {
+	switch (components) {
+	case 1:
+		return GL_RED;
+	case 2:
+		return GL_RG;
+	case 4:
+		return GL_RGBA;
+	}
+	return GL_RGB;
+}
+
+//the faces of a cubemap have to be uploaded separately, a 2D texture only has one
+static int faceCount(GLenum target) {
+	return target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+}
+
+static GLenum faceTarget(GLenum target, int face) {
+	return target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+}
+
+//the only cubemap is the skybox
+static GPUMemory::Category categoryOf(GLenum target) {
+	return target == GL_TEXTURE_CUBE_MAP ? GPUMemory::MEMORY_SKYBOX : GPUMemory::MEMORY_TEXTURES;
+}
+
+//gray images and BC4 specular maps only have a red channel, which is repeated into green and blue so the shaders can read .rgb from any format
+static void swizzleGray(GLenum target, bool alpha) {
+	const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, alpha ? GL_GREEN : GL_ONE };
+	glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+}
+
+//the faces of a cubemap all have to have the same format, size and number of levels, or the cubemap is incomplete and samples as black
+static bool matchingFaces(const DecodedImage* a, const DecodedImage* b) {
+	return a->compressed->format == b->compressed->format && a->width == b->width && a->height == b->height
+		&& a->compressed->levels.size() == b->compressed->levels.size();
+}
+
+/*
+Uses the .ctex file next to an image instead of the image itself, if the texconvert tool made one after the image last changed and the
+driver supports its format. Textures without mipmaps only need the first level.
+*/
+static bool loadCompressed(DecodedImage* image, bool mipmaps) {
+	std::error_code error;
+	fs::path path = fs::path(image->path).replace_extension(".ctex");
+	if (!fs::exists(path, error) || fs::last_write_time(path, error) < fs::last_write_time(image->path, error))
+		return false;
+
+	std::unique_ptr<CompressedImage> compressed(new CompressedImage());
+	if (!readCompressedImage(path.string(), *compressed))
+		return false;
+	if ((compressed->format == CTEX_BC1 || compressed->format == CTEX_BC3) && !GLExtensions::textureCompressionS3TC)
+		return false;
+
+	image->width = compressed->width;
+	image->height = compressed->height;
+	image->level = mipmaps ? (int)compressed->levels.size() - 1 : 0;
+	image->compressed = std::move(compressed);
+	return true;
+}
+
+TextureStreamer::TextureStreamer(ThreadPool& pool, size_t ringSize, size_t frameBudget)
+	: pool(pool), decoded(DECODED_QUEUE_SIZE), ringSize(ringSize), frameBudget(frameBudget), budget(frameBudget) {
+	glGenBuffers(1, &ring);
+	GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+	if (GLExtensions::bufferStorage) {
+		//map the ring once and keep writing into it while the GPU reads from other parts of it
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLExtensions::BufferStorage(GL_PIXEL_UNPACK_BUFFER, ringSize, NULL, flags);
+		mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ringSize, flags);
+	} else {
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, ringSize, NULL, GL_STREAM_DRAW);
+	}
+	GPUMemory::buffer(ring, GPUMemory::MEMORY_BUFFERS, ringSize);
+	GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureStreamer::~TextureStreamer() {
+	//the workers still hold a pointer to this streamer, so wait until they're done before cleaning up. Images that haven't started decoding
+	//are dropped, and the queue is emptied while waiting, as a worker can't finish while the queue is full
+	stopping = true;
+	DecodedImage* image;
+	while (decoding.load() > 0) {
+		while (decoded.pop(image)) {
+			uploads.push_back(image);
+		}
+		std::this_thread::yield();
+	}
+	while (decoded.pop(image)) {
+		uploads.push_back(image);
+	}
+	for (DecodedImage* upload : uploads) {
+		stbi_image_free(upload->data);
+		delete upload;
+	}
+	for (auto& texture : textures) {
+		if (texture.second.released)
+			GLState::deleteTextures(1, &texture.first);
+	}
+
+	for (RingFence& fence : fences) {
+		glDeleteSync(fence.fence);
+	}
+	if (mapped) {
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	GLState::deleteBuffers(1, &ring);
+}
+
+GLuint TextureStreamer::create(GLenum target, const glm::vec3& placeholder, bool mipmaps) {
+	const unsigned char pixel[3] = { (unsigned char)(placeholder.r * 255), (unsigned char)(placeholder.g * 255), (unsigned char)(placeholder.b * 255) };
+
+	GLuint id;
+	glGenTextures(1, &id);
+	GLState::bindTexture(target, id);
+	for (int face = 0; face < faceCount(target); face++) {
+		glTexImage2D(faceTarget(target, face), 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, pixel);
+		GPUMemory::texture(id, faceTarget(target, face), categoryOf(target), GL_RGB, 1, 1);
+	}
+
+	StreamedTexture texture;
+	texture.target = target;
+	texture.placeholder = placeholder;
+	texture.mipmaps = mipmaps;
+	textures[id] = texture;
+	return id;
+}
+
+void TextureStreamer::load(GLuint texture, GLenum target, const std::string& path, bool discardFlat, std::function<void(GLuint)> onDiscard) {
+	StreamedTexture& streamed = textures[texture];
+	streamed.pending++;
+	if (onDiscard)
+		streamed.onDiscard = onDiscard;
+	outstanding++;
+	decoding++;
+	decode(texture, target, path, discardFlat, streamed.mipmaps, true);
+}
+
+void TextureStreamer::loadCubemap(GLuint texture, const std::vector<std::string>& faces) {
+	StreamedTexture& streamed = textures[texture];
+	streamed.pending += (int)faces.size();
+	outstanding += (int)faces.size();
+	decoding++;
+
+	bool mipmaps = streamed.mipmaps;
+	pool.submit([this, texture, faces, mipmaps]() {
+		if (stopping) {
+			decoding--;
+			return;
+		}
+		//the precompressed faces are only used when every face has one and they all match, otherwise every face is decoded from its image
+		std::vector<DecodedImage*> images;
+		bool compressed = true;
+		for (size_t face = 0; face < faces.size() && compressed; face++) {
+			DecodedImage* image = new DecodedImage();
+			image->texture = texture;
+			image->target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)face;
+			image->path = faces[face];
+			images.push_back(image);
+			compressed = loadCompressed(image, mipmaps) && matchingFaces(images.front(), image);
+		}
+
+		if (compressed) {
+			for (DecodedImage* image : images) {
+				queue(image);
+			}
+		} else {
+			for (DecodedImage* image : images) {
+				delete image;
+			}
+			//counted before this job is, so the destructor can't see 0 in between
+			decoding += (int)faces.size();
+			for (size_t face = 0; face < faces.size(); face++) {
+				decode(texture, GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)face, faces[face], false, mipmaps, false);
+			}
+		}
+		decoding--;
+	});
+}
+
+//decodes an image on the pool and queues it for uploading, the image has to be counted in decoding already
+void TextureStreamer::decode(GLuint texture, GLenum target, const std::string& path, bool discardFlat, bool mipmaps, bool precompressed) {
+	pool.submit([this, texture, target, path, discardFlat, mipmaps, precompressed]() {
+		if (stopping) {
+			decoding--;
+			return;
+		}
+		DecodedImage* image = new DecodedImage();
+		image->texture = texture;
+		image->target = target;
+		image->path = path;
+
+		if (precompressed && loadCompressed(image, mipmaps)) {
+			image->discarded = discardFlat && (image->compressed->flags & CTEX_FLAT);
+		} else {
+			image->data = stbi_load(path.c_str(), &image->width, &image->height, &image->components, 0);
+			if (image->data && discardFlat && isFlatImage(image->data, image->width, image->height, image->components)) {
+				stbi_image_free(image->data);
+				image->data = nullptr;
+				image->discarded = true;
+			}
+		}
+		queue(image);
+		decoding--;
+	});
+}
+
+//hands a decoded image to the render thread, the render thread empties the queue every frame so it only fills up when a lot of small images finish at once
+void TextureStreamer::queue(DecodedImage* image) {
+	while (!decoded.push(image)) {
+		std::this_thread::yield();
+	}
+}
+
+void TextureStreamer::release(GLuint texture) {
+	auto streamed = textures.find(texture);
+	if (streamed != textures.end() && streamed->second.pending > 0) {
+		streamed->second.released = true;
+		return;
+	}
+	if (streamed != textures.end())
+		textures.erase(streamed);
+	GLState::deleteTextures(1, &texture);
+}
+
+bool TextureStreamer::idle() const {
+	return outstanding == 0;
+}
+
+void TextureStreamer::update() {
+	DecodedImage* image;
+	while (decoded.pop(image)) {
+		uploads.push_back(image);
+	}
+	retireFences();
+	if (!uploads.empty())
+		uploadImages();
+
+	//everything written to the ring this frame can be reused once the GPU has passed this point
+	if (frameUsed > 0) {
+		fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), frameUsed });
+		frameUsed = 0;
+	}
+	GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	budget = frameBudget;
+}
+
+void TextureStreamer::uploadImages() {
+	//rows of RGB images aren't always a multiple of 4 bytes long
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	while (!uploads.empty()) {
+		DecodedImage* image = uploads.front();
+		StreamedTexture& texture = textures[image->texture];
+
+		bool done = false;
+		if (texture.released) {
+			//nobody uses the texture anymore, so the image is dropped and the texture goes along with the last one
+			uploads.pop_front();
+			outstanding--;
+			if (--texture.pending == 0) {
+				GLuint id = image->texture;
+				textures.erase(id);
+				GLState::deleteTextures(1, &id);
+			}
+			stbi_image_free(image->data);
+			delete image;
+			continue;
+		} else if (image->discarded) {
+			if (texture.onDiscard)
+				texture.onDiscard(image->texture);
+			textures.erase(image->texture);
+			outstanding--;
+			uploads.pop_front();
+			delete image;
+			continue;
+		} else if (!image->data && !image->compressed) {
+			std::cout << "Texture failed to load at path: " << image->path << std::endl;
+			texture.failed = true;
+			done = true;
+		} else {
+			//stop for this frame when the budget is used up or the GPU is still reading from the whole ring
+			if (!uploadChunk(image))
+				break;
+			done = image->compressed ? image->level == 0 && image->uploadedRows == (image->height + 3) / 4 : image->uploadedRows == image->height;
+		}
+
+		if (done) {
+			uploads.pop_front();
+			outstanding--;
+			if (--texture.pending == 0)
+				finish(image->texture, texture);
+			stbi_image_free(image->data);
+			delete image;
+		}
+	}
+}
+
+bool TextureStreamer::uploadCompressed(GLuint texture, GLenum target, int level, int x, int y, int width, int height, GLenum format, const void* data, size_t size) {
+	size_t offset;
+	if (size > budget || !allocate(size, offset))
+		return false;
+
+	GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+	write(offset, data, size);
+	GLState::bindTexture(target, texture);
+	glCompressedTexSubImage2D(target, level, x, y, width, height, format, (GLsizei)size, (void*)offset);
+	budget -= size;
+	return true;
+}
+
+/*
+Gets a texture ready for the next level of an image. The texture has to stay complete while its levels are being filled over several frames,
+so before the first level the placeholder is moved to the 1x1 mipmap level of the final image and the texture is limited to that level.
+The level is then allocated at full size but isn't sampled until the limit is lifted again.
+*/
+void TextureStreamer::start(DecodedImage* image, StreamedTexture& texture, int width, int height) {
+	//the pixel pointers below are client memory, not offsets into the ring
+	GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GLState::bindTexture(texture.target, image->texture);
+
+	if (!texture.started) {
+		const unsigned char pixel[3] = { (unsigned char)(texture.placeholder.r * 255), (unsigned char)(texture.placeholder.g * 255), (unsigned char)(texture.placeholder.b * 255) };
+		GLint level = (GLint)std::log2((float)std::max(image->width, image->height));
+		for (int face = 0; face < faceCount(texture.target); face++) {
+			glTexImage2D(faceTarget(texture.target, face), level, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, pixel);
+			GPUMemory::texture(image->texture, faceTarget(texture.target, face), categoryOf(texture.target), GL_RGB, 1, 1, 1, level);
+		}
+		glTexParameteri(texture.target, GL_TEXTURE_BASE_LEVEL, level);
+		glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, level);
+		if (image->compressed && texture.mipmaps)
+			texture.maxLevel = (int)image->compressed->levels.size() - 1;
+		texture.started = true;
+	}
+
+	//compressed formats can be allocated with glTexImage2D as well, as long as no data is passed
+	GLenum format = formatOf(image->components);
+	GLenum internalFormat = image->compressed ? ctexGLFormat(image->compressed->format) : format;
+	glTexImage2D(image->target, image->level, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+	GPUMemory::texture(image->texture, image->target, categoryOf(texture.target), internalFormat, width, height, 1, image->level);
+	if (image->compressed ? image->compressed->format == CTEX_BC4 : image->components <= 2)
+		swizzleGray(texture.target, !image->compressed && image->components == 2);
+	GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+}
+
+//copies as many rows of the current level of the image into the ring as the budget allows and starts uploading them to the texture
+bool TextureStreamer::uploadChunk(DecodedImage* image) {
+	int width = image->width, height = image->height;
+	size_t rowSize = (size_t)width * image->components;
+	int rowCount = height;
+	const unsigned char* levelData = image->data;
+	if (image->compressed) {
+		const CTexLevel& level = image->compressed->levels[image->level];
+		width = level.width;
+		height = level.height;
+		rowCount = (height + 3) / 4;
+		rowSize = level.size / rowCount;
+		levelData = image->compressed->data.data() + level.offset;
+	}
+
+	size_t rows = std::min((size_t)(rowCount - image->uploadedRows), budget / rowSize);
+	//a row that's larger than the whole budget is still uploaded on its own, otherwise the image would never finish
+	if (rows == 0 && budget == frameBudget)
+		rows = 1;
+	rows = std::min(rows, ringSize / rowSize);
+
+	size_t offset;
+	while (rows > 0 && !allocate(rows * rowSize, offset)) {
+		rows /= 2;
+	}
+	if (rows == 0)
+		return false;
+
+	StreamedTexture& texture = textures[image->texture];
+	if (image->uploadedRows == 0)
+		start(image, texture, width, height);
+	GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+
+	size_t size = rows * rowSize;
+	write(offset, levelData + image->uploadedRows * rowSize, size);
+
+	//with a pixel unpack buffer bound the last argument is an offset into the buffer, and the copy to the texture happens on the GPU's time
+	GLState::bindTexture(texture.target, image->texture);
+	if (image->compressed) {
+		//compressed uploads have to start on a block boundary and cover whole blocks, except at the bottom edge of the level
+		int y = image->uploadedRows * 4;
+		int chunkHeight = std::min((int)rows * 4, height - y);
+		glCompressedTexSubImage2D(image->target, image->level, 0, y, width, chunkHeight, ctexGLFormat(image->compressed->format), (GLsizei)size, (void*)offset);
+	} else {
+		GLenum format = formatOf(image->components);
+		glTexSubImage2D(image->target, 0, 0, image->uploadedRows, width, (GLsizei)rows, format, GL_UNSIGNED_BYTE, (void*)offset);
+	}
+	image->uploadedRows += (int)rows;
+	budget -= std::min(budget, size);
+
+	//move on to the next larger level, a 2D texture can already show every level down from the one that was just finished
+	if (image->compressed && image->uploadedRows == rowCount && image->level > 0) {
+		if (texture.maxLevel >= 0 && faceCount(texture.target) == 1)
+			glTexParameteri(texture.target, GL_TEXTURE_BASE_LEVEL, image->level);
+		image->level--;
+		image->uploadedRows = 0;
+	}
+	return true;
+}
+
+//copies data into a part of the ring returned by allocate(), the ring has to be bound to GL_PIXEL_UNPACK_BUFFER
+void TextureStreamer::write(size_t offset, const void* source, size_t size) {
+	if (mapped) {
+		memcpy(mapped + offset, source, size);
+	} else {
+		//the fences already guarantee the GPU isn't reading from this part of the ring, so the driver doesn't have to synchronize
+		void* chunk = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		memcpy(chunk, source, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+}
+
+//all images of a texture are uploaded, switch from the placeholder to the full image
+void TextureStreamer::finish(GLuint id, StreamedTexture& texture) {
+	//textures that failed to load keep showing their placeholder
+	if (!texture.failed && texture.started) {
+		GLState::bindTexture(texture.target, id);
+		glTexParameteri(texture.target, GL_TEXTURE_BASE_LEVEL, 0);
+		if (texture.maxLevel >= 0) {
+			//precompressed images come with their whole mip chain
+			glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, texture.maxLevel);
+		} else if (texture.mipmaps) {
+			glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, 1000);
+			glGenerateMipmap(texture.target);
+			GPUMemory::mipmaps(id);
+		} else {
+			glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, 0);
+		}
+	}
+	textures.erase(id);
+}
+
+//free the parts of the ring that the GPU is done with, without waiting for the ones it isn't
+void TextureStreamer::retireFences() {
+	while (!fences.empty()) {
+		GLenum status = glClientWaitSync(fences.front().fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(fences.front().fence);
+		used -= fences.front().size;
+		fences.pop_front();
+	}
+}
+
+//reserves a contiguous part of the ring, returns false when the GPU may still be reading from the space that would be needed
+bool TextureStreamer::allocate(size_t size, size_t& offset) {
+	size = (size + 15) & ~(size_t)15;
+	if (size > ringSize)
+		return false;
+
+	//a chunk can't wrap around the end of the ring, so skip the rest of it and start again at the beginning
+	if (head + size > ringSize) {
+		size_t skipped = ringSize - head;
+		if (used + skipped + size > ringSize)
+			return false;
+		used += skipped;
+		frameUsed += skipped;
+		head = 0;
+	}
+	if (used + size > ringSize)
+		return false;
+
+	offset = head;
+	head += size;
+	used += size;
+	frameUsed += size;
+	return true;
+}
@@ -0,0 +1,50 @@
+#include <threadpool.h>
+
+ThreadPool::ThreadPool(unsigned int threads) {
+	if (threads == 0) {
+		unsigned int cores = std::thread::hardware_concurrency();
+		threads = cores > 1 ? cores - 1 : 1;
+	}
+	for (unsigned int i = 0; i < threads; i++) {
+		workers.emplace_back(&ThreadPool::run, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push(std::move(job));
+	}
+	condition.notify_one();
+}
+
+unsigned int ThreadPool::size() const {
+	return (unsigned int)workers.size();
+}
+
+//keep taking jobs from the queue until the pool is destroyed and the queue is empty
+void ThreadPool::run() {
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+				return;
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+		job();
+	}
+}
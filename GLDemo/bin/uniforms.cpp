@@ -0,0 +1,47 @@
+#include <glad/glad.h>
+
+#include <uniforms.h>
+#include <glstate.h>
+#include <gpumemory.h>
+
+FrameUniforms::FrameUniforms(int slots) : slots(slots) {
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	stride = (sizeof(FrameData) + alignment - 1) / alignment * alignment;
+
+	glGenBuffers(1, &UBO);
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferData(GL_UNIFORM_BUFFER, stride * slots, NULL, GL_DYNAMIC_DRAW);
+	GPUMemory::buffer(UBO, GPUMemory::MEMORY_BUFFERS, stride * slots);
+	GLState::bindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, UBO, 0, sizeof(FrameData));
+}
+
+FrameUniforms::~FrameUniforms() {
+	GLState::deleteBuffers(1, &UBO);
+}
+
+void FrameUniforms::update(const FrameData& data, int slot) {
+	slot = slot < slots ? slot : slots - 1;
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, stride * slot, sizeof(FrameData), &data);
+	GLState::bindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, UBO, stride * slot, sizeof(FrameData));
+}
+
+
+StereoUniforms::StereoUniforms() {
+	glGenBuffers(1, &UBO);
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(StereoData), NULL, GL_DYNAMIC_DRAW);
+	GPUMemory::buffer(UBO, GPUMemory::MEMORY_BUFFERS, sizeof(StereoData));
+	GLState::bindBufferBase(GL_UNIFORM_BUFFER, STEREO_BLOCK_BINDING, UBO);
+}
+
+StereoUniforms::~StereoUniforms() {
+	GLState::deleteBuffers(1, &UBO);
+}
+
+void StereoUniforms::update(const StereoData& data) {
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(StereoData), &data);
+	GLState::bindBufferBase(GL_UNIFORM_BUFFER, STEREO_BLOCK_BINDING, UBO);
+}
\ No newline at end of file
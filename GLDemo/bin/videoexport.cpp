@@ -0,0 +1,199 @@
+#include <videoexport.h>
+#include <imagewriter.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+//the frames are binary, so the pipe must not translate line endings
+static const char* PIPE_MODE = "wb";
+#else
+static const char* PIPE_MODE = "w";
+#endif
+
+namespace fs = std::filesystem;
+
+void ExportSettings::addOptions(Options& options) {
+	auto output = [this](const std::string& value, bool pipe, bool poster) {
+		this->output = value;
+		this->pipe = pipe;
+		this->poster = poster;
+		return true;
+	};
+	options.add("--export", [output](const std::string& value) { return output(value, false, false); });
+	options.add("--pipe", [output](const std::string& value) { return output(value, true, false); });
+	options.add("--poster", [output](const std::string& value) { return output(value, false, true); });
+	options.add("--size", [this](const std::string& value) {
+		if (sscanf(value.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+			std::cout << "Invalid export size " << value << ", expected <width>x<height>" << std::endl;
+			return false;
+		}
+		return true;
+	});
+	options.add("--fps", [this](const std::string& value) {
+		frameRate = atof(value.c_str());
+		if (frameRate <= 0.0) {
+			std::cout << "Invalid export frame rate " << value << std::endl;
+			return false;
+		}
+		return true;
+	});
+	options.add("--frames", [this](const std::string& value) {
+		frames = atoi(value.c_str());
+		if (frames <= 0) {
+			std::cout << "Invalid amount of frames " << value << std::endl;
+			return false;
+		}
+		return true;
+	});
+	options.add("--tile", [this](const std::string& value) {
+		//tiles of a TIFF file must be a multiple of 16 pixels
+		tileSize = atoi(value.c_str()) / 16 * 16;
+		if (tileSize <= 0) {
+			std::cout << "Invalid tile size " << value << ", expected a multiple of 16" << std::endl;
+			return false;
+		}
+		return true;
+	});
+}
+
+bool ExportSettings::isExporting() const {
+	return !output.empty();
+}
+
+VideoExport::VideoExport(const ExportSettings& settings, ThreadPool& pool) : settings(settings), pool(pool), readback(settings.width, settings.height) {
+	//every encoder holds a copy of its frame, so the amount of frames in flight is limited to keep memory in check
+	maxWriting = settings.pipe ? 4 : std::max(2, (int)pool.size() * 2);
+	if (settings.pipe && settings.eyes > 1) {
+		std::cout << "Stereo can only be exported as images, use --export instead of --pipe" << std::endl;
+		return;
+	}
+	if (settings.pipe) {
+		pipe = popen(settings.output.c_str(), PIPE_MODE);
+		if (!pipe) {
+			std::cout << "Couldn't start the export command: " << settings.output << std::endl;
+			return;
+		}
+		pipeWriter.reset(new ThreadPool(1));
+	} else {
+		std::error_code error;
+		fs::create_directories(settings.output, error);
+		if (error) {
+			std::cout << "Couldn't create the export directory " << settings.output << ": " << error.message() << std::endl;
+			opened = false;
+			return;
+		}
+	}
+	std::cout << "Exporting " << settings.frames << " frames of " << settings.width << "x" << settings.height << " at " << settings.frameRate
+		<< " fps to " << settings.output << std::endl;
+}
+
+VideoExport::~VideoExport() {
+	finish();
+}
+
+bool VideoExport::isOpen() const {
+	return settings.pipe ? pipe != nullptr : opened;
+}
+
+float VideoExport::getDeltaTime() const {
+	return (float)(1.0 / settings.frameRate);
+}
+
+bool VideoExport::isDone() const {
+	return captured >= (uint64_t)settings.frames;
+}
+
+bool VideoExport::hasFailed() const {
+	return failed;
+}
+
+void VideoExport::capture(GLuint framebuffer, int eye, int x, int y) {
+	if (isDone() || !isOpen() || hasFailed())
+		return;
+	FrameReadback::Handler handler = [this](uint64_t frame, const unsigned char* pixels) { write(frame, pixels); };
+	readback.collect(handler);
+	//every buffer still holds a frame the GPU hasn't finished copying, so the oldest one has to be waited for
+	//the images of a stereo frame are numbered one after another, left eye first
+	while (!readback.read(framebuffer, captured * settings.eyes + eye, x, y)) {
+		readback.collect(handler, true);
+	}
+	if (eye < settings.eyes - 1)
+		return;
+	captured++;
+	if (captured % 60 == 0 || isDone())
+		std::cout << "Exported " << captured << " of " << settings.frames << " frames" << std::endl;
+}
+
+void VideoExport::write(uint64_t image, const unsigned char* pixels) {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return writing < maxWriting; });
+		writing++;
+	}
+
+	int width = settings.width, height = settings.height;
+	size_t rowSize = (size_t)width * 3;
+	std::shared_ptr<std::vector<unsigned char>> copy = std::make_shared<std::vector<unsigned char>>(pixels, pixels + rowSize * height);
+	auto done = [this](bool written) {
+		std::lock_guard<std::mutex> lock(mutex);
+		writing--;
+		if (!written)
+			failed = true;
+		condition.notify_all();
+	};
+
+	if (settings.pipe) {
+		//the rows are read back from the bottom up, while video frames start at the top
+		pipeWriter->submit([this, copy, rowSize, height, done]() {
+			bool written = true;
+			for (int row = height - 1; row >= 0 && written; row--) {
+				written = fwrite(copy->data() + row * rowSize, 1, rowSize, pipe) == rowSize;
+			}
+			done(written);
+		});
+	} else {
+		char name[48];
+		unsigned long long frame = image / settings.eyes;
+		if (settings.eyes > 1)
+			snprintf(name, sizeof(name), "frame_%06llu_%s.png", frame, image % settings.eyes == 0 ? "left" : "right");
+		else
+			snprintf(name, sizeof(name), "frame_%06llu.png", frame);
+		std::string path = (fs::path(settings.output) / name).string();
+		pool.submit([copy, path, width, height, done]() {
+			bool written = writePng(path, width, height, 3, copy->data(), true);
+			if (!written)
+				std::cout << "Couldn't write " << path << std::endl;
+			done(written);
+		});
+	}
+}
+
+bool VideoExport::finish() {
+	if (finished)
+		return !failed;
+	finished = true;
+	while (readback.pending() > 0) {
+		readback.collect([this](uint64_t frame, const unsigned char* pixels) { write(frame, pixels); }, true);
+	}
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return writing == 0; });
+	}
+	if (pipe) {
+		//waits for the command to finish encoding
+		pipeWriter.reset();
+		if (pclose(pipe) != 0)
+			failed = true;
+		pipe = nullptr;
+	}
+	if (failed)
+		std::cout << "Not every frame of the export could be written" << std::endl;
+	return !failed;
+}
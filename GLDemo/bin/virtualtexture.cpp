@@ -0,0 +1,545 @@
+#include <glad/glad.h>
+
+#include <virtualtexture.h>
+#include <extensions.h>
+#include <glstate.h>
+#include <gpumemory.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//the feedback buffer is this many times smaller than the window along each side, which is plenty to find the visible pages
+const int FEEDBACK_SCALE = 8;
+//number of feedback buffers that can be waiting to be read back, the feedback of a frame is handled this many frames later at most
+const int FEEDBACK_LATENCY = 3;
+//pages that can be read or waiting to be uploaded at once, new requests are dropped until there's room again
+const size_t MAX_LOADING = 64;
+//frames before a page that couldn't be read is requested again, doubled with every failure after that up to the maximum
+const unsigned int RETRY_FRAMES = 60;
+const unsigned int MAX_RETRY_FRAMES = 60 * 64;
+
+/*
+The page cache of a format: a single texture holding pagesPerSide x pagesPerSide pages, shared by all virtual textures of that format.
+Pages that are in use by a virtual texture are kept in a list from the most to the least recently used, except the coarsest level of every
+texture, which never leaves the cache.
+*/
+struct VirtualTexture::Cache {
+	struct Page {
+		VirtualTexture* texture = nullptr;
+		int level = 0, x = 0, y = 0;
+		unsigned int lastUsed = 0; //the last frame in which the page was in the feedback
+		bool pinned = false;
+		std::list<int>::iterator position;
+	};
+
+	CTexFormat format;
+	GLuint texture = 0;
+	GLuint unit;
+	int pagesPerSide;
+	std::vector<Page> pages;
+	std::vector<int> free;
+	std::list<int> lru;
+};
+
+//identifies a page within a virtual texture
+static uint64_t pageKey(int level, int x, int y) {
+	return (uint64_t)level << 48 | (uint64_t)y << 24 | (uint64_t)x;
+}
+
+//identifies a page across all virtual textures
+static uint64_t loadKey(int index, int level, int x, int y) {
+	return (uint64_t)index << 56 | pageKey(level, x, y);
+}
+
+//a page table entry as the RGBA8UI texel read by virtualtexture.glsl: the position of the page in the cache and its level
+static uint32_t packEntry(int page, int pagesPerSide, int level) {
+	return (uint32_t)(page % pagesPerSide) | (uint32_t)(page / pagesPerSide) << 8 | (uint32_t)level << 16 | 0xFFu << 24;
+}
+
+static int nextPowerOfTwo(int value) {
+	int result = 1;
+	while (result < value)
+		result *= 2;
+	return result;
+}
+
+//grows a rectangle of page coordinates (x0, y0, x1, y1) to include another one, x0 > x1 means the rectangle is empty
+static void include(glm::ivec4& rect, const glm::ivec4& other) {
+	if (rect.x > rect.z) {
+		rect = other;
+	} else {
+		rect = glm::ivec4(glm::min(glm::ivec2(rect.x, rect.y), glm::ivec2(other.x, other.y)), glm::max(glm::ivec2(rect.z, rect.w), glm::ivec2(other.z, other.w)));
+	}
+}
+
+static const glm::ivec4 EMPTY_RECT(0, 0, -1, -1);
+
+GLuint VirtualTexture::getPageTable() const {
+	return pageTable;
+}
+
+int VirtualTexture::getIndex() const {
+	return index;
+}
+
+glm::vec4 VirtualTexture::getShape() const {
+	return glm::vec4(file.width, file.height, file.levels.size() - 1, cache->pagesPerSide);
+}
+
+void VirtualTexture::setUniforms(const Shader& shader, const std::string& name) const {
+	GLState::bindTexture(cache->unit, GL_TEXTURE_2D, cache->texture);
+	shader.setInt(name + ".cache", cache->unit);
+	shader.setVec4(name + ".shape", getShape());
+}
+
+VirtualTextures::VirtualTextures(ThreadPool& pool, TextureStreamer& streamer, int pagesPerSide, GLuint firstCacheUnit, int windowWidth, int windowHeight)
+	: pool(pool), streamer(streamer), pagesPerSide(pagesPerSide), firstCacheUnit(firstCacheUnit), loaded(MAX_LOADING) {
+	feedbackWidth = std::max(1, windowWidth / FEEDBACK_SCALE);
+	feedbackHeight = std::max(1, windowHeight / FEEDBACK_SCALE);
+
+	//every pixel of the feedback buffer holds the X and Y of a page, its level, and the index of its texture plus one (0 for no texture)
+	glGenFramebuffers(1, &feedbackFBO);
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+	glGenTextures(1, &feedbackColor);
+	GLState::bindTexture(GL_TEXTURE_2D, feedbackColor);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16UI, feedbackWidth, feedbackHeight, 0, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, NULL);
+	GPUMemory::texture(feedbackColor, GL_TEXTURE_2D, GPUMemory::MEMORY_VIRTUAL_TEXTURES, GL_RGBA16UI, feedbackWidth, feedbackHeight);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor, 0);
+
+	//planetoids without virtual textures are drawn into the feedback as well, so they hide the pages behind them
+	glGenRenderbuffers(1, &feedbackDepth);
+	GLState::bindRenderbuffer(feedbackDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, feedbackWidth, feedbackHeight);
+	GPUMemory::renderbuffer(feedbackDepth, GPUMemory::MEMORY_VIRTUAL_TEXTURES, GL_DEPTH_COMPONENT24, feedbackWidth, feedbackHeight);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Virtual texture feedback framebuffer is not complete" << std::endl;
+	}
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	readbacks.resize(FEEDBACK_LATENCY);
+	for (Readback& readback : readbacks) {
+		glGenBuffers(1, &readback.buffer);
+		GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)feedbackWidth * feedbackHeight * 4 * sizeof(GLushort), NULL, GL_STREAM_READ);
+		GPUMemory::buffer(readback.buffer, GPUMemory::MEMORY_VIRTUAL_TEXTURES, (size_t)feedbackWidth * feedbackHeight * 4 * sizeof(GLushort));
+	}
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+VirtualTextures::~VirtualTextures() {
+	//the workers still read from the page files, so wait until they're done before cleaning up
+	while (reading.load() > 0) {
+		std::this_thread::yield();
+	}
+	LoadedPage* page;
+	while (loaded.pop(page)) {
+		pending.push_back(page);
+	}
+	for (LoadedPage* upload : pending) {
+		delete upload;
+	}
+
+	for (Readback& readback : readbacks) {
+		if (readback.fence)
+			glDeleteSync(readback.fence);
+		GLState::deleteBuffers(1, &readback.buffer);
+	}
+	GLState::deleteRenderbuffers(1, &feedbackDepth);
+	GLState::deleteTextures(1, &feedbackColor);
+	GLState::deleteFramebuffers(1, &feedbackFBO);
+
+	for (auto& texture : textures) {
+		GLState::deleteTextures(1, &texture->pageTable);
+	}
+	for (auto& cache : caches) {
+		GLState::deleteTextures(1, &cache.second->texture);
+	}
+}
+
+VirtualTexture::Cache* VirtualTextures::getCache(CTexFormat format) {
+	auto it = caches.find(format);
+	if (it != caches.end())
+		return it->second.get();
+
+	std::unique_ptr<VirtualTexture::Cache> cache(new VirtualTexture::Cache());
+	cache->format = format;
+	cache->unit = firstCacheUnit + (format - CTEX_BC1);
+	cache->pagesPerSide = pagesPerSide;
+	cache->pages.resize((size_t)pagesPerSide * pagesPerSide);
+	for (int page = (int)cache->pages.size() - 1; page >= 0; page--) {
+		cache->free.push_back(page);
+	}
+
+	//compressed formats can be allocated with glTexImage2D as well, as long as no data is passed
+	int size = pagesPerSide * VTEX_PAGE_SIZE;
+	glGenTextures(1, &cache->texture);
+	GLState::bindTexture(GL_TEXTURE_2D, cache->texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, ctexGLFormat(format), size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	GPUMemory::texture(cache->texture, GL_TEXTURE_2D, GPUMemory::MEMORY_VIRTUAL_TEXTURES, ctexGLFormat(format), size, size);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	//BC4 specular maps only have red, which is read as gray like the specular maps of the texture streamer
+	if (format == CTEX_BC4) {
+		const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	}
+
+	VirtualTexture::Cache* result = cache.get();
+	caches[format] = std::move(cache);
+	return result;
+}
+
+VirtualTexture* VirtualTextures::load(const std::string& path) {
+	//planetoids that use the same map share its virtual texture
+	for (const std::unique_ptr<VirtualTexture>& texture : textures) {
+		if (texture->path == path)
+			return texture.get();
+	}
+
+	std::unique_ptr<VirtualTexture> texture(new VirtualTexture());
+	texture->path = path;
+	texture->stream.open(path, std::ios::binary);
+	if (!texture->stream) {
+		std::cout << "Couldn't open page file: " << path << std::endl;
+		return nullptr;
+	}
+	PageFile& file = texture->file;
+	if (!readPageFileHeader(texture->stream, path, file))
+		return nullptr;
+	if ((file.format == CTEX_BC1 || file.format == CTEX_BC3) && !GLExtensions::textureCompressionS3TC) {
+		std::cout << "The driver doesn't support the format of page file: " << path << std::endl;
+		return nullptr;
+	}
+
+	//the coarsest level is read right away and never leaves the cache, so every entry of the page table always has a page to fall back to
+	int coarsest = (int)file.levels.size() - 1;
+	std::vector<unsigned char> data(file.pageSize);
+	texture->stream.seekg(vtexPageOffset(file, coarsest, 0, 0));
+	if (!texture->stream.read(reinterpret_cast<char*>(data.data()), data.size())) {
+		std::cout << "Page file is truncated: " << path << std::endl;
+		return nullptr;
+	}
+
+	VirtualTexture::Cache* cache = getCache(file.format);
+	if (cache->free.empty()) {
+		std::cout << "Page cache is full, can't load page file: " << path << std::endl;
+		return nullptr;
+	}
+	int page = cache->free.back();
+	cache->free.pop_back();
+	cache->pages[page].texture = texture.get();
+	cache->pages[page].level = coarsest;
+	cache->pages[page].pinned = true;
+
+	GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GLState::bindTexture(GL_TEXTURE_2D, cache->texture);
+	glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, (page % pagesPerSide) * VTEX_PAGE_SIZE, (page / pagesPerSide) * VTEX_PAGE_SIZE,
+		VTEX_PAGE_SIZE, VTEX_PAGE_SIZE, ctexGLFormat(file.format), (GLsizei)data.size(), data.data());
+
+	texture->index = (int)textures.size();
+	texture->cache = cache;
+	texture->resident[pageKey(coarsest, 0, 0)] = page;
+
+	/*
+	The page table has a mip level for every level of the texture. Mip levels of a texture are always half the size of the level above them,
+	while the number of pages of a level is rounded up, so the table is made a power of two large to have room for all of them.
+	*/
+	int tableWidth = nextPowerOfTwo(file.levels[0].pagesX);
+	int tableHeight = nextPowerOfTwo(file.levels[0].pagesY);
+	glGenTextures(1, &texture->pageTable);
+	GLState::bindTexture(GL_TEXTURE_2D, texture->pageTable);
+	for (int level = 0; level <= coarsest; level++) {
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8UI, std::max(1, tableWidth >> level), std::max(1, tableHeight >> level), 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, NULL);
+		GPUMemory::texture(texture->pageTable, GL_TEXTURE_2D, GPUMemory::MEMORY_VIRTUAL_TEXTURES, GL_RGBA8UI, std::max(1, tableWidth >> level), std::max(1, tableHeight >> level), 1, level);
+		texture->entries.push_back(std::vector<uint32_t>((size_t)file.levels[level].pagesX * file.levels[level].pagesY));
+		texture->dirty.push_back(EMPTY_RECT);
+	}
+	//integer textures can't be filtered, they're only read with texelFetch
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, coarsest);
+
+	markDirty(texture.get(), coarsest, 0, 0);
+	updatePageTable(texture.get());
+
+	textures.push_back(std::move(texture));
+	return textures.back().get();
+}
+
+bool VirtualTextures::beginFeedback(Shader& shader) {
+	//when the oldest feedback still hasn't been read back, the GPU is behind and this frame is skipped rather than waited for
+	if (textures.empty() || readbacks[nextReadback].fence)
+		return false;
+
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+	glViewport(0, 0, feedbackWidth, feedbackHeight);
+	GLState::enable(GL_DEPTH_TEST);
+	const GLuint clear[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 0, clear);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	//the derivatives are FEEDBACK_SCALE times larger at the lower resolution, which would make every page a few levels too coarse
+	shader.use();
+	shader.setFloat("lodBias", -std::log2((float)FEEDBACK_SCALE));
+	shader.setInt("frame", (int)frame);
+	return true;
+}
+
+void VirtualTextures::endFeedback() {
+	Readback& readback = readbacks[nextReadback];
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, 0);
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	nextReadback = (nextReadback + 1) % readbacks.size();
+
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void VirtualTextures::update() {
+	frame++;
+	readFeedback();
+	uploadPages();
+	for (auto& texture : textures) {
+		updatePageTable(texture.get());
+	}
+}
+
+//handles every readback the GPU has finished, from the oldest to the newest, without waiting for the ones it hasn't
+void VirtualTextures::readFeedback() {
+	for (size_t i = 0; i < readbacks.size(); i++) {
+		Readback& readback = readbacks[(nextReadback + i) % readbacks.size()];
+		if (!readback.fence)
+			continue;
+		GLenum status = glClientWaitSync(readback.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(readback.fence);
+		readback.fence = 0;
+
+		size_t size = (size_t)feedbackWidth * feedbackHeight * 4 * sizeof(GLushort);
+		GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		const GLushort* pixels = (const GLushort*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+		if (!pixels) {
+			GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			continue;
+		}
+
+		//most pixels land on the same few pages, so every page is only looked at once
+		std::unordered_set<uint64_t> seen;
+		std::vector<Request> requests;
+		for (size_t pixel = 0; pixel < (size_t)feedbackWidth * feedbackHeight; pixel++) {
+			const GLushort* value = pixels + pixel * 4;
+			if (value[3] == 0 || value[3] > textures.size())
+				continue;
+			VirtualTexture* texture = textures[value[3] - 1].get();
+			int level = value[2], x = value[0], y = value[1];
+			if (level >= (int)texture->file.levels.size() || x >= texture->file.levels[level].pagesX || y >= texture->file.levels[level].pagesY)
+				continue;
+			request(seen, requests, texture, level, x, y);
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		//coarse pages cover the most of the screen and are what the finer pages fall back to, so they're loaded first
+		std::stable_sort(requests.begin(), requests.end(), [](const Request& a, const Request& b) { return a.level > b.level; });
+		for (const Request& request : requests) {
+			if (loading.size() >= MAX_LOADING)
+				break;
+			loading.insert(loadKey(request.texture->index, request.level, request.x, request.y));
+			reading++;
+			pool.submit([this, request]() {
+				LoadedPage* page = new LoadedPage();
+				page->request = request;
+				page->data.resize(request.texture->file.pageSize);
+				{
+					std::lock_guard<std::mutex> lock(request.texture->streamMutex);
+					std::ifstream& stream = request.texture->stream;
+					stream.clear();
+					stream.seekg(vtexPageOffset(request.texture->file, request.level, request.x, request.y));
+					page->failed = !stream.read(reinterpret_cast<char*>(page->data.data()), page->data.size());
+				}
+
+				while (!loaded.push(page)) {
+					std::this_thread::yield();
+				}
+				reading--;
+			});
+		}
+	}
+}
+
+/*
+Marks a visible page and all the coarser pages that contain it as used in this frame, and adds the ones that aren't in the cache to the requests.
+The coarser pages are needed as well, as they're what's shown while the finer page is loading and when it's evicted again.
+*/
+void VirtualTextures::request(std::unordered_set<uint64_t>& seen, std::vector<Request>& requests, VirtualTexture* texture, int level, int x, int y) {
+	int coarsest = (int)texture->file.levels.size() - 1;
+	for (; level <= coarsest; level++, x /= 2, y /= 2) {
+		x = std::min(x, texture->file.levels[level].pagesX - 1);
+		y = std::min(y, texture->file.levels[level].pagesY - 1);
+		uint64_t key = loadKey(texture->index, level, x, y);
+		//this page and every page above it have already been handled
+		if (!seen.insert(key).second)
+			return;
+
+		auto it = texture->resident.find(pageKey(level, x, y));
+		if (it != texture->resident.end()) {
+			VirtualTexture::Cache::Page& page = texture->cache->pages[it->second];
+			page.lastUsed = frame;
+			if (!page.pinned)
+				texture->cache->lru.splice(texture->cache->lru.begin(), texture->cache->lru, page.position);
+		} else if (!loading.count(key)) {
+			auto retry = retries.find(key);
+			if (retry == retries.end() || (int)(frame - retry->second.frame) >= 0)
+				requests.push_back({ texture, level, x, y });
+		}
+	}
+}
+
+//uploads the pages that have been read from disk, each into a free page of the cache or in place of the least recently used one
+void VirtualTextures::uploadPages() {
+	LoadedPage* page;
+	while (loaded.pop(page)) {
+		pending.push_back(page);
+	}
+
+	while (!pending.empty()) {
+		page = pending.front();
+		Request& request = page->request;
+		VirtualTexture::Cache* cache = request.texture->cache;
+		uint64_t key = loadKey(request.texture->index, request.level, request.x, request.y);
+
+		if (page->failed) {
+			//the page is tried again later rather than every frame, the coarser pages are shown in the meantime
+			Retry& retry = retries[key];
+			unsigned int delay = std::min(RETRY_FRAMES << std::min(retry.failures, 6u), MAX_RETRY_FRAMES);
+			retry.failures++;
+			retry.frame = frame + delay;
+			std::cout << "Couldn't read page " << request.x << ", " << request.y << " of level " << request.level << " from: " << request.texture->path
+				<< ", trying again in " << delay << " frames" << std::endl;
+			loading.erase(key);
+			pending.pop_front();
+			delete page;
+			continue;
+		}
+
+		int target = -1;
+		if (!cache->free.empty()) {
+			target = cache->free.back();
+		} else if (!cache->lru.empty() && frame - cache->pages[cache->lru.back()].lastUsed > (unsigned int)FEEDBACK_LATENCY) {
+			//the feedback comes in up to FEEDBACK_LATENCY frames late, so a page that was seen within that many frames may still be on screen
+			target = cache->lru.back();
+		}
+		if (target < 0) {
+			//every page in the cache is (or may still be) on screen, the coarser pages that are in it have to do until the view changes
+			loading.erase(key);
+			pending.pop_front();
+			delete page;
+			continue;
+		}
+
+		//stop for this frame when the budget of the texture streamer is used up
+		if (!streamer.uploadCompressed(cache->texture, GL_TEXTURE_2D, 0, (target % pagesPerSide) * VTEX_PAGE_SIZE, (target / pagesPerSide) * VTEX_PAGE_SIZE,
+			VTEX_PAGE_SIZE, VTEX_PAGE_SIZE, ctexGLFormat(cache->format), page->data.data(), page->data.size()))
+			break;
+
+		if (!cache->free.empty()) {
+			cache->free.pop_back();
+		} else {
+			VirtualTexture::Cache::Page& old = cache->pages[target];
+			unmap(old.texture, old.level, old.x, old.y);
+			cache->lru.erase(old.position);
+		}
+		map(request.texture, request.level, request.x, request.y, target);
+
+		loading.erase(key);
+		retries.erase(key);
+		pending.pop_front();
+		delete page;
+	}
+}
+
+void VirtualTextures::map(VirtualTexture* texture, int level, int x, int y, int page) {
+	VirtualTexture::Cache* cache = texture->cache;
+	VirtualTexture::Cache::Page& entry = cache->pages[page];
+	entry.texture = texture;
+	entry.level = level;
+	entry.x = x;
+	entry.y = y;
+	entry.lastUsed = frame;
+	cache->lru.push_front(page);
+	entry.position = cache->lru.begin();
+
+	texture->resident[pageKey(level, x, y)] = page;
+	markDirty(texture, level, x, y);
+}
+
+void VirtualTextures::unmap(VirtualTexture* texture, int level, int x, int y) {
+	texture->resident.erase(pageKey(level, x, y));
+	markDirty(texture, level, x, y);
+}
+
+void VirtualTextures::markDirty(VirtualTexture* texture, int level, int x, int y) {
+	include(texture->dirty[level], glm::ivec4(x, y, x, y));
+}
+
+/*
+Recomputes the entries of the page table that changed and uploads them. A change to a page also changes every finer entry that falls back
+to it, so the levels are handled from the coarsest to the finest and the changed part of each level is passed down to the one below it.
+*/
+void VirtualTextures::updatePageTable(VirtualTexture* texture) {
+	const PageFile& file = texture->file;
+	int coarsest = (int)file.levels.size() - 1;
+	bool bound = false;
+
+	for (int level = coarsest; level >= 0; level--) {
+		glm::ivec4 rect = texture->dirty[level];
+		if (rect.x > rect.z)
+			continue;
+		texture->dirty[level] = EMPTY_RECT;
+
+		const VTexLevel& info = file.levels[level];
+		std::vector<uint32_t>& entries = texture->entries[level];
+		for (int y = rect.y; y <= rect.w; y++) {
+			for (int x = rect.x; x <= rect.z; x++) {
+				auto it = texture->resident.find(pageKey(level, x, y));
+				if (it != texture->resident.end()) {
+					entries[(size_t)y * info.pagesX + x] = packEntry(it->second, pagesPerSide, level);
+				} else {
+					//the coarsest page is always resident, so there's always a coarser level here
+					const VTexLevel& parent = file.levels[level + 1];
+					int px = std::min(x / 2, parent.pagesX - 1), py = std::min(y / 2, parent.pagesY - 1);
+					entries[(size_t)y * info.pagesX + x] = texture->entries[level + 1][(size_t)py * parent.pagesX + px];
+				}
+			}
+		}
+
+		if (!bound) {
+			GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			GLState::bindTexture(GL_TEXTURE_2D, texture->pageTable);
+			bound = true;
+		}
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, info.pagesX);
+		glTexSubImage2D(GL_TEXTURE_2D, level, rect.x, rect.y, rect.z - rect.x + 1, rect.w - rect.y + 1, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,
+			&entries[(size_t)rect.y * info.pagesX + rect.x]);
+
+		if (level > 0) {
+			const VTexLevel& child = file.levels[level - 1];
+			int x1 = rect.z == info.pagesX - 1 ? child.pagesX - 1 : std::min(rect.z * 2 + 1, child.pagesX - 1);
+			int y1 = rect.w == info.pagesY - 1 ? child.pagesY - 1 : std::min(rect.w * 2 + 1, child.pagesY - 1);
+			include(texture->dirty[level - 1], glm::ivec4(std::min(rect.x * 2, x1), std::min(rect.y * 2, y1), x1, y1));
+		}
+	}
+	if (bound)
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
@@ -0,0 +1,65 @@
+#include <vtex.h>
+
+#include <algorithm>
+#include <iostream>
+
+//the header as it's stored on disk, followed directly by the pages
+struct VTexHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	uint32_t pageSize;
+	uint32_t pageBorder;
+};
+
+void vtexLayout(PageFile& file) {
+	file.pageSize = ctexLevelSize(file.format, VTEX_PAGE_SIZE, VTEX_PAGE_SIZE);
+	file.levels.clear();
+
+	int width = file.width, height = file.height;
+	uint64_t firstPage = 0;
+	for (;;) {
+		VTexLevel level = { width, height, (width + VTEX_PAGE_CONTENT - 1) / VTEX_PAGE_CONTENT, (height + VTEX_PAGE_CONTENT - 1) / VTEX_PAGE_CONTENT, firstPage };
+		file.levels.push_back(level);
+		if (level.pagesX == 1 && level.pagesY == 1)
+			break;
+		firstPage += (uint64_t)level.pagesX * level.pagesY;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+}
+
+uint64_t vtexPageOffset(const PageFile& file, int level, int x, int y) {
+	const VTexLevel& info = file.levels[level];
+	return sizeof(VTexHeader) + (info.firstPage + (uint64_t)y * info.pagesX + x) * file.pageSize;
+}
+
+bool readPageFileHeader(std::ifstream& stream, const std::string& path, PageFile& file) {
+	VTexHeader header;
+	if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != VTEX_MAGIC || header.version != VTEX_VERSION
+		|| header.format < CTEX_BC1 || header.format > CTEX_BC5 || header.width == 0 || header.height == 0
+		|| header.pageSize != VTEX_PAGE_SIZE || header.pageBorder != VTEX_PAGE_BORDER) {
+		std::cout << "Page file has an invalid header: " << path << std::endl;
+		return false;
+	}
+	file.format = (CTexFormat)header.format;
+	file.width = (int)header.width;
+	file.height = (int)header.height;
+	vtexLayout(file);
+
+	if (file.levels.size() != header.levels) {
+		std::cout << "Page file has an invalid number of levels: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool writePageFileHeader(std::ofstream& stream, const PageFile& file) {
+	VTexHeader header = { VTEX_MAGIC, VTEX_VERSION, (uint32_t)file.format, (uint32_t)file.width, (uint32_t)file.height,
+		(uint32_t)file.levels.size(), VTEX_PAGE_SIZE, VTEX_PAGE_BORDER };
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return (bool)stream;
+}
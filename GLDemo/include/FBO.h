@@ -3,21 +3,45 @@
 
 #include <glad/glad.h>
 #include <shader_m.h>
+#include <stereo.h>
 
 class FBO {
 public:
-	FBO(const GLuint& windowWidth, const GLuint& windowHeight, glm::vec3& lightPos);
+	//the size is that of a single eye, a stereo framebuffer holds both eyes in the given layout (see stereo.h)
+	FBO(const GLuint& windowWidth, const GLuint& windowHeight, glm::vec3& lightPos, StereoLayout layout = STEREO_OFF);
 	~FBO();
 
-	void drawTextureQuad(Shader& shader);
+	/*
+	Draws the texture to the window, which is screenWidth by screenHeight pixels. Packed stereo layouts are drawn as they are, for a projector
+	to pull apart. A layered framebuffer needs the screen shader compiled with LAYERED, and draws each eye to its own back buffer when the
+	window has quad buffered stereo, or both eyes next to each other when it doesn't.
+	*/
+	void drawTextureQuad(Shader& shader, int screenWidth, int screenHeight);
+	//renders into the framebuffer from now on, across all of its pixels
 	void enable();
+	//renders into the part of the framebuffer of a single eye from now on, or into all of them with ALL_EYES
+	void selectEye(int eye);
+	//1, or 2 for a stereo framebuffer
+	int getEyes() const;
+	GLuint getFramebuffer() const;
+	//the framebuffer to read the image of an eye from, and where it starts in that framebuffer
+	GLuint getEyeFramebuffer(int eye, int& x, int& y) const;
+
+	static const int ALL_EYES = -1;
 
 private:
 	GLuint m_FBO;
+	GLsizei m_width, m_height;
+	StereoLayout m_layout;
+	GLenum m_target; //GL_TEXTURE_2D_ARRAY for a layered framebuffer
+	bool m_quadBuffered = false;
 	GLuint m_scrVAO;
 	GLuint m_scrVBO;
 	GLuint m_TCB;
-	GLuint m_RBO;
+	GLuint m_RBO = 0;
+	//a layered framebuffer has its depth in a texture array as well, and a framebuffer for every layer
+	GLuint m_depth = 0;
+	GLuint m_eyeFBO[2] = { 0, 0 };
 
 	float quadVertices[24] = { // vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates.
 	// positions   // texCoords
@@ -3,8 +3,10 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <shader_m.h>
+#include <glstate.h>
 
 #include <glad/glad.h>
 
@@ -23,13 +25,31 @@ struct Character {
 	GLuint offset;
 };
 
+//the glyphs of a font rasterized by FreeType, before they're uploaded into textures
+struct FontData {
+	struct Glyph {
+		std::vector<unsigned char> bitmap;
+		glm::ivec2 size;
+		glm::ivec2 bearing;
+		GLuint offset;
+	};
+	std::map<GLchar, Glyph> glyphs;
+};
+
 class HUD {
 public:
 	HUD(const char * fontPath);
+	HUD(const FontData& font);
+
+	//rasterizes the glyphs of a font without calling OpenGL, so it can run on a worker thread
+	static FontData rasterize(const char * fontPath);
 
 	~HUD() {
-		glDeleteVertexArrays(1, &hud_VAO);
-		glDeleteBuffers(1, &hud_VBO);
+		GLState::deleteVertexArrays(1, &hud_VAO);
+		GLState::deleteBuffers(1, &hud_VBO);
+		for (auto& character : Characters) {
+			GLState::deleteTextures(1, &character.second.textureID);
+		}
 	}
 
 	void RenderText(Shader& shader, std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color);
@@ -0,0 +1,75 @@
+#ifndef ATMOSPHERE_H
+#define ATMOSPHERE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <shader_m.h>
+
+#include <future>
+#include <string>
+#include <vector>
+
+/*
+Describes the atmosphere of a planetoid. All distances are relative to the radius of the planetoid, so the same profile looks the same
+regardless of how large the planetoid is drawn, and the scattering coefficients are given per planetoid radius.
+The heights are exaggerated compared to the real solar system, otherwise the atmospheres would be thinner than a single pixel.
+*/
+struct AtmosphereProfile {
+	std::string name;
+	float height; //thickness of the atmosphere
+	glm::vec3 rayleighScattering; //scattering by gas molecules, which scatter blue light the most
+	float rayleighScaleHeight; //height at which the density of the gas has dropped to 1/e
+	float mieScattering; //scattering by dust and aerosols, which scatter all wavelengths equally
+	float mieScaleHeight;
+	float mieG; //anisotropy of mie scattering, the closer to 1.0 the more light is scattered forwards
+	float sunIntensity;
+};
+
+//the lookup tables as they are computed on the CPU, before they are uploaded to the GPU
+struct AtmosphereTables {
+	std::vector<float> transmittance; //RGB, TRANSMITTANCE_WIDTH * TRANSMITTANCE_HEIGHT
+	std::vector<float> inscatter; //RGBA, INSCATTER_MU * INSCATTER_MU_S * INSCATTER_NU
+};
+
+//dimensions of the lookup tables
+const int TRANSMITTANCE_WIDTH = 128; //cosine of the zenith angle
+const int TRANSMITTANCE_HEIGHT = 32; //altitude
+const int INSCATTER_MU = 32; //cosine of the view zenith angle where the view ray enters the atmosphere
+const int INSCATTER_MU_S = 32; //cosine of the sun zenith angle at that point
+const int INSCATTER_NU = 16; //cosine of the angle between the view ray and the sun
+
+/*
+Precomputed atmospheric scattering for a single atmosphere profile. Ray marching through the atmosphere for every fragment is too expensive,
+so the transmittance (how much light survives a path through the atmosphere) and single in-scattering (how much sunlight is scattered
+towards the viewer along a view ray) are integrated once into lookup tables, which the shaders only have to sample.
+The tables are built on a worker thread when the atmosphere is created and cached to disk, so later launches can skip the integration.
+*/
+class Atmosphere {
+public:
+	Atmosphere(const AtmosphereProfile& profile);
+	~Atmosphere();
+
+	//uploads the lookup tables once the worker thread is done, must be called from the thread that owns the GL context
+	//returns whether the tables are ready to be used
+	bool poll();
+
+	//set the uniforms used for lighting the surface of a planetoid, the transmittance table is bound to the given texture unit
+	void setSurfaceUniforms(const Shader& shader, GLuint unit, const glm::vec3& center, float planetRadius) const;
+	//set the uniforms used for drawing the atmosphere shell around a planetoid
+	void setShellUniforms(const Shader& shader, GLuint unit, const glm::vec3& center, float planetRadius) const;
+
+	const AtmosphereProfile& getProfile() const;
+
+private:
+	AtmosphereProfile profile;
+	std::future<AtmosphereTables> pending;
+	bool ready = false;
+	GLuint transmittanceTex = 0;
+	GLuint inscatterTex = 0;
+
+	void upload(const AtmosphereTables& tables);
+};
+
+#endif
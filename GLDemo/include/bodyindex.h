@@ -0,0 +1,65 @@
+#ifndef BODYINDEX_H
+#define BODYINDEX_H
+
+#include <glm/glm.hpp>
+
+#include <bvh.h>
+#include <minorplanets.h>
+#include <planetoid.h>
+#include <threadpool.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+//a body of the scene that was found by a query of a BodyIndex
+struct BodyHit {
+	//the index of the planetoid in the list the index was made with, or -1 for an asteroid of the catalog
+	int planetoid = -1;
+	size_t asteroid = 0;
+	float distance = 0.0f; //see BVH::Hit
+};
+
+/*
+Every body of the scene in a BVH, the planetoids as well as the asteroids of a catalog, for picking and for finding the bodies near a point.
+Every frame the bodies are moved to where they're drawn and the tree is refit on the thread pool while the frame is drawn: the asteroids are
+moved in a chunk per worker and the chunk that finishes last refits the tree. The render thread only asks whether that's done, and runs its
+queries and starts the next update when it is, so it never waits for the workers. The answers are a frame behind what's on screen.
+*/
+class BodyIndex {
+public:
+	//the catalog must stay around for as long as the index, the asteroids are placed like minorPlanets draws them
+	BodyIndex(ThreadPool& pool, const std::vector<Planetoid*>& planetoids, const MinorPlanetCatalog* catalog = nullptr, const MinorPlanets* minorPlanets = nullptr);
+	//waits for the update that's running
+	~BodyIndex();
+	BodyIndex(const BodyIndex&) = delete;
+	BodyIndex& operator=(const BodyIndex&) = delete;
+
+	//whether the last update is done, the queries and update may only be called when it is
+	bool ready() const;
+	//moves every body to where it's drawn in the frame with the given time of the catalog (see MinorPlanets::draw)
+	void update(const glm::vec3& sunPos, double days);
+
+	//see the queries of BVH
+	bool pick(const glm::vec3& origin, const glm::vec3& direction, float spread, BodyHit& hit) const;
+	bool nearest(const glm::vec3& point, float maxDistance, BodyHit& hit) const;
+	void within(const glm::vec3& point, float radius, std::vector<BodyHit>& hits) const;
+
+private:
+	ThreadPool& pool;
+	std::vector<Planetoid*> planetoids;
+	const MinorPlanetCatalog* catalog;
+	const MinorPlanets* minorPlanets;
+	BVH bvh;
+
+	std::atomic<bool> updating{ false };
+	std::atomic<int> remainingChunks{ 0 };
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	BodyHit toBodyHit(const BVH::Hit& hit) const;
+	void finishUpdate();
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <threadpool.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct BVHTree;
+struct BVHBuild;
+
+/*
+A bounding volume hierarchy over spheres that move every frame, for finding bodies without looking at all of them (picking, the nearest body
+and all bodies within a distance of a point).
+Moving the bodies doesn't rebuild the tree: refit only grows and shrinks the boxes around where the bodies are now, which keeps every query
+correct but makes the boxes overlap more and more as bodies drift away from the ones they were grouped with. Once the surface area heuristic
+cost of the tree has grown past REBUILD_DEGRADATION times what it was right after a build, a new tree is built from a copy of the bodies on the
+thread pool while the old one is still refit and used, and it's swapped in by the first refit after it's done.
+Queries and refits must not run at the same time, the rebuild never touches the tree that's in use.
+*/
+class BVH {
+public:
+	//a body a query found, the distance is along the ray for raycasts and to the surface of the body for the other queries
+	struct Hit {
+		uint32_t body;
+		float distance;
+	};
+
+	BVH(ThreadPool& pool);
+	~BVH();
+	BVH(const BVH&) = delete;
+	BVH& operator=(const BVH&) = delete;
+
+	//the center (xyz) and radius (w) of every body, written before every refit. The tree is rebuilt when the amount of bodies changes, until
+	//then the queries find nothing
+	std::vector<glm::vec4> bodies;
+
+	void refit();
+	//the body closest to the origin whose sphere comes within spread times the distance along the ray of it, so points of no size can be picked
+	//within a cone (spread is the tangent of its half angle). The direction must be normalized
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, float spread, Hit& hit) const;
+	bool nearest(const glm::vec3& point, float maxDistance, Hit& hit) const;
+	//every body whose sphere is at least partly within radius of the point, in no particular order
+	void within(const glm::vec3& point, float radius, std::vector<Hit>& hits) const;
+	//the cost of the tree relative to right after it was built
+	float getDegradation() const;
+
+	static constexpr float REBUILD_DEGRADATION = 1.5f;
+
+private:
+	ThreadPool& pool;
+	std::unique_ptr<BVHTree> tree;
+	//the rebuild that's running, it's kept alive by its jobs as well so the tree can be destroyed before they're done
+	std::shared_ptr<BVHBuild> build;
+
+	void startBuild();
+};
+
+#endif
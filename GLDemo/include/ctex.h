@@ -0,0 +1,63 @@
+#ifndef CTEX_H
+#define CTEX_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+Block compressed textures with a precomputed mip chain, as written by the texconvert tool (see tools/texconvert.cpp) and loaded by the
+texture streamer. Compressed textures stay compressed in video memory, so they take 4 to 8 times less memory and bandwidth than the
+JPEGs and PNGs they're made from, and loading them is just a copy as there's nothing left to decode.
+
+The container is a small DDS-like file: a header, a table with the offset and size of every mip level, and the block data of each
+level from the largest to the smallest. Cubemaps aren't stored as a single file, every face is converted on its own.
+*/
+
+// GL_EXT_texture_compression_s3tc, BC4 and BC5 (RGTC) are core in 3.0
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+const uint32_t CTEX_MAGIC = 0x58455443; //"CTEX"
+const uint32_t CTEX_VERSION = 1;
+
+enum CTexFormat {
+	CTEX_BC1 = 1, //RGB, 8 bytes per block, for color maps without alpha
+	CTEX_BC3 = 2, //RGBA, 16 bytes per block, for color maps with alpha
+	CTEX_BC4 = 3, //one channel, 8 bytes per block, for specular maps
+	CTEX_BC5 = 4 //two channels, 16 bytes per block, for normal maps of which the shader reconstructs Z
+};
+
+enum CTexFlags {
+	CTEX_FLAT = 1 << 0 //every pixel of the source image has the same color (see TextureStreamer::load)
+};
+
+struct CTexLevel {
+	int width, height;
+	size_t offset, size; //position of the level in CompressedImage::data
+};
+
+struct CompressedImage {
+	CTexFormat format;
+	int width, height;
+	uint32_t flags = 0;
+	std::vector<CTexLevel> levels;
+	std::vector<unsigned char> data;
+};
+
+//number of bytes in a 4x4 block of the given format
+size_t ctexBlockSize(CTexFormat format);
+//size of a level of the given dimensions, partial blocks at the edges are stored as full blocks
+size_t ctexLevelSize(CTexFormat format, int width, int height);
+//the internal format to pass to glCompressedTexImage2D
+GLenum ctexGLFormat(CTexFormat format);
+
+//both only print a message and return false when something is wrong, nothing in here calls OpenGL so they can run on any thread
+bool readCompressedImage(const std::string& path, CompressedImage& image);
+bool writeCompressedImage(const std::string& path, const CompressedImage& image);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef EXTENSIONS_H
+#define EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <string>
+
+/*
+glad was generated for the OpenGL 3.3 core profile only, so functionality from newer versions and extensions is loaded here at runtime.
+Every feature is optional: check its flag before calling any of its functions, and fall back to the 3.3 core path when it's missing.
+*/
+
+// GL_ARB_get_program_binary (core in 4.1)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// GL_ARB_buffer_storage (core in 4.4)
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+// GL_NVX_gpu_memory_info and GL_ATI_meminfo, all sizes are in KB
+#ifndef GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX 0x9047
+#define GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX 0x9048
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_VBO_FREE_MEMORY_ATI 0x87FB
+#define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+#define GL_RENDERBUFFER_FREE_MEMORY_ATI 0x87FD
+#endif
+
+namespace GLExtensions {
+	//must be called once after glad has been loaded, with the same loader function
+	void load(GLADloadproc loader);
+	//checks whether the driver reports the given extension, f.e. "GL_ARB_get_program_binary"
+	bool has(const std::string& name);
+	//the OpenGL version of the current context, f.e. 45 for 4.5
+	int version();
+	//vendor, renderer and version of the driver, changes whenever the GPU or the driver changes
+	std::string driverString();
+
+	extern bool programBinary;
+	extern PFNGLGETPROGRAMBINARYPROC GetProgramBinary;
+	extern PFNGLPROGRAMBINARYPROC ProgramBinary;
+	extern PFNGLPROGRAMPARAMETERIPROC ProgramParameteri;
+
+	extern bool parallelShaderCompile;
+	extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreads;
+
+	//BC1-BC3 compressed textures, practically every desktop driver has these but they've never been core
+	extern bool textureCompressionS3TC;
+
+	//immutable buffers that can stay mapped while the GPU reads from them
+	extern bool bufferStorage;
+	extern PFNGLBUFFERSTORAGEPROC BufferStorage;
+
+	//gl_Layer can be written by vertex shaders, so instanced draws can go to a different layer of a layered framebuffer per instance
+	extern bool vertexShaderLayer;
+
+	//how much video memory is free, NVIDIA drivers report how much there is in total as well (see GPUMemory::queryDriver)
+	extern bool memoryInfoNVX;
+	extern bool memoryInfoATI;
+}
+
+#endif
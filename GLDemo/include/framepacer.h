@@ -0,0 +1,51 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <glad/glad.h>
+
+#include <options.h>
+
+//how long to wait before every frame, see LatencySettings::addOptions for the command line
+struct LatencySettings {
+	bool lowLatency = false;
+	float frameDelay = 0.0f; //in ms
+	bool autoDelay = false;
+
+	/*
+	Adds the latency options, frames are queued by the driver as usual unless one of them is given:
+	  --latency <normal|low>     low keeps the GPU from falling more than a frame behind
+	  --frame-delay <ms|auto>    waits this long before every frame, so its input is sampled closer to when it's shown. auto waits for as
+	                             long as the frames leave over until the next refresh. Implies --latency low
+	*/
+	void addOptions(Options& options);
+};
+
+/*
+Keeps the time between sampling the input of a frame and showing it short. With vsync the driver lets the CPU run a few frames ahead of
+the GPU, so every frame is shown two or three refreshes after its input was read. After every swap the pacer waits for the GPU to finish
+the frame, so there's never more than one frame in flight, and then for the frame delay: a frame that only takes a few milliseconds is
+better started just before the refresh it's shown at than right after the last one.
+*/
+class FramePacer {
+public:
+	//the refresh rate of the monitor the window is on, which the automatic delay fills up to
+	FramePacer(const LatencySettings& settings, int refreshRate);
+	~FramePacer();
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	//call right after the buffers are swapped, and sample the input of the next frame right after it returns
+	void afterSwap();
+	//how long the last frame waited for, in ms
+	float getDelay() const;
+
+private:
+	LatencySettings settings;
+	double refreshInterval;
+	//when the work of the frame that's being drawn started, and the longest time a recent frame took to get through the GPU
+	double frameStart = 0.0;
+	double workTime = 0.0;
+	float delay = 0.0f;
+};
+
+#endif
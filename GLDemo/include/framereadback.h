@@ -0,0 +1,49 @@
+#ifndef FRAMEREADBACK_H
+#define FRAMEREADBACK_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+Reads rendered frames back to the CPU without stalling the render thread. glReadPixels copies the color buffer into one of a ring of pixel
+buffer objects, which the GPU does whenever it gets to it, and a fence marks when the copy is done. The frames are only mapped once their
+fence has passed, a few frames later, so the CPU never waits for the GPU to catch up unless it asks to.
+Pixels are tightly packed RGB rows from the bottom to the top, like OpenGL stores them.
+*/
+class FrameReadback {
+public:
+	//called with the pixels of a frame, which are only valid during the call
+	typedef std::function<void(uint64_t frame, const unsigned char* pixels)> Handler;
+
+	FrameReadback(int width, int height, int buffers = 3);
+	~FrameReadback();
+	FrameReadback(const FrameReadback&) = delete;
+	FrameReadback& operator=(const FrameReadback&) = delete;
+
+	//starts copying the first color attachment of the framebuffer from x, y on, returns false when every buffer still holds a frame that wasn't collected
+	bool read(GLuint framebuffer, uint64_t frame, int x = 0, int y = 0);
+	//hands the frames whose copies are done to the handler, oldest first. With wait set, it waits for the oldest frame when it isn't done yet
+	void collect(const Handler& handler, bool wait = false);
+	//frames that were read but haven't been collected yet
+	int pending() const;
+
+	int getWidth() const;
+	int getHeight() const;
+
+private:
+	struct Slot {
+		GLuint buffer;
+		GLsync fence = 0;
+		uint64_t frame = 0;
+	};
+
+	int width, height;
+	std::vector<Slot> slots;
+	size_t oldest = 0;
+	int inFlight = 0;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <shader_m.h>
+#include <lockfreequeue.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <thread>
+
+//the parts of a frame that are timed on the CPU, in the order they run in
+enum FrameSection {
+	SECTION_INPUT, //the keyboard
+	SECTION_UPDATE, //applying the simulation and the queries of the bodies
+	SECTION_UPLOAD, //virtual texture pages and streamed textures
+	SECTION_DRAW, //every view
+	SECTION_OUTPUT, //the HUD, exports, the stream and the quad on screen
+	SECTION_PRESENT, //swapping the buffers, pacing and polling events, which is where vsync and a GPU that's behind are waited for
+	SECTION_COUNT
+};
+
+//the times of a single frame in ms
+struct FrameRecord {
+	uint64_t frame = 0;
+	double start = 0.0; //since the first frame
+	float frameTime = 0.0f; //from the start of this frame to the start of the next one, what the frame rate is made of
+	float cpuTime = 0.0f; //from the start of the frame until its buffers are swapped
+	float gpuTime = -1.0f; //of all commands of the frame, negative when the timer query didn't come back in time
+	float sections[SECTION_COUNT] = {};
+	bool stutter = false;
+};
+
+//a frame that took more than STUTTER_FACTOR times the median frame time, and the section that took the most longer than it usually does
+struct Stutter {
+	uint64_t frame;
+	double start;
+	float frameTime, median;
+	FrameSection section;
+};
+
+//percentiles of the frame times of the last HISTORY_FRAMES frames
+struct FrameTimePercentiles {
+	float p50 = 0.0f, p95 = 0.0f, p99 = 0.0f, max = 0.0f;
+};
+
+/*
+Measures every frame: the time between frames, the CPU time of every section and the GPU time (with a timer query that's read a few frames
+later, so the CPU never waits for it). The last HISTORY_FRAMES frames are kept for the rolling percentiles and the graph, and every frame that
+takes more than twice the median is recorded as a stutter along with the section that caused it. The whole session goes into a histogram.
+With a log file every frame is handed to a writer thread through a lock-free queue and written as a row of a CSV file, so the render thread
+never waits for the disk. Frames are dropped from the log when the writer falls behind.
+*/
+class FrameStats {
+public:
+	//frames are written to logPath when it isn't empty
+	FrameStats(const std::string& logPath = "");
+	//writes the frames that are still queued
+	~FrameStats();
+	FrameStats(const FrameStats&) = delete;
+	FrameStats& operator=(const FrameStats&) = delete;
+
+	bool isLogging() const;
+	//at the very start of every frame, this also finishes the last frame
+	void beginFrame();
+	//everything from here on is counted towards the section, until the next one starts
+	void section(FrameSection section);
+	//right before the buffers are swapped, starts SECTION_PRESENT
+	void endFrame();
+
+	FrameTimePercentiles getPercentiles() const;
+	size_t getStutterCount() const;
+	//draws the frame times (white) and GPU times (orange) of the last GRAPH_FRAMES frames into a rectangle, in the pixels of the projection.
+	//the lines across are at 1x and 2x the refresh interval, stutters are marked red
+	void drawGraph(Shader& shader, const glm::mat4& projection, float x, float y, float width, float height, float refreshInterval);
+	//prints the percentiles, the histogram of the session and the last stutters
+	void report() const;
+
+	static const int HISTORY_FRAMES = 1024;
+	static const int GRAPH_FRAMES = 240;
+	static constexpr float STUTTER_FACTOR = 2.0f;
+	//the histogram has a bin for every HISTOGRAM_BIN ms, frames past the last bin are counted in it
+	static constexpr float HISTOGRAM_BIN = 2.0f;
+	static const int HISTOGRAM_BINS = 32;
+
+private:
+	//timer queries in flight, a query is read back when its slot comes around again
+	static const int QUERY_FRAMES = 4;
+
+	std::chrono::steady_clock::time_point origin, frameStart, sectionStart;
+	FrameSection current = SECTION_PRESENT;
+	uint64_t frame = 0;
+	FrameRecord history[HISTORY_FRAMES];
+	FrameTimePercentiles percentiles;
+	float sectionMedians[SECTION_COUNT] = {};
+	uint64_t histogram[HISTOGRAM_BINS] = {};
+	std::deque<Stutter> stutters;
+	size_t stutterCount = 0;
+
+	GLuint queries[QUERY_FRAMES];
+	bool pending[QUERY_FRAMES] = { false };
+	uint64_t queryFrames[QUERY_FRAMES] = {};
+
+	GLuint graphVAO, graphVBO;
+
+	//the frames on their way to the log, which are only queued once their GPU time is known
+	LockFreeQueue<FrameRecord> logQueue;
+	std::thread writer;
+	std::atomic<bool> stopping{ false };
+	uint64_t dropped = 0;
+	std::ofstream log;
+
+	void finishFrame(FrameRecord& record);
+	void updatePercentiles();
+	bool readQuery(int slot);
+	void publish(const FrameRecord& record);
+	void writeLog();
+};
+
+#endif
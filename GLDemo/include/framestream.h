@@ -0,0 +1,70 @@
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+#include <glad/glad.h>
+
+#include <framereadback.h>
+#include <options.h>
+#include <threadpool.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//where to stream to, see StreamSettings::addOptions for the command line
+struct StreamSettings {
+	std::string address = "127.0.0.1"; //only this machine can watch unless the address is given
+	int port = 0;
+	int quality = 75; //of the JPEG frames, from 1 to 100
+
+	/*
+	Adds the stream options, nothing is streamed unless --stream is given:
+	  --stream [<address>:]<port>   serves the frames over HTTP, f.e. --stream 8080 for this machine or --stream 0.0.0.0:8080 for the network
+	  --stream-quality <1-100>
+	*/
+	void addOptions(Options& options);
+};
+
+class StreamServer;
+
+/*
+Serves the rendered frames as a Motion JPEG stream over HTTP, for secondary displays driven by thin clients, which only need a browser or
+a video player (http://<address>:<port>/ for a page with the stream, /stream for the stream itself and /frame.jpg for a single frame).
+The render thread only queues an asynchronous readback of every frame (see FrameReadback) and hands the frames that have arrived to the
+thread pool, which compresses them to JPEG. It never waits for either: a frame is dropped when every readback buffer is still busy or
+too many frames are being compressed already.
+Every viewer is sent the newest frame whenever it's ready for the next one, so a slow viewer skips frames instead of falling behind, and
+never holds up the others. Nothing is read back while no one is watching.
+*/
+class FrameStream {
+public:
+	FrameStream(const StreamSettings& settings, int width, int height, ThreadPool& pool);
+	//waits for the frames that are being compressed and disconnects every viewer
+	~FrameStream();
+	FrameStream(const FrameStream&) = delete;
+	FrameStream& operator=(const FrameStream&) = delete;
+
+	bool isOpen() const;
+	//reads back the frame that was just rendered into the first color attachment of the framebuffer, starting at x, y
+	void capture(GLuint framebuffer, int x = 0, int y = 0);
+
+private:
+	StreamSettings settings;
+	ThreadPool& pool;
+	FrameReadback readback;
+	std::unique_ptr<StreamServer> server;
+	uint64_t frame = 0;
+
+	//frames that are being compressed, finished frames are counted down from the thread pool
+	std::mutex mutex;
+	std::condition_variable condition;
+	int encoding = 0;
+	int maxEncoding;
+
+	void encode(uint64_t frame, const unsigned char* pixels);
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <glad/glad.h>
+
+/*
+OpenGL drivers don't check whether a call actually changes anything, so binding the same program, VAO or texture again still costs
+CPU time in the driver. Every bind and every piece of fixed-function state the renderer touches goes through here instead, which keeps a
+shadow copy of the current state and drops any call that wouldn't change it.
+This only works when nothing calls the GL functions directly behind its back, so always use these instead of the raw gl* versions.
+*/
+
+namespace GLState {
+	//number of texture units that are tracked, binds to higher units are always passed on to the driver
+	const GLuint MAX_TEXTURE_UNITS = 16;
+
+	//how many state changes were requested and how many of those could be skipped
+	struct Stats {
+		unsigned int calls = 0;
+		unsigned int elided = 0;
+	};
+
+	//forget all cached state, must be called whenever something else may have changed the state (f.e. after creating a new context)
+	void reset();
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vao);
+	//GL_ELEMENT_ARRAY_BUFFER bindings are stored per VAO, so they're only tracked for the currently bound VAO
+	void bindBuffer(GLenum target, GLuint buffer);
+	//glBindBufferBase also binds the buffer to the generic binding point of the target, so it's tracked as well
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	//the same goes for glBindBufferRange
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	void bindFramebuffer(GLenum target, GLuint framebuffer);
+	//GL_RENDERBUFFER is the only renderbuffer target, so there's no target argument
+	void bindRenderbuffer(GLuint renderbuffer);
+
+	void activeTexture(GLuint unit);
+	//binds a texture to the currently active texture unit
+	void bindTexture(GLenum target, GLuint texture);
+	//binds a texture to the given texture unit, only switching the active unit when the binding actually has to change
+	void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	//glEnable/glDisable for GL_DEPTH_TEST, GL_BLEND and GL_CULL_FACE, other capabilities are passed on to the driver as is
+	void enable(GLenum cap);
+	void disable(GLenum cap);
+	void depthFunc(GLenum func);
+	void depthMask(GLboolean flag);
+	void blendFunc(GLenum sfactor, GLenum dfactor);
+
+	//deleting an object resets every binding of it to 0, so the cache has to forget about it as well. The memory of textures, buffers and
+	//renderbuffers is released from GPUMemory along with them
+	void deleteTextures(GLsizei n, const GLuint* textures);
+	void deleteBuffers(GLsizei n, const GLuint* buffers);
+	void deleteVertexArrays(GLsizei n, const GLuint* arrays);
+	void deleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+	void deleteRenderbuffers(GLsizei n, const GLuint* renderbuffers);
+	void deleteProgram(GLuint program);
+
+	//counters since the last call to endFrame()
+	const Stats& frameStats();
+	//returns the counters of the frame that just ended and starts counting again from zero
+	Stats endFrame();
+}
+
+#endif
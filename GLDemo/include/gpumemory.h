@@ -0,0 +1,69 @@
+#ifndef GPUMEMORY_H
+#define GPUMEMORY_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+
+/*
+Keeps count of the video memory taken by every texture, buffer and renderbuffer the app allocates. The sizes are worked out from the
+dimensions and internal formats that are passed to OpenGL, so they're what the storage needs rather than what the driver actually reserves:
+drivers pad RGB textures to 4 bytes per pixel (which is counted as such here), align rows and add space for compression metadata of their
+own, so the real usage is a bit higher. Every allocation goes into a category, and is forgotten again when GLState deletes its object.
+Whenever the total goes over the budget a warning is printed once, until it's back under it. Drivers that have GL_NVX_gpu_memory_info or
+GL_ATI_meminfo also report how much memory is left on the GPU, which includes everything other programs and the driver itself use.
+Only the render thread may call these, like any other GL function.
+*/
+
+namespace GPUMemory {
+	enum Category {
+		MEMORY_TEXTURES, //the streamed textures of the planetoids and the solid colors
+		MEMORY_SKYBOX, //cubemaps
+		MEMORY_VIRTUAL_TEXTURES, //page caches, page tables and the feedback buffer
+		MEMORY_ATMOSPHERES, //the scattering tables
+		MEMORY_MODELS, //vertices and indices of the models, orbits and the minor planets
+		MEMORY_FRAMEBUFFERS, //attachments and the screen quad
+		MEMORY_HUD, //the glyphs of the font and the buffers of the text and graph
+		MEMORY_BUFFERS, //uniform buffers, the upload ring and readbacks
+		MEMORY_CATEGORY_COUNT
+	};
+
+	const char* categoryName(Category category);
+
+	//bytes taken by an image of the given internal format, compressed formats are stored in whole 4x4 blocks
+	size_t imageSize(GLenum internalFormat, int width, int height, int depth = 1);
+
+	//records an image of a texture, replacing what was recorded for the same level before. target is the target the image was allocated
+	//with, so every face of a cubemap is counted on its own. Array layers and 3D slices are counted through the depth
+	void texture(GLuint texture, GLenum target, Category category, GLenum internalFormat, int width, int height, int depth = 1, int level = 0);
+	//records the levels that glGenerateMipmap allocates below level 0 of every face
+	void mipmaps(GLuint texture);
+	//records the store of a buffer, replacing the one that was recorded for it before
+	void buffer(GLuint buffer, Category category, size_t bytes);
+	void renderbuffer(GLuint renderbuffer, Category category, GLenum internalFormat, int width, int height);
+
+	//called by GLState whenever objects are deleted
+	void releaseTextures(GLsizei n, const GLuint* textures);
+	void releaseBuffers(GLsizei n, const GLuint* buffers);
+	void releaseRenderbuffers(GLsizei n, const GLuint* renderbuffers);
+
+	size_t total();
+	size_t total(Category category);
+
+	//0 turns the warning off
+	void setBudget(size_t bytes);
+	size_t getBudget();
+	bool overBudget();
+
+	//the memory that's still free on the GPU and the memory it has, in bytes. Returns false when the driver has no way of telling, and
+	//dedicated is 0 when it only tells what's free
+	bool queryDriver(size_t& available, size_t& dedicated);
+
+	//a single line with the total, the largest categories and what the driver reports, for the HUD
+	std::string summary();
+	//prints every category with the number of objects in it, the budget and what the driver reports
+	void report();
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+A zlib stream compressed with a small deflate encoder (fixed Huffman codes with greedy LZ77 matching), which compresses renders of space,
+that are mostly black, to a fraction of their size while being fast enough to keep up with rendering when every image is written on a
+worker thread of its own. Data is compressed in blocks as it comes in, and matches are only searched within a block.
+*/
+class Deflater {
+public:
+	Deflater();
+
+	//adds data to the stream
+	void write(const uint8_t* data, size_t size);
+	//compresses the rest of the data and ends the stream with its checksum
+	void finish();
+	//the compressed bytes so far, which can be taken out at any time
+	std::vector<uint8_t>& output();
+
+private:
+	//data waiting to be compressed into the next block
+	std::vector<uint8_t> pending;
+	//whole bytes of the compressed stream
+	std::vector<uint8_t> compressed;
+	uint64_t bitBuffer = 0;
+	int bitCount = 0;
+	uint32_t adler = 1;
+	std::vector<int> head, previous;
+
+	void writeBits(uint32_t bits, int count);
+	void compressBlock(bool final);
+};
+
+/*
+Writes an 8 bit RGB or RGBA PNG file a few rows at a time, so images far larger than memory can be written while they're being made.
+Every writer is independent of the others, so any number of them can be used on different threads at once.
+*/
+class PngWriter {
+public:
+	//channels is 3 for RGB or 4 for RGBA
+	PngWriter(const std::string& path, int width, int height, int channels = 3);
+	~PngWriter();
+	PngWriter(const PngWriter&) = delete;
+	PngWriter& operator=(const PngWriter&) = delete;
+
+	bool isOpen() const;
+	//appends rows from top to bottom, stride is the distance in bytes from one row to the next, which is negative for bottom-up images
+	void writeRows(const unsigned char* first, int rows, ptrdiff_t stride);
+	//finishes the file once all rows have been written, returns false when anything couldn't be written
+	bool close();
+
+private:
+	FILE* file = nullptr;
+	int width, height, channels;
+	int rowsWritten = 0;
+	bool failed = false;
+	Deflater deflater;
+	//a row with its filter byte
+	std::vector<uint8_t> row;
+
+	void writeChunk(const char* type, const uint8_t* data, size_t size);
+	//writes the compressed rows as IDAT chunks
+	void flushChunks();
+};
+
+/*
+Writes a tiled TIFF file one tile at a time, so images that are far larger than memory can be written while they're being rendered a tile at
+a time, without ever holding more than a few tiles. Tiles are compressed on their own with deflate, and can be compressed on any thread before
+they're added to the file. Images that could grow past 4 GB are written as BigTIFF.
+*/
+class TiffWriter {
+public:
+	//tileSize must be a multiple of 16, tiles along the right and bottom edge are padded up to the full size
+	TiffWriter(const std::string& path, int width, int height, int tileSize, int channels = 3);
+	~TiffWriter();
+	TiffWriter(const TiffWriter&) = delete;
+	TiffWriter& operator=(const TiffWriter&) = delete;
+
+	bool isOpen() const;
+	int getColumns() const;
+	int getRows() const;
+	//compresses a tile from its rows of tileSize pixels, stride is the distance in bytes from one row to the next like for PngWriter::writeRows
+	std::vector<uint8_t> compressTile(const unsigned char* first, ptrdiff_t stride) const;
+	//appends a compressed tile to the file, tiles are numbered from left to right and from top to bottom and can be added in any order
+	void writeTile(int index, const std::vector<uint8_t>& compressed);
+	//writes the directory of the tiles once all of them have been added, returns false when anything couldn't be written
+	bool close();
+
+private:
+	FILE* file = nullptr;
+	int width, height, tileSize, channels;
+	bool big;
+	bool failed = false;
+	uint64_t offset;
+	std::vector<uint64_t> offsets, sizes;
+};
+
+//writes a whole image at once, bottomUp is set for images read back from OpenGL
+bool writePng(const std::string& path, int width, int height, int channels, const unsigned char* pixels, bool bottomUp);
+
+/*
+Compresses an 8 bit RGB image into a baseline JPEG file in memory, with 4:2:0 chroma subsampling and the standard Huffman tables, which is
+quick enough to compress a frame of a stream on a worker thread every frame. quality goes from 1 to 100 like in most image editors, stride
+is the distance in bytes from one row to the next like for PngWriter::writeRows.
+*/
+std::vector<uint8_t> encodeJpeg(int width, int height, const unsigned char* first, ptrdiff_t stride, int quality);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef LENSFLARE_H
+#define LENSFLARE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <shader_m.h>
+
+//amount of sprites the flare consists of, must match the size of the sprite tables in flare_vs.glsl
+const int FLARE_SPRITES = 8;
+
+/*
+Draws the glare around the Sun and a lens flare across the screen, whose intensity depends on how much of the Sun is visible.
+The visibility is measured on the GPU with an occlusion query: a disc in front of the Sun is drawn with depth testing against the scene, and
+the samples that pass are divided by the area the whole disc covers on screen, which is worked out on the CPU. Parts of the Sun that are
+off screen are never counted, so the flare fades as the Sun leaves the screen. The query results are read back a few frames later, so the CPU
+never has to wait for the GPU to finish rendering the current frame.
+*/
+class LensFlare {
+public:
+	LensFlare();
+	~LensFlare();
+
+	//issues the occlusion queries for the Sun, must be called after all planetoids have been drawn so they're in the depth buffer.
+	//viewportSize is the size of the view in pixels
+	void testVisibility(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const glm::vec2& viewportSize, const glm::vec3& sunPos,
+		float sunRadius, const glm::vec3& viewPos);
+	//draws the glare and the flare on top of the scene, tile moves it into a tile of a larger image (see PosterExport::getTileTransform)
+	void draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& sunPos, float aspect,
+		const glm::vec4& tile = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f));
+
+	//fraction of the Sun that was visible, a few frames ago
+	float getVisibility() const;
+
+private:
+	//amount of frames the queries are kept in flight before their results are read
+	static const int QUERY_FRAMES = 3;
+	//points around the edge of the disc that its area on screen is measured with
+	static const int OUTLINE_POINTS = 32;
+
+	GLuint visibleQueries[QUERY_FRAMES];
+	GLuint totalQueries[QUERY_FRAMES];
+	bool pending[QUERY_FRAMES] = { false };
+	//samples the whole disc covers on screen in each slot, 0 when it crosses the plane of the camera and the total query is used instead
+	float discSamples[QUERY_FRAMES] = {};
+	int frame = 0;
+	float visibility = 0.0f;
+
+	GLuint quadVAO, quadVBO;
+
+	void readResults(int slot);
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+A bounded queue that any number of threads can push to and pop from at the same time without taking a lock, used to hand work between
+worker threads and the render thread without the render thread ever having to wait on a mutex.
+Every slot carries a sequence number that tells whether it's ready to be written or read in the current lap around the ring, so a
+producer and a consumer only ever compete for the same counter and never for the same slot (see Dmitry Vyukov's bounded MPMC queue).
+The capacity is rounded up to a power of two. push() and pop() never block, they return false when the queue is full or empty.
+*/
+template<typename T>
+class LockFreeQueue {
+public:
+	LockFreeQueue(size_t capacity) {
+		size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+		mask = size - 1;
+		slots = std::vector<Slot>(size);
+		for (size_t i = 0; i < size; i++)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	LockFreeQueue(const LockFreeQueue&) = delete;
+	LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+	bool push(const T& value) {
+		size_t pos = tail.load(std::memory_order_relaxed);
+		Slot* slot;
+		for (;;) {
+			slot = &slots[pos & mask];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+			if (diff == 0) {
+				//the slot is free in this lap, claim it by moving the tail past it
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				//the slot still holds a value from the previous lap, so the queue is full
+				return false;
+			} else {
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+		slot->value = value;
+		slot->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& value) {
+		size_t pos = head.load(std::memory_order_relaxed);
+		Slot* slot;
+		for (;;) {
+			slot = &slots[pos & mask];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+			if (diff == 0) {
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				//nothing has been written to the slot in this lap yet, so the queue is empty
+				return false;
+			} else {
+				pos = head.load(std::memory_order_relaxed);
+			}
+		}
+		value = slot->value;
+		//mark the slot as free for the next lap
+		slot->sequence.store(pos + mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T value;
+
+		Slot() : sequence(0), value() {}
+		Slot(const Slot& other) : sequence(other.sequence.load()), value(other.value) {}
+	};
+
+	std::vector<Slot> slots;
+	size_t mask;
+	//keep the counters on separate cache lines so producers and consumers don't slow each other down
+	alignas(64) std::atomic<size_t> head{ 0 };
+	alignas(64) std::atomic<size_t> tail{ 0 };
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef MESHBUFFER_H
+#define MESHBUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+//every vertex of a model holds data for its position, normals, texture coordinates, and (bi)tangents
+struct Vertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::vec2 TexCoords;
+	glm::vec3 Tangent;
+	glm::vec3 Bitangent;
+};
+
+//where the vertices and indices of a mesh are in the shared buffers, indices are relative to baseVertex
+struct MeshAllocation {
+	GLint baseVertex = 0;
+	GLuint firstIndex = 0;
+	GLsizei vertexCount = 0;
+	GLsizei indexCount = 0;
+};
+
+/*
+A single vertex buffer and index buffer shared by all meshes with the Vertex format, along with the one VAO that reads from them.
+Meshes are sub-allocated from the buffers and drawn with glDrawElementsBaseVertex, so drawing any number of meshes never needs another
+VAO to be bound. The buffers start out small and double in size when they run out of space, the contents are copied over on the GPU.
+Space of freed meshes is reused by later ones.
+*/
+class MeshBuffer {
+public:
+	MeshBuffer();
+	~MeshBuffer();
+	MeshBuffer(const MeshBuffer&) = delete;
+	MeshBuffer& operator=(const MeshBuffer&) = delete;
+
+	MeshAllocation allocate(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
+	void free(const MeshAllocation& mesh);
+
+	//the VAO that has to be bound to draw the meshes
+	GLuint getVAO() const;
+
+private:
+	//first fit allocator over a range of elements, free ranges are merged with their neighbours
+	struct Ranges {
+		size_t capacity = 0;
+		std::map<size_t, size_t> free; //size of every free range by its first element
+
+		bool allocate(size_t count, size_t& first);
+		void release(size_t first, size_t count);
+		void grow(size_t newCapacity);
+	};
+
+	GLuint VAO = 0, VBO = 0, EBO = 0;
+	Ranges vertexRanges, indexRanges;
+
+	void setupVertexArray();
+	//replaces a buffer with a larger one holding the same contents
+	void growBuffer(GLuint& buffer, Ranges& ranges, size_t elementSize, size_t needed);
+};
+
+#endif
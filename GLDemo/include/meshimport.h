@@ -0,0 +1,24 @@
+#ifndef MESHIMPORT_H
+#define MESHIMPORT_H
+
+#include <model.h>
+
+#include <string>
+
+/*
+Importers for the model formats we ship (Wavefront .obj and 3D Studio .3ds), which are a lot faster than going through Assimp.
+The file is memory mapped and parsed in place, numbers are parsed 8 digits at a time, and the vertices and indices are written straight
+into the meshes of the ModelData, after which the tangents of every mesh are calculated in a single pass over its triangles.
+The results match what Assimp returns with the flags used by Model::import: the meshes are triangulated, texture coordinates are flipped,
+missing normals are smoothed over every face that shares a position, and the meshes end up in the space of the first one (see model.h).
+The objects of 3DS files are placed with the matrix they were saved with, the keyframer isn't read.
+Nothing in here calls OpenGL, so it can run on any thread.
+*/
+
+//returns false when the format isn't one of ours or the file can't be read, the caller then falls back to Assimp
+bool importNative(const std::string& path, ModelData& data);
+
+//calculates the tangents and bitangents of a mesh from its positions, texture coordinates and normals
+void calculateTangents(ModelData::Mesh& mesh);
+
+#endif
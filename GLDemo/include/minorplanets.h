@@ -0,0 +1,74 @@
+#ifndef MINORPLANETS_H
+#define MINORPLANETS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <shader_m.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+The orbits of a catalog of asteroids, with an array for every orbital element rather than a struct for every body, so the parser can
+write every element straight into place and the renderer can upload each of them as a vertex attribute of its own.
+The elements are heliocentric and relative to the ecliptic and equinox of J2000, angles are in radians.
+*/
+struct MinorPlanetCatalog {
+	std::vector<float> semiMajorAxis; //in AU
+	std::vector<float> eccentricity;
+	std::vector<float> inclination;
+	std::vector<float> ascendingNode; //longitude of the ascending node
+	std::vector<float> perihelion; //argument of perihelion
+	std::vector<float> meanAnomaly; //at J2000, every body is moved there from the epoch of its elements
+	std::vector<float> meanMotion; //per day
+	std::vector<float> magnitude; //absolute magnitude H, lower is brighter
+	//the packed designation of every body (columns 1 to 7 of the record), only used to name the bodies and never uploaded
+	std::vector<uint64_t> designation;
+
+	size_t size() const;
+	void resize(size_t count);
+	//f.e. (433) for a numbered body, bodies that only have a provisional designation are named by the packed one (K25A00A)
+	std::string name(size_t index) const;
+
+	/*
+	Loads a catalog in the fixed width format of MPCORB.DAT from the Minor Planet Center (the full catalog has well over a million bodies,
+	and extracts like NEA.txt work as well). The file is memory mapped and split into a chunk per core: the chunks first count their
+	records, after which every chunk knows where its records go and parses them straight into the arrays. Numbers are read with the
+	parsers of textfile.h, 8 digits at a time.
+	The arrays are cached in binary, which is loaded instead for as long as the catalog doesn't change. Doesn't call OpenGL.
+	*/
+	static bool load(const std::string& path, MinorPlanetCatalog& catalog);
+};
+
+/*
+Draws every body of a catalog as a point, on the GPU: the elements are uploaded once, and every frame the vertex shader solves Kepler's
+equation for every body to find where it is at the current time. Nothing is uploaded per frame.
+The scene isn't to scale, so distances are mapped from AU to the scene by interpolating between the orbits of the planets (see setScale).
+*/
+class MinorPlanets {
+public:
+	MinorPlanets(const MinorPlanetCatalog& catalog);
+	~MinorPlanets();
+	MinorPlanets(const MinorPlanets&) = delete;
+	MinorPlanets& operator=(const MinorPlanets&) = delete;
+
+	//the distance of the orbit of every planet in AU (x) and in the scene (y), from the Sun outward, up to MAX_SCALE_POINTS of them
+	void setScale(const std::vector<glm::vec2>& orbits);
+	//draws the bodies where they are the given amount of days after J2000, points are pointScale pixels wide for the brightest ones
+	void draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& sunPos, double days, float pointScale = 1.0f);
+	//where draw puts a body of the catalog the bodies were uploaded from, the same math as minorplanet_vs.glsl but on the CPU
+	glm::vec3 position(const MinorPlanetCatalog& catalog, size_t index, const glm::vec3& sunPos, double days) const;
+
+	static const int MAX_SCALE_POINTS = 8;
+
+private:
+	GLuint VAO, VBO;
+	GLsizei count;
+	std::vector<glm::vec2> scale;
+
+	float sceneDistance(float distance) const;
+};
+
+#endif
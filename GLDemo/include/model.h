@@ -10,49 +10,78 @@
 #include <assimp/postprocess.h>
 
 #include <shader_m.h>
+#include <meshbuffer.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <vector>
 
 //define all possible texture types
 enum TexType { TEX_DIFFUSE, TEX_NORMAL, TEX_SPECULAR };
 
-//every vertex of a model holds data for its position, normals, texture coordinates, and (bi)tangents
-struct Vertex {
-	glm::vec3 Position;
-	glm::vec3 Normal;
-	glm::vec2 TexCoords;
-	glm::vec3 Tangent;
-	glm::vec3 Bitangent;
-};
+class VirtualTexture;
+struct TextureResource;
 
 //every texture will contain the texture data in the id-variable and its type in the type-variable
+//for virtual textures the id is their page table, and the rest of the virtual texture is bound through virtualTexture (see virtualtexture.h)
+//textures loaded through Resources keep their resource alive as long as the texture is used (see resources.h)
 struct Texture {
 	GLuint id;
 	TexType type;
+	VirtualTexture* virtualTexture = nullptr;
+	std::shared_ptr<TextureResource> resource;
+
+	//flat normal maps are dropped by the texture streamer once they've been decoded, those are skipped when drawing
+	bool isDiscarded() const;
+};
+
+//the meshes of a model file as they're read from disk, before anything is uploaded. Every material of the file gets a mesh of its own,
+//but the materials themselves aren't kept as every planetoid is drawn with the textures it's given
+struct ModelData {
+	struct Mesh {
+		std::vector<Vertex> vertices;
+		std::vector<GLuint> indices;
+	};
+	std::vector<Mesh> meshes;
+	float boundingRadius = 0.0f;
 };
 
+/*
+A model file with all of its meshes. The node hierarchy is flattened on import: the transforms of the nodes are applied to the vertices, so
+every mesh ends up in the space of the model and the whole model is placed with a single model matrix. That space is the one of the first
+mesh, which keeps the axes it was modelled in, and the other meshes are placed around it. This undoes the rotation from Z up to Y up that
+assimp gives 3DS files and the placement of their objects, so the planetoids are oriented the way their textures and rotations expect.
+The vertices and indices of the meshes live in the shared buffers of a MeshBuffer, which has to outlive the model.
+*/
 class Model
 {
 public:
 	//needs to be initialized with a filepath to the 3D model
-	Model(std::string const &path);
+	Model(std::string const &path, MeshBuffer& meshes);
+	//uploads a model that was imported already
+	Model(ModelData data, MeshBuffer& meshes);
+
+	//reads a model file without calling OpenGL, so it can run on a worker thread
+	static ModelData import(std::string const &path);
 	~Model();
+	//the meshes are freed along with the model, so it can't be copied
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
 
-	// draws the model
-	void Draw(const Shader& shader, const std::vector<Texture>* textures);
+	// draws all meshes of the model with the same textures, with more than one instance every mesh is drawn that many times (f.e. once per eye)
+	void Draw(const Shader& shader, const std::vector<Texture>* textures, GLsizei instances = 1);
+	//distance from the model origin to its furthest vertex, used to get the world space size of a scaled model
+	float getBoundingRadius() const;
+	//bytes taken in the vertex and index buffers
+	size_t getMemoryUsage() const;
 
 private:
-	GLuint VAO, VBO, EBO;
-	std::vector<Vertex> vertices;
-	std::vector<GLuint> indices;
-
-	void loadModel(std::string const &path);
-	void processMesh(aiMesh *mesh, const aiScene *scene);
-	void setupMesh();
+	MeshBuffer& meshes;
+	std::vector<MeshAllocation> submeshes;
+	float boundingRadius = 0.0f;
 };
 #endif
\ No newline at end of file
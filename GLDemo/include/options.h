@@ -0,0 +1,26 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <functional>
+#include <map>
+#include <string>
+
+/*
+The command line is a list of "--option value" pairs. Every module adds the options it reads to a single Options, which goes through the
+command line once and hands each value to the option it belongs to. Options that nobody added, options without a value and values that an
+option rejects are all reported here, and make parse() fail so a mistyped export doesn't quietly open the interactive window instead.
+*/
+class Options {
+public:
+	//gets the value of the option, returns false when the value is invalid after printing why
+	typedef std::function<bool(const std::string& value)> Handler;
+
+	void add(const std::string& name, Handler handler);
+	//returns false when any option is unknown, misses its value or has an invalid one
+	bool parse(int argc, char** argv);
+
+private:
+	std::map<std::string, Handler> handlers;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef ORBITS_H
+#define ORBITS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <shader_m.h>
+#include <planetoid.h>
+
+#include <vector>
+
+/*
+Draws the orbit of every planetoid as a line loop around its parent.
+The vertices of all orbits are generated once relative to the center of their parent and stored in a single static VBO, together with the
+index of the orbit they belong to. Every frame only the centers of the parents are updated in a buffer texture, which the vertex shader
+adds to each vertex, so orbits of moons follow their moving parent without ever re-uploading the vertices. All orbits are then drawn with
+a single glMultiDrawArrays call, and a geometry shader turns the lines into quads with a constant width in pixels.
+*/
+class Orbits {
+public:
+	Orbits(Planetoid* root, int segments = 256);
+	~Orbits();
+
+	//updates the centers of the orbits, must be called after the planetoids have moved this frame
+	void update();
+	void draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos, const glm::vec2& viewportSize);
+
+private:
+	GLuint VAO, VBO;
+	GLuint centerBuffer, centerTex;
+	//the parent of every orbit, whose position is the center of that orbit
+	std::vector<Planetoid*> parents;
+	std::vector<glm::vec4> centers;
+	std::vector<GLint> firsts;
+	std::vector<GLsizei> counts;
+
+	void addOrbits(Planetoid* parent, int segments, std::vector<glm::vec4>& vertices);
+};
+
+#endif
@@ -4,27 +4,85 @@
 #include <glad/glad.h>
 
 #include <model.h>
+#include <resources.h>
+#include <atmosphere.h>
 
 using namespace std;
 
+//features of the sphere shader variants, in the same order as they're passed to the ShaderVariants of the sphere shader
+enum SphereFeature {
+	SPHERE_NORMAL_MAP = 1 << 0,
+	SPHERE_SPECULAR_MAP = 1 << 1,
+	SPHERE_EMISSIVE = 1 << 2,
+	SPHERE_VIRTUAL_DIFFUSE = 1 << 3,
+	SPHERE_VIRTUAL_NORMAL = 1 << 4,
+	SPHERE_VIRTUAL_SPECULAR = 1 << 5,
+	SPHERE_STEREO = 1 << 6
+};
+
+//maximum amount of occluding spheres per planetoid, must match MAX_OCCLUDERS in sphere_fs.glsl
+const int MAX_OCCLUDERS = 4;
+//texture unit for the atmosphere lookup tables, placed after the units used by the diffuse, normal and specular maps
+const GLuint ATMOSPHERE_TEXTURE_UNIT = 3;
+//first texture unit of the page caches of virtual textures, one unit for every compressed format (see VirtualTextures)
+const GLuint VIRTUAL_CACHE_TEXTURE_UNIT = 4;
+//maximum amount of virtual textures per planetoid, must match MAX_VIRTUAL_MAPS in vtfeedback_fs.glsl
+const int MAX_VIRTUAL_MAPS = 3;
+
+//how a planetoid moves, which is advanced by the Simulation on its own thread
+struct PlanetoidMotion {
+	float orbitRadius, orbitSpeed, rotationSpeed, size;
+	bool orbiting; //planetoids that aren't lit (the Sun) only spin around their own axis
+};
+
 class Planetoid {
 public:
+	//where the planetoid is in the snapshot of the simulation that's being drawn
 	glm::vec3 position;
-	bool turning;
 
-	Planetoid(Model* model, const glm::vec3& startingPos, const vector<Texture>* textures, float radius, float size, float orbitSpeed, float rotationSpeed, bool light);
+	Planetoid(ModelHandle model, const glm::vec3& startingPos, const vector<Texture>& textures, float radius, float size, float orbitSpeed, float rotationSpeed, bool light);
 
-	void Draw(const Shader& shader, float& deltaTime, glm::vec3& origin, bool turning);
+	//draws this planetoid where the simulation last put it, the planetoids of a frame are drawn through a DrawList (see scene.h)
+	//with two eyes both are drawn at once with the stereo variant of the shader (see stereo.h)
+	void Draw(ShaderVariants& shaders, int eyes = 1);
+	//starts compiling the shader variants used by this planetoid and all its children, so they're ready by the time they're drawn
+	void prepareShaders(ShaderVariants& shaders, int eyes = 1);
 	void addPlanetoid(Planetoid* planet);
+	//register a planetoid that can eclipse this one by blocking the light of the Sun
+	void addOccluder(Planetoid* occluder);
+	//let a ring planetoid cast its shadow onto this planetoid, innerRatio is the inner edge of the ring relative to its outer edge
+	void setRingShadow(Planetoid* ring, float innerRatio, float opacity);
+	void setAtmosphere(Atmosphere* atmosphere);
+	//draws the atmosphere shell of this planetoid, called after all planetoids and the skybox have been drawn
+	void DrawAtmosphere(const Shader& shader, int eyes = 1);
+	//draws this planetoid into the feedback buffer of the virtual textures, see VirtualTextures::beginFeedback
+	void DrawFeedback(const Shader& shader);
+
+	//world space radius of the planetoid
+	float getRadius() const;
+	glm::mat4 getModelMatrix() const;
+	//called by the render thread with the transform of the newest snapshot of the simulation, see Simulation::apply
+	void setModelMatrix(const glm::mat4& model);
+	PlanetoidMotion getMotion() const;
+	//distance between the center of the planetoid and the center of its parent
+	float getOrbitRadius() const;
+	const vector<Planetoid*>& getChildren() const;
 
 private:
 	float orbitSpeed, rotationSpeed, radius, size;
-	glm::mat4 planetTrans;
-	glm::mat4 planetRot;
-	glm::mat4 planetScale;
+	glm::mat4 model;
 	bool light;
-	Model* base;
-	const vector<Texture>* textures;
+	ModelHandle base;
+	vector<Texture> textures;
 	vector<Planetoid*> children;
+	vector<Planetoid*> occluders;
+	Planetoid* ring = nullptr;
+	float ringInnerRatio = 0.0f;
+	float ringOpacity = 0.0f;
+	Atmosphere* atmosphere = nullptr;
+
+	void setShadowUniforms(const Shader& shader);
+	//picks the sphere shader variant from the textures this planetoid actually has
+	unsigned int getVariant() const;
 };
 #endif
\ No newline at end of file
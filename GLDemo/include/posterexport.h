@@ -0,0 +1,73 @@
+#ifndef POSTEREXPORT_H
+#define POSTEREXPORT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <framereadback.h>
+#include <imagewriter.h>
+#include <threadpool.h>
+#include <videoexport.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+/*
+Renders a single frame at a size far beyond the largest framebuffer, f.e. 32768x16384 for a printed poster, by drawing it one tile at a
+time. Every tile is drawn with the projection of the whole poster narrowed down to its own part of the poster (see getTileProjection), so
+the tiles line up exactly, and it's written into a tiled TIFF file as soon as it's been read back and compressed. The poster is never held
+in memory as a whole.
+Anything that's placed in screen space instead of through the projection, like the lens flare, must be moved with getTileTransform and
+sized with getPixelScale, or it would start over in every tile.
+Before the first tile the whole poster is drawn at the size of a tile, which is when everything that's measured over the whole view (the
+visibility of the Sun) has to be measured, see isTiling.
+*/
+class PosterExport {
+public:
+	PosterExport(const ExportSettings& settings, ThreadPool& pool);
+	//waits until every tile has been written
+	~PosterExport();
+	PosterExport(const PosterExport&) = delete;
+	PosterExport& operator=(const PosterExport&) = delete;
+
+	bool isOpen() const;
+	//whether every tile has been captured
+	bool isDone() const;
+	//whether a tile is being drawn, rather than the whole poster at the size of a tile
+	bool isTiling() const;
+	//size of the framebuffer the tiles are drawn into
+	int getTileSize() const;
+	//aspect ratio of the whole poster
+	float getAspect() const;
+	//how many pixels of the poster there are for every pixel of a window of the given height, to scale sizes given in pixels
+	float getPixelScale(int windowHeight) const;
+	//maps the normalized device coordinates of the whole poster to those of the current tile, as a scale in XY and an offset in ZW
+	glm::vec4 getTileTransform() const;
+	//the projection of the whole poster narrowed down to the current tile
+	glm::mat4 getTileProjection(const glm::mat4& projection) const;
+	//reads back the tile that was just rendered into the first color attachment of the framebuffer, and moves on to the next tile
+	void capture(GLuint framebuffer);
+	//collects the remaining readbacks and writes the file, returns false when it couldn't be written
+	bool finish();
+
+private:
+	ExportSettings settings;
+	ThreadPool& pool;
+	FrameReadback readback;
+	std::unique_ptr<TiffWriter> writer;
+	int tile = -1;
+	int tiles;
+	bool finished = false;
+	bool failed = false;
+
+	//tiles that have been read back but aren't written yet, the render thread waits when there are too many of them
+	std::mutex mutex;
+	std::condition_variable condition;
+	int writing = 0;
+	int maxWriting;
+
+	void write(uint64_t index, const unsigned char* pixels);
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <model.h>
+#include <meshbuffer.h>
+#include <shader_m.h>
+#include <texturestreamer.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+//a texture loaded through Resources, its GL texture is deleted when the last handle to it goes away
+struct TextureResource {
+	GLuint id;
+	GLenum target;
+	//the image was flat and the streamer dropped it (see TextureStreamer::load), the texture only holds its placeholder and shouldn't be used
+	bool discarded = false;
+
+	//textures without a streamer are deleted directly
+	TextureResource(GLuint id, GLenum target, TextureStreamer* streamer);
+	~TextureResource();
+	TextureResource(const TextureResource&) = delete;
+	TextureResource& operator=(const TextureResource&) = delete;
+
+	//bytes of video memory taken by every level and face of the texture that's currently allocated
+	size_t getMemoryUsage() const;
+
+private:
+	TextureStreamer* streamer;
+};
+
+//handles to shared resources, the resource is released together with the last handle
+typedef std::shared_ptr<Model> ModelHandle;
+typedef std::shared_ptr<TextureResource> TextureHandle;
+typedef std::shared_ptr<Shader> ShaderHandle;
+
+//how a texture is created, textures loaded from the same file with different parameters are separate resources
+struct TextureParams {
+	glm::vec3 placeholder = glm::vec3(0.5f); //the color shown while the image is streaming in
+	bool mipmaps = true;
+	GLenum wrap = GL_REPEAT;
+	bool discardFlat = false; //drop the image when it's a single color, see TextureResource::discarded
+};
+
+/*
+Loads models, textures and shaders once and shares them between everyone who asks for the same one. Resources are looked up by the canonical
+path of their files together with the parameters they're created with, so "./bin/models/../models/rock.obj" finds the rock that's already loaded.
+Only weak references are kept here: a resource lives exactly as long as one of its handles does, so whatever isn't used anymore is freed on
+the spot instead of piling up, and loading it again afterwards simply loads it from disk again.
+The TextureStreamer has to outlive every texture handle, as the textures are released through it. All models are stored in a single MeshBuffer
+owned by the resources, so the resources have to outlive every model handle.
+*/
+class Resources {
+public:
+	Resources(TextureStreamer& streamer);
+
+	//a model that was already imported with Model::import on another thread can be passed along, it's dropped when the model is loaded already
+	ModelHandle model(const std::string& path, ModelData* imported = nullptr);
+	//streams the image into a 2D texture, see TextureStreamer
+	TextureHandle texture(const std::string& path, const TextureParams& params = TextureParams());
+	//streams six images into the faces of a cubemap, in the order +X, -X, +Y, -Y, +Z, -Z
+	TextureHandle cubemap(const std::vector<std::string>& faces, const TextureParams& params = TextureParams());
+	//a 1x1 texture of a single color
+	TextureHandle solidTexture(const glm::vec3& color);
+	ShaderHandle shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::vector<std::string>& defines = {});
+
+	//prints every live resource with its memory usage and the number of handles to it
+	void report();
+
+private:
+	TextureStreamer& streamer;
+	MeshBuffer meshes;
+	std::map<std::string, std::weak_ptr<Model>> models;
+	std::map<std::string, std::weak_ptr<TextureResource>> textures;
+	std::map<std::string, std::weak_ptr<Shader>> shaders;
+
+	TextureHandle createTexture(const std::string& key, GLenum target, const std::vector<std::string>& paths, const TextureParams& params);
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+
+#include <planetoid.h>
+
+#include <vector>
+
+//a planetoid as it's drawn this frame
+struct DrawItem {
+	Planetoid* planetoid;
+	glm::vec3 center;
+	float radius; //of a sphere around the planetoid and its atmosphere shell
+};
+
+/*
+A camera together with the rectangle of the framebuffer it's drawn into. A frame can be drawn from several views, f.e. the main camera
+with close-ups of a few planetoids and a map of the orbits on top of it. Every view gets its own slot in the Frame uniform block
+(see FrameUniforms) and its own list of visible planetoids, everything else is shared.
+*/
+struct View {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 position;
+	//in pixels of the framebuffer, from the bottom left
+	int x, y, width, height;
+	//only the main view measures the visibility of the Sun for the lens flare and records the pages of the virtual textures it needs
+	bool main = false;
+	//orthographic views don't get the skybox and the atmospheres, which both need rays that start at the eye
+	bool perspective = true;
+	//the items of the draw list inside the frustum of the view, see DrawList::cull
+	std::vector<const DrawItem*> visible;
+};
+
+/*
+The planetoids to draw this frame in the order they're drawn in, which is built once per frame after the planetoids have been moved to the
+newest snapshot of the simulation (see Simulation::apply). Every view then only picks out the planetoids it can see, so drawing a frame from
+more views doesn't walk the planetoid tree or move anything again.
+*/
+class DrawList {
+public:
+	void build(Planetoid* root);
+	//fills the visible items of the view with those whose bounding spheres are at least partly inside its frustum
+	void cull(View& view) const;
+	const std::vector<DrawItem>& getItems() const;
+
+private:
+	std::vector<DrawItem> items;
+
+	void add(Planetoid* planet);
+};
+
+//a perspective view of a planetoid from the given direction, at a distance where the planetoid fills about half of the view
+View followView(const Planetoid& target, const glm::vec3& direction, int x, int y, int width, int height);
+//a top down orthographic view of the orbital plane, showing everything within extent of the center
+View mapView(const glm::vec3& center, float extent, int x, int y, int width, int height);
+
+#endif
@@ -8,16 +8,37 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
 
+/*
+A linked shader program. The sources are run through a small preprocessor first, which resolves #include "file" directives and adds a
+#define for every entry in defines, so a single source file can be compiled into several specialized variants (see ShaderVariants).
+Linked programs are cached on disk with glGetProgramBinary, keyed by the hash of their sources and the driver, and loaded back with
+glProgramBinary on later launches. Programs that aren't cached are compiled and linked without waiting for the result, so when the driver
+supports parallel shader compilation all programs compile at the same time. The compile status is only checked the first time the program
+is used, or when finish() is called.
+*/
 class Shader
 {
 public:
 	unsigned int ID;
 
-	Shader(const char * vertexPath, const char * fragmentPath);
+	Shader(const char * vertexPath, const char * fragmentPath, const char * geometryPath = nullptr, const std::vector<std::string>& defines = {});
+	~Shader();
+	// the program is deleted along with the shader, so it can't be copied
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
 
 	// activate the shader
 	void use();
+	// returns whether the driver is done compiling and linking, never blocks
+	bool isReady() const;
+	// waits for compiling and linking to finish, checks for errors and stores the program in the cache
+	void finish();
+	// size of the linked program binary in bytes, 0 while it's still being compiled or when the driver can't retrieve binaries
+	size_t getBinarySize() const;
 	// utility uniform functions
 	void setBool(const std::string &name, bool value) const;
 	void setInt(const std::string &name, int value) const;
@@ -33,7 +54,37 @@ public:
 	void setMat4(const std::string &name, const glm::mat4 &mat) const;
 
 private:
-	// utility function for checking shader compilation/linking errors.
-	void checkCompileErrors(GLuint shader, std::string type);
+	// shader objects that are still attached while the program is being compiled and linked
+	unsigned int vertex = 0, fragment = 0, geometry = 0;
+	bool pending = false;
+	std::string cachePath;
+	std::string cacheKey;
+	// the files every stage was read from, by the source string number they have in compile errors
+	std::vector<std::string> vertexFiles, fragmentFiles, geometryFiles;
+
+	bool loadBinary();
+	void bindUniformBlocks();
+	void saveBinary();
+	// utility function for checking shader compilation/linking errors, returns whether it was successful. The files are listed below the errors
+	bool checkCompileErrors(GLuint shader, std::string type, const std::vector<std::string>* files = nullptr);
+};
+/*
+All variants of a single shader, each compiled with a different combination of features. The features are passed as the names of their defines,
+the bits in a variant mask select which of them are enabled (bit 0 for the first feature, bit 1 for the second, etc.). The defines are added to
+every variant, whichever features it has.
+Variants are compiled the first time they're requested, so only the combinations that are actually used are ever built.
+*/
+class ShaderVariants
+{
+public:
+	ShaderVariants(const char * vertexPath, const char * fragmentPath, const std::vector<std::string>& features, const std::vector<std::string>& defines = {});
+
+	Shader& get(unsigned int mask);
+
+private:
+	std::string vertexPath, fragmentPath;
+	std::vector<std::string> features;
+	std::vector<std::string> defines;
+	std::map<unsigned int, std::unique_ptr<Shader>> variants;
 };
 #endif
\ No newline at end of file
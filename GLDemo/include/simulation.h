@@ -0,0 +1,90 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <planetoid.h>
+#include <triplebuffer.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+//where a body is after a step, kept apart rather than as a model matrix so the render thread can blend two steps
+struct BodyState {
+	glm::vec3 position;
+	glm::quat orientation;
+	float scale;
+};
+
+//the state of every body after a step of the simulation and the step before it, in the order the simulation visits the planetoids
+struct SceneSnapshot {
+	std::vector<BodyState> bodies;
+	std::vector<BodyState> previousBodies;
+	double time = 0.0; //simulated seconds since the start
+	double orbitTime = 0.0; //simulated seconds the planetoids have been orbiting, which stands still while they're stopped
+	//when the step and the one before it were published, in seconds of the steady clock
+	double published = 0.0;
+	double previousPublished = 0.0;
+	uint64_t steps = 0;
+};
+
+/*
+Moves the planetoids along their orbits on a thread of its own, so a slow step of the simulation never holds up drawing a frame and
+a slow frame never slows down the simulation. The simulation owns the motion of every body, and after every step it publishes the model
+matrices of all of them through a triple buffer. The render thread picks up the newest snapshot once per frame with apply(), which
+never waits on the simulation thread, and only ever reads the copies of the transforms stored in the planetoids themselves.
+Steps and frames don't line up, so drawing the newest step as is makes the planetoids jump ahead by one step in some frames and by none
+in others. Instead every frame shows the scene one step in the past, which always lies between the two steps in the newest snapshot:
+positions are blended linearly and orientations with a slerp.
+The planetoid tree must be complete before the simulation is created, and must outlive it.
+*/
+class Simulation {
+public:
+	//steps per second, the simulation sleeps between steps. With a rate of 0 no thread is started and the caller advances it with step()
+	Simulation(Planetoid* root, double stepRate = 240.0);
+	~Simulation();
+	Simulation(const Simulation&) = delete;
+	Simulation& operator=(const Simulation&) = delete;
+
+	//whether planetoids orbit around their parents, they keep spinning around their own axis either way
+	void setTurning(bool turning);
+	//advances the simulation by a fixed amount of time and publishes the result, only for a simulation without a thread of its own
+	void step(float deltaTime);
+	//moves the planetoids to where they are one step before the newest snapshot of the simulation, called by the render thread before
+	//anything is drawn. A simulation advanced with step() is shown exactly at its last step
+	const SceneSnapshot& apply();
+
+private:
+	struct Body {
+		PlanetoidMotion motion;
+		int parent;
+		glm::mat4 translation = glm::mat4(1.0f);
+		glm::mat4 rotation = glm::mat4(1.0f);
+	};
+
+	//only touched by the simulation thread once it's running
+	std::vector<Body> bodies;
+	double time = 0.0;
+	double orbitTime = 0.0;
+	uint64_t steps = 0;
+	std::vector<BodyState> lastBodies; //the state published in the step before
+	double lastPublished = 0.0;
+	//only touched by the render thread
+	std::vector<Planetoid*> planetoids;
+
+	TripleBuffer<SceneSnapshot> snapshots;
+	std::atomic<bool> turning{ true };
+	std::atomic<bool> stopping{ false };
+	double stepRate;
+	std::thread thread;
+
+	void addBodies(Planetoid* planet, int parent);
+	void advance(float deltaTime);
+	void publish();
+	void run();
+};
+
+#endif
@@ -4,20 +4,22 @@
 #include <glad/glad.h>
 
 #include <shader_m.h>
+#include <resources.h>
 
 #include <vector>
 #include <string>
 
 class Skybox {
 public:
-	Skybox(const std::vector<std::string>& faces);
+	Skybox(const std::vector<std::string>& faces, Resources& resources);
 	~Skybox();
 
-	void draw(Shader& shader, glm::mat4& view, glm::mat4& projection);
+	//with two eyes the shader must be compiled with STEREO, and draws both of them at once (see stereo.h)
+	void draw(Shader& shader, glm::mat4& view, glm::mat4& projection, int eyes = 1);
 
 private:
 	GLuint skyboxVAO, skyboxVBO;
-	GLuint cubemapTex;
+	TextureHandle cubemap;
 
 	float skyboxVertices[108] = {
 		// positions          
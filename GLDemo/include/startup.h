@@ -0,0 +1,86 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <threadpool.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Runs the steps of loading the application as a graph of stages, each of which starts as soon as the stages it depends on are done.
+
+- Tasks do the CPU heavy parts (reading files, importing models, rasterizing glyphs, ...) on the thread pool, they must not call OpenGL.
+- GL tasks upload the results of tasks on the render thread. They're run by finish() in the order their inputs become ready, and while
+  none are ready the render thread waits for the workers.
+- Steps are the parts of main() that run on the render thread anyway, such as creating the window. They're only timed, so everything they
+  create stays in scope, and the tasks keep running on the workers in the meantime.
+
+A stage that fails makes every stage that depends on it fail as well, without running them. Every stage records when it started and
+finished, which is printed as a timeline once the first frame is on screen.
+*/
+class Startup {
+public:
+	typedef int Stage;
+
+	Startup(ThreadPool& pool);
+	//waits for the tasks that are still running, as they write into objects owned by the caller
+	~Startup();
+
+	//work returns false when the stage failed
+	Stage addTask(const std::string& name, std::function<bool()> work, const std::vector<Stage>& dependencies = {});
+	Stage addGLTask(const std::string& name, std::function<bool()> work, const std::vector<Stage>& dependencies = {});
+
+	//submits the tasks added so far, tasks added later are submitted as soon as they're ready
+	void start();
+	//ends the current step and starts timing the next one on the render thread
+	void step(const std::string& name);
+	//ends the current step and runs the GL tasks until every stage is done, returns false when any of them failed
+	bool finish();
+	//prints the timeline of all stages along with the time to the first frame
+	void firstFrame();
+
+private:
+	struct Node {
+		std::string name;
+		std::function<bool()> work;
+		bool gl;
+		std::vector<Stage> dependents;
+		int waiting = 0; //dependencies that aren't done yet
+		bool done = false;
+		bool skipped = false; //a dependency failed
+		bool succeeded = false;
+		bool onRenderThread = false;
+		double begin = 0.0, end = 0.0; //in milliseconds since the start
+	};
+
+	ThreadPool& pool;
+	std::chrono::steady_clock::time_point origin;
+	std::thread::id renderThread;
+	//the nodes are never moved once workers may be using them
+	std::deque<Node> stages;
+	Stage currentStep = -1;
+	bool started = false;
+	bool stopping = false; //no more tasks are submitted once the destructor runs
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<Stage> readyGL;
+	int remaining = 0; //stages that aren't done yet
+	int running = 0; //tasks submitted to the pool that haven't finished
+	bool failed = false;
+
+	Stage add(const std::string& name, std::function<bool()> work, const std::vector<Stage>& dependencies, bool gl);
+	double now() const;
+	void submit(Stage stage);
+	void execute(Stage stage, Node* node, bool task);
+	void complete(Stage stage, bool success, bool task);
+	void endStep();
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef STEREO_H
+#define STEREO_H
+
+#include <glm/glm.hpp>
+
+#include <scene.h>
+#include <uniforms.h>
+#include <options.h>
+
+/*
+How the images of both eyes are packed into the framebuffer:
+side by side   the left eye in the left half and the right eye in the right half, for projectors in side by side 3D mode
+top bottom     the left eye in the top half and the right eye in the bottom half
+layered        every eye in a layer of a texture array, shown with quad buffered stereo when the window has it
+Both eyes are drawn in a single pass: every draw of the scene is instanced twice, and the vertex shader picks the view of the eye and
+where it ends up in the framebuffer from gl_InstanceID (see shaders/stereo.glsl).
+*/
+enum StereoLayout { STEREO_OFF, STEREO_SIDE_BY_SIDE, STEREO_TOP_BOTTOM, STEREO_LAYERED };
+
+struct StereoSettings {
+	StereoLayout layout = STEREO_OFF;
+	float separation = 0.2f; //distance between the eyes in world units
+	float convergence = 12.0f; //distance at which both eyes see the same point, anything closer comes out of the screen
+
+	/*
+	Adds the stereo options, the scene is drawn for a single eye unless --stereo is given:
+	  --stereo <side-by-side|top-bottom|layered>, --separation <distance>, --convergence <distance>
+	*/
+	void addOptions(Options& options);
+	//the define that selects the layout in shaders compiled with STEREO
+	const char* getDefine() const;
+};
+
+//splits the view of a camera into the views of both eyes, moved apart along the X-axis of the camera with off-axis projections
+void stereoEyes(const View& center, const StereoSettings& settings, View eyes[2]);
+//the data of the Stereo uniform block for both eyes
+StereoData stereoData(const View eyes[2]);
+//the items that are visible to either eye, in the order of the draw list
+void stereoCull(const DrawList& drawList, View& center, View eyes[2]);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef TEXTFILE_H
+#define TEXTFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/*
+What the parsers of large text files (the native model importers and the minor planet catalogs) have in common: the file is memory mapped
+and parsed in place, and numbers are parsed without going through the C library.
+Nothing in here calls OpenGL, so it can run on any thread.
+*/
+
+//a read-only view of a whole file, pages are only read from disk once the parser touches them
+class MappedFile {
+public:
+	MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool isOpen() const { return data != nullptr; }
+	const char* begin() const { return data; }
+	const char* end() const { return data + size; }
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	//the handles of the file and its mapping, kept as void* so windows.h stays out of this header
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
+
+//number parsing, which is most of the work for text formats. Runs of digits are read 8 at a time as a single 64 bit integer
+//(see "Fast number parsing without fallback" by Lemire), only the digits at the end of a number are read one by one
+
+inline bool isDigit(char c) {
+	return (unsigned char)(c - '0') < 10;
+}
+
+inline bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline uint64_t load8(const char* p) {
+	uint64_t value;
+	memcpy(&value, p, 8);
+	return value;
+}
+
+//whether all 8 bytes are between '0' and '9'
+inline bool isEightDigits(uint64_t chunk) {
+	return !(((chunk + 0x4646464646464646) | (chunk - 0x3030303030303030)) & 0x8080808080808080);
+}
+
+//combines 8 digits in 3 multiplications, the first digit is in the lowest byte
+inline uint32_t parseEightDigits(uint64_t chunk) {
+	const uint64_t mask = 0x000000FF000000FF;
+	const uint64_t mul1 = 0x000F424000000064; //100 + (1000000 << 32)
+	const uint64_t mul2 = 0x0000271000000001; //1 + (10000 << 32)
+	chunk -= 0x3030303030303030;
+	chunk = (chunk * 10) + (chunk >> 8);
+	chunk = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+	return (uint32_t)chunk;
+}
+
+//reads a run of digits into value, digits past the 19th don't fit in 64 bits and are only counted in dropped
+inline const char* parseDigits(const char* p, const char* end, uint64_t& value, int& dropped) {
+	while (end - p >= 8 && value < 100000000000ULL) {
+		uint64_t chunk = load8(p);
+		if (!isEightDigits(chunk))
+			break;
+		value = value * 100000000 + parseEightDigits(chunk);
+		p += 8;
+	}
+	for (; p < end && isDigit(*p); p++) {
+		if (value < 1000000000000000000ULL)
+			value = value * 10 + (*p - '0');
+		else
+			dropped++;
+	}
+	return p;
+}
+
+inline void skipSpaces(const char*& p, const char* end) {
+	while (p < end && isSpace(*p))
+		p++;
+}
+
+//move p past the number and return false when there's none, floats may have whitespace in front of them
+bool parseFloat(const char*& p, const char* end, float& result);
+bool parseDouble(const char*& p, const char* end, double& result);
+bool parseInt(const char*& p, const char* end, long long& result);
+
+#endif
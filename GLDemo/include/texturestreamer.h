@@ -0,0 +1,131 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <threadpool.h>
+#include <lockfreequeue.h>
+#include <ctex.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//an image decoded by a worker thread, waiting to be uploaded on the render thread
+struct DecodedImage {
+	GLuint texture;
+	GLenum target; //GL_TEXTURE_2D or one of the faces of a cubemap
+	std::string path;
+	unsigned char* data = nullptr;
+	int width = 0, height = 0, components = 0;
+	//set instead of data when a precompressed version of the image was found, its levels are uploaded from the smallest to the largest
+	std::unique_ptr<CompressedImage> compressed;
+	bool discarded = false; //the image was flat and its texture should be dropped (see TextureStreamer::load)
+	int level = 0; //the mip level that's being uploaded
+	int uploadedRows = 0; //of the current level, in rows of 4x4 blocks for compressed images
+};
+
+/*
+Loads textures without stalling the render thread. Images are decoded on a thread pool and passed back through a lock-free queue,
+then uploaded a few rows at a time through a ring of pixel buffer objects, so that the copy to the GPU happens asynchronously and
+no more than a fixed number of bytes is uploaded per frame. When the driver supports it the ring is persistently mapped, otherwise
+each chunk is mapped unsynchronized; either way fences make sure a part of the ring is only overwritten once the GPU is done with it.
+
+Textures can be used right away: until their image is fully uploaded they show a single placeholder color.
+
+When a .ctex file made by the texconvert tool exists next to an image (see ctex.h), it's loaded instead: there's nothing to decode, the
+upload is 4 to 8 times smaller, and its mip levels are shown one after another as soon as they're in, from the smallest to the largest.
+*/
+class TextureStreamer {
+public:
+	TextureStreamer(ThreadPool& pool, size_t ringSize, size_t frameBudget);
+	~TextureStreamer();
+
+	//creates a texture that shows the placeholder color until images are streamed into it, texture parameters are left to the caller
+	GLuint create(GLenum target, const glm::vec3& placeholder, bool mipmaps);
+	/*
+	Decodes the image at path in the background and streams it into the given target of a texture made by create(), f.e. one face of a cubemap.
+	When discardFlat is set and the image turns out to be a single color, nothing is uploaded and onDiscard is called with the texture instead,
+	which is then no longer managed by the streamer.
+	*/
+	void load(GLuint texture, GLenum target, const std::string& path, bool discardFlat = false, std::function<void(GLuint)> onDiscard = nullptr);
+	/*
+	Streams six images into the faces of a cubemap made by create(), in the order +X, -X, +Y, -Y, +Z, -Z. The faces of a cubemap have to share
+	their format, so their .ctex files are only used when every face has one of the same format and size, otherwise all faces are decoded.
+	*/
+	void loadCubemap(GLuint texture, const std::vector<std::string>& faces);
+
+	/*
+	Copies a region of block compressed data into a level of an existing texture through the ring, taken from the same per-frame budget as
+	the images. Returns false without uploading anything when the budget of this frame is used up or the ring is full, f.e. so the pages
+	of virtual textures (see virtualtexture.h) can be tried again next frame. Has to be called before update() in a frame.
+	*/
+	bool uploadCompressed(GLuint texture, GLenum target, int level, int x, int y, int width, int height, GLenum format, const void* data, size_t size);
+
+	/*
+	Deletes a texture made by create(). When images are still being decoded or uploaded into it, they're dropped once they come in and the
+	texture is only deleted after the last of them, so its name can't be reused for a new texture while images for the old one are on their way.
+	*/
+	void release(GLuint texture);
+
+	//uploads decoded images within the budget of this frame, must be called once per frame from the thread that owns the GL context
+	void update();
+	//whether every requested image has been uploaded
+	bool idle() const;
+
+private:
+	//a texture that images are being streamed into
+	struct StreamedTexture {
+		GLenum target;
+		glm::vec3 placeholder;
+		bool mipmaps;
+		int pending = 0; //images that haven't been uploaded yet
+		bool started = false; //the placeholder has been moved out of the way of the full image
+		int maxLevel = -1; //the last mip level of a precompressed image, -1 when mipmaps still have to be generated
+		bool failed = false;
+		bool released = false; //release() was called while images were still pending
+		std::function<void(GLuint)> onDiscard;
+	};
+
+	//a part of the ring that was written to in a frame, which can be reused once the GPU has passed the fence
+	struct RingFence {
+		GLsync fence;
+		size_t size;
+	};
+
+	ThreadPool& pool;
+	LockFreeQueue<DecodedImage*> decoded;
+	std::atomic<int> decoding{ 0 }; //images still being decoded by the workers
+	std::atomic<bool> stopping{ false }; //set by the destructor, images that haven't been decoded yet are skipped
+	int outstanding = 0; //images that have been requested but aren't uploaded yet
+	std::deque<DecodedImage*> uploads;
+	std::map<GLuint, StreamedTexture> textures;
+
+	GLuint ring = 0;
+	size_t ringSize;
+	unsigned char* mapped = nullptr; //base pointer of the persistently mapped ring, null when mapping per chunk
+	size_t head = 0; //where the next chunk is written
+	size_t used = 0; //bytes the GPU may still be reading from
+	size_t frameUsed = 0; //bytes written this frame, including the part skipped when wrapping around
+	std::deque<RingFence> fences;
+	size_t frameBudget;
+	size_t budget; //what's left of the budget of the current frame
+
+	void decode(GLuint texture, GLenum target, const std::string& path, bool discardFlat, bool mipmaps, bool precompressed);
+	void queue(DecodedImage* image);
+	void uploadImages();
+	void start(DecodedImage* image, StreamedTexture& texture, int width, int height);
+	bool uploadChunk(DecodedImage* image);
+	void write(size_t offset, const void* source, size_t size);
+	void finish(GLuint id, StreamedTexture& texture);
+	void retireFences();
+	bool allocate(size_t size, size_t& offset);
+};
+
+#endif
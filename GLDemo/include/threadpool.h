@@ -0,0 +1,38 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/*
+A fixed set of worker threads that run jobs in the order they were submitted, for CPU heavy work such as decoding images that
+shouldn't block the render thread. Jobs must not touch OpenGL, as the GL context is only current on the render thread.
+Jobs that are still queued when the pool is destroyed are finished first.
+*/
+class ThreadPool {
+public:
+	//0 threads uses one thread per core, minus the one the render thread runs on
+	ThreadPool(unsigned int threads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(std::function<void()> job);
+	unsigned int size() const;
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping = false;
+
+	void run();
+};
+
+#endif
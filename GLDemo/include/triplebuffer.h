@@ -0,0 +1,53 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+/*
+Hands the newest version of a value from one writer thread to one reader thread without either of them ever waiting for the other.
+There are three copies of the value: the writer fills in the back one, the reader reads the front one, and the one in the middle is the
+newest that was published. Publishing swaps the back copy with the middle one, and acquiring swaps the middle one with the front copy
+when it's newer than what the reader has, both with a single atomic exchange. Versions the reader was too slow to see are simply skipped.
+*/
+template<typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() = default;
+	//every copy starts out as the initial value, so the reader has something to read before the first publish
+	TripleBuffer(const T& initial) {
+		for (T& buffer : buffers)
+			buffer = initial;
+	}
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	//the copy the writer fills in, it still holds whatever was written into it two publishes ago
+	T& back() {
+		return buffers[backIndex];
+	}
+
+	//makes the back copy the newest one and gives the writer the copy that was in the middle
+	void publish() {
+		backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	//the newest copy that was published, or the same one as last time when nothing new was published since
+	const T& acquire() {
+		if (middle.load(std::memory_order_relaxed) & FRESH)
+			frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+		return buffers[frontIndex];
+	}
+
+private:
+	//the index of the middle copy is stored together with whether it was published after the reader last acquired it
+	static constexpr int INDEX = 3;
+	static constexpr int FRESH = 4;
+
+	T buffers[3];
+	int backIndex = 0;
+	alignas(64) std::atomic<int> middle{ 1 };
+	alignas(64) int frontIndex = 2;
+};
+
+#endif
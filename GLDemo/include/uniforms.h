@@ -0,0 +1,76 @@
+#ifndef UNIFORMS_H
+#define UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+//binding point of the Frame uniform block, every shader that declares the block is bound to it automatically (see Shader::finish)
+const GLuint FRAME_BLOCK_BINDING = 0;
+//binding point of the Stereo uniform block, which is only declared by shaders compiled for stereo (see stereo.h)
+const GLuint STEREO_BLOCK_BINDING = 1;
+
+//mirrors the Light struct in shaders/frame.glsl, the members are ordered so the std140 layout matches the C++ layout without padding
+struct LightData {
+	glm::vec3 position;
+	float radius;
+	glm::vec3 ambient;
+	float constant;
+	glm::vec3 diffuse;
+	float linear;
+	glm::vec3 specular;
+	float quadratic;
+};
+
+//mirrors the Frame uniform block in shaders/frame.glsl
+struct FrameData {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPos;
+	float shininess;
+	LightData light;
+};
+static_assert(sizeof(LightData) == 64, "LightData must match the std140 layout of Light in frame.glsl");
+static_assert(sizeof(FrameData) == 208, "FrameData must match the std140 layout of the Frame block in frame.glsl");
+
+//mirrors the Stereo uniform block in shaders/stereo.glsl, the left eye comes first
+struct StereoData {
+	glm::mat4 view[2];
+	glm::mat4 projection[2];
+	glm::vec4 position[2]; //w is unused
+};
+static_assert(sizeof(StereoData) == 288, "StereoData must match the std140 layout of the Stereo block in stereo.glsl");
+
+/*
+Uniform buffer holding everything that stays the same for all draws in a frame, such as the camera and the light.
+The data is uploaded once per frame instead of being set on every shader, which also means every variant of a shader sees the same values.
+A frame that's drawn from several views (see scene.h) has a slot in the buffer for every view, so switching views only binds another
+range of the buffer, and no view overwrites data that the draws of an earlier view may still be reading.
+*/
+class FrameUniforms {
+public:
+	FrameUniforms(int slots = 1);
+	~FrameUniforms();
+
+	//uploads the data of a slot and binds it to the Frame block
+	void update(const FrameData& data, int slot = 0);
+
+private:
+	GLuint UBO;
+	GLsizeiptr stride; //size of a slot, rounded up to the alignment the driver requires for bound ranges
+	int slots;
+};
+
+//uniform buffer with the views of both eyes, which is read by the shaders that draw both eyes in a single instanced draw
+class StereoUniforms {
+public:
+	StereoUniforms();
+	~StereoUniforms();
+
+	//uploads the eyes and binds them to the Stereo block
+	void update(const StereoData& data);
+
+private:
+	GLuint UBO;
+};
+
+#endif
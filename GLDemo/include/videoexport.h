@@ -0,0 +1,90 @@
+#ifndef VIDEOEXPORT_H
+#define VIDEOEXPORT_H
+
+#include <glad/glad.h>
+
+#include <framereadback.h>
+#include <options.h>
+#include <threadpool.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+
+//what to export, see ExportSettings::addOptions for the command line
+struct ExportSettings {
+	std::string output; //the directory of the image sequence, the command the frames are piped to, or the file of the poster
+	bool pipe = false;
+	bool poster = false;
+	int tileSize = 2048; //of a poster, in pixels
+	int width = 1920, height = 1080;
+	double frameRate = 60.0;
+	int frames = 600;
+	//a stereo export writes every frame as an image per eye, frame_000000_left.png and frame_000000_right.png (see stereo.h)
+	int eyes = 1;
+
+	/*
+	Adds the export options, the application runs interactively unless one of the first three is given:
+	  --export <directory>   writes every frame as frame_000000.png, frame_000001.png, ... into the directory
+	  --pipe <command>       writes every frame as raw rgb24 to the standard input of the command, f.e.
+	                         "ffmpeg -y -f rawvideo -pix_fmt rgb24 -s 1920x1080 -r 60 -i - -c:v libx264 -crf 16 solarsystem.mp4"
+	  --poster <file>        renders a single frame of any size as a tiled TIFF file (see posterexport.h)
+	  --size <width>x<height>, --fps <frames per second>, --frames <amount of frames>, --tile <size of the tiles of a poster>
+	*/
+	void addOptions(Options& options);
+	bool isExporting() const;
+};
+
+/*
+Records the scene frame by frame, for video that's smoother and sharper than recording the window could ever be. Every frame is read back
+asynchronously (see FrameReadback) and then handed off: PNG frames are encoded in parallel on the thread pool, and piped frames are written
+in order by a thread of their own. Nothing is ever dropped, instead the render thread waits when the readbacks or the encoders fall too far
+behind, which only makes the export take longer.
+The scene has to be advanced by getDeltaTime() every frame instead of the time that actually passed, so the output is the same every time.
+*/
+class VideoExport {
+public:
+	VideoExport(const ExportSettings& settings, ThreadPool& pool);
+	//waits until every frame has been written
+	~VideoExport();
+	VideoExport(const VideoExport&) = delete;
+	VideoExport& operator=(const VideoExport&) = delete;
+
+	bool isOpen() const;
+	//the simulated time between two frames
+	float getDeltaTime() const;
+	//whether every frame has been captured
+	bool isDone() const;
+	//whether a frame couldn't be written, the export can't be completed anymore and should be ended
+	bool hasFailed() const;
+	//reads back the frame that was just rendered into the first color attachment of the framebuffer, starting at x, y
+	//a stereo export captures every eye in turn, the frame is complete once the last eye has been captured
+	void capture(GLuint framebuffer, int eye = 0, int x = 0, int y = 0);
+	//collects the remaining readbacks and waits until every frame has been written, returns false when any of them couldn't be
+	bool finish();
+
+private:
+	ExportSettings settings;
+	ThreadPool& pool;
+	FrameReadback readback;
+	FILE* pipe = nullptr;
+	//writes the frames to the pipe one after another
+	std::unique_ptr<ThreadPool> pipeWriter;
+	uint64_t captured = 0;
+	bool finished = false;
+	bool opened = true; //the output directory could be created, the pipe is checked on its own
+
+	//frames that have been read back but aren't written yet, the render thread waits when there are too many of them
+	std::mutex mutex;
+	std::condition_variable condition;
+	int writing = 0;
+	int maxWriting;
+	std::atomic<bool> failed{ false }; //a frame couldn't be written
+
+	void write(uint64_t image, const unsigned char* pixels);
+};
+
+#endif
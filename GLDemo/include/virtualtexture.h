@@ -0,0 +1,142 @@
+#ifndef VIRTUALTEXTURE_H
+#define VIRTUALTEXTURE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <shader_m.h>
+#include <threadpool.h>
+#include <lockfreequeue.h>
+#include <texturestreamer.h>
+#include <vtex.h>
+
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class VirtualTextures;
+
+/*
+A texture that's too large to keep in video memory as a whole, f.e. a 64k planet map. It's read from a page file (see vtex.h) one page
+at a time, and only the pages that are actually visible are kept in the page cache of its format. The page table holds an entry for every
+page of every level, which points to where the page is in the cache. Pages that aren't in the cache point to the closest coarser level
+that is instead, so the texture is always complete but gets sharper as the pages come in.
+*/
+class VirtualTexture {
+public:
+	//the page table, a GL_RGBA8UI texture with a mip level for every level of the virtual texture (see virtualtexture.glsl)
+	GLuint getPageTable() const;
+	//index of the texture in the feedback buffer
+	int getIndex() const;
+	//width and height of the virtual texture, its coarsest level and the number of pages along a side of its cache
+	glm::vec4 getShape() const;
+	//binds the page cache and sets the rest of the VirtualMap uniform with the given name, the page table is bound like any other texture
+	void setUniforms(const Shader& shader, const std::string& name) const;
+
+private:
+	friend class VirtualTextures;
+
+	struct Cache;
+
+	int index;
+	std::string path;
+	PageFile file;
+	Cache* cache;
+	GLuint pageTable = 0;
+	//where every resident page is in the cache, by its key (see pageKey)
+	std::unordered_map<uint64_t, int> resident;
+	//page table entries of every level and the part of every level that has to be recomputed and uploaded
+	std::vector<std::vector<uint32_t>> entries;
+	std::vector<glm::ivec4> dirty;
+
+	//the page file is shared by the workers, which read one page at a time
+	std::ifstream stream;
+	std::mutex streamMutex;
+};
+
+/*
+Streams the pages of virtual textures into a page cache of a fixed size, so maps of any size only take a fixed amount of video memory.
+
+Every frame the planetoids are drawn into a small feedback buffer, in which every pixel records the page and level that the pixel would
+sample (see vtfeedback_fs.glsl). The buffer is read back asynchronously, and a few frames later the pages in it are marked as used and
+the missing ones are read from disk on the thread pool, coarse levels first. Loaded pages are uploaded through the ring of the texture
+streamer, taking the place of the page in the cache that has been used the longest ago when it's full.
+*/
+class VirtualTextures {
+public:
+	//pagesPerSide sets the size of the page cache of every format, f.e. 32 pages is a 4096x4096 texture, which takes 8 MB for BC1 and BC4 and 16 MB for BC3 and BC5
+	VirtualTextures(ThreadPool& pool, TextureStreamer& streamer, int pagesPerSide, GLuint firstCacheUnit, int windowWidth, int windowHeight);
+	~VirtualTextures();
+
+	//opens a page file made by "texconvert --virtual", returns nullptr when it can't be used, a page file that was already opened returns the same texture
+	VirtualTexture* load(const std::string& path);
+
+	//starts the feedback pass and prepares the shader, returns false when there are no virtual textures to draw feedback for
+	bool beginFeedback(Shader& shader);
+	//sends the feedback of this frame to be read back, afterwards the caller has to bind its own framebuffer again
+	void endFeedback();
+
+	//handles the feedback that has been read back and uploads loaded pages, must be called once per frame before TextureStreamer::update()
+	void update();
+
+private:
+	struct Request {
+		VirtualTexture* texture;
+		int level, x, y;
+	};
+	//a page read from disk by a worker
+	struct LoadedPage {
+		Request request;
+		std::vector<unsigned char> data;
+		bool failed = false;
+	};
+
+	ThreadPool& pool;
+	TextureStreamer& streamer;
+	int pagesPerSide;
+	GLuint firstCacheUnit;
+	std::vector<std::unique_ptr<VirtualTexture>> textures;
+	std::map<CTexFormat, std::unique_ptr<VirtualTexture::Cache>> caches;
+	unsigned int frame = 0;
+
+	std::unordered_set<uint64_t> loading; //pages that are being read or waiting to be uploaded, by texture index and page key
+	//pages that couldn't be read, which aren't requested again before the frame after which they may be retried
+	struct Retry {
+		unsigned int frame = 0;
+		unsigned int failures = 0;
+	};
+	std::unordered_map<uint64_t, Retry> retries;
+	LockFreeQueue<LoadedPage*> loaded;
+	std::atomic<int> reading{ 0 };
+	std::deque<LoadedPage*> pending;
+
+	//the feedback buffer and the ring of pixel pack buffers it's read back through
+	GLuint feedbackFBO = 0, feedbackColor = 0, feedbackDepth = 0;
+	int feedbackWidth, feedbackHeight;
+	GLint viewport[4];
+	struct Readback {
+		GLuint buffer = 0;
+		GLsync fence = 0;
+	};
+	std::vector<Readback> readbacks;
+	size_t nextReadback = 0;
+
+	VirtualTexture::Cache* getCache(CTexFormat format);
+	void readFeedback();
+	void request(std::unordered_set<uint64_t>& seen, std::vector<Request>& requests, VirtualTexture* texture, int level, int x, int y);
+	void uploadPages();
+	void map(VirtualTexture* texture, int level, int x, int y, int page);
+	void unmap(VirtualTexture* texture, int level, int x, int y);
+	void markDirty(VirtualTexture* texture, int level, int x, int y);
+	void updatePageTable(VirtualTexture* texture);
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef VTEX_H
+#define VTEX_H
+
+#include <ctex.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+Page files for virtual textures, as written by "texconvert --virtual" and read by VirtualTextures (see virtualtexture.h).
+Every mip level of the texture is cut into square pages, which are block compressed in the same formats as .ctex files. Pages overlap their
+neighbours by a border on every side, so a page can be sampled with bilinear filtering without reading outside of it. The pages are
+stored level by level from the largest to the smallest and row by row within a level, all with the same size, so the position of any page
+follows from its coordinates and it can be read on its own without a table.
+*/
+
+const uint32_t VTEX_MAGIC = 0x58455456; //"VTEX"
+const uint32_t VTEX_VERSION = 1;
+//pixels along a side of a page including the border, must match VT_PAGE_SIZE and VT_PAGE_BORDER in virtualtexture.glsl
+const int VTEX_PAGE_SIZE = 128;
+const int VTEX_PAGE_BORDER = 4;
+//pixels of the texture itself along a side of a page
+const int VTEX_PAGE_CONTENT = VTEX_PAGE_SIZE - 2 * VTEX_PAGE_BORDER;
+
+struct VTexLevel {
+	int width, height;
+	int pagesX, pagesY;
+	uint64_t firstPage; //index of the first page of this level in the file
+};
+
+struct PageFile {
+	CTexFormat format;
+	int width, height;
+	std::vector<VTexLevel> levels; //down to the first level that fits in a single page
+	size_t pageSize; //bytes per page
+};
+
+//fills in the levels and page size of a page file from its format and size
+void vtexLayout(PageFile& file);
+//byte offset of a page from the start of the file
+uint64_t vtexPageOffset(const PageFile& file, int level, int x, int y);
+
+//both only print a message and return false when something is wrong, nothing in here calls OpenGL so they can run on any thread
+bool readPageFileHeader(std::ifstream& stream, const std::string& path, PageFile& file);
+bool writePageFileHeader(std::ofstream& stream, const PageFile& file);
+
+#endif
@@ -0,0 +1,212 @@
+#include "bcencoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//endpoints are stored as 16-bit 5:6:5 colors
+static uint16_t pack565(const float* color) {
+	int r = (int)std::round(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+	int g = (int)std::round(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+	int b = (int)std::round(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack565(uint16_t packed, float* color) {
+	color[0] = ((packed >> 11) & 31) * 255.0f / 31.0f;
+	color[1] = ((packed >> 5) & 63) * 255.0f / 63.0f;
+	color[2] = (packed & 31) * 255.0f / 31.0f;
+}
+
+//picks the closest of the four palette colors for every pixel, returns the total squared error
+static float chooseColorIndices(const float pixels[16][3], uint16_t c0, uint16_t c1, int* indices) {
+	float palette[4][3];
+	unpack565(c0, palette[0]);
+	unpack565(c1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+		palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+	}
+
+	float total = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float best = 1e30f;
+		for (int p = 0; p < 4; p++) {
+			float dr = pixels[i][0] - palette[p][0], dg = pixels[i][1] - palette[p][1], db = pixels[i][2] - palette[p][2];
+			float error = dr * dr + dg * dg + db * db;
+			if (error < best) {
+				best = error;
+				indices[i] = p;
+			}
+		}
+		total += best;
+	}
+	return total;
+}
+
+/*
+Solves for the two endpoints that fit the pixels best in the least squares sense, given which palette entry every pixel uses.
+Returns false when the indices don't determine the endpoints, f.e. when every pixel uses the same entry.
+*/
+static bool refineEndpoints(const float pixels[16][3], const int* indices, float* e0, float* e1) {
+	static const float WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ap[3] = { 0.0f, 0.0f, 0.0f }, bp[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		float a = WEIGHTS[indices[i]], b = 1.0f - a;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int c = 0; c < 3; c++) {
+			ap[c] += a * pixels[i][c];
+			bp[c] += b * pixels[i][c];
+		}
+	}
+	float det = aa * bb - ab * ab;
+	if (std::abs(det) < 1e-6f)
+		return false;
+	for (int c = 0; c < 3; c++) {
+		e0[c] = (ap[c] * bb - bp[c] * ab) / det;
+		e1[c] = (bp[c] * aa - ap[c] * ab) / det;
+	}
+	return true;
+}
+
+/*
+Encodes the color part of a BC1 or BC3 block. The endpoints start out at the extremes of the pixels along their principal axis,
+which is the direction in which the colors of the block vary the most, and are then refined once with a least squares fit.
+*/
+static void encodeColorBlock(const uint8_t* source, int stride, uint8_t* block) {
+	float pixels[16][3];
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) {
+			pixels[i][c] = source[i * stride + c];
+			mean[c] += pixels[i][c] / 16.0f;
+		}
+	}
+
+	//covariance of the colors, of which the largest eigenvector is found with a few power iterations
+	float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		float r = pixels[i][0] - mean[0], g = pixels[i][1] - mean[1], b = pixels[i][2] - mean[2];
+		cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+		cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+	}
+	float axis[3] = { 0.9f, 1.0f, 0.7f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		float length = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+		if (length < 1e-6f)
+			break;
+		axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+	}
+	float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	for (int c = 0; c < 3; c++)
+		axis[c] /= axisLength;
+
+	float minT = 1e30f, maxT = -1e30f;
+	for (int i = 0; i < 16; i++) {
+		float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] + (pixels[i][2] - mean[2]) * axis[2];
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+	//pull the endpoints in a bit, the extremes are usually outliers and the palette covers the middle of the range better this way
+	float inset = (maxT - minT) / 16.0f;
+	float e0[3], e1[3];
+	for (int c = 0; c < 3; c++) {
+		e0[c] = mean[c] + axis[c] * (maxT - inset);
+		e1[c] = mean[c] + axis[c] * (minT + inset);
+	}
+
+	uint16_t c0 = pack565(e0), c1 = pack565(e1);
+	int indices[16];
+	float error = chooseColorIndices(pixels, c0, c1, indices);
+
+	float r0[3], r1[3];
+	if (refineEndpoints(pixels, indices, r0, r1)) {
+		uint16_t rc0 = pack565(r0), rc1 = pack565(r1);
+		int refined[16];
+		float refinedError = chooseColorIndices(pixels, rc0, rc1, refined);
+		if (refinedError < error) {
+			c0 = rc0;
+			c1 = rc1;
+			memcpy(indices, refined, sizeof(indices));
+		}
+	}
+
+	//the first endpoint has to be the larger one, otherwise the block is decoded in the three color mode with black as the fourth color
+	if (c0 < c1) {
+		std::swap(c0, c1);
+		for (int i = 0; i < 16; i++)
+			indices[i] ^= 1;
+	} else if (c0 == c1) {
+		for (int i = 0; i < 16; i++)
+			indices[i] = 0;
+	}
+
+	uint32_t packed = 0;
+	for (int i = 0; i < 16; i++)
+		packed |= (uint32_t)indices[i] << (2 * i);
+	block[0] = c0 & 0xFF; block[1] = c0 >> 8;
+	block[2] = c1 & 0xFF; block[3] = c1 >> 8;
+	for (int i = 0; i < 4; i++)
+		block[4 + i] = (packed >> (8 * i)) & 0xFF;
+}
+
+//encodes 16 values of a single channel, used for BC4, BC5 and the alpha of BC3
+static void encodeChannelBlock(const uint8_t* source, int stride, uint8_t* block) {
+	int minValue = 255, maxValue = 0;
+	for (int i = 0; i < 16; i++) {
+		minValue = std::min(minValue, (int)source[i * stride]);
+		maxValue = std::max(maxValue, (int)source[i * stride]);
+	}
+	block[0] = (uint8_t)maxValue;
+	block[1] = (uint8_t)minValue;
+
+	//with the first endpoint larger than the second there are six values in between them, which covers the range the best
+	uint64_t packed = 0;
+	if (maxValue > minValue) {
+		float palette[8];
+		palette[0] = (float)maxValue;
+		palette[1] = (float)minValue;
+		for (int p = 2; p < 8; p++)
+			palette[p] = ((8 - p) * maxValue + (p - 1) * minValue) / 7.0f;
+
+		for (int i = 0; i < 16; i++) {
+			float value = source[i * stride];
+			int index = 0;
+			float best = 1e30f;
+			for (int p = 0; p < 8; p++) {
+				float error = std::abs(value - palette[p]);
+				if (error < best) {
+					best = error;
+					index = p;
+				}
+			}
+			packed |= (uint64_t)index << (3 * i);
+		}
+	}
+	for (int i = 0; i < 6; i++)
+		block[2 + i] = (packed >> (8 * i)) & 0xFF;
+}
+
+void encodeBC1(const uint8_t* rgb, uint8_t* block) {
+	encodeColorBlock(rgb, 3, block);
+}
+
+void encodeBC3(const uint8_t* rgba, uint8_t* block) {
+	encodeChannelBlock(rgba + 3, 4, block);
+	encodeColorBlock(rgba, 4, block + 8);
+}
+
+void encodeBC4(const uint8_t* values, uint8_t* block) {
+	encodeChannelBlock(values, 1, block);
+}
+
+void encodeBC5(const uint8_t* rg, uint8_t* block) {
+	encodeChannelBlock(rg, 2, block);
+	encodeChannelBlock(rg + 1, 2, block + 8);
+}
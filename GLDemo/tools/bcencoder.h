@@ -0,0 +1,20 @@
+#ifndef BCENCODER_H
+#define BCENCODER_H
+
+#include <cstdint>
+
+/*
+CPU encoders for single 4x4 blocks of the BC formats in ctex.h. Every function takes the 16 pixels of a block in row order and writes
+one compressed block. They only depend on their inputs, so blocks can be encoded on as many threads as there are cores.
+*/
+
+//rgb: 16 * 3 bytes, writes 8 bytes
+void encodeBC1(const uint8_t* rgb, uint8_t* block);
+//rgba: 16 * 4 bytes, writes 16 bytes (BC4 style alpha block followed by a BC1 color block)
+void encodeBC3(const uint8_t* rgba, uint8_t* block);
+//values: 16 bytes of a single channel, writes 8 bytes
+void encodeBC4(const uint8_t* values, uint8_t* block);
+//rg: 16 * 2 bytes, writes 16 bytes (a BC4 block for each channel)
+void encodeBC5(const uint8_t* rg, uint8_t* block);
+
+#endif
@@ -0,0 +1,325 @@
+/*
+texconvert: converts the JPEG and PNG textures of the demo into block compressed .ctex files with a full mip chain (see ctex.h),
+which the texture streamer picks up instead of the source image when it finds one next to it.
+With --virtual the images are cut into .vtex page files instead (see vtex.h), which are loaded as virtual textures. That's meant for maps
+that are too large to be loaded as a single texture, f.e. 16k to 64k planet maps. The whole image is still decoded into memory here.
+
+Usage: texconvert [--force] [--virtual] [--threads n] <file or directory>...
+Directories are searched recursively. The format follows the same naming convention as the planet textures: _n files are normal maps
+(BC5), _s files specular maps (BC4) and everything else color maps (BC1, or BC3 when the image has transparency).
+Files whose output is newer than the source are skipped unless --force is given.
+
+Run it from the GLDemo directory as: texconvert ./bin/textures
+*/
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <ctex.h>
+#include <vtex.h>
+#include <threadpool.h>
+
+#include "bcencoder.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+enum TextureKind { KIND_COLOR, KIND_NORMAL, KIND_SPECULAR };
+
+//a mip level as RGBA pixels
+struct Level {
+	int width, height;
+	std::vector<uint8_t> pixels;
+};
+
+//runs body(0) to body(count - 1) on the pool and waits until all of them are done
+static void parallelFor(ThreadPool& pool, int count, const std::function<void(int)>& body) {
+	std::mutex mutex;
+	std::condition_variable condition;
+	int remaining = count;
+	for (int i = 0; i < count; i++) {
+		pool.submit([&, i]() {
+			body(i);
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--remaining == 0)
+				condition.notify_one();
+		});
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [&] { return remaining == 0; });
+}
+
+static TextureKind kindOf(const fs::path& path) {
+	std::string stem = path.stem().string();
+	if (stem.size() > 2 && stem.compare(stem.size() - 2, 2, "_n") == 0)
+		return KIND_NORMAL;
+	if (stem.size() > 2 && stem.compare(stem.size() - 2, 2, "_s") == 0)
+		return KIND_SPECULAR;
+	return KIND_COLOR;
+}
+
+//same tolerance as the flat check of the texture streamer
+static bool isFlat(const Level& level) {
+	const int tolerance = 3;
+	for (size_t i = 4; i < level.pixels.size(); i++) {
+		if (std::abs((int)level.pixels[i] - (int)level.pixels[i % 4]) > tolerance)
+			return false;
+	}
+	return true;
+}
+
+static bool hasAlpha(const Level& level) {
+	for (size_t i = 3; i < level.pixels.size(); i += 4) {
+		if (level.pixels[i] < 255)
+			return true;
+	}
+	return false;
+}
+
+/*
+Halves the size of a level with a box filter. Normals can't just be averaged like colors, as the average of two unit vectors is shorter
+than a unit vector, so normal maps are decoded, averaged and normalized again.
+*/
+static Level downsample(const Level& source, bool normals) {
+	Level level;
+	level.width = std::max(1, source.width / 2);
+	level.height = std::max(1, source.height / 2);
+	level.pixels.resize((size_t)level.width * level.height * 4);
+
+	for (int y = 0; y < level.height; y++) {
+		for (int x = 0; x < level.width; x++) {
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (int dy = 0; dy < 2; dy++) {
+				for (int dx = 0; dx < 2; dx++) {
+					int sx = std::min(x * 2 + dx, source.width - 1);
+					int sy = std::min(y * 2 + dy, source.height - 1);
+					const uint8_t* pixel = &source.pixels[((size_t)sy * source.width + sx) * 4];
+					for (int c = 0; c < 4; c++)
+						sum[c] += normals && c < 3 ? pixel[c] / 127.5f - 1.0f : pixel[c];
+				}
+			}
+
+			uint8_t* out = &level.pixels[((size_t)y * level.width + x) * 4];
+			if (normals) {
+				float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+				if (length < 1e-6f) {
+					sum[0] = sum[1] = 0.0f;
+					sum[2] = length = 1.0f;
+				}
+				for (int c = 0; c < 3; c++)
+					out[c] = (uint8_t)std::round((sum[c] / length * 0.5f + 0.5f) * 255.0f);
+				out[3] = (uint8_t)std::round(sum[3] / 4.0f);
+			} else {
+				for (int c = 0; c < 4; c++)
+					out[c] = (uint8_t)std::round(sum[c] / 4.0f);
+			}
+		}
+	}
+	return level;
+}
+
+//encodes the block at bx, by of a level, blocks that stick out of the image repeat the pixels at the edge
+static void encodeBlock(const Level& level, int bx, int by, CTexFormat format, unsigned char* block) {
+	uint8_t rgba[16 * 4], channels[16 * 4];
+	for (int i = 0; i < 16; i++) {
+		int x = std::min(bx * 4 + i % 4, level.width - 1);
+		int y = std::min(by * 4 + i / 4, level.height - 1);
+		memcpy(&rgba[i * 4], &level.pixels[((size_t)y * level.width + x) * 4], 4);
+	}
+
+	switch (format) {
+	case CTEX_BC1:
+		for (int i = 0; i < 16; i++)
+			memcpy(&channels[i * 3], &rgba[i * 4], 3);
+		encodeBC1(channels, block);
+		break;
+	case CTEX_BC3:
+		encodeBC3(rgba, block);
+		break;
+	case CTEX_BC4:
+		//the luminance, so specular maps that aren't gray keep their brightness
+		for (int i = 0; i < 16; i++)
+			channels[i] = (uint8_t)std::round(rgba[i * 4] * 0.2126f + rgba[i * 4 + 1] * 0.7152f + rgba[i * 4 + 2] * 0.0722f);
+		encodeBC4(channels, block);
+		break;
+	case CTEX_BC5:
+		for (int i = 0; i < 16; i++) {
+			channels[i * 2] = rgba[i * 4];
+			channels[i * 2 + 1] = rgba[i * 4 + 1];
+		}
+		encodeBC5(channels, block);
+		break;
+	}
+}
+
+//encodes every block of a level, one row of blocks per job
+static void encodeLevel(ThreadPool& pool, const Level& level, CTexFormat format, unsigned char* output) {
+	int blocksX = (level.width + 3) / 4;
+	int blocksY = (level.height + 3) / 4;
+	size_t blockSize = ctexBlockSize(format);
+
+	parallelFor(pool, blocksY, [&](int by) {
+		for (int bx = 0; bx < blocksX; bx++)
+			encodeBlock(level, bx, by, format, output + ((size_t)by * blocksX + bx) * blockSize);
+	});
+}
+
+/*
+Cuts a level into the pages of a page file and encodes them, one row of pages per job. Planet maps wrap around horizontally, so the borders
+at the left and right edge of the map are taken from the other side, while the borders at the top and bottom repeat the edge.
+*/
+static void encodePages(ThreadPool& pool, const Level& level, const VTexLevel& info, CTexFormat format, size_t pageSize, unsigned char* output) {
+	const int blocks = VTEX_PAGE_SIZE / 4;
+	size_t blockSize = ctexBlockSize(format);
+
+	parallelFor(pool, info.pagesY, [&](int py) {
+		Level page;
+		page.width = page.height = VTEX_PAGE_SIZE;
+		page.pixels.resize((size_t)VTEX_PAGE_SIZE * VTEX_PAGE_SIZE * 4);
+
+		for (int px = 0; px < info.pagesX; px++) {
+			for (int y = 0; y < VTEX_PAGE_SIZE; y++) {
+				int sy = std::min(std::max(py * VTEX_PAGE_CONTENT - VTEX_PAGE_BORDER + y, 0), level.height - 1);
+				for (int x = 0; x < VTEX_PAGE_SIZE; x++) {
+					int sx = ((px * VTEX_PAGE_CONTENT - VTEX_PAGE_BORDER + x) % level.width + level.width) % level.width;
+					memcpy(&page.pixels[((size_t)y * VTEX_PAGE_SIZE + x) * 4], &level.pixels[((size_t)sy * level.width + sx) * 4], 4);
+				}
+			}
+
+			unsigned char* pageOutput = output + ((size_t)py * info.pagesX + px) * pageSize;
+			for (int by = 0; by < blocks; by++) {
+				for (int bx = 0; bx < blocks; bx++)
+					encodeBlock(page, bx, by, format, pageOutput + ((size_t)by * blocks + bx) * blockSize);
+			}
+		}
+	});
+}
+
+//writes the page file of an image, level by level so only a single level of pages has to be kept in memory
+static bool convertVirtual(ThreadPool& pool, Level level, TextureKind kind, CTexFormat format, const fs::path& output) {
+	PageFile file;
+	file.format = format;
+	file.width = level.width;
+	file.height = level.height;
+	vtexLayout(file);
+
+	std::ofstream stream(output.string(), std::ios::binary | std::ios::trunc);
+	if (!stream || !writePageFileHeader(stream, file)) {
+		std::cout << "Couldn't write page file: " << output.string() << std::endl;
+		return false;
+	}
+
+	std::vector<unsigned char> pages;
+	for (size_t i = 0; i < file.levels.size(); i++) {
+		if (i > 0)
+			level = downsample(level, kind == KIND_NORMAL);
+		const VTexLevel& info = file.levels[i];
+		pages.resize((size_t)info.pagesX * info.pagesY * file.pageSize);
+		encodePages(pool, level, info, format, file.pageSize, pages.data());
+		stream.write(reinterpret_cast<const char*>(pages.data()), pages.size());
+	}
+	return (bool)stream;
+}
+
+static bool convert(ThreadPool& pool, const fs::path& input, const fs::path& output, bool virtualTexture) {
+	Level level;
+	int components;
+	unsigned char* data = stbi_load(input.string().c_str(), &level.width, &level.height, &components, 4);
+	if (!data) {
+		std::cout << "Failed to load " << input.string() << ": " << stbi_failure_reason() << std::endl;
+		return false;
+	}
+	level.pixels.assign(data, data + (size_t)level.width * level.height * 4);
+	stbi_image_free(data);
+
+	TextureKind kind = kindOf(input);
+	CTexFormat format;
+	if (kind == KIND_NORMAL)
+		format = CTEX_BC5;
+	else if (kind == KIND_SPECULAR)
+		format = CTEX_BC4;
+	else
+		format = hasAlpha(level) ? CTEX_BC3 : CTEX_BC1;
+	if (virtualTexture)
+		return convertVirtual(pool, std::move(level), kind, format, output);
+
+	CompressedImage image;
+	image.format = format;
+	image.width = level.width;
+	image.height = level.height;
+	image.flags = isFlat(level) ? CTEX_FLAT : 0;
+
+	//the whole mip chain down to 1x1 is stored, so the texture never needs glGenerateMipmap
+	for (;;) {
+		CTexLevel entry = { level.width, level.height, image.data.size(), ctexLevelSize(image.format, level.width, level.height) };
+		image.data.resize(entry.offset + entry.size);
+		encodeLevel(pool, level, image.format, image.data.data() + entry.offset);
+		image.levels.push_back(entry);
+
+		if (level.width == 1 && level.height == 1)
+			break;
+		level = downsample(level, kind == KIND_NORMAL);
+	}
+	return writeCompressedImage(output.string(), image);
+}
+
+int main(int argc, char* argv[]) {
+	bool force = false;
+	bool virtualTexture = false;
+	unsigned int threads = 0;
+	std::vector<fs::path> inputs;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--force") {
+			force = true;
+		} else if (arg == "--virtual") {
+			virtualTexture = true;
+		} else if (arg == "--threads" && i + 1 < argc) {
+			threads = (unsigned int)std::stoi(argv[++i]);
+		} else if (fs::is_directory(arg)) {
+			for (const auto& item : fs::recursive_directory_iterator(arg)) {
+				std::string extension = item.path().extension().string();
+				if (item.is_regular_file() && (extension == ".jpg" || extension == ".jpeg" || extension == ".png"))
+					inputs.push_back(item.path());
+			}
+		} else if (fs::is_regular_file(arg)) {
+			inputs.push_back(arg);
+		} else {
+			std::cout << "Not a file or directory: " << arg << std::endl;
+		}
+	}
+	if (inputs.empty()) {
+		std::cout << "Usage: texconvert [--force] [--virtual] [--threads n] <file or directory>..." << std::endl;
+		return 1;
+	}
+
+	ThreadPool pool(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads);
+	int failed = 0;
+	for (const fs::path& input : inputs) {
+		fs::path output = fs::path(input).replace_extension(virtualTexture ? ".vtex" : ".ctex");
+		if (!force && fs::exists(output) && fs::last_write_time(output) >= fs::last_write_time(input))
+			continue;
+
+		auto start = std::chrono::steady_clock::now();
+		if (convert(pool, input, output, virtualTexture)) {
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+			std::cout << input.string() << " -> " << output.string() << " (" << fs::file_size(input) / 1024 << " KB -> "
+				<< fs::file_size(output) / 1024 << " KB, " << ms << " ms)" << std::endl;
+		} else {
+			failed++;
+		}
+	}
+	return failed > 0 ? 1 : 0;
+}